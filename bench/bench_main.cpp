@@ -0,0 +1,446 @@
+/*
+  Benchmark gob_stdmap containers against the standard containers
+
+  Usage: gob_stdmap_bench [--max-size N] [--min-size N] [--format csv|json] [--filter substr] [--repeat N] [--ops N]
+  Each result line has container, key type, size, operation, nanoseconds per operation and bytes.
+  Sizes go from --min-size (16) to --max-size (10000000) in x16 steps.
+  --ops is the number of operations timed per measurement for small sizes.
+  "memory" rows report the heap bytes held by a container of the size (ns is 0).
+*/
+#include <gob_stdmap.hpp>
+#include <map>
+#include <unordered_map>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#if defined(GOB_STDMAP_BENCH_BOOST)
+#include <boost/container/flat_map.hpp>
+#endif
+
+// ---------------------------------------------------------------------------
+// Heap accounting: every global allocation carries a header with its size
+namespace {
+std::int64_t live_bytes{};
+// Stored just before the returned pointer
+struct block_info
+{
+    void* raw;
+    std::size_t size;
+};
+
+// nullptr if out of memory
+void* counted_alloc(std::size_t sz, std::size_t align = alignof(std::max_align_t)) noexcept
+{
+    auto raw = static_cast<unsigned char*>(std::malloc(sz + align + sizeof(block_info)));
+    if(!raw) { return nullptr; }
+    auto v = reinterpret_cast<std::uintptr_t>(raw + sizeof(block_info));
+    auto p = reinterpret_cast<unsigned char*>((v + align - 1) & ~std::uintptr_t(align - 1));
+    const block_info info{ raw, sz };
+    std::memcpy(p - sizeof(info), &info, sizeof(info));
+    live_bytes += static_cast<std::int64_t>(sz);
+    return p;
+}
+void* counted_new(std::size_t sz, std::size_t align = alignof(std::max_align_t))
+{
+    auto p = counted_alloc(sz, align);
+    if(!p) { throw std::bad_alloc(); }
+    return p;
+}
+void counted_free(void* ptr) noexcept
+{
+    if(!ptr) { return; }
+    block_info info;
+    std::memcpy(&info, static_cast<unsigned char*>(ptr) - sizeof(info), sizeof(info));
+    live_bytes -= static_cast<std::int64_t>(info.size);
+    std::free(info.raw);
+}
+}  // namespace
+
+// Over-aligned overloads too (cache line aligned nodes), and the nothrow ones (std::stable_sort's buffer)
+// so that no allocation bypasses the header
+void* operator new(std::size_t sz) { return counted_new(sz); }
+void* operator new[](std::size_t sz) { return counted_new(sz); }
+void* operator new(std::size_t sz, std::align_val_t al) { return counted_new(sz, static_cast<std::size_t>(al)); }
+void* operator new[](std::size_t sz, std::align_val_t al) { return counted_new(sz, static_cast<std::size_t>(al)); }
+void* operator new(std::size_t sz, const std::nothrow_t&) noexcept { return counted_alloc(sz); }
+void* operator new[](std::size_t sz, const std::nothrow_t&) noexcept { return counted_alloc(sz); }
+void* operator new(std::size_t sz, std::align_val_t al, const std::nothrow_t&) noexcept
+{
+    return counted_alloc(sz, static_cast<std::size_t>(al));
+}
+void* operator new[](std::size_t sz, std::align_val_t al, const std::nothrow_t&) noexcept
+{
+    return counted_alloc(sz, static_cast<std::size_t>(al));
+}
+void operator delete(void* p) noexcept { counted_free(p); }
+void operator delete[](void* p) noexcept { counted_free(p); }
+void operator delete(void* p, std::size_t) noexcept { counted_free(p); }
+void operator delete[](void* p, std::size_t) noexcept { counted_free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { counted_free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { counted_free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { counted_free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { counted_free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { counted_free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { counted_free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { counted_free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { counted_free(p); }
+
+// ---------------------------------------------------------------------------
+namespace {
+
+struct options
+{
+    std::size_t min_size{ 16 };
+    std::size_t max_size{ 10000000 };
+    bool json{};
+    std::string filter{};
+    unsigned repeat{ 3 };
+    std::size_t ops{ 1000000 };
+};
+options opt;
+
+// Keep results alive
+volatile std::uint64_t sink;
+
+using clock_type = std::chrono::steady_clock;
+
+void report(const char* container, const char* key, std::size_t size, const char* op, double ns, std::int64_t bytes)
+{
+    if(opt.json)
+    {
+        std::printf("{\"container\":\"%s\",\"key\":\"%s\",\"size\":%zu,\"op\":\"%s\",\"ns_per_op\":%.3f,\"bytes\":%lld}\n", container,
+                    key, size, op, ns, static_cast<long long>(bytes));
+    }
+    else { std::printf("%s,%s,%zu,%s,%.3f,%lld\n", container, key, size, op, ns, static_cast<long long>(bytes)); }
+    std::fflush(stdout);
+}
+
+// Best of repeat runs, in nanoseconds per operation
+template <class F>
+double measure(std::size_t ops, F&& f)
+{
+    double best = 1e300;
+    for(unsigned r = 0; r < opt.repeat; ++r)
+    {
+        auto s = clock_type::now();
+        f();
+        auto e = clock_type::now();
+        best = std::min(best, std::chrono::duration<double, std::nano>(e - s).count() / static_cast<double>(ops));
+    }
+    return best;
+}
+
+// ---------------------------------------------------------------------------
+// Keys
+template <class K> struct key_traits;
+template <> struct key_traits<std::uint32_t>
+{
+    static const char* name() { return "u32"; }
+    static std::uint64_t raw(std::uint64_t r) { return r & 0xFFFFFFFFU; }
+    static std::uint32_t make(std::uint64_t r) { return static_cast<std::uint32_t>(r); }
+};
+template <> struct key_traits<std::uint64_t>
+{
+    static const char* name() { return "u64"; }
+    static std::uint64_t raw(std::uint64_t r) { return r; }
+    static std::uint64_t make(std::uint64_t r) { return r; }
+};
+template <> struct key_traits<std::string>
+{
+    static const char* name() { return "string"; }
+    static std::uint64_t raw(std::uint64_t r) { return r; }
+    // Longer than SSO
+    static std::string make(std::uint64_t r)
+    {
+        char buf[40];
+        std::snprintf(buf, sizeof(buf), "key/%016llx/x", static_cast<unsigned long long>(r));
+        return buf;
+    }
+};
+
+// First n present keys in random order, then n absent keys
+template <class K>
+std::vector<K> make_keys(std::size_t n)
+{
+    std::mt19937_64 rng(n * 2654435761ULL);
+    std::vector<std::uint64_t> raw;
+    raw.reserve(n * 2);
+    while(raw.size() < n * 2)
+    {
+        auto need = n * 2 - raw.size();
+        for(std::size_t i = 0; i < need; ++i) { raw.push_back(key_traits<K>::raw(rng())); }
+        std::sort(raw.begin(), raw.end());
+        raw.erase(std::unique(raw.begin(), raw.end()), raw.end());
+    }
+    std::shuffle(raw.begin(), raw.end(), rng);
+    std::vector<K> keys;
+    keys.reserve(n * 2);
+    for(auto r : raw) { keys.push_back(key_traits<K>::make(r)); }
+    return keys;
+}
+
+// ---------------------------------------------------------------------------
+// Containers
+template <class M> struct container_traits
+{
+    static constexpr bool mutable_keys = true;
+    // One by one insertion is O(N) for sorted vectors; skip huge sizes
+    static constexpr std::size_t max_insert = ~std::size_t(0);
+};
+template <class K, class T> struct container_traits<goblib::flat_map<K, T>>
+{
+    static constexpr bool mutable_keys = true;
+    static constexpr std::size_t max_insert = 200000;
+};
+template <class K, class T> struct container_traits<goblib::soa_flat_map<K, T>>
+{
+    static constexpr bool mutable_keys = true;
+    static constexpr std::size_t max_insert = 200000;
+};
+template <class K, class T> struct container_traits<goblib::frozen_map<K, T>>
+{
+    static constexpr bool mutable_keys = false;
+    static constexpr std::size_t max_insert = 0;
+};
+template <class K, class T> struct container_traits<goblib::perfect_hash_map<K, T>>
+{
+    static constexpr bool mutable_keys = false;
+    static constexpr std::size_t max_insert = 0;
+};
+template <class T> struct container_traits<goblib::string_flat_map<T>>
+{
+    static constexpr bool mutable_keys = true;
+    static constexpr std::size_t max_insert = 200000;
+};
+#if defined(GOB_STDMAP_BENCH_BOOST)
+template <class K, class T> struct container_traits<boost::container::flat_map<K, T>>
+{
+    static constexpr bool mutable_keys = true;
+    static constexpr std::size_t max_insert = 200000;
+};
+#endif
+
+// Containers resolving a sorted batch of keys in one pass
+template <class M, class = void> struct has_find_sorted : std::false_type {};
+template <class M>
+struct has_find_sorted<M, std::void_t<decltype(std::declval<const M&>().find_sorted(
+                              std::declval<const typename M::key_type*>(), std::declval<const typename M::key_type*>(),
+                              std::declval<typename M::const_iterator*>()))>> : std::true_type {};
+
+template <class M, class K>
+M build(const std::vector<K>& keys, std::size_t n)
+{
+    std::vector<std::pair<K, std::uint64_t>> src;
+    src.reserve(n);
+    for(std::size_t i = 0; i < n; ++i) { src.emplace_back(keys[i], i); }
+    return M(src.begin(), src.end());
+}
+
+template <class M, class K>
+void run(const char* name, std::size_t n, const std::vector<K>& keys)
+{
+    using traits = container_traits<M>;
+    const char* kname = key_traits<K>::name();
+    // Enough operations to get a stable time for small maps
+    const std::size_t lookups = std::max<std::size_t>(n, opt.ops);
+
+    // memory
+    {
+        auto before = live_bytes;
+        M m = build<M>(keys, n);
+        report(name, kname, n, "memory", 0.0, live_bytes - before);
+        sink = m.size();
+    }
+    // bulk build from unsorted range
+    {
+        const std::size_t reps = std::max<std::size_t>(1, opt.ops / n);
+        auto ns = measure(n * reps, [&] {
+            for(std::size_t r = 0; r < reps; ++r)
+            {
+                M m = build<M>(keys, n);
+                sink = m.size();
+            }
+        });
+        report(name, kname, n, "build", ns, 0);
+    }
+    // insert one by one in random order
+    if constexpr(traits::mutable_keys)
+    {
+        if(n <= traits::max_insert)
+        {
+            const std::size_t reps = std::max<std::size_t>(1, opt.ops / n);
+            auto ns = measure(n * reps, [&] {
+                for(std::size_t r = 0; r < reps; ++r)
+                {
+                    M m;
+                    for(std::size_t i = 0; i < n; ++i) { m.emplace(keys[i], i); }
+                    sink = m.size();
+                }
+            });
+            report(name, kname, n, "insert", ns, 0);
+        }
+    }
+    // slowest single insertion in random order (growth spikes)
+    if constexpr(traits::mutable_keys)
+    {
+        if(n <= traits::max_insert)
+        {
+            double worst{};
+            M m;
+            for(std::size_t i = 0; i < n; ++i)
+            {
+                auto s = clock_type::now();
+                m.emplace(keys[i], i);
+                auto e = clock_type::now();
+                worst = std::max(worst, std::chrono::duration<double, std::nano>(e - s).count());
+            }
+            sink = m.size();
+            report(name, kname, n, "insert_max", worst, 0);
+        }
+    }
+
+    M m = build<M>(keys, n);
+    // find hit / miss
+    {
+        auto ns = measure(lookups, [&] {
+            std::uint64_t s{};
+            for(std::size_t i = 0, j = 0; i < lookups; ++i, j = (j + 1 == n ? 0 : j + 1)) { s += m.find(keys[j]) != m.end(); }
+            sink = s;
+        });
+        report(name, kname, n, "find_hit", ns, 0);
+        ns = measure(lookups, [&] {
+            std::uint64_t s{};
+            for(std::size_t i = 0, j = 0; i < lookups; ++i, j = (j + 1 == n ? 0 : j + 1)) { s += m.find(keys[n + j]) != m.end(); }
+            sink = s;
+        });
+        report(name, kname, n, "find_miss", ns, 0);
+    }
+    // find a sorted batch of 1/16 of the keys (find_sorted if available, otherwise find one by one)
+    {
+        std::vector<K> batch(keys.begin(), keys.begin() + static_cast<std::ptrdiff_t>(std::max<std::size_t>(1, n / 16)));
+        std::sort(batch.begin(), batch.end());
+        std::vector<typename M::const_iterator> found(batch.size());
+        const M& cm = m;
+        const std::size_t reps = std::max<std::size_t>(1, lookups / batch.size());
+        auto ns = measure(batch.size() * reps, [&] {
+            std::uint64_t s{};
+            for(std::size_t r = 0; r < reps; ++r)
+            {
+                if constexpr(has_find_sorted<M>::value) { cm.find_sorted(batch.data(), batch.data() + batch.size(), found.data()); }
+                else
+                {
+                    for(std::size_t i = 0; i < batch.size(); ++i) { found[i] = cm.find(batch[i]); }
+                }
+                s += found.back() != cm.end();
+            }
+            sink = s;
+        });
+        report(name, kname, n, "find_sorted", ns, 0);
+    }
+    // iterate
+    {
+        const std::size_t reps = std::max<std::size_t>(1, lookups / n);
+        auto ns = measure(n * reps, [&] {
+            std::uint64_t s{};
+            for(std::size_t r = 0; r < reps; ++r)
+            {
+                for(auto&& e : m) { s += e.second; }
+            }
+            sink = s;
+        });
+        report(name, kname, n, "iterate", ns, 0);
+    }
+    // erase every element in random order
+    if constexpr(traits::mutable_keys)
+    {
+        if(n <= traits::max_insert)
+        {
+            double best = 1e300;
+            for(unsigned r = 0; r < opt.repeat; ++r)
+            {
+                M c = m;
+                auto s = clock_type::now();
+                for(std::size_t i = 0; i < n; ++i) { c.erase(keys[i]); }
+                auto e = clock_type::now();
+                sink = c.size();
+                best = std::min(best, std::chrono::duration<double, std::nano>(e - s).count() / static_cast<double>(n));
+            }
+            report(name, kname, n, "erase", best, 0);
+        }
+    }
+}
+
+bool selected(const char* name) { return opt.filter.empty() || std::strstr(name, opt.filter.c_str()); }
+
+template <class K>
+void run_key(std::size_t n)
+{
+    auto keys = make_keys<K>(n);
+    using V = std::uint64_t;
+    if(selected("std::map")) { run<std::map<K, V>>("std::map", n, keys); }
+    if(selected("std::unordered_map")) { run<std::unordered_map<K, V>>("std::unordered_map", n, keys); }
+#if defined(GOB_STDMAP_BENCH_BOOST)
+    if(selected("boost::flat_map")) { run<boost::container::flat_map<K, V>>("boost::flat_map", n, keys); }
+#endif
+    if(selected("goblib::flat_map")) { run<goblib::flat_map<K, V>>("goblib::flat_map", n, keys); }
+    if(selected("goblib::soa_flat_map")) { run<goblib::soa_flat_map<K, V>>("goblib::soa_flat_map", n, keys); }
+    if(selected("goblib::buffered_flat_map")) { run<goblib::buffered_flat_map<K, V>>("goblib::buffered_flat_map", n, keys); }
+    if(selected("goblib::btree_map")) { run<goblib::btree_map<K, V>>("goblib::btree_map", n, keys); }
+    if(selected("goblib::art_map")) { run<goblib::art_map<K, V>>("goblib::art_map", n, keys); }
+    if constexpr(std::is_same<K, std::string>::value)
+    {
+        if(selected("goblib::string_flat_map")) { run<goblib::string_flat_map<V>>("goblib::string_flat_map", n, keys); }
+    }
+    if(selected("goblib::frozen_map")) { run<goblib::frozen_map<K, V>>("goblib::frozen_map", n, keys); }
+    if(selected("goblib::perfect_hash_map")) { run<goblib::perfect_hash_map<K, V>>("goblib::perfect_hash_map", n, keys); }
+    if(selected("goblib::hash_map")) { run<goblib::hash_map<K, V>>("goblib::hash_map", n, keys); }
+    if(selected("goblib::incremental_hash_map")) { run<goblib::incremental_hash_map<K, V>>("goblib::incremental_hash_map", n, keys); }
+}
+
+bool parse(int argc, char** argv)
+{
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+        bool has_value = i + 1 < argc;
+        if(a == "--max-size" && has_value) { opt.max_size = std::strtoull(argv[++i], nullptr, 10); }
+        else if(a == "--min-size" && has_value) { opt.min_size = std::strtoull(argv[++i], nullptr, 10); }
+        else if(a == "--format" && has_value) { opt.json = std::strcmp(argv[++i], "json") == 0; }
+        else if(a == "--filter" && has_value) { opt.filter = argv[++i]; }
+        else if(a == "--ops" && has_value) { opt.ops = std::strtoull(argv[++i], nullptr, 10); }
+        else if(a == "--repeat" && has_value) { opt.repeat = std::max(1U, static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10))); }
+        else
+        {
+            std::fprintf(stderr, "Usage: %s [--max-size N] [--min-size N] [--format csv|json] [--filter substr] [--repeat N] [--ops N]\n", argv[0]);
+            return false;
+        }
+    }
+    return opt.min_size > 0 && opt.min_size <= opt.max_size;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    if(!parse(argc, argv)) { return 1; }
+    if(!opt.json) { std::printf("container,key,size,op,ns_per_op,bytes\n"); }
+    // min_size, x16 steps, and max_size itself
+    std::vector<std::size_t> sizes;
+    for(std::size_t n = opt.min_size; n <= opt.max_size; n *= 16) { sizes.push_back(n); }
+    if(sizes.back() != opt.max_size) { sizes.push_back(opt.max_size); }
+    for(auto n : sizes)
+    {
+        run_key<std::uint32_t>(n);
+        run_key<std::uint64_t>(n);
+        run_key<std::string>(n);
+    }
+    return 0;
+}
@@ -0,0 +1,336 @@
+/*!
+  @file gob_allocator.hpp
+  @brief Bump arena and fixed block pool allocators for gob_stdmap containers
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_ALLOCATOR_HPP
+#define GOB_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <algorithm>
+#include <limits>
+#include "internal/gob_stdmap_detail.hpp"
+
+namespace goblib {
+
+namespace stdmap_detail {
+// Global heap allocation honoring over-alignment
+inline void* allocate_bytes(std::size_t bytes, std::size_t align)
+{
+    if(align > __STDCPP_DEFAULT_NEW_ALIGNMENT__) { return ::operator new(bytes, std::align_val_t(align)); }
+    return ::operator new(bytes);
+}
+inline void deallocate_bytes(void* p, std::size_t align) noexcept
+{
+    if(align > __STDCPP_DEFAULT_NEW_ALIGNMENT__) { ::operator delete(p, std::align_val_t(align)); }
+    else { ::operator delete(p); }
+}
+}  // namespace stdmap_detail
+
+/*!
+  @class arena
+  @brief Bump pointer memory arena
+  @details Allocation advances a pointer in the current block. Deallocation does nothing,
+  and all memory is given back at once by release() or the destructor.
+  Suitable for short-lived containers (request scope etc.).
+  Optionally starts from a user supplied buffer (stack or static memory).
+  @note Not thread-safe. A growing vector leaves its old buffers in the arena until release(), so reserve() in advance.
+ */
+class arena
+{
+  public:
+    static constexpr std::size_t default_block_size = 4096;
+
+    ///@name Constructor
+    ///@{
+    //! @param block_size Size of heap blocks obtained when the current block is exhausted
+    explicit arena(std::size_t block_size = default_block_size) : _block_size(std::max<std::size_t>(block_size, 64)) {}
+    //! @brief Start from the buffer. Heap blocks are used after it is exhausted
+    arena(void* buffer, std::size_t size, std::size_t block_size = default_block_size)
+            : _cur(static_cast<unsigned char*>(buffer)), _end(static_cast<unsigned char*>(buffer) + size),
+              _block_size(std::max<std::size_t>(block_size, 64)), _buffer(buffer), _buffer_size(size) {}
+    arena(const arena&) = delete;
+    arena& operator=(const arena&) = delete;
+    ~arena() { release(); }
+    ///@}
+
+    /*!
+      @brief Allocate memory
+      @param bytes Size
+      @param align Alignment (power of 2)
+     */
+    void* allocate(std::size_t bytes, std::size_t align = alignof(std::max_align_t))
+    {
+        // A new block needs room for the header and the alignment too
+        if(bytes > std::numeric_limits<std::size_t>::max() - align - sizeof(block_header)) { stdmap_detail::throw_bad_array_new_length(); }
+        auto p = align_up(_cur, align);
+        if(!p || p > _end || static_cast<std::size_t>(_end - p) < bytes)
+        {
+            add_block(bytes + align);
+            p = align_up(_cur, align);
+        }
+        _cur = p + bytes;
+        _used += bytes;
+        return p;
+    }
+    //! @brief Do nothing (memory is given back by release())
+    void deallocate(void*, std::size_t) noexcept {}
+
+    //! @brief Give back all memory. Every pointer obtained from this arena becomes invalid
+    void release() noexcept
+    {
+        while(_head)
+        {
+            auto next = _head->next;
+            ::operator delete(static_cast<void*>(_head));
+            _head = next;
+        }
+        _cur = static_cast<unsigned char*>(_buffer);
+        _end = _cur ? _cur + _buffer_size : nullptr;
+        _used = 0;
+    }
+
+    //! @brief Total bytes handed out since the last release()
+    std::size_t used() const noexcept { return _used; }
+
+    friend bool operator==(const arena& a, const arena& b) noexcept { return &a == &b; }
+    friend bool operator!=(const arena& a, const arena& b) noexcept { return &a != &b; }
+
+  private:
+    struct block_header
+    {
+        block_header* next;
+    };
+
+    static unsigned char* align_up(unsigned char* p, std::size_t align)
+    {
+        if(!p) { return nullptr; }
+        auto v = reinterpret_cast<std::uintptr_t>(p);
+        return p + ((align - (v & (align - 1))) & (align - 1));
+    }
+
+    void add_block(std::size_t min_bytes)
+    {
+        auto sz = std::max(_block_size, min_bytes + sizeof(block_header));
+        auto h = static_cast<block_header*>(::operator new(sz));
+        h->next = _head;
+        _head = h;
+        _cur = reinterpret_cast<unsigned char*>(h) + sizeof(block_header);
+        _end = reinterpret_cast<unsigned char*>(h) + sz;
+    }
+
+    block_header* _head{};
+    unsigned char* _cur{};
+    unsigned char* _end{};
+    std::size_t _block_size{};
+    void* _buffer{};
+    std::size_t _buffer_size{};
+    std::size_t _used{};
+};
+
+/*!
+  @class arena_allocator
+  @brief Standard allocator which allocates from goblib::arena
+  @code{.cpp}
+  goblib::arena ar;
+  using alloc_t = goblib::arena_allocator<std::pair<int, int>>;
+  goblib::flat_map<int, int, std::less<int>, alloc_t> m{ alloc_t(ar) };
+  @endcode
+ */
+template <class T>
+class arena_allocator
+{
+  public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    explicit arena_allocator(arena& ar) noexcept : _arena(&ar) {}
+    template <class U>
+    arena_allocator(const arena_allocator<U>& o) noexcept : _arena(o._arena) {}
+
+    //! @throw std::bad_array_new_length if n > max_size()
+    T* allocate(std::size_t n)
+    {
+        if(n > max_size()) { stdmap_detail::throw_bad_array_new_length(); }
+        return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* p, std::size_t n) noexcept { _arena->deallocate(p, n * sizeof(T)); }
+    std::size_t max_size() const noexcept { return std::numeric_limits<std::size_t>::max() / sizeof(T); }
+
+    //! @brief The arena allocating from
+    arena& resource() const noexcept { return *_arena; }
+
+    template <class U>
+    friend bool operator==(const arena_allocator& a, const arena_allocator<U>& b) noexcept { return a._arena == b._arena; }
+    template <class U>
+    friend bool operator!=(const arena_allocator& a, const arena_allocator<U>& b) noexcept { return a._arena != b._arena; }
+
+  private:
+    template <class U> friend class arena_allocator;
+    arena* _arena;
+};
+
+/*!
+  @class pool
+  @brief Fixed size block memory pool
+  @details Blocks are carved out of chunks obtained from the global heap and recycled through a free list,
+  so node based containers reuse freed slots without going to the global heap.
+  All chunks are given back by release() or the destructor.
+  @note Not thread-safe.
+ */
+class pool
+{
+  public:
+    static constexpr std::size_t default_blocks_per_chunk = 64;
+
+    ///@name Constructor
+    ///@{
+    /*!
+      @param block_size Size of a block
+      @param blocks_per_chunk Number of blocks obtained from the heap at once
+      @param align Alignment of blocks (power of 2)
+     */
+    explicit pool(std::size_t block_size, std::size_t blocks_per_chunk = default_blocks_per_chunk,
+                  std::size_t align = alignof(std::max_align_t))
+            : _align(std::max(align, alignof(free_node))),
+              _block_size(round_up(std::max(block_size, sizeof(free_node)), _align)),
+              _blocks_per_chunk(std::max<std::size_t>(blocks_per_chunk, 1)) {}
+    pool(const pool&) = delete;
+    pool& operator=(const pool&) = delete;
+    ~pool() { release(); }
+    ///@}
+
+    //! @brief Allocate a block
+    void* allocate()
+    {
+        if(!_free) { add_chunk(); }
+        auto p = _free;
+        _free = p->next;
+        ++_in_use;
+        return p;
+    }
+    //! @brief Return the block to the pool
+    void deallocate(void* p) noexcept
+    {
+        auto n = static_cast<free_node*>(p);
+        n->next = _free;
+        _free = n;
+        --_in_use;
+    }
+
+    //! @brief Give back all chunks. Every block obtained from this pool becomes invalid
+    void release() noexcept
+    {
+        while(_chunks)
+        {
+            auto next = _chunks->next;
+            stdmap_detail::deallocate_bytes(_chunks, _align);
+            _chunks = next;
+        }
+        _free = nullptr;
+        _in_use = 0;
+    }
+
+    std::size_t block_size() const noexcept { return _block_size; }
+    std::size_t alignment() const noexcept { return _align; }
+    //! @brief Number of blocks currently allocated
+    std::size_t in_use() const noexcept { return _in_use; }
+
+    friend bool operator==(const pool& a, const pool& b) noexcept { return &a == &b; }
+    friend bool operator!=(const pool& a, const pool& b) noexcept { return &a != &b; }
+
+  private:
+    struct free_node
+    {
+        free_node* next;
+    };
+
+    static std::size_t round_up(std::size_t v, std::size_t align) { return (v + align - 1) & ~(align - 1); }
+
+    void add_chunk()
+    {
+        // The first block of a chunk links the chunks
+        auto header = round_up(sizeof(free_node), _align);
+        auto bytes = header + _block_size * _blocks_per_chunk;
+        auto c = static_cast<free_node*>(stdmap_detail::allocate_bytes(bytes, _align));
+        c->next = _chunks;
+        _chunks = c;
+        auto base = reinterpret_cast<unsigned char*>(c) + header;
+        for(std::size_t i = _blocks_per_chunk; i-- > 0;)
+        {
+            auto n = reinterpret_cast<free_node*>(base + i * _block_size);
+            n->next = _free;
+            _free = n;
+        }
+    }
+
+    std::size_t _align{};
+    std::size_t _block_size{};
+    std::size_t _blocks_per_chunk{};
+    free_node* _free{};
+    free_node* _chunks{};
+    std::size_t _in_use{};
+};
+
+/*!
+  @class pool_allocator
+  @brief Standard allocator which allocates single objects from goblib::pool
+  @details Requests for one object that fits in a block are served by the pool.
+  Others (arrays, larger or over-aligned types) go to the global heap.
+  @code{.cpp}
+  goblib::pool pl(64);
+  using alloc_t = goblib::pool_allocator<std::pair<const int, int>>;
+  std::map<int, int, std::less<int>, alloc_t> m{ alloc_t(pl) };
+  @endcode
+ */
+template <class T>
+class pool_allocator
+{
+  public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    explicit pool_allocator(pool& pl) noexcept : _pool(&pl) {}
+    template <class U>
+    pool_allocator(const pool_allocator<U>& o) noexcept : _pool(o._pool) {}
+
+    //! @throw std::bad_array_new_length if n > max_size()
+    T* allocate(std::size_t n)
+    {
+        if(n > max_size()) { stdmap_detail::throw_bad_array_new_length(); }
+        return static_cast<T*>(from_pool(n) ? _pool->allocate() : stdmap_detail::allocate_bytes(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        if(from_pool(n)) { _pool->deallocate(p); }
+        else { stdmap_detail::deallocate_bytes(p, alignof(T)); }
+    }
+    std::size_t max_size() const noexcept { return std::numeric_limits<std::size_t>::max() / sizeof(T); }
+
+    //! @brief The pool allocating from
+    pool& resource() const noexcept { return *_pool; }
+
+    template <class U>
+    friend bool operator==(const pool_allocator& a, const pool_allocator<U>& b) noexcept { return a._pool == b._pool; }
+    template <class U>
+    friend bool operator!=(const pool_allocator& a, const pool_allocator<U>& b) noexcept { return a._pool != b._pool; }
+
+  private:
+    template <class U> friend class pool_allocator;
+    bool from_pool(std::size_t n) const noexcept
+    {
+        return n == 1 && sizeof(T) <= _pool->block_size() && alignof(T) <= _pool->alignment();
+    }
+    pool* _pool;
+};
+
+}
+#endif
@@ -0,0 +1,1510 @@
+/*!
+  @file gob_art_map.hpp
+  @brief std::map like adaptive radix tree for string and integer keys with prefix queries
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_ART_MAP_HPP
+#define GOB_ART_MAP_HPP
+
+#include <utility>
+#include <functional>
+#include <algorithm>
+#include <iterator>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "internal/gob_stdmap_detail.hpp"
+#include "internal/gob_swiss_group.hpp"
+
+namespace goblib {
+
+namespace stdmap_detail {
+// Byte string of a key whose memcmp order is the std::less order of the keys
+template <class Key, class = void>
+struct art_key
+{
+    static constexpr bool supported = false;
+};
+
+template <>
+struct art_key<std::string>
+{
+    static constexpr bool supported = true;
+    static constexpr bool fixed_length = false;  // A key may be a prefix of another
+    using view_type = std::string_view;
+    struct bytes_type
+    {
+        std::string_view s;
+        std::size_t size() const noexcept { return s.size(); }
+        unsigned char operator[](std::size_t i) const noexcept { return static_cast<unsigned char>(s[i]); }
+    };
+    static bytes_type bytes(std::string_view k) noexcept { return { k }; }
+};
+
+// Integers are stored big-endian with the sign bit flipped, so negative values sort first
+template <class Key>
+struct art_key<Key, typename std::enable_if<std::is_integral<Key>::value && !std::is_same<Key, bool>::value>::type>
+{
+    static constexpr bool supported = true;
+    static constexpr bool fixed_length = true;  // No key is a prefix of another
+    using view_type = Key;
+    using unsigned_type = typename std::make_unsigned<Key>::type;
+    static constexpr unsigned bits = sizeof(Key) * 8;
+    struct bytes_type
+    {
+        unsigned char b[sizeof(Key)];
+        std::size_t size() const noexcept { return sizeof(Key); }
+        unsigned char operator[](std::size_t i) const noexcept { return b[i]; }
+    };
+    static unsigned_type order(Key k) noexcept
+    {
+        auto u = static_cast<unsigned_type>(k);
+        if(std::is_signed<Key>::value) { u = static_cast<unsigned_type>(u ^ (unsigned_type(1) << (bits - 1))); }
+        return u;
+    }
+    static Key from_order(unsigned_type u) noexcept
+    {
+        if(std::is_signed<Key>::value) { u = static_cast<unsigned_type>(u ^ (unsigned_type(1) << (bits - 1))); }
+        return static_cast<Key>(u);
+    }
+    static bytes_type bytes(Key k) noexcept
+    {
+        bytes_type r;
+        auto u = order(k);
+        for(std::size_t i = sizeof(Key); i-- > 0;)
+        {
+            r.b[i] = static_cast<unsigned char>(u & 0xFF);
+            u = static_cast<unsigned_type>(u >> 4 >> 4);  // Two shifts, since shifting an 8 bit value by 8 is not portable
+        }
+        return r;
+    }
+};
+}
+
+/*!
+  @class art_map
+  @brief Adaptive radix tree (ART) for string and integer keys, with prefix queries
+  @details Keys are split into bytes and each inner node branches on one byte. Inner nodes come in four
+  sizes (4, 16, 48 and 256 children) and grow or shrink with their fanout, so sparse levels stay small
+  and dense levels are indexed directly. A chain of single-child nodes is compressed into a prefix of
+  the node below it, and a key that is the prefix of others ends at the node of its last byte.
+  Lookup cost depends on the key length, not on the number of elements, and needs no key comparisons
+  until the single leaf reached. Keys sharing a prefix (URL paths, IP addresses) share the inner nodes.
+  @tparam Key std::string or an integral type (bool excluded)
+  @tparam T Mapped type
+  @tparam Allocator Allocator for std::pair<const Key, T> (rebound for the nodes)
+  @note The interface is the same as std::map with the following differences.
+  - Iteration order is the byte order of the keys, which is std::less<Key> for the supported keys.
+  - Lookup takes std::string_view for std::string keys, so std::string, const char* and views work without a copy.
+  - Each element is a separately allocated leaf, so insertion and erasure invalidate no other iterators or references.
+  - Erasure may reallocate the inner node that loses a child (nodes shrink at 3, 12 and 37 children).
+    It does not throw: if that allocation fails the node keeps its size.
+  - The hint of insert and emplace_hint is ignored.
+  - Node16 lookups use SSE2 unless GOB_STDMAP_DISABLE_SIMD is defined.
+  - prefix_range and longest_prefix are added (see "Prefix query").
+ */
+template <class Key, class T, class Allocator = std::allocator<std::pair<const Key, T>>>
+class art_map
+{
+    static_assert(stdmap_detail::art_key<Key>::supported, "art_map supports std::string and integral keys");
+
+    using alloc_traits = std::allocator_traits<Allocator>;
+    using key_traits = stdmap_detail::art_key<Key>;
+    using key_bytes = typename key_traits::bytes_type;
+    struct link;
+    struct leaf_node;
+    struct node_base;
+
+  public:
+    template <bool Const> class basic_iterator;
+
+    ///@name Member types
+    ///@{
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<const Key, T>;
+    using key_compare = std::less<Key>;
+    using allocator_type = Allocator;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = value_type*;
+    using const_pointer = const value_type*;
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    //! @brief Argument type of lookups (std::string_view for std::string keys, otherwise Key)
+    using key_view_type = typename key_traits::view_type;
+    ///@}
+
+    //! @brief Bidirectional iterator walking the linked leaves in key order
+    template <bool Const>
+    class basic_iterator
+    {
+        friend class art_map;
+        template <bool> friend class basic_iterator;
+
+      public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = typename art_map::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference = typename std::conditional<Const, const value_type&, value_type&>::type;
+        using pointer = typename std::conditional<Const, const value_type*, value_type*>::type;
+
+        basic_iterator() = default;
+        template <bool C, typename std::enable_if<Const && !C, std::nullptr_t>::type = nullptr>
+        basic_iterator(const basic_iterator<C>& o) : _p(o._p) {}
+
+        reference operator*() const { return *static_cast<leaf_node*>(_p)->value(); }
+        pointer operator->() const { return static_cast<leaf_node*>(_p)->value(); }
+        basic_iterator& operator++()
+        {
+            _p = _p->next;
+            return *this;
+        }
+        basic_iterator operator++(int) { auto t = *this; ++*this; return t; }
+        basic_iterator& operator--()
+        {
+            _p = _p->prev;
+            return *this;
+        }
+        basic_iterator operator--(int) { auto t = *this; --*this; return t; }
+
+        template <bool C> bool operator==(const basic_iterator<C>& o) const { return _p == o._p; }
+        template <bool C> bool operator!=(const basic_iterator<C>& o) const { return !(*this == o); }
+
+      private:
+        explicit basic_iterator(link* p) : _p(p) {}
+        link* _p{};
+    };
+
+    ///@name Constructor
+    ///@{
+    art_map() : art_map(Allocator()) {}
+    explicit art_map(const Allocator& alloc) : _alloc(alloc) {}
+    template <class InputIt>
+    art_map(InputIt first, InputIt last, const Allocator& alloc = Allocator()) : art_map(alloc)
+    {
+        insert(first, last);
+    }
+    art_map(std::initializer_list<value_type> il, const Allocator& alloc = Allocator()) : art_map(il.begin(), il.end(), alloc) {}
+    art_map(const art_map& o) : art_map(o, alloc_traits::select_on_container_copy_construction(o._alloc)) {}
+    art_map(const art_map& o, const Allocator& alloc) : art_map(o.begin(), o.end(), alloc) {}
+    art_map(art_map&& o) noexcept : _alloc(std::move(o._alloc)) { steal(o); }
+    ~art_map() { destroy(); }
+    ///@}
+
+    ///@name Assignment
+    ///@{
+    art_map& operator=(const art_map& o)
+    {
+        if(this != &o)
+        {
+            art_map t(o, alloc_traits::propagate_on_container_copy_assignment::value ? o._alloc : _alloc);
+            destroy();
+            if constexpr(alloc_traits::propagate_on_container_copy_assignment::value) { _alloc = o._alloc; }
+            steal(t);
+        }
+        return *this;
+    }
+    //! @brief Takes the nodes of o, or moves its elements one by one if the allocators differ and do not propagate
+    art_map& operator=(art_map&& o) noexcept(alloc_traits::propagate_on_container_move_assignment::value ||
+                                             alloc_traits::is_always_equal::value)
+    {
+        if(this != &o)
+        {
+            clear();
+            if constexpr(alloc_traits::propagate_on_container_move_assignment::value) { _alloc = std::move(o._alloc); }
+            if(alloc_traits::propagate_on_container_move_assignment::value || alloc_traits::is_always_equal::value || _alloc == o._alloc)
+            {
+                steal(o);
+            }
+            else
+            {
+                for(auto& e : o) { try_emplace_impl(e.first, std::move(e.second)); }
+                o.clear();
+            }
+        }
+        return *this;
+    }
+    art_map& operator=(std::initializer_list<value_type> il)
+    {
+        clear();
+        insert(il);
+        return *this;
+    }
+    ///@}
+
+    allocator_type get_allocator() const noexcept { return _alloc; }
+
+    ///@name Element access
+    ///@{
+    T& at(key_view_type key)
+    {
+        auto l = find_leaf(key);
+        if(!l) { stdmap_detail::throw_out_of_range("art_map::at"); }
+        return l->value()->second;
+    }
+    const T& at(key_view_type key) const
+    {
+        auto l = find_leaf(key);
+        if(!l) { stdmap_detail::throw_out_of_range("art_map::at"); }
+        return l->value()->second;
+    }
+    T& operator[](const Key& key) { return try_emplace(key).first->second; }
+    T& operator[](Key&& key) { return try_emplace(std::move(key)).first->second; }
+    ///@}
+
+    ///@name Iterators
+    ///@{
+    iterator begin() noexcept { return iterator(_head.next); }
+    const_iterator begin() const noexcept { return const_iterator(_head.next); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    iterator end() noexcept { return iterator(head()); }
+    const_iterator end() const noexcept { return const_iterator(head()); }
+    const_iterator cend() const noexcept { return end(); }
+    reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+    const_reverse_iterator crbegin() const noexcept { return rbegin(); }
+    reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+    const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+    const_reverse_iterator crend() const noexcept { return rend(); }
+    ///@}
+
+    ///@name Capacity
+    ///@{
+    bool empty() const noexcept { return _size == 0; }
+    size_type size() const noexcept { return _size; }
+    size_type max_size() const noexcept { return alloc_traits::max_size(_alloc); }
+    ///@}
+
+    ///@name Modifiers
+    ///@{
+    void clear() noexcept
+    {
+        destroy();
+        _root = nullptr;
+        _head.prev = _head.next = &_head;
+        _size = 0;
+    }
+
+    std::pair<iterator, bool> insert(const value_type& v) { return try_emplace_impl(v.first, v.second); }
+    std::pair<iterator, bool> insert(value_type&& v) { return emplace(std::move(v)); }
+    template <class P, typename std::enable_if<std::is_constructible<value_type, P&&>::value, std::nullptr_t>::type = nullptr>
+    std::pair<iterator, bool> insert(P&& v) { return emplace(std::forward<P>(v)); }
+    iterator insert(const_iterator hint, const value_type& v)
+    {
+        (void)hint;
+        return insert(v).first;
+    }
+    iterator insert(const_iterator hint, value_type&& v)
+    {
+        (void)hint;
+        return insert(std::move(v)).first;
+    }
+    template <class P, typename std::enable_if<std::is_constructible<value_type, P&&>::value, std::nullptr_t>::type = nullptr>
+    iterator insert(const_iterator hint, P&& v) { return emplace_hint(hint, std::forward<P>(v)); }
+    //! @brief Insert elements of the range. Existing elements win over equivalent new keys
+    template <class InputIt>
+    void insert(InputIt first, InputIt last)
+    {
+        for(; first != last; ++first) { emplace(*first); }
+    }
+    void insert(std::initializer_list<value_type> il) { insert(il.begin(), il.end()); }
+    //! @brief Insert elements of the range (moved if rg is an rvalue)
+    template <class R>
+    void insert_range(R&& rg)
+    {
+        if constexpr(std::is_rvalue_reference<R&&>::value)
+        {
+            insert(std::make_move_iterator(std::begin(rg)), std::make_move_iterator(std::end(rg)));
+        }
+        else { insert(std::begin(rg), std::end(rg)); }
+    }
+
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(const Key& key, M&& obj) { return insert_or_assign_impl(key, std::forward<M>(obj)); }
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(Key&& key, M&& obj) { return insert_or_assign_impl(std::move(key), std::forward<M>(obj)); }
+    template <class M>
+    iterator insert_or_assign(const_iterator hint, const Key& key, M&& obj)
+    {
+        (void)hint;
+        return insert_or_assign_impl(key, std::forward<M>(obj)).first;
+    }
+    template <class M>
+    iterator insert_or_assign(const_iterator hint, Key&& key, M&& obj)
+    {
+        (void)hint;
+        return insert_or_assign_impl(std::move(key), std::forward<M>(obj)).first;
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        if constexpr(stdmap_detail::is_key_mapped_args<Key, Args...>::value) { return try_emplace_impl(std::forward<Args>(args)...); }
+        else
+        {
+            // The key is known only after construction; the leaf is dropped if it exists
+            auto l = make_leaf(std::forward<Args>(args)...);
+            if(auto e = find_leaf(l->value()->first))
+            {
+                free_leaf(l);
+                return { iterator(e), false };
+            }
+            return { iterator(insert_leaf(l)), true };
+        }
+    }
+    template <class... Args>
+    iterator emplace_hint(const_iterator hint, Args&&... args)
+    {
+        (void)hint;
+        return emplace(std::forward<Args>(args)...).first;
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) { return try_emplace_impl(key, std::forward<Args>(args)...); }
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(Key&& key, Args&&... args) { return try_emplace_impl(std::move(key), std::forward<Args>(args)...); }
+    template <class... Args>
+    iterator try_emplace(const_iterator hint, const Key& key, Args&&... args)
+    {
+        (void)hint;
+        return try_emplace_impl(key, std::forward<Args>(args)...).first;
+    }
+    template <class... Args>
+    iterator try_emplace(const_iterator hint, Key&& key, Args&&... args)
+    {
+        (void)hint;
+        return try_emplace_impl(std::move(key), std::forward<Args>(args)...).first;
+    }
+
+    //! @return Iterator following the erased element
+    iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+    iterator erase(const_iterator pos)
+    {
+        link* next = pos._p->next;
+        erase_leaf(static_cast<leaf_node*>(pos._p));
+        return iterator(next);
+    }
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        while(first != last) { first = erase(first); }
+        return iterator(last._p);
+    }
+    size_type erase(key_view_type key)
+    {
+        auto l = find_leaf(key);
+        if(!l) { return 0; }
+        erase_leaf(l);
+        return 1;
+    }
+
+    /*!
+      @brief Move elements of source into this
+      @details Elements whose key already exists in this are left in source (same as std::map::merge).
+      The leaves are relinked, not copied
+     */
+    void merge(art_map& source)
+    {
+        if(&source == this) { return; }
+        for(link* p = source._head.next; p != &source._head;)
+        {
+            auto l = static_cast<leaf_node*>(p);
+            p = p->next;
+            if(find_leaf(l->value()->first)) { continue; }
+            if(!alloc_traits::is_always_equal::value && !(_alloc == source._alloc))
+            {
+                try_emplace_impl(l->value()->first, std::move(l->value()->second));
+                source.erase_leaf(l);
+                continue;
+            }
+            source.detach_leaf(l);
+            insert_leaf(l);
+        }
+    }
+    void merge(art_map&& source) { merge(source); }
+
+    void swap(art_map& o) noexcept
+    {
+        using std::swap;
+        if constexpr(alloc_traits::propagate_on_container_swap::value) { swap(_alloc, o._alloc); }
+        const link a = _head;
+        const link b = o._head;
+        swap(_root, o._root);
+        swap(_size, o._size);
+        adopt_list(b, &o._head);
+        o.adopt_list(a, &_head);
+    }
+    ///@}
+
+    ///@name Lookup
+    ///@{
+    size_type count(key_view_type key) const { return find_leaf(key) ? 1 : 0; }
+    iterator find(key_view_type key) { return iterator(find_link(key)); }
+    const_iterator find(key_view_type key) const { return const_iterator(find_link(key)); }
+    bool contains(key_view_type key) const { return find_leaf(key) != nullptr; }
+    iterator lower_bound(key_view_type key) { return iterator(lower_bound_link(key)); }
+    const_iterator lower_bound(key_view_type key) const { return const_iterator(lower_bound_link(key)); }
+    iterator upper_bound(key_view_type key) { return iterator(upper_bound_link(key)); }
+    const_iterator upper_bound(key_view_type key) const { return const_iterator(upper_bound_link(key)); }
+    std::pair<iterator, iterator> equal_range(key_view_type key)
+    {
+        if(auto l = find_leaf(key)) { return { iterator(l), iterator(l->next) }; }
+        auto lb = lower_bound(key);
+        return { lb, lb };
+    }
+    std::pair<const_iterator, const_iterator> equal_range(key_view_type key) const
+    {
+        auto r = const_cast<art_map*>(this)->equal_range(key);
+        return { r.first, r.second };
+    }
+    ///@}
+
+    /*!
+      @name Prefix query
+      @brief Elements sharing a key prefix, found by descending the prefix only.
+      prefix_range for strings and longest_prefix are available for std::string keys,
+      prefix_range by bit length for integral keys
+      @code{.cpp}
+      for(auto& e : routes.prefix_range("/api/")) { ... }  // Keys starting with "/api/"
+      auto it = routes.longest_prefix("/api/users/42");    // e.g. "/api/users/"
+      for(auto& e : table.prefix_range(0xC0A80000u, 16)) { ... }  // 192.168.0.0/16
+      @endcode
+     */
+    ///@{
+    //! @brief Elements whose keys start with prefix (all elements for an empty prefix)
+    template <class K = Key, typename std::enable_if<std::is_same<K, std::string>::value, std::nullptr_t>::type = nullptr>
+    range_view<iterator> prefix_range(std::string_view prefix)
+    {
+        auto r = prefix_range_link(prefix);
+        return { iterator(r.first), iterator(r.second) };
+    }
+    template <class K = Key, typename std::enable_if<std::is_same<K, std::string>::value, std::nullptr_t>::type = nullptr>
+    range_view<const_iterator> prefix_range(std::string_view prefix) const
+    {
+        auto r = prefix_range_link(prefix);
+        return { const_iterator(r.first), const_iterator(r.second) };
+    }
+    //! @brief Element whose key is the longest prefix of s (including s itself), or end()
+    template <class K = Key, typename std::enable_if<std::is_same<K, std::string>::value, std::nullptr_t>::type = nullptr>
+    iterator longest_prefix(std::string_view s) { return iterator(longest_prefix_link(s)); }
+    template <class K = Key, typename std::enable_if<std::is_same<K, std::string>::value, std::nullptr_t>::type = nullptr>
+    const_iterator longest_prefix(std::string_view s) const { return const_iterator(longest_prefix_link(s)); }
+    /*!
+      @brief Elements whose keys equal key in the leading bits (the high bits of the unsigned value, e.g. a CIDR block)
+      @details Signed keys are compared as offset binary (the sign bit flipped), the order of iteration
+     */
+    template <class K = Key, typename std::enable_if<std::is_integral<K>::value, std::nullptr_t>::type = nullptr>
+    range_view<iterator> prefix_range(Key key, unsigned bits)
+    {
+        auto r = prefix_bits_link(key, bits);
+        return { iterator(r.first), iterator(r.second) };
+    }
+    template <class K = Key, typename std::enable_if<std::is_integral<K>::value, std::nullptr_t>::type = nullptr>
+    range_view<const_iterator> prefix_range(Key key, unsigned bits) const
+    {
+        auto r = prefix_bits_link(key, bits);
+        return { const_iterator(r.first), const_iterator(r.second) };
+    }
+    ///@}
+
+    ///@name Observers
+    ///@{
+    key_compare key_comp() const { return key_compare(); }
+    ///@}
+
+    ///@name Comparison
+    ///@{
+    friend bool operator==(const art_map& a, const art_map& b)
+    {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+    }
+    friend bool operator!=(const art_map& a, const art_map& b) { return !(a == b); }
+    friend bool operator<(const art_map& a, const art_map& b)
+    {
+        return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+    }
+    friend bool operator>(const art_map& a, const art_map& b) { return b < a; }
+    friend bool operator<=(const art_map& a, const art_map& b) { return !(b < a); }
+    friend bool operator>=(const art_map& a, const art_map& b) { return !(a < b); }
+    friend void swap(art_map& a, art_map& b) noexcept(noexcept(a.swap(b))) { a.swap(b); }
+    ///@}
+
+  private:
+    // Leading bytes of the compressed prefix stored in a node. Longer prefixes are checked against a leaf
+    static constexpr std::uint32_t max_prefix = 8;
+    enum : std::uint8_t
+    {
+        node4_kind,
+        node16_kind,
+        node48_kind,
+        node256_kind
+    };
+
+    // Leaves are doubly linked in key order through the sentinel _head
+    struct link
+    {
+        link* prev{};
+        link* next{};
+    };
+    struct leaf_node : link
+    {
+        alignas(value_type) unsigned char storage[sizeof(value_type)];
+        value_type* value() { return std::launder(reinterpret_cast<value_type*>(storage)); }
+    };
+
+    // Child pointers with the low bit set are leaves. prefix_len bytes are skipped before the node's byte,
+    // and value is the leaf whose key ends here (a proper prefix of the keys below)
+    struct node_base
+    {
+        std::uint8_t type{};
+        std::uint16_t count{};
+        std::uint32_t prefix_len{};
+        unsigned char prefix[max_prefix]{};
+        leaf_node* value{};
+    };
+    // Keys sorted, children in the same order
+    struct node4 : node_base
+    {
+        static constexpr std::uint8_t kind = node4_kind;
+        unsigned char keys[4]{};
+        node_base* children[4]{};
+    };
+    struct node16 : node_base
+    {
+        static constexpr std::uint8_t kind = node16_kind;
+        unsigned char keys[16]{};
+        node_base* children[16]{};
+    };
+    // index[byte] is the child slot + 1 (0 if absent)
+    struct node48 : node_base
+    {
+        static constexpr std::uint8_t kind = node48_kind;
+        unsigned char index[256]{};
+        node_base* children[48]{};
+    };
+    struct node256 : node_base
+    {
+        static constexpr std::uint8_t kind = node256_kind;
+        node_base* children[256]{};
+    };
+
+    static bool is_leaf(const node_base* p) noexcept { return reinterpret_cast<std::uintptr_t>(p) & 1; }
+    static leaf_node* as_leaf(const node_base* p) noexcept
+    {
+        return reinterpret_cast<leaf_node*>(reinterpret_cast<std::uintptr_t>(p) & ~std::uintptr_t(1));
+    }
+    static node_base* tag_leaf(leaf_node* l) noexcept
+    {
+        return reinterpret_cast<node_base*>(reinterpret_cast<std::uintptr_t>(l) | 1);
+    }
+    static key_bytes bytes_of(leaf_node* l) noexcept { return key_traits::bytes(l->value()->first); }
+
+    link* head() const noexcept { return const_cast<link*>(&_head); }
+
+    ///@name Node management
+    ///@{
+    template <class N>
+    N* new_node()
+    {
+        typename alloc_traits::template rebind_alloc<N> a(_alloc);
+        N* n = std::allocator_traits<decltype(a)>::allocate(a, 1);
+        ::new(static_cast<void*>(n)) N();
+        n->type = N::kind;
+        return n;
+    }
+    template <class N>
+    void delete_node(N* n) noexcept
+    {
+        typename alloc_traits::template rebind_alloc<N> a(_alloc);
+        n->~N();
+        std::allocator_traits<decltype(a)>::deallocate(a, n, 1);
+    }
+    // Node of the smaller size for a shrink, or nullptr if the allocation fails (the node then keeps its size, so erasure
+    // never throws)
+    template <class N>
+    N* new_shrunk_node() noexcept
+    {
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+        try
+        {
+            return new_node<N>();
+        }
+        catch(...)
+        {
+            return nullptr;
+        }
+#else
+        return new_node<N>();
+#endif
+    }
+    void free_node(node_base* n) noexcept
+    {
+        switch(n->type)
+        {
+        case node4_kind: delete_node(static_cast<node4*>(n)); break;
+        case node16_kind: delete_node(static_cast<node16*>(n)); break;
+        case node48_kind: delete_node(static_cast<node48*>(n)); break;
+        default: delete_node(static_cast<node256*>(n)); break;
+        }
+    }
+
+    template <class... Args>
+    leaf_node* make_leaf(Args&&... args)
+    {
+        typename alloc_traits::template rebind_alloc<leaf_node> a(_alloc);
+        leaf_node* l = std::allocator_traits<decltype(a)>::allocate(a, 1);
+        ::new(static_cast<void*>(l)) leaf_node();
+        struct guard
+        {
+            art_map* self;
+            leaf_node* l;
+            ~guard()
+            {
+                if(self) { self->deallocate_leaf(l); }
+            }
+        } g{ this, l };
+        alloc_traits::construct(_alloc, l->value(), std::forward<Args>(args)...);
+        g.self = nullptr;
+        return l;
+    }
+    void deallocate_leaf(leaf_node* l) noexcept
+    {
+        typename alloc_traits::template rebind_alloc<leaf_node> a(_alloc);
+        l->~leaf_node();
+        std::allocator_traits<decltype(a)>::deallocate(a, l, 1);
+    }
+    void free_leaf(leaf_node* l) noexcept
+    {
+        alloc_traits::destroy(_alloc, l->value());
+        deallocate_leaf(l);
+    }
+
+    static void copy_header(node_base* dst, const node_base* src) noexcept
+    {
+        dst->count = src->count;
+        dst->prefix_len = src->prefix_len;
+        std::memcpy(dst->prefix, src->prefix, max_prefix);
+        dst->value = src->value;
+    }
+    // Set the prefix to len bytes of k from depth
+    static void set_prefix(node_base* n, const key_bytes& k, std::size_t depth, std::size_t len) noexcept
+    {
+        n->prefix_len = static_cast<std::uint32_t>(len);
+        for(std::size_t i = 0; i < len && i < max_prefix; ++i) { n->prefix[i] = k[depth + i]; }
+    }
+    template <std::size_t N>
+    static void insert_sorted(unsigned char (&keys)[N], node_base* (&children)[N], std::uint16_t& count, unsigned char c,
+                              node_base* child) noexcept
+    {
+        std::size_t i = count;
+        for(; i > 0 && keys[i - 1] > c; --i)
+        {
+            keys[i] = keys[i - 1];
+            children[i] = children[i - 1];
+        }
+        keys[i] = c;
+        children[i] = child;
+        ++count;
+    }
+    template <std::size_t N>
+    static void erase_sorted(unsigned char (&keys)[N], node_base* (&children)[N], std::uint16_t& count, unsigned char c) noexcept
+    {
+        std::size_t i = 0;
+        while(keys[i] != c) { ++i; }
+        for(--count; i < count; ++i)
+        {
+            keys[i] = keys[i + 1];
+            children[i] = children[i + 1];
+        }
+    }
+    ///@}
+
+    ///@name Child access
+    ///@{
+    // Slot of the child for byte c, or nullptr
+    static node_base** find_child(node_base* n, unsigned char c) noexcept
+    {
+        switch(n->type)
+        {
+        case node4_kind:
+        {
+            auto p = static_cast<node4*>(n);
+            for(std::uint16_t i = 0; i < p->count; ++i)
+            {
+                if(p->keys[i] == c) { return p->children + i; }
+            }
+            return nullptr;
+        }
+        case node16_kind:
+        {
+            auto p = static_cast<node16*>(n);
+#if defined(GOB_STDMAP_SWISS_SSE2)
+            auto eq = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(c)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p->keys)));
+            auto m = static_cast<std::uint32_t>(_mm_movemask_epi8(eq)) & ((std::uint32_t(1) << p->count) - 1);
+            return m ? p->children + stdmap_detail::countr_zero(m) : nullptr;
+#else
+            for(std::uint16_t i = 0; i < p->count && p->keys[i] <= c; ++i)
+            {
+                if(p->keys[i] == c) { return p->children + i; }
+            }
+            return nullptr;
+#endif
+        }
+        case node48_kind:
+        {
+            auto p = static_cast<node48*>(n);
+            return p->index[c] ? p->children + (p->index[c] - 1) : nullptr;
+        }
+        default:
+        {
+            auto p = static_cast<node256*>(n);
+            return p->children[c] ? p->children + c : nullptr;
+        }
+        }
+    }
+    // Child with the smallest byte greater than c (-1 for the first child), or nullptr. The byte is stored to *byte
+    static node_base* next_child(const node_base* n, int c, unsigned char* byte = nullptr) noexcept
+    {
+        switch(n->type)
+        {
+        case node4_kind:
+        case node16_kind:
+        {
+            const unsigned char* keys = n->type == node4_kind ? static_cast<const node4*>(n)->keys : static_cast<const node16*>(n)->keys;
+            node_base* const* children =
+                    n->type == node4_kind ? static_cast<const node4*>(n)->children : static_cast<const node16*>(n)->children;
+            for(std::uint16_t i = 0; i < n->count; ++i)
+            {
+                if(keys[i] > c)
+                {
+                    if(byte) { *byte = keys[i]; }
+                    return children[i];
+                }
+            }
+            return nullptr;
+        }
+        case node48_kind:
+        {
+            auto p = static_cast<const node48*>(n);
+            for(int b = c + 1; b < 256; ++b)
+            {
+                if(p->index[b])
+                {
+                    if(byte) { *byte = static_cast<unsigned char>(b); }
+                    return p->children[p->index[b] - 1];
+                }
+            }
+            return nullptr;
+        }
+        default:
+        {
+            auto p = static_cast<const node256*>(n);
+            for(int b = c + 1; b < 256; ++b)
+            {
+                if(p->children[b])
+                {
+                    if(byte) { *byte = static_cast<unsigned char>(b); }
+                    return p->children[b];
+                }
+            }
+            return nullptr;
+        }
+        }
+    }
+    // Child with the largest byte less than c (256 for the last child), or nullptr
+    static node_base* prev_child(const node_base* n, int c) noexcept
+    {
+        switch(n->type)
+        {
+        case node4_kind:
+        case node16_kind:
+        {
+            const unsigned char* keys = n->type == node4_kind ? static_cast<const node4*>(n)->keys : static_cast<const node16*>(n)->keys;
+            node_base* const* children =
+                    n->type == node4_kind ? static_cast<const node4*>(n)->children : static_cast<const node16*>(n)->children;
+            for(std::uint16_t i = n->count; i-- > 0;)
+            {
+                if(keys[i] < c) { return children[i]; }
+            }
+            return nullptr;
+        }
+        case node48_kind:
+        {
+            auto p = static_cast<const node48*>(n);
+            for(int b = c - 1; b >= 0; --b)
+            {
+                if(p->index[b]) { return p->children[p->index[b] - 1]; }
+            }
+            return nullptr;
+        }
+        default:
+        {
+            auto p = static_cast<const node256*>(n);
+            for(int b = c - 1; b >= 0; --b)
+            {
+                if(p->children[b]) { return p->children[b]; }
+            }
+            return nullptr;
+        }
+        }
+    }
+    static leaf_node* minimum(const node_base* p) noexcept
+    {
+        while(!is_leaf(p))
+        {
+            if(p->value) { return p->value; }
+            p = next_child(p, -1);
+        }
+        return as_leaf(p);
+    }
+    static leaf_node* maximum(const node_base* p) noexcept
+    {
+        while(!is_leaf(p))
+        {
+            auto c = prev_child(p, 256);
+            if(!c) { return p->value; }
+            p = c;
+        }
+        return as_leaf(p);
+    }
+    // Number of leading prefix bytes of n equal to k from depth (at most the remaining length of k)
+    static std::size_t prefix_match(const node_base* n, const key_bytes& k, std::size_t depth) noexcept
+    {
+        const std::size_t limit = std::min<std::size_t>(n->prefix_len, k.size() - depth);
+        const std::size_t stored = std::min<std::size_t>(limit, max_prefix);
+        for(std::size_t i = 0; i < stored; ++i)
+        {
+            if(n->prefix[i] != k[depth + i]) { return i; }
+        }
+        if(limit > max_prefix)
+        {
+            auto mk = bytes_of(minimum(n));
+            for(std::size_t i = max_prefix; i < limit; ++i)
+            {
+                if(mk[depth + i] != k[depth + i]) { return i; }
+            }
+        }
+        return limit;
+    }
+    // Byte i of the prefix of n found at depth
+    static unsigned char prefix_byte(const node_base* n, std::size_t depth, std::size_t i) noexcept
+    {
+        return i < max_prefix ? n->prefix[i] : bytes_of(minimum(n))[depth + i];
+    }
+    ///@}
+
+    ///@name Insertion
+    ///@{
+    template <class K, class... Args>
+    std::pair<iterator, bool> try_emplace_impl(K&& key, Args&&... args)
+    {
+        if(auto l = find_leaf(key)) { return { iterator(l), false }; }
+        auto l = make_leaf(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                           std::forward_as_tuple(std::forward<Args>(args)...));
+        return { iterator(insert_leaf(l)), true };
+    }
+    template <class K, class M>
+    std::pair<iterator, bool> insert_or_assign_impl(K&& key, M&& obj)
+    {
+        auto r = try_emplace_impl(std::forward<K>(key), std::forward<M>(obj));
+        if(!r.second) { r.first->second = std::forward<M>(obj); }
+        return r;
+    }
+
+    // Add the leaf whose key is not in the tree. The leaf is freed if a node allocation throws
+    leaf_node* insert_leaf(leaf_node* l)
+    {
+        struct guard
+        {
+            art_map* self;
+            leaf_node* l;
+            ~guard()
+            {
+                if(self) { self->free_leaf(l); }
+            }
+        } g{ this, l };
+        auto pred = attach(l);
+        g.self = nullptr;
+        // Link after the largest leaf less than the key
+        link* prev = pred ? static_cast<link*>(maximum(pred)) : &_head;
+        l->prev = prev;
+        l->next = prev->next;
+        prev->next->prev = l;
+        prev->next = l;
+        ++_size;
+        return l;
+    }
+    /*
+      Put the leaf in the tree and return the subtree holding its predecessor (nullptr if it is the first).
+      Nodes are allocated before anything is modified, so the tree is intact if an allocation throws
+    */
+    node_base* attach(leaf_node* l)
+    {
+        const auto k = bytes_of(l);
+        node_base** ref = &_root;
+        node_base* pred{};
+        std::size_t depth{};
+        for(;;)
+        {
+            node_base* p = *ref;
+            if(!p)
+            {
+                *ref = tag_leaf(l);
+                return pred;
+            }
+            if(is_leaf(p))
+            {
+                // Lazy expansion: a new node4 holds both leaves below their common bytes
+                leaf_node* o = as_leaf(p);
+                const auto ok = bytes_of(o);
+                std::size_t i = depth;
+                const std::size_t limit = std::min(k.size(), ok.size());
+                while(i < limit && k[i] == ok[i]) { ++i; }
+                auto n = new_node<node4>();
+                set_prefix(n, k, depth, i - depth);
+                if constexpr(!key_traits::fixed_length)
+                {
+                    // One key is a prefix of the other and ends at the new node
+                    if(i == k.size())
+                    {
+                        n->value = l;
+                        insert_sorted(n->keys, n->children, n->count, ok[i], p);
+                        *ref = n;
+                        return pred;
+                    }
+                    if(i == ok.size())
+                    {
+                        n->value = o;
+                        insert_sorted(n->keys, n->children, n->count, k[i], tag_leaf(l));
+                        *ref = n;
+                        return p;
+                    }
+                }
+                insert_sorted(n->keys, n->children, n->count, ok[i], p);
+                insert_sorted(n->keys, n->children, n->count, k[i], tag_leaf(l));
+                if(ok[i] < k[i]) { pred = p; }
+                *ref = n;
+                return pred;
+            }
+            if(p->prefix_len)
+            {
+                const auto m = prefix_match(p, k, depth);
+                if(m < p->prefix_len)
+                {
+                    // Split the prefix: a new node4 takes the matching bytes
+                    auto s = new_node<node4>();
+                    set_prefix(s, k, depth, m);
+                    const unsigned char c = prefix_byte(p, depth, m);
+                    const std::size_t rest = p->prefix_len - m - 1;
+                    if(p->prefix_len <= max_prefix) { std::memmove(p->prefix, p->prefix + m + 1, rest); }
+                    else
+                    {
+                        auto mk = bytes_of(minimum(p));
+                        for(std::size_t i = 0; i < rest && i < max_prefix; ++i) { p->prefix[i] = mk[depth + m + 1 + i]; }
+                    }
+                    p->prefix_len = static_cast<std::uint32_t>(rest);
+                    insert_sorted(s->keys, s->children, s->count, c, p);
+                    if(depth + m == k.size()) { s->value = l; }
+                    else
+                    {
+                        insert_sorted(s->keys, s->children, s->count, k[depth + m], tag_leaf(l));
+                        if(c < k[depth + m]) { pred = p; }
+                    }
+                    *ref = s;
+                    return pred;
+                }
+                depth += p->prefix_len;
+            }
+            if(depth == k.size())
+            {
+                p->value = l;
+                return pred;
+            }
+            const unsigned char c = k[depth];
+            if(auto b = prev_child(p, c)) { pred = b; }
+            else if(p->value) { pred = tag_leaf(p->value); }
+            auto slot = find_child(p, c);
+            if(!slot)
+            {
+                add_child(ref, c, tag_leaf(l));
+                return pred;
+            }
+            ref = slot;
+            ++depth;
+        }
+    }
+    // Add the child for byte c to *ref, growing the node into the next size if it is full
+    void add_child(node_base** ref, unsigned char c, node_base* child)
+    {
+        node_base* n = *ref;
+        switch(n->type)
+        {
+        case node4_kind:
+        {
+            auto p = static_cast<node4*>(n);
+            if(p->count < 4)
+            {
+                insert_sorted(p->keys, p->children, p->count, c, child);
+                return;
+            }
+            auto g = new_node<node16>();
+            copy_header(g, p);
+            std::copy_n(p->keys, 4, g->keys);
+            std::copy_n(p->children, 4, g->children);
+            insert_sorted(g->keys, g->children, g->count, c, child);
+            *ref = g;
+            delete_node(p);
+            return;
+        }
+        case node16_kind:
+        {
+            auto p = static_cast<node16*>(n);
+            if(p->count < 16)
+            {
+                insert_sorted(p->keys, p->children, p->count, c, child);
+                return;
+            }
+            auto g = new_node<node48>();
+            copy_header(g, p);
+            for(unsigned i = 0; i < 16; ++i)
+            {
+                g->index[p->keys[i]] = static_cast<unsigned char>(i + 1);
+                g->children[i] = p->children[i];
+            }
+            g->index[c] = 17;
+            g->children[16] = child;
+            ++g->count;
+            *ref = g;
+            delete_node(p);
+            return;
+        }
+        case node48_kind:
+        {
+            auto p = static_cast<node48*>(n);
+            if(p->count < 48)
+            {
+                unsigned s = 0;
+                while(p->children[s]) { ++s; }
+                p->children[s] = child;
+                p->index[c] = static_cast<unsigned char>(s + 1);
+                ++p->count;
+                return;
+            }
+            auto g = new_node<node256>();
+            copy_header(g, p);
+            for(unsigned b = 0; b < 256; ++b)
+            {
+                if(p->index[b]) { g->children[b] = p->children[p->index[b] - 1]; }
+            }
+            g->children[c] = child;
+            ++g->count;
+            *ref = g;
+            delete_node(p);
+            return;
+        }
+        default:
+        {
+            auto p = static_cast<node256*>(n);
+            p->children[c] = child;
+            ++p->count;
+            return;
+        }
+        }
+    }
+    ///@}
+
+    ///@name Erasure
+    ///@{
+    void erase_leaf(leaf_node* l) noexcept
+    {
+        detach_leaf(l);
+        free_leaf(l);
+    }
+    // Remove the leaf from the tree and the list without freeing it
+    void detach_leaf(leaf_node* l) noexcept
+    {
+        const auto k = bytes_of(l);
+        node_base** ref = &_root;
+        std::size_t depth{};
+        for(;;)
+        {
+            node_base* p = *ref;
+            if(is_leaf(p))
+            {
+                *ref = nullptr;
+                break;
+            }
+            depth += p->prefix_len;
+            if(depth == k.size())
+            {
+                p->value = nullptr;
+                collapse(ref);
+                break;
+            }
+            const unsigned char c = k[depth];
+            auto slot = find_child(p, c);
+            if(is_leaf(*slot))
+            {
+                remove_child(ref, c);
+                collapse(ref);
+                break;
+            }
+            ref = slot;
+            ++depth;
+        }
+        l->prev->next = l->next;
+        l->next->prev = l->prev;
+        --_size;
+    }
+    // Remove the child for byte c from *ref, shrinking the node into the previous size below the threshold
+    // (if the smaller node can be allocated; a node may stay larger than its count needs)
+    void remove_child(node_base** ref, unsigned char c) noexcept
+    {
+        node_base* n = *ref;
+        switch(n->type)
+        {
+        case node4_kind:
+        {
+            auto p = static_cast<node4*>(n);
+            erase_sorted(p->keys, p->children, p->count, c);
+            return;
+        }
+        case node16_kind:
+        {
+            auto p = static_cast<node16*>(n);
+            erase_sorted(p->keys, p->children, p->count, c);
+            if(p->count > 3) { return; }
+            auto g = new_shrunk_node<node4>();
+            if(!g) { return; }
+            copy_header(g, p);
+            std::copy_n(p->keys, p->count, g->keys);
+            std::copy_n(p->children, p->count, g->children);
+            *ref = g;
+            delete_node(p);
+            return;
+        }
+        case node48_kind:
+        {
+            auto p = static_cast<node48*>(n);
+            p->children[p->index[c] - 1] = nullptr;
+            p->index[c] = 0;
+            if(--p->count > 12) { return; }
+            auto g = new_shrunk_node<node16>();
+            if(!g) { return; }
+            copy_header(g, p);
+            for(unsigned b = 0, j = 0; b < 256; ++b)
+            {
+                if(p->index[b])
+                {
+                    g->keys[j] = static_cast<unsigned char>(b);
+                    g->children[j++] = p->children[p->index[b] - 1];
+                }
+            }
+            *ref = g;
+            delete_node(p);
+            return;
+        }
+        default:
+        {
+            auto p = static_cast<node256*>(n);
+            p->children[c] = nullptr;
+            if(--p->count > 37) { return; }
+            auto g = new_shrunk_node<node48>();
+            if(!g) { return; }
+            copy_header(g, p);
+            for(unsigned b = 0, j = 0; b < 256; ++b)
+            {
+                if(p->children[b])
+                {
+                    g->index[b] = static_cast<unsigned char>(j + 1);
+                    g->children[j++] = p->children[b];
+                }
+            }
+            *ref = g;
+            delete_node(p);
+            return;
+        }
+        }
+    }
+    // Replace a node left with a single entry by that entry, merging the prefixes
+    void collapse(node_base** ref) noexcept
+    {
+        node_base* n = *ref;
+        if(n->count + (n->value ? 1 : 0) > 1) { return; }
+        if(!n->count) { *ref = tag_leaf(n->value); }
+        else
+        {
+            unsigned char c{};
+            node_base* child = next_child(n, -1, &c);
+            if(!is_leaf(child))
+            {
+                unsigned char buf[max_prefix]{};
+                std::size_t len = std::min<std::size_t>(n->prefix_len, max_prefix);
+                std::memcpy(buf, n->prefix, len);
+                if(len < max_prefix) { buf[len++] = c; }
+                std::memcpy(buf + len, child->prefix, std::min<std::size_t>(child->prefix_len, max_prefix - len));
+                std::memcpy(child->prefix, buf, max_prefix);
+                child->prefix_len += n->prefix_len + 1;
+            }
+            *ref = child;
+        }
+        free_node(n);
+    }
+    ///@}
+
+    ///@name Search
+    ///@{
+    // Compare the stored prefix bytes only; the leaf reached is compared with the whole key
+    leaf_node* find_leaf(key_view_type key) const noexcept
+    {
+        const auto k = key_traits::bytes(key);
+        const node_base* p = _root;
+        std::size_t depth{};
+        while(p)
+        {
+            if(is_leaf(p))
+            {
+                auto l = as_leaf(p);
+                return l->value()->first == key ? l : nullptr;
+            }
+            if(p->prefix_len)
+            {
+                if(k.size() - depth < p->prefix_len) { return nullptr; }
+                const std::size_t stored = std::min<std::size_t>(p->prefix_len, max_prefix);
+                for(std::size_t i = 0; i < stored; ++i)
+                {
+                    if(p->prefix[i] != k[depth + i]) { return nullptr; }
+                }
+                depth += p->prefix_len;
+            }
+            if(depth == k.size()) { return p->value && p->value->value()->first == key ? p->value : nullptr; }
+            auto slot = find_child(const_cast<node_base*>(p), k[depth]);
+            if(!slot) { return nullptr; }
+            p = *slot;
+            ++depth;
+        }
+        return nullptr;
+    }
+    link* find_link(key_view_type key) const noexcept
+    {
+        auto l = find_leaf(key);
+        return l ? static_cast<link*>(l) : head();
+    }
+    link* lower_bound_link(key_view_type key) const noexcept
+    {
+        const auto k = key_traits::bytes(key);
+        const node_base* p = _root;
+        std::size_t depth{};
+        if(!p) { return head(); }
+        for(;;)
+        {
+            if(is_leaf(p))
+            {
+                auto l = as_leaf(p);
+                return l->value()->first < key ? l->next : l;
+            }
+            if(p->prefix_len)
+            {
+                const auto m = prefix_match(p, k, depth);
+                if(m < p->prefix_len)
+                {
+                    // The key diverges inside the prefix: the whole subtree is either above or below it
+                    if(depth + m == k.size() || k[depth + m] < prefix_byte(p, depth, m)) { return minimum(p); }
+                    return maximum(p)->next;
+                }
+                depth += p->prefix_len;
+            }
+            if(depth == k.size()) { return minimum(p); }
+            const unsigned char c = k[depth];
+            if(auto slot = find_child(const_cast<node_base*>(p), c))
+            {
+                p = *slot;
+                ++depth;
+                continue;
+            }
+            if(auto a = next_child(p, c)) { return minimum(a); }
+            return maximum(p)->next;
+        }
+    }
+    link* upper_bound_link(key_view_type key) const noexcept
+    {
+        auto l = find_leaf(key);
+        return l ? l->next : lower_bound_link(key);
+    }
+
+    // [first, last) of the keys starting with the prefix
+    std::pair<link*, link*> prefix_range_link(std::string_view prefix) const noexcept
+    {
+        const auto k = key_traits::bytes(prefix);
+        const node_base* p = _root;
+        std::size_t depth{};
+        while(p)
+        {
+            if(is_leaf(p))
+            {
+                auto l = as_leaf(p);
+                if(std::string_view(l->value()->first).substr(0, prefix.size()) == prefix) { return { l, l->next }; }
+                break;
+            }
+            if(p->prefix_len)
+            {
+                const auto m = prefix_match(p, k, depth);
+                if(depth + m == k.size()) { return { minimum(p), maximum(p)->next }; }
+                if(m < p->prefix_len) { break; }
+                depth += p->prefix_len;
+            }
+            if(depth == k.size()) { return { minimum(p), maximum(p)->next }; }
+            auto slot = find_child(const_cast<node_base*>(p), k[depth]);
+            if(!slot) { break; }
+            p = *slot;
+            ++depth;
+        }
+        return { head(), head() };
+    }
+    link* longest_prefix_link(std::string_view s) const noexcept
+    {
+        const auto k = key_traits::bytes(s);
+        const node_base* p = _root;
+        leaf_node* best{};
+        std::size_t depth{};
+        while(p)
+        {
+            if(is_leaf(p))
+            {
+                auto l = as_leaf(p);
+                const std::string_view lk = l->value()->first;
+                if(s.substr(0, lk.size()) == lk) { best = l; }
+                break;
+            }
+            if(p->prefix_len)
+            {
+                if(prefix_match(p, k, depth) < p->prefix_len) { break; }
+                depth += p->prefix_len;
+            }
+            // Every byte on the path matched, so a key ending here is a prefix of s
+            if(p->value) { best = p->value; }
+            if(depth == k.size()) { break; }
+            auto slot = find_child(const_cast<node_base*>(p), k[depth]);
+            if(!slot) { break; }
+            p = *slot;
+            ++depth;
+        }
+        return best ? static_cast<link*>(best) : head();
+    }
+    std::pair<link*, link*> prefix_bits_link(Key key, unsigned bits) const noexcept
+    {
+        using U = typename key_traits::unsigned_type;
+        if(bits >= key_traits::bits) { return { lower_bound_link(key), upper_bound_link(key) }; }
+        const U low = static_cast<U>(static_cast<U>(~U(0)) >> bits);
+        const U first = static_cast<U>(key_traits::order(key) & static_cast<U>(~low));
+        return { lower_bound_link(key_traits::from_order(first)), upper_bound_link(key_traits::from_order(static_cast<U>(first | low))) };
+    }
+    ///@}
+
+    // Take over the list whose sentinel was h (sentinel address old) as the list of this
+    void adopt_list(const link& h, link* old) noexcept
+    {
+        if(h.next == old)
+        {
+            _head.prev = _head.next = &_head;
+            return;
+        }
+        _head = h;
+        _head.next->prev = &_head;
+        _head.prev->next = &_head;
+    }
+    void steal(art_map& o) noexcept
+    {
+        _root = o._root;
+        _size = o._size;
+        adopt_list(o._head, &o._head);
+        o._root = nullptr;
+        o._size = 0;
+        o._head.prev = o._head.next = &o._head;
+    }
+    // Free all nodes and leaves. Inner nodes are released depth first without recursion,
+    // keeping the parent in the value field (the leaves are freed through the list)
+    void destroy() noexcept
+    {
+        for(link* p = _head.next; p != &_head;)
+        {
+            auto l = static_cast<leaf_node*>(p);
+            p = p->next;
+            free_leaf(l);
+        }
+        if(!_root || is_leaf(_root)) { return; }
+        node_base* n = _root;
+        n->value = nullptr;
+        while(n)
+        {
+            if(auto inner = take_inner_child(n))
+            {
+                inner->value = reinterpret_cast<leaf_node*>(n);
+                n = inner;
+                continue;
+            }
+            auto parent = reinterpret_cast<node_base*>(n->value);
+            free_node(n);
+            n = parent;
+        }
+    }
+    // Clear and return a child slot holding an inner node, or nullptr (used while destroying only)
+    static node_base* take_inner_child(node_base* n) noexcept
+    {
+        node_base** children{};
+        std::size_t count{};
+        switch(n->type)
+        {
+        case node4_kind: children = static_cast<node4*>(n)->children, count = n->count; break;
+        case node16_kind: children = static_cast<node16*>(n)->children, count = n->count; break;
+        case node48_kind: children = static_cast<node48*>(n)->children, count = 48; break;
+        default: children = static_cast<node256*>(n)->children, count = 256; break;
+        }
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            if(children[i] && !is_leaf(children[i]))
+            {
+                auto c = children[i];
+                children[i] = nullptr;
+                return c;
+            }
+        }
+        return nullptr;
+    }
+
+    node_base* _root{};
+    link _head{ &_head, &_head };
+    size_type _size{};
+    Allocator _alloc{};
+};
+
+/*!
+  @brief Erase all elements satisfying the predicate
+  @return Number of erased elements
+ */
+template <class Key, class T, class Allocator, class Pred>
+typename art_map<Key, T, Allocator>::size_type erase_if(art_map<Key, T, Allocator>& c, Pred pred)
+{
+    auto n = c.size();
+    for(auto it = c.begin(); it != c.end();)
+    {
+        if(pred(*it)) { it = c.erase(it); }
+        else { ++it; }
+    }
+    return n - c.size();
+}
+
+}
+#endif
@@ -0,0 +1,1360 @@
+/*!
+  @file gob_btree_map.hpp
+  @brief std::map compatible B+-tree with cache line sized nodes
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_BTREE_MAP_HPP
+#define GOB_BTREE_MAP_HPP
+
+#include <vector>
+#include <utility>
+#include <functional>
+#include <algorithm>
+#include <iterator>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "internal/gob_stdmap_detail.hpp"
+
+namespace goblib {
+
+/*!
+  @class btree_map
+  @brief B+-tree based map for large and frequently modified data
+  @details Elements are stored only in the leaves, many per node, and the leaves are doubly linked,
+  so iteration walks contiguous arrays. Internal nodes hold separator keys and child pointers only.
+  Nodes are cache line aligned and sized to NodeSize bytes, so a lookup touches about log_B(N) nodes
+  (B is the fanout) instead of log_2(N) scattered nodes as in a red-black tree, and there are no
+  per-element pointers. Appending in ascending key order fills the leaves completely.
+  @tparam Key Key type (copyable; internal nodes keep copies as separators)
+  @tparam T Mapped type
+  @tparam Compare Compare function object for the key
+  @tparam Allocator Allocator for std::pair<Key, T> (rebound for the nodes)
+  @tparam NodeSize Target size of a node in bytes (e.g. 256 for a few cache lines, 4096 for a page)
+  @note The interface is the same as std::map with the following differences.
+  - value_type is std::pair<Key, T> (not const Key). Do not modify the key through an iterator.
+  - Insertion and erasure invalidate iterators, pointers and references (elements move between nodes).
+  - Insertion, erasure and lookup are O(log N).
+  - The hint of insert and emplace_hint is ignored.
+  - try_emplace, emplace(key, mapped) and insert_or_assign construct the element in place in its leaf.
+  - Elements and keys for which goblib::is_trivially_relocatable holds are shifted and split by memmove.
+  - Iterators prefetch the next leaf when they enter one, so ordered scans overlap the cache misses of the leaves.
+ */
+template <class Key, class T, class Compare = std::less<Key>, class Allocator = std::allocator<std::pair<Key, T>>,
+          std::size_t NodeSize = 256>
+class btree_map
+{
+    using alloc_traits = std::allocator_traits<Allocator>;
+    struct leaf_node;
+    struct internal_node;
+
+  public:
+    template <bool Const> class basic_iterator;
+
+    ///@name Member types
+    ///@{
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<Key, T>;
+    using key_compare = Compare;
+    using allocator_type = Allocator;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = value_type*;
+    using const_pointer = const value_type*;
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    ///@}
+
+    static_assert(NodeSize >= stdmap_detail::cache_line_size, "NodeSize must be at least a cache line");
+
+  private:
+    // Number of items fitting in NodeSize after the overhead (at least 3, so nodes can split and merge)
+    static constexpr std::size_t fit(std::size_t overhead, std::size_t item)
+    {
+        return NodeSize > overhead && (NodeSize - overhead) / item > 3 ? (NodeSize - overhead) / item : 3;
+    }
+
+  public:
+    //! @brief Number of elements per leaf node
+    static constexpr size_type leaf_capacity = fit(8 + 2 * sizeof(void*), sizeof(value_type));
+    //! @brief Number of separator keys per internal node (fanout - 1)
+    static constexpr size_type internal_capacity = fit(8 + sizeof(Key) + 2 * sizeof(void*), sizeof(Key) + sizeof(void*));
+
+    //! @brief Compare value_type by key
+    class value_compare
+    {
+        friend class btree_map;
+      public:
+        bool operator()(const value_type& a, const value_type& b) const { return comp(a.first, b.first); }
+      protected:
+        explicit value_compare(Compare c) : comp(c) {}
+        Compare comp;
+    };
+
+    //! @brief Bidirectional iterator walking the linked leaves
+    template <bool Const>
+    class basic_iterator
+    {
+        friend class btree_map;
+        template <bool> friend class basic_iterator;
+
+      public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = typename btree_map::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference = typename std::conditional<Const, const value_type&, value_type&>::type;
+        using pointer = typename std::conditional<Const, const value_type*, value_type*>::type;
+
+        basic_iterator() = default;
+        template <bool C, typename std::enable_if<Const && !C, std::nullptr_t>::type = nullptr>
+        basic_iterator(const basic_iterator<C>& o) : _leaf(o._leaf), _i(o._i) {}
+
+        reference operator*() const { return _leaf->values()[_i]; }
+        pointer operator->() const { return _leaf->values() + _i; }
+        basic_iterator& operator++()
+        {
+            if(++_i == _leaf->count && _leaf->next)
+            {
+                _leaf = _leaf->next;
+                _i = 0;
+                if(_leaf->next) { prefetch_node(_leaf->next); }
+            }
+            return *this;
+        }
+        basic_iterator operator++(int) { auto t = *this; ++*this; return t; }
+        basic_iterator& operator--()
+        {
+            if(_i == 0)
+            {
+                _leaf = _leaf->prev;
+                _i = _leaf->count;
+            }
+            --_i;
+            return *this;
+        }
+        basic_iterator operator--(int) { auto t = *this; --*this; return t; }
+
+        template <bool C> bool operator==(const basic_iterator<C>& o) const { return _leaf == o._leaf && _i == o._i; }
+        template <bool C> bool operator!=(const basic_iterator<C>& o) const { return !(*this == o); }
+
+      private:
+        basic_iterator(leaf_node* l, size_type i) : _leaf(l), _i(i) {}
+        leaf_node* _leaf{};
+        size_type _i{};
+    };
+
+    ///@name Constructor
+    ///@{
+    btree_map() : btree_map(Compare()) {}
+    explicit btree_map(const Compare& comp, const Allocator& alloc = Allocator()) : _comp(comp), _alloc(alloc) {}
+    explicit btree_map(const Allocator& alloc) : btree_map(Compare(), alloc) {}
+    template <class InputIt>
+    btree_map(InputIt first, InputIt last, const Compare& comp = Compare(), const Allocator& alloc = Allocator())
+            : btree_map(comp, alloc)
+    {
+        insert(first, last);
+    }
+    template <class InputIt>
+    btree_map(InputIt first, InputIt last, const Allocator& alloc) : btree_map(first, last, Compare(), alloc) {}
+    //! @brief Construct from the range sorted by key without equivalent keys. O(N), leaves are filled completely
+    template <class InputIt>
+    btree_map(sorted_unique_t, InputIt first, InputIt last, const Compare& comp = Compare(), const Allocator& alloc = Allocator())
+            : btree_map(comp, alloc)
+    {
+        build_sorted(first, last);
+    }
+    btree_map(std::initializer_list<value_type> il, const Compare& comp = Compare(), const Allocator& alloc = Allocator())
+            : btree_map(il.begin(), il.end(), comp, alloc) {}
+    btree_map(std::initializer_list<value_type> il, const Allocator& alloc) : btree_map(il, Compare(), alloc) {}
+    btree_map(const btree_map& o) : btree_map(o, alloc_traits::select_on_container_copy_construction(o._alloc)) {}
+    btree_map(const btree_map& o, const Allocator& alloc) : btree_map(o._comp, alloc) { build_sorted(o.begin(), o.end()); }
+    btree_map(btree_map&& o) noexcept : _comp(std::move(o._comp)), _alloc(std::move(o._alloc)) { steal(o); }
+    ~btree_map() { destroy(); }
+    ///@}
+
+    ///@name Assignment
+    ///@{
+    btree_map& operator=(const btree_map& o)
+    {
+        if(this != &o)
+        {
+            btree_map t(o, alloc_traits::propagate_on_container_copy_assignment::value ? o._alloc : _alloc);
+            destroy();
+            _comp = std::move(t._comp);
+            if constexpr(alloc_traits::propagate_on_container_copy_assignment::value) { _alloc = o._alloc; }
+            steal(t);
+        }
+        return *this;
+    }
+    //! @brief Takes the nodes of o, or moves its elements one by one if the allocators differ and do not propagate
+    btree_map& operator=(btree_map&& o) noexcept(alloc_traits::propagate_on_container_move_assignment::value ||
+                                                 alloc_traits::is_always_equal::value)
+    {
+        if(this != &o)
+        {
+            clear();
+            _comp = std::move(o._comp);
+            if constexpr(alloc_traits::propagate_on_container_move_assignment::value) { _alloc = std::move(o._alloc); }
+            if(alloc_traits::propagate_on_container_move_assignment::value || alloc_traits::is_always_equal::value || _alloc == o._alloc)
+            {
+                steal(o);
+            }
+            else
+            {
+                build_sorted(std::make_move_iterator(o.begin()), std::make_move_iterator(o.end()));
+                o.clear();
+            }
+        }
+        return *this;
+    }
+    btree_map& operator=(std::initializer_list<value_type> il)
+    {
+        clear();
+        insert(il);
+        return *this;
+    }
+    ///@}
+
+    allocator_type get_allocator() const noexcept { return _alloc; }
+
+    ///@name Element access
+    ///@{
+    T& at(const Key& key)
+    {
+        auto it = find(key);
+        if(it == end()) { stdmap_detail::throw_out_of_range("btree_map::at"); }
+        return it->second;
+    }
+    const T& at(const Key& key) const
+    {
+        auto it = find(key);
+        if(it == end()) { stdmap_detail::throw_out_of_range("btree_map::at"); }
+        return it->second;
+    }
+    T& operator[](const Key& key) { return try_emplace(key).first->second; }
+    T& operator[](Key&& key) { return try_emplace(std::move(key)).first->second; }
+    ///@}
+
+    ///@name Iterators
+    ///@{
+    iterator begin() noexcept { return iterator(_first, 0); }
+    const_iterator begin() const noexcept { return const_iterator(_first, 0); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    iterator end() noexcept { return iterator(_last, _last ? _last->count : 0); }
+    const_iterator end() const noexcept { return const_iterator(_last, _last ? _last->count : 0); }
+    const_iterator cend() const noexcept { return end(); }
+    reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+    const_reverse_iterator crbegin() const noexcept { return rbegin(); }
+    reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+    const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+    const_reverse_iterator crend() const noexcept { return rend(); }
+    ///@}
+
+    ///@name Capacity
+    ///@{
+    bool empty() const noexcept { return _size == 0; }
+    size_type size() const noexcept { return _size; }
+    size_type max_size() const noexcept { return alloc_traits::max_size(_alloc); }
+    //! @brief Number of levels (0 if empty, 1 if the root is a leaf)
+    size_type height() const noexcept
+    {
+        size_type h{};
+        for(const node_base* n = _root; n; n = n->leaf ? nullptr : static_cast<const internal_node*>(n)->children[0]) { ++h; }
+        return h;
+    }
+    ///@}
+
+    ///@name Modifiers
+    ///@{
+    void clear() noexcept
+    {
+        destroy();
+        _root = nullptr;
+        _first = _last = nullptr;
+        _size = 0;
+    }
+
+    std::pair<iterator, bool> insert(const value_type& v) { return try_emplace_impl(v.first, v.second); }
+    std::pair<iterator, bool> insert(value_type&& v) { return insert_value(std::move(v)); }
+    template <class P, typename std::enable_if<std::is_constructible<value_type, P&&>::value, std::nullptr_t>::type = nullptr>
+    std::pair<iterator, bool> insert(P&& v) { return emplace(std::forward<P>(v)); }
+    iterator insert(const_iterator hint, const value_type& v)
+    {
+        (void)hint;
+        return insert(v).first;
+    }
+    iterator insert(const_iterator hint, value_type&& v)
+    {
+        (void)hint;
+        return insert(std::move(v)).first;
+    }
+    template <class P, typename std::enable_if<std::is_constructible<value_type, P&&>::value, std::nullptr_t>::type = nullptr>
+    iterator insert(const_iterator hint, P&& v) { return emplace_hint(hint, std::forward<P>(v)); }
+    //! @brief Insert elements of the range. Existing elements win over equivalent new keys
+    template <class InputIt>
+    void insert(InputIt first, InputIt last)
+    {
+        for(; first != last; ++first) { emplace(*first); }
+    }
+    //! @brief Insert elements of the range sorted by key without equivalent keys. O(M) bulk load if this is empty
+    template <class InputIt>
+    void insert(sorted_unique_t, InputIt first, InputIt last)
+    {
+        if(empty()) { build_sorted(first, last); }
+        else { insert(first, last); }
+    }
+    void insert(std::initializer_list<value_type> il) { insert(il.begin(), il.end()); }
+    void insert(sorted_unique_t s, std::initializer_list<value_type> il) { insert(s, il.begin(), il.end()); }
+    //! @brief Insert elements of the range (moved if rg is an rvalue)
+    template <class R>
+    void insert_range(R&& rg)
+    {
+        if constexpr(std::is_rvalue_reference<R&&>::value)
+        {
+            insert(std::make_move_iterator(std::begin(rg)), std::make_move_iterator(std::end(rg)));
+        }
+        else { insert(std::begin(rg), std::end(rg)); }
+    }
+
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(const Key& key, M&& obj) { return insert_or_assign_impl(key, std::forward<M>(obj)); }
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(Key&& key, M&& obj) { return insert_or_assign_impl(std::move(key), std::forward<M>(obj)); }
+    template <class M>
+    iterator insert_or_assign(const_iterator hint, const Key& key, M&& obj)
+    {
+        (void)hint;
+        return insert_or_assign_impl(key, std::forward<M>(obj)).first;
+    }
+    template <class M>
+    iterator insert_or_assign(const_iterator hint, Key&& key, M&& obj)
+    {
+        (void)hint;
+        return insert_or_assign_impl(std::move(key), std::forward<M>(obj)).first;
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        if constexpr(stdmap_detail::is_key_mapped_args<Key, Args...>::value) { return try_emplace_impl(std::forward<Args>(args)...); }
+        else { return insert_value(value_type(std::forward<Args>(args)...)); }
+    }
+    template <class... Args>
+    iterator emplace_hint(const_iterator hint, Args&&... args)
+    {
+        (void)hint;
+        return emplace(std::forward<Args>(args)...).first;
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) { return try_emplace_impl(key, std::forward<Args>(args)...); }
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(Key&& key, Args&&... args) { return try_emplace_impl(std::move(key), std::forward<Args>(args)...); }
+    template <class... Args>
+    iterator try_emplace(const_iterator hint, const Key& key, Args&&... args)
+    {
+        (void)hint;
+        return try_emplace_impl(key, std::forward<Args>(args)...).first;
+    }
+    template <class... Args>
+    iterator try_emplace(const_iterator hint, Key&& key, Args&&... args)
+    {
+        (void)hint;
+        return try_emplace_impl(std::move(key), std::forward<Args>(args)...).first;
+    }
+
+    //! @return Iterator following the erased element
+    iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+    iterator erase(const_iterator pos)
+    {
+        node_path p;
+        auto leaf = descend(pos->first, p);
+        return erase_at(p, leaf, pos._i);
+    }
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        // Erasure may move the elements after first, so count instead of comparing with last
+        auto n = std::distance(first, last);
+        iterator it(first._leaf, first._i);
+        while(n-- > 0) { it = erase(it); }
+        return it;
+    }
+    size_type erase(const Key& key) { return erase_key(key); }
+
+    /*!
+      @brief Move elements of source into this
+      @details Elements whose key already exists in this are left in source (same as std::map::merge)
+     */
+    void merge(btree_map& source)
+    {
+        if(&source == this) { return; }
+        for(auto it = source.begin(); it != source.end();)
+        {
+            if(contains(it->first))
+            {
+                ++it;
+                continue;
+            }
+            // Locate the element in source while its key is intact
+            node_path p;
+            auto l = source.descend(it->first, p);
+            value_type v(std::move(*it));
+            it = source.erase_at(p, l, it._i);
+            insert_value(std::move(v));
+        }
+    }
+    void merge(btree_map&& source) { merge(source); }
+
+    void swap(btree_map& o) noexcept(std::is_nothrow_swappable<Compare>::value)
+    {
+        using std::swap;
+        swap(_comp, o._comp);
+        if constexpr(alloc_traits::propagate_on_container_swap::value) { swap(_alloc, o._alloc); }
+        swap(_root, o._root);
+        swap(_first, o._first);
+        swap(_last, o._last);
+        swap(_size, o._size);
+    }
+    ///@}
+
+    ///@name Lookup
+    ///@{
+    size_type count(const Key& key) const { return contains(key) ? 1 : 0; }
+    iterator find(const Key& key) { return find_impl(key); }
+    const_iterator find(const Key& key) const { return find_impl(key); }
+    bool contains(const Key& key) const { return find(key) != end(); }
+    iterator lower_bound(const Key& key) { return lower_bound_impl(key); }
+    const_iterator lower_bound(const Key& key) const { return lower_bound_impl(key); }
+    iterator upper_bound(const Key& key) { return upper_bound_impl(key); }
+    const_iterator upper_bound(const Key& key) const { return upper_bound_impl(key); }
+    std::pair<iterator, iterator> equal_range(const Key& key) { return equal_range_impl(key); }
+    std::pair<const_iterator, const_iterator> equal_range(const Key& key) const
+    {
+        auto r = equal_range_impl(key);
+        return { r.first, r.second };
+    }
+    ///@}
+
+    /*!
+      @name Heterogeneous lookup
+      @brief Available if Compare::is_transparent exists (e.g. std::less<>).
+      Query by any type comparable with Key without constructing a temporary Key
+     */
+    ///@{
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    size_type count(const K& key) const { return contains(key) ? 1 : 0; }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    iterator find(const K& key) { return find_impl(key); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    const_iterator find(const K& key) const { return find_impl(key); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    bool contains(const K& key) const { return find_impl(key) != end(); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    iterator lower_bound(const K& key) { return lower_bound_impl(key); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    const_iterator lower_bound(const K& key) const { return lower_bound_impl(key); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    iterator upper_bound(const K& key) { return upper_bound_impl(key); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    const_iterator upper_bound(const K& key) const { return upper_bound_impl(key); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    std::pair<iterator, iterator> equal_range(const K& key) { return equal_range_impl(key); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    std::pair<const_iterator, const_iterator> equal_range(const K& key) const
+    {
+        auto r = equal_range_impl(key);
+        return { r.first, r.second };
+    }
+    template <class K, class C = Compare, stdmap_detail::if_transparent_erase<C, K, iterator, const_iterator> = nullptr>
+    size_type erase(K&& key) { return erase_key(key); }
+    ///@}
+
+    /*!
+      @name Range query
+      @brief Ordered scans of a key range, and lookup of many keys in one pass.
+      The K overloads are available if Compare::is_transparent exists
+      @code{.cpp}
+      for(auto& e : m.range(from, to)) { ... }  // Keys in [from, to)
+      std::vector<decltype(m)::const_iterator> found(keys.size());
+      m.find_sorted(keys.begin(), keys.end(), found.begin());  // keys sorted by key_comp()
+      @endcode
+     */
+    ///@{
+    //! @brief Elements whose keys are in [lo, hi). Empty if hi is not greater than lo
+    range_view<iterator> range(const Key& lo, const Key& hi) { return range_impl(lo, hi); }
+    range_view<const_iterator> range(const Key& lo, const Key& hi) const
+    {
+        auto r = range_impl(lo, hi);
+        return { r.begin(), r.end() };
+    }
+    //! @brief Number of elements whose keys are in [lo, hi). O(log N + count / leaf_capacity), counted per leaf
+    size_type count_range(const Key& lo, const Key& hi) const { return count_range_impl(lo, hi); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    range_view<iterator> range(const K& lo, const K& hi) { return range_impl(lo, hi); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    range_view<const_iterator> range(const K& lo, const K& hi) const
+    {
+        auto r = range_impl(lo, hi);
+        return { r.begin(), r.end() };
+    }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    size_type count_range(const K& lo, const K& hi) const { return count_range_impl(lo, hi); }
+
+    /*!
+      @brief Find each key of the sorted range [first, last), writing the iterator (or end()) to out
+      @details Keys must be sorted by key_comp() (equivalent keys allowed). A key in the current or
+      the next leaf is searched there without descending from the root, and the leaf after the current
+      one is prefetched, so runs of nearby keys cost one leaf search each.
+      @return Output iterator past the last written
+     */
+    template <class InputIt, class OutputIt>
+    OutputIt find_sorted(InputIt first, InputIt last, OutputIt out) { return find_sorted_impl(first, last, out, iterator()); }
+    template <class InputIt, class OutputIt>
+    OutputIt find_sorted(InputIt first, InputIt last, OutputIt out) const
+    {
+        return find_sorted_impl(first, last, out, const_iterator());
+    }
+    ///@}
+
+    ///@name Observers
+    ///@{
+    key_compare key_comp() const { return _comp; }
+    value_compare value_comp() const { return value_compare(_comp); }
+    ///@}
+
+    ///@name Comparison
+    ///@{
+    friend bool operator==(const btree_map& a, const btree_map& b)
+    {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+    }
+    friend bool operator!=(const btree_map& a, const btree_map& b) { return !(a == b); }
+    friend bool operator<(const btree_map& a, const btree_map& b)
+    {
+        return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+    }
+    friend bool operator>(const btree_map& a, const btree_map& b) { return b < a; }
+    friend bool operator<=(const btree_map& a, const btree_map& b) { return !(b < a); }
+    friend bool operator>=(const btree_map& a, const btree_map& b) { return !(a < b); }
+    friend void swap(btree_map& a, btree_map& b) noexcept(noexcept(a.swap(b))) { a.swap(b); }
+    ///@}
+
+  private:
+    // A leaf holds count elements, an internal node count keys and count + 1 children.
+    // Keys in children[i] are less than keys[i], keys in children[i + 1] are not
+    struct node_base
+    {
+        std::uint32_t count{};
+        bool leaf{};
+    };
+    struct alignas(stdmap_detail::cache_line_size) leaf_node : node_base
+    {
+        leaf_node* prev{};
+        leaf_node* next{};
+        alignas(value_type) unsigned char storage[sizeof(value_type) * leaf_capacity];
+        value_type* values() { return std::launder(reinterpret_cast<value_type*>(storage)); }
+    };
+    // One spare key and child, so an insertion may overflow the node before it is split
+    struct alignas(stdmap_detail::cache_line_size) internal_node : node_base
+    {
+        node_base* children[internal_capacity + 2];
+        alignas(Key) unsigned char storage[sizeof(Key) * (internal_capacity + 1)];
+        Key* keys() { return std::launder(reinterpret_cast<Key*>(storage)); }
+    };
+    using leaf_allocator = typename alloc_traits::template rebind_alloc<leaf_node>;
+    using leaf_alloc_traits = std::allocator_traits<leaf_allocator>;
+    using internal_allocator = typename alloc_traits::template rebind_alloc<internal_node>;
+    using internal_alloc_traits = std::allocator_traits<internal_allocator>;
+
+    static constexpr size_type min_leaf = leaf_capacity / 2;
+    static constexpr size_type min_internal = internal_capacity / 2;
+    // Every internal node has 2 or more children
+    static constexpr size_type max_height = 64;
+
+    // Internal nodes from the root to a leaf and the child index taken in each
+    struct node_path
+    {
+        struct entry
+        {
+            internal_node* node;
+            size_type index;
+        };
+        entry e[max_height];
+        size_type depth{};
+    };
+
+    // Nodes allocated before an insertion modifies the tree, so a failed allocation leaves it intact
+    struct node_reserve
+    {
+        explicit node_reserve(btree_map& m) : map(m) {}
+        ~node_reserve()
+        {
+            if(leaf) { map.free_leaf(leaf); }
+            for(size_type i = used; i < count; ++i) { map.free_internal(internals[i]); }
+        }
+        internal_node* take() { return internals[used++]; }
+        btree_map& map;
+        leaf_node* leaf{};
+        internal_node* internals[max_height + 1];
+        size_type count{}, used{};
+    };
+
+    ///@name Node management
+    ///@{
+    leaf_node* new_leaf()
+    {
+        leaf_allocator a(_alloc);
+        auto p = leaf_alloc_traits::allocate(a, 1);
+        ::new(static_cast<void*>(p)) leaf_node;
+        p->leaf = true;
+        return p;
+    }
+    internal_node* new_internal()
+    {
+        internal_allocator a(_alloc);
+        auto p = internal_alloc_traits::allocate(a, 1);
+        ::new(static_cast<void*>(p)) internal_node;
+        return p;
+    }
+    // Elements or keys must have been destroyed or moved out
+    void free_leaf(leaf_node* p) noexcept
+    {
+        leaf_allocator a(_alloc);
+        p->~leaf_node();
+        leaf_alloc_traits::deallocate(a, p, 1);
+    }
+    void free_internal(internal_node* p) noexcept
+    {
+        internal_allocator a(_alloc);
+        p->~internal_node();
+        internal_alloc_traits::deallocate(a, p, 1);
+    }
+    // Free the internal nodes of the subtree and their keys (leaves are freed through the leaf chain)
+    void free_internals(node_base* n) noexcept
+    {
+        if(!n || n->leaf) { return; }
+        auto in = static_cast<internal_node*>(n);
+        for(size_type i = 0; i <= in->count; ++i) { free_internals(in->children[i]); }
+        std::destroy_n(in->keys(), in->count);
+        free_internal(in);
+    }
+    void destroy() noexcept
+    {
+        free_internals(_root);
+        for(leaf_node* l = _first; l;)
+        {
+            auto next = l->next;
+            for(size_type i = 0; i < l->count; ++i) { alloc_traits::destroy(_alloc, l->values() + i); }
+            free_leaf(l);
+            l = next;
+        }
+    }
+    void steal(btree_map& o) noexcept
+    {
+        _root = o._root;
+        _first = o._first;
+        _last = o._last;
+        _size = o._size;
+        o._root = nullptr;
+        o._first = o._last = nullptr;
+        o._size = 0;
+    }
+    void link_after(leaf_node* pos, leaf_node* l) noexcept
+    {
+        l->prev = pos;
+        l->next = pos ? pos->next : nullptr;
+        if(l->next) { l->next->prev = l; }
+        else { _last = l; }
+        if(pos) { pos->next = l; }
+        else { _first = l; }
+    }
+    void unlink(leaf_node* l) noexcept
+    {
+        if(l->prev) { l->prev->next = l->next; }
+        else { _first = l->next; }
+        if(l->next) { l->next->prev = l->prev; }
+        else { _last = l->prev; }
+    }
+    ///@}
+
+    ///@name Element relocation (move construct and destroy the source, or copy the bytes if trivially relocatable)
+    ///@{
+    void relocate(value_type* dst, value_type* src)
+    {
+        if constexpr(is_trivially_relocatable<value_type>::value) { relocate_bytes(dst, src, 1); }
+        else
+        {
+            alloc_traits::construct(_alloc, dst, std::move(*src));
+            alloc_traits::destroy(_alloc, src);
+        }
+    }
+    void relocate(Key* dst, Key* src)
+    {
+        if constexpr(is_trivially_relocatable<Key>::value) { relocate_bytes(dst, src, 1); }
+        else
+        {
+            ::new(static_cast<void*>(dst)) Key(std::move(*src));
+            src->~Key();
+        }
+    }
+    // Ascending order: dst must not be after an overlapping src
+    template <class U>
+    void relocate_forward(U* dst, U* src, size_type n)
+    {
+        if constexpr(is_trivially_relocatable<U>::value) { relocate_bytes(dst, src, n); }
+        else
+        {
+            for(size_type i = 0; i < n; ++i) { relocate(dst + i, src + i); }
+        }
+    }
+    // Descending order: dst must not be before an overlapping src
+    template <class U>
+    void relocate_backward(U* dst, U* src, size_type n)
+    {
+        if constexpr(is_trivially_relocatable<U>::value) { relocate_bytes(dst, src, n); }
+        else
+        {
+            for(size_type i = n; i-- > 0;) { relocate(dst + i, src + i); }
+        }
+    }
+    template <class U>
+    static void relocate_bytes(U* dst, U* src, size_type n)
+    {
+        if(n) { std::memmove(static_cast<void*>(dst), static_cast<const void*>(src), n * sizeof(U)); }
+    }
+    ///@}
+
+    ///@name Search
+    ///@{
+    // Bring the whole node into the cache before the binary search jumps around in it
+    static void prefetch_node(const void* n)
+    {
+        constexpr size_type bytes = std::max(sizeof(leaf_node), sizeof(internal_node));
+        auto p = static_cast<const unsigned char*>(n);
+        for(size_type off = 0; off < bytes; off += stdmap_detail::cache_line_size)
+        {
+            stdmap_detail::prefetch(p + off);
+        }
+    }
+    // Index of the child which may contain key (number of separators <= key)
+    template <class K>
+    size_type child_index(internal_node* n, const K& key) const
+    {
+        const Key* k = n->keys();
+        size_type lo{}, len{ n->count };
+        while(len > 0)
+        {
+            auto half = len / 2;
+            if(!_comp(key, k[lo + half])) { lo += half + 1; len -= half + 1; }
+            else { len = half; }
+        }
+        return lo;
+    }
+    template <class K>
+    size_type leaf_lower_bound(leaf_node* l, const K& key, size_type from = 0) const
+    {
+        const value_type* v = l->values();
+        size_type lo{ from }, len{ l->count - from };
+        while(len > 0)
+        {
+            auto half = len / 2;
+            if(_comp(v[lo + half].first, key)) { lo += half + 1; len -= half + 1; }
+            else { len = half; }
+        }
+        return lo;
+    }
+    template <class K>
+    size_type leaf_upper_bound(leaf_node* l, const K& key) const
+    {
+        const value_type* v = l->values();
+        size_type lo{}, len{ l->count };
+        while(len > 0)
+        {
+            auto half = len / 2;
+            if(!_comp(key, v[lo + half].first)) { lo += half + 1; len -= half + 1; }
+            else { len = half; }
+        }
+        return lo;
+    }
+    template <class K>
+    leaf_node* descend(const K& key) const
+    {
+        node_base* n = _root;
+        while(!n->leaf)
+        {
+            auto in = static_cast<internal_node*>(n);
+            n = in->children[child_index(in, key)];
+            prefetch_node(n);
+        }
+        return static_cast<leaf_node*>(n);
+    }
+    template <class K>
+    leaf_node* descend(const K& key, node_path& p) const
+    {
+        node_base* n = _root;
+        p.depth = 0;
+        while(!n->leaf)
+        {
+            auto in = static_cast<internal_node*>(n);
+            auto ci = child_index(in, key);
+            p.e[p.depth++] = { in, ci };
+            n = in->children[ci];
+            prefetch_node(n);
+        }
+        return static_cast<leaf_node*>(n);
+    }
+    // Position i of the leaf, moved to the next leaf if it is past the end of a non-last leaf
+    iterator make_iterator(leaf_node* l, size_type i) const
+    {
+        if(i == l->count && l->next) { return iterator(l->next, 0); }
+        return iterator(l, i);
+    }
+    template <class K>
+    iterator find_impl(const K& key) const
+    {
+        if(!_root) { return iterator(); }
+        auto l = descend(key);
+        auto i = leaf_lower_bound(l, key);
+        return (i < l->count && !_comp(key, l->values()[i].first)) ? iterator(l, i) : end_iterator();
+    }
+    template <class K>
+    iterator lower_bound_impl(const K& key) const
+    {
+        if(!_root) { return iterator(); }
+        auto l = descend(key);
+        return make_iterator(l, leaf_lower_bound(l, key));
+    }
+    template <class K>
+    iterator upper_bound_impl(const K& key) const
+    {
+        if(!_root) { return iterator(); }
+        auto l = descend(key);
+        return make_iterator(l, leaf_upper_bound(l, key));
+    }
+    template <class K>
+    std::pair<iterator, iterator> equal_range_impl(const K& key) const
+    {
+        if(!_root) { return { iterator(), iterator() }; }
+        auto l = descend(key);
+        auto i = leaf_lower_bound(l, key);
+        auto first = make_iterator(l, i);
+        return { first, (i < l->count && !_comp(key, l->values()[i].first)) ? make_iterator(l, i + 1) : first };
+    }
+    iterator end_iterator() const { return iterator(_last, _last ? _last->count : 0); }
+
+    template <class K>
+    range_view<iterator> range_impl(const K& lo, const K& hi) const
+    {
+        auto first = lower_bound_impl(lo);
+        return { first, _comp(lo, hi) ? lower_bound_impl(hi) : first };
+    }
+    template <class K>
+    size_type count_range_impl(const K& lo, const K& hi) const
+    {
+        auto r = range_impl(lo, hi);
+        auto first = r.begin(), last = r.end();
+        if(first._leaf == last._leaf) { return last._i - first._i; }
+        size_type n = first._leaf->count - first._i;
+        for(auto l = first._leaf->next; l != last._leaf; l = l->next)
+        {
+            if(l->next) { prefetch_node(l->next); }
+            n += l->count;
+        }
+        return n + last._i;
+    }
+    // Keys after the last of leaf l are not in it
+    template <class K>
+    bool leaf_covers(leaf_node* l, const K& key) const
+    {
+        return l->count && !_comp(l->values()[l->count - 1].first, key);
+    }
+    template <class InputIt, class OutputIt, class It>
+    OutputIt find_sorted_impl(InputIt first, InputIt last, OutputIt out, It) const
+    {
+        leaf_node* l{};
+        size_type i{};
+        for(; first != last; ++first)
+        {
+            const auto& key = *first;
+            if(!_root)
+            {
+                *out++ = It();
+                continue;
+            }
+            // Stay in the leaf, step to the next one, or descend again
+            if(!l || !leaf_covers(l, key))
+            {
+                if(l && l->next && leaf_covers(l->next, key)) { l = l->next; }
+                else { l = descend(key); }
+                i = 0;
+                if(l->next) { prefetch_node(l->next); }
+            }
+            i = leaf_lower_bound(l, key, i);
+            *out++ = (i < l->count && !_comp(key, l->values()[i].first)) ? It(iterator(l, i)) : It(end_iterator());
+        }
+        return out;
+    }
+    ///@}
+
+    ///@name Insertion
+    ///@{
+    std::pair<iterator, bool> insert_value(value_type&& v)
+    {
+        node_path p;
+        leaf_node* l{};
+        size_type i{};
+        if(_root)
+        {
+            l = descend(v.first, p);
+            i = leaf_lower_bound(l, v.first);
+            if(i < l->count && !_comp(v.first, l->values()[i].first)) { return { iterator(l, i), false }; }
+        }
+        return { insert_at(p, l, i, std::move(v)), true };
+    }
+    template <class K, class... Args>
+    std::pair<iterator, bool> try_emplace_impl(K&& key, Args&&... args)
+    {
+        node_path p;
+        leaf_node* l{};
+        size_type i{};
+        if(_root)
+        {
+            l = descend(key, p);
+            i = leaf_lower_bound(l, key);
+            if(i < l->count && !_comp(key, l->values()[i].first)) { return { iterator(l, i), false }; }
+        }
+        return { insert_at(p, l, i, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                           std::forward_as_tuple(std::forward<Args>(args)...)),
+                 true };
+    }
+    template <class K, class M>
+    std::pair<iterator, bool> insert_or_assign_impl(K&& key, M&& obj)
+    {
+        node_path p;
+        leaf_node* l{};
+        size_type i{};
+        if(_root)
+        {
+            l = descend(key, p);
+            i = leaf_lower_bound(l, key);
+            if(i < l->count && !_comp(key, l->values()[i].first))
+            {
+                l->values()[i].second = std::forward<M>(obj);
+                return { iterator(l, i), false };
+            }
+        }
+        return { insert_at(p, l, i, std::forward<K>(key), std::forward<M>(obj)), true };
+    }
+
+    // Construct the element from args at position i of leaf l reached through p, splitting full nodes on the way up.
+    // If the construction throws, the tree is left as it was.
+    // Arguments that refer to an element of l would see it relocated, so the element is built first from those
+    template <class... Args>
+    iterator insert_at(node_path& p, leaf_node* l, size_type i, Args&&... args)
+    {
+        if(l && stdmap_detail::args_refer_into(l->values(), l->values() + l->count, args...))
+        {
+            value_type v(std::forward<Args>(args)...);
+            return insert_at(p, l, i, std::move(v));
+        }
+        if(!_root)
+        {
+            node_reserve r(*this);
+            r.leaf = new_leaf();
+            alloc_traits::construct(_alloc, r.leaf->values(), std::forward<Args>(args)...);
+            l = r.leaf;
+            r.leaf = nullptr;
+            l->count = 1;
+            link_after(nullptr, l);
+            _root = l;
+            _size = 1;
+            return iterator(l, 0);
+        }
+        if(l->count < leaf_capacity)
+        {
+            put(l, i, std::forward<Args>(args)...);
+            ++_size;
+            return iterator(l, i);
+        }
+
+        // The leaf splits, and so does every full ancestor in a row (and the root, adding a level)
+        node_reserve r(*this);
+        size_type d = p.depth;
+        while(d > 0 && p.e[d - 1].node->count == internal_capacity) { --d; }
+        r.leaf = new_leaf();
+        for(size_type n = p.depth - d + (d == 0); r.count < n; ++r.count) { r.internals[r.count] = new_internal(); }
+
+        leaf_node* right = r.leaf;
+        // Appending at the end of the last leaf keeps the left leaf full (ascending insertion)
+        const size_type c = l->count;
+        const size_type left_count = (l == _last && i == c) ? c : (c + 1) / 2;
+        // Removes the new element and moves the upper half back (and lets r free the right leaf) if the construction
+        // or the copy of the separator throws
+        struct split_guard
+        {
+            btree_map* self;
+            leaf_node* l;
+            leaf_node* right;
+            leaf_node* placed{};
+            size_type index{};
+            ~split_guard()
+            {
+                if(self)
+                {
+                    if(placed)
+                    {
+                        alloc_traits::destroy(self->_alloc, placed->values() + index);
+                        self->relocate_forward(placed->values() + index, placed->values() + index + 1, placed->count - index - 1);
+                        --placed->count;
+                    }
+                    self->relocate_forward(l->values() + l->count, right->values(), right->count);
+                    l->count += right->count;
+                    right->count = 0;
+                }
+            }
+        } g{ this, l, right };
+        iterator result;
+        if(i < left_count)
+        {
+            relocate_forward(right->values(), l->values() + left_count - 1, c - left_count + 1);
+            right->count = static_cast<std::uint32_t>(c - left_count + 1);
+            l->count = static_cast<std::uint32_t>(left_count - 1);
+            put(l, i, std::forward<Args>(args)...);
+            result = iterator(l, i);
+        }
+        else
+        {
+            relocate_forward(right->values(), l->values() + left_count, c - left_count);
+            right->count = static_cast<std::uint32_t>(c - left_count);
+            l->count = static_cast<std::uint32_t>(left_count);
+            put(right, i - left_count, std::forward<Args>(args)...);
+            result = iterator(right, i - left_count);
+        }
+        g.placed = result._leaf;
+        g.index = result._i;
+        // Copied before the right leaf is linked, so a throwing copy leaves the tree unchanged
+        Key sep(right->values()[0].first);
+        g.self = nullptr;
+        r.leaf = nullptr;
+        link_after(l, right);
+        ++_size;
+        insert_separator(p, std::move(sep), right, r);
+        return result;
+    }
+    // Construct the element at position i of the leaf with free space. The gap is closed again if the construction throws
+    template <class... Args>
+    void put(leaf_node* l, size_type i, Args&&... args)
+    {
+        relocate_backward(l->values() + i + 1, l->values() + i, l->count - i);
+        struct guard
+        {
+            btree_map* self;
+            leaf_node* l;
+            size_type i;
+            ~guard()
+            {
+                if(self) { self->relocate_forward(l->values() + i, l->values() + i + 1, l->count - i); }
+            }
+        } g{ this, l, i };
+        alloc_traits::construct(_alloc, l->values() + i, std::forward<Args>(args)...);
+        g.self = nullptr;
+        ++l->count;
+    }
+    // Add separator key and the new right sibling child to the parents in p
+    void insert_separator(node_path& p, Key&& key, node_base* child, node_reserve& r)
+    {
+        Key sep(std::move(key));
+        for(size_type d = p.depth; d-- > 0;)
+        {
+            internal_node* n = p.e[d].node;
+            const size_type ci = p.e[d].index;
+            relocate_backward(n->keys() + ci + 1, n->keys() + ci, n->count - ci);
+            ::new(static_cast<void*>(n->keys() + ci)) Key(std::move(sep));
+            std::copy_backward(n->children + ci + 1, n->children + n->count + 1, n->children + n->count + 2);
+            n->children[ci + 1] = child;
+            if(++n->count <= internal_capacity) { return; }
+
+            // Overflowed: the middle key moves up, the keys after it go to the new right node
+            internal_node* right = r.take();
+            const size_type mid = n->count / 2;
+            right->count = static_cast<std::uint32_t>(n->count - mid - 1);
+            relocate_forward(right->keys(), n->keys() + mid + 1, right->count);
+            std::copy(n->children + mid + 1, n->children + n->count + 1, right->children);
+            sep = std::move(n->keys()[mid]);
+            n->keys()[mid].~Key();
+            n->count = static_cast<std::uint32_t>(mid);
+            child = right;
+        }
+        internal_node* root = r.take();
+        ::new(static_cast<void*>(root->keys())) Key(std::move(sep));
+        root->children[0] = _root;
+        root->children[1] = child;
+        root->count = 1;
+        _root = root;
+    }
+    ///@}
+
+    ///@name Erasure
+    ///@{
+    template <class K>
+    size_type erase_key(const K& key)
+    {
+        if(!_root) { return 0; }
+        node_path p;
+        auto l = descend(key, p);
+        auto i = leaf_lower_bound(l, key);
+        if(i == l->count || _comp(key, l->values()[i].first)) { return 0; }
+        erase_at(p, l, i);
+        return 1;
+    }
+    // Erase position i of leaf l reached through p, then borrow from or merge with a sibling if underfull
+    iterator erase_at(node_path& p, leaf_node* l, size_type i)
+    {
+        alloc_traits::destroy(_alloc, l->values() + i);
+        relocate_forward(l->values() + i, l->values() + i + 1, l->count - i - 1);
+        --l->count;
+        --_size;
+        if(p.depth == 0)
+        {
+            if(l->count == 0)
+            {
+                unlink(l);
+                free_leaf(l);
+                _root = nullptr;
+                return iterator();
+            }
+            return make_iterator(l, i);
+        }
+        if(l->count >= min_leaf) { return make_iterator(l, i); }
+
+        internal_node* parent = p.e[p.depth - 1].node;
+        const size_type ci = p.e[p.depth - 1].index;
+        auto left = ci > 0 ? static_cast<leaf_node*>(parent->children[ci - 1]) : nullptr;
+        auto right = ci < parent->count ? static_cast<leaf_node*>(parent->children[ci + 1]) : nullptr;
+        if(left && left->count > min_leaf)
+        {
+            relocate_backward(l->values() + 1, l->values(), l->count);
+            relocate(l->values(), left->values() + left->count - 1);
+            --left->count;
+            ++l->count;
+            parent->keys()[ci - 1] = l->values()[0].first;
+            return make_iterator(l, i + 1);
+        }
+        if(right && right->count > min_leaf)
+        {
+            relocate(l->values() + l->count, right->values());
+            relocate_forward(right->values(), right->values() + 1, right->count - 1);
+            --right->count;
+            ++l->count;
+            parent->keys()[ci] = right->values()[0].first;
+            return make_iterator(l, i);
+        }
+        leaf_node* pos_leaf;
+        size_type pos;
+        if(left)
+        {
+            pos_leaf = left;
+            pos = left->count + i;
+            merge_leaves(left, l);
+            remove_child(parent, ci - 1);
+        }
+        else
+        {
+            pos_leaf = l;
+            pos = i;
+            merge_leaves(l, right);
+            remove_child(parent, ci);
+        }
+        rebalance_internal(p, p.depth - 1);
+        return make_iterator(pos_leaf, pos);
+    }
+    // Move all elements of right to the end of left and free right
+    void merge_leaves(leaf_node* left, leaf_node* right)
+    {
+        relocate_forward(left->values() + left->count, right->values(), right->count);
+        left->count += right->count;
+        unlink(right);
+        free_leaf(right);
+    }
+    // Remove keys[k] and children[k + 1]
+    void remove_child(internal_node* n, size_type k)
+    {
+        n->keys()[k].~Key();
+        relocate_forward(n->keys() + k, n->keys() + k + 1, n->count - k - 1);
+        std::copy(n->children + k + 2, n->children + n->count + 1, n->children + k + 1);
+        --n->count;
+    }
+    // Fix underfull internal nodes from depth d up to the root
+    void rebalance_internal(node_path& p, size_type d)
+    {
+        for(;; --d)
+        {
+            internal_node* n = p.e[d].node;
+            if(d == 0)
+            {
+                if(n->count == 0)
+                {
+                    _root = n->children[0];
+                    free_internal(n);
+                }
+                return;
+            }
+            if(n->count >= min_internal) { return; }
+
+            internal_node* parent = p.e[d - 1].node;
+            const size_type ci = p.e[d - 1].index;
+            auto left = ci > 0 ? static_cast<internal_node*>(parent->children[ci - 1]) : nullptr;
+            auto right = ci < parent->count ? static_cast<internal_node*>(parent->children[ci + 1]) : nullptr;
+            if(left && left->count > min_internal)
+            {
+                // Rotate: parent separator comes down in front, last key of left goes up
+                relocate_backward(n->keys() + 1, n->keys(), n->count);
+                std::copy_backward(n->children, n->children + n->count + 1, n->children + n->count + 2);
+                relocate(n->keys(), parent->keys() + ci - 1);
+                n->children[0] = left->children[left->count];
+                relocate(parent->keys() + ci - 1, left->keys() + left->count - 1);
+                --left->count;
+                ++n->count;
+                return;
+            }
+            if(right && right->count > min_internal)
+            {
+                relocate(n->keys() + n->count, parent->keys() + ci);
+                n->children[n->count + 1] = right->children[0];
+                relocate(parent->keys() + ci, right->keys());
+                relocate_forward(right->keys(), right->keys() + 1, right->count - 1);
+                std::copy(right->children + 1, right->children + right->count + 1, right->children);
+                --right->count;
+                ++n->count;
+                return;
+            }
+            if(left)
+            {
+                merge_internals(left, parent->keys() + ci - 1, n);
+                remove_child(parent, ci - 1);
+            }
+            else
+            {
+                merge_internals(n, parent->keys() + ci, right);
+                remove_child(parent, ci);
+            }
+        }
+    }
+    // Append separator (moved from, the parent removes it) and all of right to left, and free right
+    void merge_internals(internal_node* left, Key* separator, internal_node* right)
+    {
+        ::new(static_cast<void*>(left->keys() + left->count)) Key(std::move(*separator));
+        relocate_forward(left->keys() + left->count + 1, right->keys(), right->count);
+        std::copy(right->children, right->children + right->count + 1, left->children + left->count + 1);
+        left->count += right->count + 1;
+        right->count = 0;
+        free_internal(right);
+    }
+    ///@}
+
+    // Bulk load into the empty tree: fill leaves in order, then build each level over the one below
+    template <class InputIt>
+    void build_sorted(InputIt first, InputIt last)
+    {
+        struct entry
+        {
+            node_base* node;
+            const Key* min_key;
+        };
+        std::vector<entry> level, next;
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+        try
+#endif
+        {
+            leaf_node* l{};
+            for(; first != last; ++first)
+            {
+                if(!l || l->count == leaf_capacity)
+                {
+                    level.reserve(level.size() + 1);
+                    l = new_leaf();
+                    link_after(_last, l);
+                    level.push_back({ l, nullptr });
+                }
+                alloc_traits::construct(_alloc, l->values() + l->count, *first);
+                ++l->count;
+                ++_size;
+            }
+            for(auto& e : level) { e.min_key = &static_cast<leaf_node*>(e.node)->values()[0].first; }
+            while(level.size() > 1)
+            {
+                // Spread the children evenly, so every node has 2 or more
+                const size_type groups = (level.size() + internal_capacity) / (internal_capacity + 1);
+                const size_type base = level.size() / groups, extra = level.size() % groups;
+                next.clear();
+                next.reserve(groups);
+                for(size_type g = 0, k = 0; g < groups; ++g)
+                {
+                    const size_type n = base + (g < extra);
+                    auto in = new_internal();
+                    next.push_back({ in, level[k].min_key });
+                    in->children[0] = level[k].node;
+                    level[k].node = nullptr;
+                    for(size_type j = 1; j < n; ++j)
+                    {
+                        ::new(static_cast<void*>(in->keys() + j - 1)) Key(*level[k + j].min_key);
+                        in->children[j] = level[k + j].node;
+                        level[k + j].node = nullptr;
+                        in->count = static_cast<std::uint32_t>(j);
+                    }
+                    k += n;
+                }
+                level.swap(next);
+            }
+            _root = level.empty() ? nullptr : level[0].node;
+        }
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+        catch(...)
+        {
+            for(auto& e : level) { free_internals(e.node); }
+            for(auto& e : next) { free_internals(e.node); }
+            _root = nullptr;
+            clear();
+            throw;
+        }
+#endif
+    }
+
+    node_base* _root{};
+    leaf_node* _first{};
+    leaf_node* _last{};
+    size_type _size{};
+    Compare _comp{};
+    Allocator _alloc{};
+};
+
+/*!
+  @brief Erase all elements satisfying the predicate
+  @return Number of erased elements
+ */
+template <class Key, class T, class Compare, class Allocator, std::size_t NodeSize, class Pred>
+typename btree_map<Key, T, Compare, Allocator, NodeSize>::size_type erase_if(btree_map<Key, T, Compare, Allocator, NodeSize>& c, Pred pred)
+{
+    auto n = c.size();
+    for(auto it = c.begin(); it != c.end();)
+    {
+        if(pred(*it)) { it = c.erase(it); }
+        else { ++it; }
+    }
+    return n - c.size();
+}
+
+}
+#endif
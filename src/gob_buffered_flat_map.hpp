@@ -0,0 +1,553 @@
+/*!
+  @file gob_buffered_flat_map.hpp
+  @brief Sorted vector based map with an unsorted insertion buffer
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_BUFFERED_FLAT_MAP_HPP
+#define GOB_BUFFERED_FLAT_MAP_HPP
+
+#include <vector>
+#include <utility>
+#include <functional>
+#include <algorithm>
+#include <iterator>
+#include <initializer_list>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <cstddef>
+#include "internal/gob_stdmap_detail.hpp"
+
+namespace goblib {
+
+/*!
+  @class buffered_flat_map
+  @brief Sorted vector based map which defers sorting of new elements
+  @details Elements are kept as std::pair<Key, T> in one contiguous array: a body sorted by key,
+  followed by a small unsorted tail. New elements are appended to the tail in O(1), and lookups
+  binary search the body then scan the tail. The tail is sorted and merged into the body in one pass
+  when it grows past buffer_limit(), or when ordered access starts (begin(), lower_bound(), ...).
+  With the default limit of about sqrt(N), interleaved insertion and lookup cost O(sqrt(N)) each
+  instead of the O(N) element shifting per insertion of flat_map.
+  @tparam Key Key type
+  @tparam T Mapped type
+  @tparam Compare Compare function object for the key
+  @tparam Allocator Allocator for std::pair<Key, T>
+  @note The interface is the same as std::map with the following differences.
+  - value_type is std::pair<Key, T> (not const Key). Do not modify the key through an iterator.
+  - Insertion and erasure invalidate iterators, pointers and references.
+  - begin(), rbegin(), lower_bound(), upper_bound(), equal_range() and the comparison operators merge the tail first,
+    even on a const map. Call flush() before sharing a const map between threads.
+  - find() may return an iterator into the tail. It is valid for access and erase,
+    but elements follow in key order only after flush().
+  - end() and rend() do not merge, so `it != m.end()` keeps the result of find() valid.
+ */
+template <class Key, class T, class Compare = std::less<Key>,
+          class Allocator = std::allocator<std::pair<Key, T>>>
+class buffered_flat_map
+{
+  public:
+    ///@name Member types
+    ///@{
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<Key, T>;
+    using key_compare = Compare;
+    using allocator_type = Allocator;
+    using container_type = std::vector<value_type, Allocator>;
+    using size_type = typename container_type::size_type;
+    using difference_type = typename container_type::difference_type;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = typename std::allocator_traits<Allocator>::pointer;
+    using const_pointer = typename std::allocator_traits<Allocator>::const_pointer;
+    using iterator = typename container_type::iterator;
+    using const_iterator = typename container_type::const_iterator;
+    using reverse_iterator = typename container_type::reverse_iterator;
+    using const_reverse_iterator = typename container_type::const_reverse_iterator;
+    ///@}
+
+    //! @brief Smallest automatic buffer limit
+    static constexpr size_type min_buffer_limit = 16;
+
+    //! @brief Compare value_type by key
+    class value_compare
+    {
+        friend class buffered_flat_map;
+      public:
+        bool operator()(const value_type& a, const value_type& b) const { return comp(a.first, b.first); }
+      protected:
+        explicit value_compare(Compare c) : comp(c) {}
+        Compare comp;
+    };
+
+    ///@name Constructor
+    ///@{
+    buffered_flat_map() : buffered_flat_map(Compare()) {}
+    explicit buffered_flat_map(const Compare& comp, const Allocator& alloc = Allocator()) : _vec(alloc), _comp(comp) {}
+    explicit buffered_flat_map(const Allocator& alloc) : _vec(alloc), _comp() {}
+    template <class InputIt>
+    buffered_flat_map(InputIt first, InputIt last, const Compare& comp = Compare(), const Allocator& alloc = Allocator())
+            : _vec(alloc), _comp(comp)
+    {
+        insert(first, last);
+    }
+    template <class InputIt>
+    buffered_flat_map(InputIt first, InputIt last, const Allocator& alloc) : buffered_flat_map(first, last, Compare(), alloc) {}
+    //! @brief Construct from the range sorted by key without equivalent keys
+    template <class InputIt>
+    buffered_flat_map(sorted_unique_t, InputIt first, InputIt last, const Compare& comp = Compare(), const Allocator& alloc = Allocator())
+            : _vec(first, last, alloc), _sorted(_vec.size()), _comp(comp) {}
+    buffered_flat_map(std::initializer_list<value_type> il, const Compare& comp = Compare(), const Allocator& alloc = Allocator())
+            : buffered_flat_map(il.begin(), il.end(), comp, alloc) {}
+    buffered_flat_map(std::initializer_list<value_type> il, const Allocator& alloc) : buffered_flat_map(il, Compare(), alloc) {}
+    buffered_flat_map(const buffered_flat_map&) = default;
+    buffered_flat_map(buffered_flat_map&& o) noexcept(std::is_nothrow_move_constructible<Compare>::value)
+            : _vec(std::move(o._vec)), _sorted(o._sorted), _limit(o._limit), _comp(std::move(o._comp))
+    {
+        o._vec.clear();
+        o._sorted = 0;
+    }
+    ///@}
+
+    ///@name Assignment
+    ///@{
+    buffered_flat_map& operator=(const buffered_flat_map&) = default;
+    buffered_flat_map& operator=(buffered_flat_map&& o) noexcept(std::is_nothrow_move_assignable<Compare>::value)
+    {
+        if(this != &o)
+        {
+            _vec = std::move(o._vec);
+            _sorted = o._sorted;
+            _limit = o._limit;
+            _comp = std::move(o._comp);
+            o._vec.clear();
+            o._sorted = 0;
+        }
+        return *this;
+    }
+    buffered_flat_map& operator=(std::initializer_list<value_type> il)
+    {
+        clear();
+        insert(il);
+        return *this;
+    }
+    ///@}
+
+    allocator_type get_allocator() const noexcept { return _vec.get_allocator(); }
+
+    ///@name Element access
+    ///@{
+    T& at(const Key& key)
+    {
+        auto i = find_index(key);
+        if(i == size()) { stdmap_detail::throw_out_of_range("buffered_flat_map::at"); }
+        return _vec[i].second;
+    }
+    const T& at(const Key& key) const
+    {
+        auto i = find_index(key);
+        if(i == size()) { stdmap_detail::throw_out_of_range("buffered_flat_map::at"); }
+        return _vec[i].second;
+    }
+    T& operator[](const Key& key) { return try_emplace(key).first->second; }
+    T& operator[](Key&& key) { return try_emplace(std::move(key)).first->second; }
+    ///@}
+
+    ///@name Iterators
+    ///@{
+    iterator begin()
+    {
+        flush();
+        return _vec.begin();
+    }
+    const_iterator begin() const
+    {
+        flush();
+        return _vec.begin();
+    }
+    const_iterator cbegin() const { return begin(); }
+    iterator end() noexcept { return _vec.end(); }
+    const_iterator end() const noexcept { return _vec.end(); }
+    const_iterator cend() const noexcept { return _vec.cend(); }
+    reverse_iterator rbegin()
+    {
+        flush();
+        return _vec.rbegin();
+    }
+    const_reverse_iterator rbegin() const
+    {
+        flush();
+        return _vec.rbegin();
+    }
+    const_reverse_iterator crbegin() const { return rbegin(); }
+    reverse_iterator rend() noexcept { return _vec.rend(); }
+    const_reverse_iterator rend() const noexcept { return _vec.rend(); }
+    const_reverse_iterator crend() const noexcept { return _vec.crend(); }
+    ///@}
+
+    ///@name Capacity
+    ///@{
+    bool empty() const noexcept { return _vec.empty(); }
+    size_type size() const noexcept { return _vec.size(); }
+    size_type max_size() const noexcept { return _vec.max_size(); }
+    //! @brief Number of elements that can be held without reallocation
+    size_type capacity() const noexcept { return _vec.capacity(); }
+    //! @brief Reserve storage for at least n elements
+    void reserve(size_type n) { _vec.reserve(n); }
+    //! @brief Release unused capacity
+    void shrink_to_fit() { _vec.shrink_to_fit(); }
+    ///@}
+
+    ///@name Insertion buffer
+    ///@{
+    //! @brief Number of elements waiting in the unsorted tail
+    size_type buffered() const noexcept { return _vec.size() - _sorted; }
+    //! @brief Tail size which triggers a merge. The one set by set_buffer_limit, or max(min_buffer_limit, sqrt(size()))
+    size_type buffer_limit() const noexcept { return _limit ? _limit : std::max(min_buffer_limit, isqrt(_sorted)); }
+    //! @brief Set the tail size which triggers a merge (0: automatic). Larger limits favour insertion, smaller ones lookup
+    void set_buffer_limit(size_type n) noexcept { _limit = n; }
+    //! @brief Sort the tail and merge it into the body. O(B log B + N) for B buffered elements
+    void flush() const
+    {
+        if(_sorted == _vec.size()) { return; }
+        auto mid = _vec.begin() + static_cast<difference_type>(_sorted);
+        std::sort(mid, _vec.end(), value_comp());
+        if(_sorted && _comp(mid->first, std::prev(mid)->first)) { std::inplace_merge(_vec.begin(), mid, _vec.end(), value_comp()); }
+        _sorted = _vec.size();
+    }
+    ///@}
+
+    ///@name Modifiers
+    ///@{
+    void clear() noexcept
+    {
+        _vec.clear();
+        _sorted = 0;
+    }
+
+    std::pair<iterator, bool> insert(const value_type& v) { return try_emplace_impl(v.first, v.second); }
+    std::pair<iterator, bool> insert(value_type&& v) { return try_emplace_impl(std::move(v.first), std::move(v.second)); }
+    template <class P, typename std::enable_if<std::is_constructible<value_type, P&&>::value, std::nullptr_t>::type = nullptr>
+    std::pair<iterator, bool> insert(P&& v) { return emplace(std::forward<P>(v)); }
+    iterator insert(const_iterator hint, const value_type& v)
+    {
+        (void)hint;
+        return insert(v).first;
+    }
+    iterator insert(const_iterator hint, value_type&& v)
+    {
+        (void)hint;
+        return insert(std::move(v)).first;
+    }
+    /*!
+      @brief Insert elements of the range
+      @details The tail is merged, then the new elements are sorted, deduplicated and merged in one pass.
+      Existing elements win over equivalent new keys.
+     */
+    template <class InputIt>
+    void insert(InputIt first, InputIt last)
+    {
+        flush();
+        auto n = size();
+        _vec.insert(_vec.end(), first, last);
+        merge_appended(n, false);
+    }
+    //! @brief Insert elements of the range sorted by key without equivalent keys. O(M + N)
+    template <class InputIt>
+    void insert(sorted_unique_t, InputIt first, InputIt last)
+    {
+        flush();
+        auto n = size();
+        _vec.insert(_vec.end(), first, last);
+        merge_appended(n, true);
+    }
+    void insert(std::initializer_list<value_type> il) { insert(il.begin(), il.end()); }
+
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(const Key& key, M&& obj) { return insert_or_assign_impl(key, std::forward<M>(obj)); }
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(Key&& key, M&& obj) { return insert_or_assign_impl(std::move(key), std::forward<M>(obj)); }
+    template <class M>
+    iterator insert_or_assign(const_iterator hint, const Key& key, M&& obj)
+    {
+        (void)hint;
+        return insert_or_assign_impl(key, std::forward<M>(obj)).first;
+    }
+    template <class M>
+    iterator insert_or_assign(const_iterator hint, Key&& key, M&& obj)
+    {
+        (void)hint;
+        return insert_or_assign_impl(std::move(key), std::forward<M>(obj)).first;
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        if constexpr(stdmap_detail::is_key_mapped_args<Key, Args...>::value) { return try_emplace_impl(std::forward<Args>(args)...); }
+        else
+        {
+            value_type v(std::forward<Args>(args)...);
+            return try_emplace_impl(std::move(v.first), std::move(v.second));
+        }
+    }
+    template <class... Args>
+    iterator emplace_hint(const_iterator hint, Args&&... args)
+    {
+        (void)hint;
+        return emplace(std::forward<Args>(args)...).first;
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) { return try_emplace_impl(key, std::forward<Args>(args)...); }
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(Key&& key, Args&&... args) { return try_emplace_impl(std::move(key), std::forward<Args>(args)...); }
+    template <class... Args>
+    iterator try_emplace(const_iterator hint, const Key& key, Args&&... args)
+    {
+        (void)hint;
+        return try_emplace_impl(key, std::forward<Args>(args)...).first;
+    }
+    template <class... Args>
+    iterator try_emplace(const_iterator hint, Key&& key, Args&&... args)
+    {
+        (void)hint;
+        return try_emplace_impl(std::move(key), std::forward<Args>(args)...).first;
+    }
+
+    iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+    iterator erase(const_iterator pos) { return erase(pos, std::next(pos)); }
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        auto f = static_cast<size_type>(first - _vec.cbegin());
+        auto l = static_cast<size_type>(last - _vec.cbegin());
+        _sorted -= std::min(l, _sorted) - std::min(f, _sorted);
+        return _vec.erase(first, last);
+    }
+    size_type erase(const Key& key) { return erase_key(key); }
+
+    void swap(buffered_flat_map& o) noexcept(std::is_nothrow_swappable<Compare>::value)
+    {
+        using std::swap;
+        _vec.swap(o._vec);
+        swap(_sorted, o._sorted);
+        swap(_limit, o._limit);
+        swap(_comp, o._comp);
+    }
+    ///@}
+
+    ///@name Lookup
+    ///@{
+    size_type count(const Key& key) const { return contains(key) ? 1 : 0; }
+    iterator find(const Key& key) { return _vec.begin() + static_cast<difference_type>(find_index(key)); }
+    const_iterator find(const Key& key) const { return _vec.cbegin() + static_cast<difference_type>(find_index(key)); }
+    bool contains(const Key& key) const { return find_index(key) != size(); }
+    iterator lower_bound(const Key& key) { return std::lower_bound(begin(), end(), key, key_less()); }
+    const_iterator lower_bound(const Key& key) const { return std::lower_bound(begin(), end(), key, key_less()); }
+    iterator upper_bound(const Key& key) { return std::upper_bound(begin(), end(), key, key_less()); }
+    const_iterator upper_bound(const Key& key) const { return std::upper_bound(begin(), end(), key, key_less()); }
+    std::pair<iterator, iterator> equal_range(const Key& key)
+    {
+        auto it = lower_bound(key);
+        return { it, (it != end() && !_comp(key, it->first)) ? std::next(it) : it };
+    }
+    std::pair<const_iterator, const_iterator> equal_range(const Key& key) const
+    {
+        auto it = lower_bound(key);
+        return { it, (it != end() && !_comp(key, it->first)) ? std::next(it) : it };
+    }
+    ///@}
+
+    /*!
+      @name Heterogeneous lookup
+      @brief Available if Compare::is_transparent exists (e.g. std::less<>)
+     */
+    ///@{
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    size_type count(const K& key) const { return contains(key) ? 1 : 0; }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    iterator find(const K& key) { return _vec.begin() + static_cast<difference_type>(find_index(key)); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    const_iterator find(const K& key) const { return _vec.cbegin() + static_cast<difference_type>(find_index(key)); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    bool contains(const K& key) const { return find_index(key) != size(); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    iterator lower_bound(const K& key) { return std::lower_bound(begin(), end(), key, key_less()); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    const_iterator lower_bound(const K& key) const { return std::lower_bound(begin(), end(), key, key_less()); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    iterator upper_bound(const K& key) { return std::upper_bound(begin(), end(), key, key_less()); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    const_iterator upper_bound(const K& key) const { return std::upper_bound(begin(), end(), key, key_less()); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    std::pair<iterator, iterator> equal_range(const K& key)
+    {
+        auto it = lower_bound(key);
+        return { it, (it != end() && !_comp(key, it->first)) ? std::next(it) : it };
+    }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    std::pair<const_iterator, const_iterator> equal_range(const K& key) const
+    {
+        auto it = lower_bound(key);
+        return { it, (it != end() && !_comp(key, it->first)) ? std::next(it) : it };
+    }
+    template <class K, class C = Compare, stdmap_detail::if_transparent_erase<C, K, iterator, const_iterator> = nullptr>
+    size_type erase(K&& key) { return erase_key(key); }
+    ///@}
+
+    ///@name Observers
+    ///@{
+    key_compare key_comp() const { return _comp; }
+    value_compare value_comp() const { return value_compare(_comp); }
+    ///@}
+
+    ///@name Comparison
+    ///@{
+    friend bool operator==(const buffered_flat_map& a, const buffered_flat_map& b)
+    {
+        a.flush();
+        b.flush();
+        return a._vec == b._vec;
+    }
+    friend bool operator!=(const buffered_flat_map& a, const buffered_flat_map& b) { return !(a == b); }
+    friend bool operator<(const buffered_flat_map& a, const buffered_flat_map& b)
+    {
+        a.flush();
+        b.flush();
+        return a._vec < b._vec;
+    }
+    friend bool operator>(const buffered_flat_map& a, const buffered_flat_map& b) { return b < a; }
+    friend bool operator<=(const buffered_flat_map& a, const buffered_flat_map& b) { return !(b < a); }
+    friend bool operator>=(const buffered_flat_map& a, const buffered_flat_map& b) { return !(a < b); }
+    friend void swap(buffered_flat_map& a, buffered_flat_map& b) noexcept(noexcept(a.swap(b))) { a.swap(b); }
+    ///@}
+
+  private:
+    // Heterogeneous compare for std::lower_bound / std::upper_bound
+    struct key_less_value
+    {
+        const Compare& comp;
+        template <class K>
+        bool operator()(const value_type& v, const K& k) const { return comp(v.first, k); }
+        template <class K>
+        bool operator()(const K& k, const value_type& v) const { return comp(k, v.first); }
+    };
+    key_less_value key_less() const { return { _comp }; }
+
+    static size_type isqrt(size_type n) noexcept
+    {
+        size_type r{};
+        for(size_type bit = size_type(1) << (sizeof(size_type) * 4 - 1); bit; bit >>= 1)
+        {
+            if((r | bit) <= n / (r | bit)) { r |= bit; }
+        }
+        return r;
+    }
+
+    // Index of the key (binary search of the body, then linear scan of the tail), or size() if not found
+    template <class K>
+    size_type find_index(const K& key) const
+    {
+        auto body = _vec.cbegin() + static_cast<difference_type>(_sorted);
+        auto it = std::lower_bound(_vec.cbegin(), body, key, key_less());
+        if(it != body && !_comp(key, it->first)) { return static_cast<size_type>(it - _vec.cbegin()); }
+        for(size_type i = _sorted; i < _vec.size(); ++i)
+        {
+            if(!_comp(key, _vec[i].first) && !_comp(_vec[i].first, key)) { return i; }
+        }
+        return _vec.size();
+    }
+
+    template <class K>
+    size_type erase_key(const K& key)
+    {
+        auto i = find_index(key);
+        if(i == size()) { return 0; }
+        erase(_vec.cbegin() + static_cast<difference_type>(i));
+        return 1;
+    }
+
+    bool equivalent(const value_type& a, const value_type& b) const { return !_comp(a.first, b.first) && !_comp(b.first, a.first); }
+
+    // Sort (unless sorted) and deduplicate the elements appended after the first n (all sorted), then merge them
+    void merge_appended(size_type n, bool sorted)
+    {
+        auto eq = [this](const value_type& a, const value_type& b) { return equivalent(a, b); };
+        auto mid = _vec.begin() + static_cast<difference_type>(n);
+        if(!sorted) { std::stable_sort(mid, _vec.end(), value_comp()); }
+        _vec.erase(std::unique(mid, _vec.end(), eq), _vec.end());
+        mid = _vec.begin() + static_cast<difference_type>(n);
+        if(n != 0 && mid != _vec.end() && !_comp(std::prev(mid)->first, mid->first))
+        {
+            // Stable merge puts the existing element first among equivalents, so unique keeps it
+            std::inplace_merge(_vec.begin(), mid, _vec.end(), value_comp());
+            _vec.erase(std::unique(_vec.begin(), _vec.end(), eq), _vec.end());
+        }
+        _sorted = _vec.size();
+    }
+
+    // Append a new element to the tail. A full tail is merged first, so the new element is always the last one.
+    // The merge moves elements, so the element is built before it from a key or arguments referring to an element
+    template <class K, class... Args>
+    iterator append(K&& key, Args&&... args)
+    {
+        if(buffered() >= buffer_limit())
+        {
+            if(stdmap_detail::args_refer_into(_vec.data(), _vec.data() + _vec.size(), key, args...))
+            {
+                value_type v(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                             std::forward_as_tuple(std::forward<Args>(args)...));
+                flush();
+                _vec.push_back(std::move(v));
+                return std::prev(_vec.end());
+            }
+            flush();
+        }
+        _vec.emplace_back(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                          std::forward_as_tuple(std::forward<Args>(args)...));
+        return std::prev(_vec.end());
+    }
+
+    template <class K, class... Args>
+    std::pair<iterator, bool> try_emplace_impl(K&& key, Args&&... args)
+    {
+        auto i = find_index(key);
+        if(i != size()) { return { _vec.begin() + static_cast<difference_type>(i), false }; }
+        return { append(std::forward<K>(key), std::forward<Args>(args)...), true };
+    }
+
+    template <class K, class M>
+    std::pair<iterator, bool> insert_or_assign_impl(K&& key, M&& obj)
+    {
+        auto i = find_index(key);
+        if(i != size())
+        {
+            _vec[i].second = std::forward<M>(obj);
+            return { _vec.begin() + static_cast<difference_type>(i), false };
+        }
+        return { append(std::forward<K>(key), std::forward<M>(obj)), true };
+    }
+
+    // The body [0, _sorted) is sorted, the tail [_sorted, size()) is not. Both are mutable so that const access can merge
+    mutable container_type _vec{};
+    mutable size_type _sorted{};
+    size_type _limit{};
+    Compare _comp{};
+};
+
+/*!
+  @brief Erase all elements satisfying the predicate
+  @return Number of erased elements
+ */
+template <class Key, class T, class Compare, class Allocator, class Pred>
+typename buffered_flat_map<Key, T, Compare, Allocator>::size_type erase_if(buffered_flat_map<Key, T, Compare, Allocator>& c, Pred pred)
+{
+    auto it = std::remove_if(c.begin(), c.end(), pred);
+    auto n = static_cast<typename buffered_flat_map<Key, T, Compare, Allocator>::size_type>(std::distance(it, c.end()));
+    c.erase(it, c.end());
+    return n;
+}
+
+}
+#endif
@@ -0,0 +1,304 @@
+/*!
+  @file gob_concurrent_hash_map.hpp
+  @brief Sharded concurrent hash map
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_CONCURRENT_HASH_MAP_HPP
+#define GOB_CONCURRENT_HASH_MAP_HPP
+
+#include <mutex>
+#include <algorithm>
+#include <thread>
+#include <memory>
+#include <optional>
+#include <functional>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include "internal/gob_stdmap_detail.hpp"
+#include "gob_hash_map.hpp"
+
+namespace goblib {
+
+/*!
+  @class concurrent_hash_map
+  @brief Thread-safe hash map partitioned into independently locked shards
+  @details Keys are distributed over a power-of-two number of shards by the upper bits of the mixed hash.
+  Each shard is a goblib::hash_map with its own mutex, padded to a cache line, so threads working
+  on different shards neither wait for each other nor share cache lines.
+  Every operation locks only the shard of the key, and is atomic per key.
+  @tparam Key Key type
+  @tparam T Mapped type
+  @tparam Hash Hash function object
+  @tparam KeyEqual Equality function object for the key
+  @tparam Allocator Allocator for std::pair<const Key, T>
+  @note There are no iterators. Values are accessed by copy (get), or by callbacks (visit, update)
+  called while the shard is locked. Callbacks must not access the same map.
+  size() and for_each() lock the shards one at a time, so they are not a snapshot under concurrent writes.
+ */
+template <class Key, class T, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>,
+          class Allocator = std::allocator<std::pair<const Key, T>>>
+class concurrent_hash_map
+{
+  public:
+    ///@name Member types
+    ///@{
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<const Key, T>;
+    using size_type = std::size_t;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using allocator_type = Allocator;
+    using map_type = hash_map<Key, T, Hash, KeyEqual, Allocator>;
+    ///@}
+
+    ///@name Constructor
+    ///@{
+    /*!
+      @param shards Number of shards (rounded up to a power of 2). 0 means 4 x hardware threads
+     */
+    explicit concurrent_hash_map(size_type shards = 0, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual(),
+                                 const Allocator& alloc = Allocator())
+            : _hash(hash)
+    {
+        if(!shards) { shards = 4 * std::max(1U, std::thread::hardware_concurrency()); }
+        size_type n = 1;
+        while(n < shards) { n <<= 1; ++_shift_bits; }
+        _shard_count = n;
+        _shards.reset(new shard[n]);
+        for(size_type i = 0; i < n; ++i) { _shards[i].map = map_type(0, hash, equal, alloc); }
+    }
+    concurrent_hash_map(const concurrent_hash_map&) = delete;
+    concurrent_hash_map& operator=(const concurrent_hash_map&) = delete;
+    ///@}
+
+    ///@name Capacity
+    ///@{
+    //! @brief Number of elements (sum over the shards)
+    size_type size() const
+    {
+        size_type n{};
+        for(size_type i = 0; i < _shard_count; ++i)
+        {
+            std::lock_guard<std::mutex> lock(_shards[i].mutex);
+            n += _shards[i].map.size();
+        }
+        return n;
+    }
+    bool empty() const { return size() == 0; }
+    //! @brief Reserve for n elements in total (spread evenly)
+    void reserve(size_type n)
+    {
+        const size_type per = (n + _shard_count - 1) / _shard_count;
+        for(size_type i = 0; i < _shard_count; ++i)
+        {
+            std::lock_guard<std::mutex> lock(_shards[i].mutex);
+            _shards[i].map.reserve(per);
+        }
+    }
+    size_type shard_count() const noexcept { return _shard_count; }
+    ///@}
+
+    ///@name Modifiers
+    ///@{
+    void clear()
+    {
+        for(size_type i = 0; i < _shard_count; ++i)
+        {
+            std::lock_guard<std::mutex> lock(_shards[i].mutex);
+            _shards[i].map.clear();
+        }
+    }
+    //! @return True if inserted
+    bool insert(const value_type& v) { return try_emplace(v.first, v.second); }
+    bool insert(value_type&& v) { return try_emplace(v.first, std::move(v.second)); }
+    //! @brief Construct the value from args if the key does not exist. @return True if inserted
+    template <class... Args>
+    bool try_emplace(const Key& key, Args&&... args)
+    {
+        auto& s = shard_of(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.map.try_emplace(key, std::forward<Args>(args)...).second;
+    }
+    template <class... Args>
+    bool try_emplace(Key&& key, Args&&... args)
+    {
+        auto& s = shard_of(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.map.try_emplace(std::move(key), std::forward<Args>(args)...).second;
+    }
+    //! @return True if inserted, false if assigned
+    template <class M>
+    bool insert_or_assign(const Key& key, M&& obj)
+    {
+        auto& s = shard_of(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.map.insert_or_assign(key, std::forward<M>(obj)).second;
+    }
+    template <class M>
+    bool insert_or_assign(Key&& key, M&& obj)
+    {
+        auto& s = shard_of(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.map.insert_or_assign(std::move(key), std::forward<M>(obj)).second;
+    }
+    /*!
+      @brief Call f(T&) on the value of the key
+      @return False if the key does not exist
+     */
+    template <class F>
+    bool update(const Key& key, F&& f)
+    {
+        auto& s = shard_of(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto it = s.map.find(key);
+        if(it == s.map.end()) { return false; }
+        std::forward<F>(f)(it->second);
+        return true;
+    }
+    /*!
+      @brief Call f(T&) on the value of the key, or insert T(args...) if the key does not exist
+      @return True if inserted
+      @code{.cpp}
+      counters.emplace_or_update(word, [](int& c) { ++c; }, 1);
+      @endcode
+     */
+    template <class F, class... Args>
+    bool emplace_or_update(const Key& key, F&& f, Args&&... args)
+    {
+        auto& s = shard_of(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto r = s.map.try_emplace(key, std::forward<Args>(args)...);
+        if(!r.second) { std::forward<F>(f)(r.first->second); }
+        return r.second;
+    }
+    //! @return Number of erased elements (0 or 1)
+    size_type erase(const Key& key)
+    {
+        auto& s = shard_of(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.map.erase(key);
+    }
+    /*!
+      @brief Erase the key if pred(T&) returns true
+      @return True if erased
+     */
+    template <class Pred>
+    bool erase_if(const Key& key, Pred&& pred)
+    {
+        auto& s = shard_of(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto it = s.map.find(key);
+        if(it == s.map.end() || !std::forward<Pred>(pred)(it->second)) { return false; }
+        s.map.erase(it);
+        return true;
+    }
+    ///@}
+
+    ///@name Lookup
+    ///@{
+    //! @brief Copy of the value, or std::nullopt
+    std::optional<T> get(const Key& key) const
+    {
+        auto& s = shard_of(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto it = s.map.find(key);
+        if(it == s.map.end()) { return std::nullopt; }
+        return it->second;
+    }
+    /*!
+      @brief Call f(const T&) on the value of the key
+      @return False if the key does not exist
+     */
+    template <class F>
+    bool visit(const Key& key, F&& f) const
+    {
+        auto& s = shard_of(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto it = s.map.find(key);
+        if(it == s.map.end()) { return false; }
+        std::forward<F>(f)(static_cast<const T&>(it->second));
+        return true;
+    }
+    bool contains(const Key& key) const
+    {
+        auto& s = shard_of(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.map.contains(key);
+    }
+    size_type count(const Key& key) const { return contains(key) ? 1 : 0; }
+    ///@}
+
+    ///@name Whole map
+    ///@{
+    //! @brief Call f(const Key&, T&) on every element, locking one shard at a time
+    template <class F>
+    void for_each(F f)
+    {
+        for(size_type i = 0; i < _shard_count; ++i)
+        {
+            std::lock_guard<std::mutex> lock(_shards[i].mutex);
+            for(auto& e : _shards[i].map) { f(e.first, e.second); }
+        }
+    }
+    template <class F>
+    void for_each(F f) const
+    {
+        for(size_type i = 0; i < _shard_count; ++i)
+        {
+            std::lock_guard<std::mutex> lock(_shards[i].mutex);
+            for(auto& e : _shards[i].map) { f(e.first, static_cast<const T&>(e.second)); }
+        }
+    }
+    //! @cond
+    template <class Pred>
+    size_type remove_if(Pred& pred)
+    {
+        size_type n{};
+        for(size_type i = 0; i < _shard_count; ++i)
+        {
+            std::lock_guard<std::mutex> lock(_shards[i].mutex);
+            n += goblib::erase_if(_shards[i].map, pred);
+        }
+        return n;
+    }
+    //! @endcond
+    ///@}
+
+  private:
+    struct alignas(stdmap_detail::cache_line_size) shard
+    {
+        mutable std::mutex mutex{};
+        map_type map{};
+    };
+
+    // Upper bits of the mixed hash. The shard map indexes its slots by the lower bits
+    shard& shard_of(const Key& key) const
+    {
+        if(!_shift_bits) { return _shards[0]; }
+        const auto h = stdmap_detail::mix_hash(static_cast<std::uint64_t>(_hash(key)));
+        return _shards[static_cast<size_type>(h >> (64 - _shift_bits))];
+    }
+
+    Hash _hash;
+    unsigned _shift_bits{};
+    size_type _shard_count{};
+    std::unique_ptr<shard[]> _shards{};
+};
+
+/*!
+  @brief Erase all elements satisfying the predicate, locking one shard at a time
+  @param pred Called with const std::pair<const Key, T>&
+  @return Number of erased elements
+ */
+template <class Key, class T, class Hash, class KeyEqual, class Allocator, class Pred>
+typename concurrent_hash_map<Key, T, Hash, KeyEqual, Allocator>::size_type erase_if(
+    concurrent_hash_map<Key, T, Hash, KeyEqual, Allocator>& c, Pred pred)
+{
+    return c.remove_if(pred);
+}
+
+}
+#endif
@@ -0,0 +1,223 @@
+/*!
+  @file gob_constexpr_map.hpp
+  @brief Map built and searched at compile time
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_CONSTEXPR_MAP_HPP
+#define GOB_CONSTEXPR_MAP_HPP
+
+#include <array>
+#include <utility>
+#include <functional>
+#include <iterator>
+#include <cstddef>
+#include "internal/gob_stdmap_detail.hpp"
+
+namespace goblib {
+
+namespace stdmap_detail {
+// Not constexpr. Reaching this while constant evaluating makes the program ill-formed, and at run time it throws
+[[noreturn]] inline void constexpr_map_duplicate_key()
+{
+    throw_invalid_argument("constexpr_map: duplicate keys");
+}
+
+// Sorted order of src as an index permutation (insertion sort, stable)
+template <class V, std::size_t N, class Compare>
+constexpr std::array<std::size_t, N> sorted_order(const V (&src)[N], const Compare& comp)
+{
+    std::array<std::size_t, N> idx{};
+    for(std::size_t i = 0; i < N; ++i) { idx[i] = i; }
+    for(std::size_t i = 1; i < N; ++i)
+    {
+        const std::size_t v = idx[i];
+        std::size_t j = i;
+        while(j > 0 && comp(src[v].first, src[idx[j - 1]].first))
+        {
+            idx[j] = idx[j - 1];
+            --j;
+        }
+        idx[j] = v;
+    }
+    for(std::size_t i = 1; i < N; ++i)
+    {
+        if(!comp(src[idx[i - 1]].first, src[idx[i]].first)) { constexpr_map_duplicate_key(); }
+    }
+    return idx;
+}
+}  // namespace stdmap_detail
+
+/*!
+  @class constexpr_map
+  @brief Immutable map whose elements are sorted at compile time
+  @details Elements are kept in std::array<std::pair<Key, T>, N> sorted by key.
+  A constexpr object is placed in read-only data, costs nothing at startup and never allocates.
+  All lookups can be evaluated as constant expressions.
+  @tparam Key Key type (literal type)
+  @tparam T Mapped type (literal type)
+  @tparam N Number of elements
+  @tparam Compare Compare function object for the key (constexpr callable)
+  @note Duplicate keys are a compile error when constructed in a constant expression,
+  and throw std::invalid_argument when constructed at run time.
+  @code{.cpp}
+  constexpr auto table = goblib::make_constexpr_map<int, const char*>({ {2, "two"}, {1, "one"} });
+  static_assert(table.at(1)[0] == 'o', "");
+  @endcode
+ */
+template <class Key, class T, std::size_t N, class Compare = std::less<Key>>
+class constexpr_map
+{
+  public:
+    ///@name Member types
+    ///@{
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<Key, T>;
+    using key_compare = Compare;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = const value_type&;
+    using const_reference = const value_type&;
+    using iterator = const value_type*;
+    using const_iterator = const value_type*;
+    using reverse_iterator = std::reverse_iterator<const_iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    ///@}
+
+    ///@name Constructor
+    ///@{
+    //! @brief Build from the array of elements (need not be sorted)
+    constexpr explicit constexpr_map(const value_type (&src)[N], const Compare& comp = Compare())
+            : constexpr_map(src, stdmap_detail::sorted_order(src, comp), comp, std::make_index_sequence<N>{}) {}
+    ///@}
+
+    ///@name Element access
+    ///@{
+    constexpr const T& at(const Key& key) const
+    {
+        auto i = find_index(key);
+        if(i == N) { stdmap_detail::throw_out_of_range("constexpr_map::at"); }
+        return _data[i].second;
+    }
+    //! @brief Mapped value of key, or def if not found
+    constexpr T value_or(const Key& key, const T& def) const
+    {
+        auto i = find_index(key);
+        return i != N ? _data[i].second : def;
+    }
+    ///@}
+
+    ///@name Iterators
+    ///@{
+    constexpr const_iterator begin() const noexcept { return _data.data(); }
+    constexpr const_iterator cbegin() const noexcept { return begin(); }
+    constexpr const_iterator end() const noexcept { return _data.data() + N; }
+    constexpr const_iterator cend() const noexcept { return end(); }
+    constexpr const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+    constexpr const_reverse_iterator crbegin() const noexcept { return rbegin(); }
+    constexpr const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+    constexpr const_reverse_iterator crend() const noexcept { return rend(); }
+    ///@}
+
+    ///@name Capacity
+    ///@{
+    constexpr bool empty() const noexcept { return N == 0; }
+    constexpr size_type size() const noexcept { return N; }
+    constexpr size_type max_size() const noexcept { return N; }
+    ///@}
+
+    ///@name Lookup
+    ///@{
+    constexpr size_type count(const Key& key) const { return find_index(key) != N ? 1 : 0; }
+    constexpr bool contains(const Key& key) const { return find_index(key) != N; }
+    constexpr const_iterator find(const Key& key) const { return begin() + find_index(key); }
+    constexpr const_iterator lower_bound(const Key& key) const { return begin() + lower_bound_index(key); }
+    constexpr const_iterator upper_bound(const Key& key) const { return begin() + upper_bound_index(key); }
+    constexpr std::pair<const_iterator, const_iterator> equal_range(const Key& key) const
+    {
+        auto i = lower_bound_index(key);
+        return { begin() + i, begin() + i + (i != N && !_comp(key, _data[i].first)) };
+    }
+    ///@}
+
+    //! @name Heterogeneous lookup (if Compare::is_transparent exists)
+    ///@{
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    constexpr size_type count(const K& key) const { return find_index(key) != N ? 1 : 0; }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    constexpr bool contains(const K& key) const { return find_index(key) != N; }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    constexpr const_iterator find(const K& key) const { return begin() + find_index(key); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    constexpr const_iterator lower_bound(const K& key) const { return begin() + lower_bound_index(key); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    constexpr const_iterator upper_bound(const K& key) const { return begin() + upper_bound_index(key); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    constexpr std::pair<const_iterator, const_iterator> equal_range(const K& key) const
+    {
+        auto i = lower_bound_index(key);
+        return { begin() + i, begin() + i + (i != N && !_comp(key, _data[i].first)) };
+    }
+    ///@}
+
+    ///@name Observers
+    ///@{
+    constexpr key_compare key_comp() const { return _comp; }
+    ///@}
+
+  private:
+    template <std::size_t... I>
+    constexpr constexpr_map(const value_type (&src)[N], const std::array<std::size_t, N>& order, const Compare& comp,
+                            std::index_sequence<I...>)
+            : _data{ { src[order[I]]... } }, _comp(comp) {}
+
+    template <class K>
+    constexpr size_type lower_bound_index(const K& key) const
+    {
+        size_type lo{}, len{ N };
+        while(len > 0)
+        {
+            const size_type half = len / 2;
+            if(_comp(_data[lo + half].first, key)) { lo += half + 1; len -= half + 1; }
+            else { len = half; }
+        }
+        return lo;
+    }
+    template <class K>
+    constexpr size_type upper_bound_index(const K& key) const
+    {
+        size_type lo{}, len{ N };
+        while(len > 0)
+        {
+            const size_type half = len / 2;
+            if(!_comp(key, _data[lo + half].first)) { lo += half + 1; len -= half + 1; }
+            else { len = half; }
+        }
+        return lo;
+    }
+    template <class K>
+    constexpr size_type find_index(const K& key) const
+    {
+        auto i = lower_bound_index(key);
+        return (i != N && !_comp(key, _data[i].first)) ? i : N;
+    }
+
+    std::array<value_type, N> _data;
+    Compare _comp;
+};
+
+/*!
+  @brief Make constexpr_map from the braced list of elements
+  @code{.cpp}
+  constexpr auto m = goblib::make_constexpr_map<int, char>({ {1, 'a'}, {0, 'b'} });
+  @endcode
+ */
+template <class Key, class T, class Compare = std::less<Key>, std::size_t N>
+constexpr constexpr_map<Key, T, N, Compare> make_constexpr_map(const std::pair<Key, T> (&src)[N], const Compare& comp = Compare())
+{
+    return constexpr_map<Key, T, N, Compare>(src, comp);
+}
+
+}
+#endif
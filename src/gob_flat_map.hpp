@@ -0,0 +1,727 @@
+/*!
+  @file gob_flat_map.hpp
+  @brief std::map compatible associative container on a sorted vector
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_FLAT_MAP_HPP
+#define GOB_FLAT_MAP_HPP
+
+#include <vector>
+#include <utility>
+#include <functional>
+#include <algorithm>
+#include <iterator>
+#include <initializer_list>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include "internal/gob_stdmap_detail.hpp"
+#include "gob_map_stats.hpp"
+
+namespace goblib {
+
+/*!
+  @class flat_map
+  @brief Sorted vector based map
+  @details Elements are kept as std::pair<Key, T> in a contiguous array sorted by key.
+  Lookup is a binary search over contiguous memory, and no per-element allocation is made.
+  @tparam Key Key type
+  @tparam T Mapped type
+  @tparam Compare Compare function object for the key
+  @tparam Allocator Allocator for std::pair<Key, T>
+  @tparam Stats Statistics policy (no_stats or map_stats). See stats()
+  @note The interface is the same as std::map with the following differences.
+  - value_type is std::pair<Key, T> (not const Key). Do not modify the key through an iterator.
+  - Insertion and erasure invalidate iterators, pointers and references.
+  - Insertion and erasure are O(N) due to element shifting.
+  - try_emplace, emplace(key, mapped) and their hinted forms construct the element in place at its position
+    (without the temporary std::vector::emplace makes for a middle position) if value_type is nothrow movable.
+ */
+template <class Key, class T, class Compare = std::less<Key>,
+          class Allocator = std::allocator<std::pair<Key, T>>, class Stats = no_stats>
+class flat_map : private stdmap_detail::stats_holder<Stats>
+{
+    using stats_base = stdmap_detail::stats_holder<Stats>;
+
+  public:
+    ///@name Member types
+    ///@{
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<Key, T>;
+    using key_compare = Compare;
+    using allocator_type = Allocator;
+    using container_type = std::vector<value_type, Allocator>;
+    using size_type = typename container_type::size_type;
+    using difference_type = typename container_type::difference_type;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = typename std::allocator_traits<Allocator>::pointer;
+    using const_pointer = typename std::allocator_traits<Allocator>::const_pointer;
+    using iterator = typename container_type::iterator;
+    using const_iterator = typename container_type::const_iterator;
+    using reverse_iterator = typename container_type::reverse_iterator;
+    using const_reverse_iterator = typename container_type::const_reverse_iterator;
+    ///@}
+
+    //! @brief Compare value_type by key
+    class value_compare
+    {
+        friend class flat_map;
+      public:
+        bool operator()(const value_type& a, const value_type& b) const { return comp(a.first, b.first); }
+      protected:
+        explicit value_compare(Compare c) : comp(c) {}
+        Compare comp;
+    };
+
+    ///@name Constructor
+    ///@{
+    flat_map() : flat_map(Compare()) {}
+    explicit flat_map(const Compare& comp, const Allocator& alloc = Allocator()) : _vec(alloc), _comp(comp) {}
+    explicit flat_map(const Allocator& alloc) : _vec(alloc), _comp() {}
+    template <class InputIt>
+    flat_map(InputIt first, InputIt last, const Compare& comp = Compare(), const Allocator& alloc = Allocator())
+            : _vec(alloc), _comp(comp)
+    {
+        insert(first, last);
+    }
+    template <class InputIt>
+    flat_map(InputIt first, InputIt last, const Allocator& alloc) : flat_map(first, last, Compare(), alloc) {}
+    //! @brief Construct from the range sorted by key without equivalent keys
+    template <class InputIt>
+    flat_map(sorted_unique_t, InputIt first, InputIt last, const Compare& comp = Compare(), const Allocator& alloc = Allocator())
+            : _vec(first, last, alloc), _comp(comp) {}
+    //! @brief Adopt the container (need not be sorted)
+    explicit flat_map(container_type cont, const Compare& comp = Compare()) : _vec(std::move(cont)), _comp(comp)
+    {
+        merge_appended(0, false);
+    }
+    //! @brief Adopt the container sorted by key without equivalent keys
+    flat_map(sorted_unique_t, container_type cont, const Compare& comp = Compare()) : _vec(std::move(cont)), _comp(comp) {}
+    flat_map(std::initializer_list<value_type> il, const Compare& comp = Compare(), const Allocator& alloc = Allocator())
+            : flat_map(il.begin(), il.end(), comp, alloc) {}
+    flat_map(std::initializer_list<value_type> il, const Allocator& alloc) : flat_map(il, Compare(), alloc) {}
+    flat_map(const flat_map&) = default;
+    flat_map(const flat_map& o, const Allocator& alloc) : stats_base(o), _vec(o._vec, alloc), _comp(o._comp) {}
+    flat_map(flat_map&&) = default;
+    flat_map(flat_map&& o, const Allocator& alloc) : stats_base(o), _vec(std::move(o._vec), alloc), _comp(std::move(o._comp)) {}
+    ///@}
+
+    ///@name Assignment
+    ///@{
+    flat_map& operator=(const flat_map&) = default;
+    flat_map& operator=(flat_map&&) = default;
+    flat_map& operator=(std::initializer_list<value_type> il)
+    {
+        clear();
+        insert(il);
+        return *this;
+    }
+    ///@}
+
+    allocator_type get_allocator() const noexcept { return _vec.get_allocator(); }
+
+    ///@name Element access
+    ///@{
+    T& at(const Key& key)
+    {
+        auto it = find(key);
+        if(it == end()) { stdmap_detail::throw_out_of_range("flat_map::at"); }
+        return it->second;
+    }
+    const T& at(const Key& key) const
+    {
+        auto it = find(key);
+        if(it == end()) { stdmap_detail::throw_out_of_range("flat_map::at"); }
+        return it->second;
+    }
+    T& operator[](const Key& key) { return try_emplace(key).first->second; }
+    T& operator[](Key&& key) { return try_emplace(std::move(key)).first->second; }
+    ///@}
+
+    ///@name Iterators
+    ///@{
+    iterator begin() noexcept { return _vec.begin(); }
+    const_iterator begin() const noexcept { return _vec.begin(); }
+    const_iterator cbegin() const noexcept { return _vec.cbegin(); }
+    iterator end() noexcept { return _vec.end(); }
+    const_iterator end() const noexcept { return _vec.end(); }
+    const_iterator cend() const noexcept { return _vec.cend(); }
+    reverse_iterator rbegin() noexcept { return _vec.rbegin(); }
+    const_reverse_iterator rbegin() const noexcept { return _vec.rbegin(); }
+    const_reverse_iterator crbegin() const noexcept { return _vec.crbegin(); }
+    reverse_iterator rend() noexcept { return _vec.rend(); }
+    const_reverse_iterator rend() const noexcept { return _vec.rend(); }
+    const_reverse_iterator crend() const noexcept { return _vec.crend(); }
+    ///@}
+
+    ///@name Capacity
+    ///@{
+    bool empty() const noexcept { return _vec.empty(); }
+    size_type size() const noexcept { return _vec.size(); }
+    size_type max_size() const noexcept { return _vec.max_size(); }
+    //! @brief Number of elements that can be held without reallocation
+    size_type capacity() const noexcept { return _vec.capacity(); }
+    //! @brief Reserve storage for at least n elements
+    void reserve(size_type n)
+    {
+        auto cap = capacity();
+        _vec.reserve(n);
+        stat_resized(cap, size());
+    }
+    //! @brief Release unused capacity
+    void shrink_to_fit()
+    {
+        auto cap = capacity();
+        _vec.shrink_to_fit();
+        stat_resized(cap, size());
+    }
+    ///@}
+
+    ///@name Modifiers
+    ///@{
+    void clear() noexcept { _vec.clear(); }
+
+    std::pair<iterator, bool> insert(const value_type& v) { return insert_unique(v.first, v); }
+    std::pair<iterator, bool> insert(value_type&& v) { return insert_unique(v.first, std::move(v)); }
+    template <class P, typename std::enable_if<std::is_constructible<value_type, P&&>::value, std::nullptr_t>::type = nullptr>
+    std::pair<iterator, bool> insert(P&& v) { return emplace(std::forward<P>(v)); }
+    iterator insert(const_iterator hint, const value_type& v) { return insert_hint_unique(hint, v.first, v); }
+    iterator insert(const_iterator hint, value_type&& v) { return insert_hint_unique(hint, v.first, std::move(v)); }
+    template <class P, typename std::enable_if<std::is_constructible<value_type, P&&>::value, std::nullptr_t>::type = nullptr>
+    iterator insert(const_iterator hint, P&& v) { return emplace_hint(hint, std::forward<P>(v)); }
+    /*!
+      @brief Insert elements of the range
+      @details Elements are appended, then sorted and deduplicated once and merged with the existing elements.
+      O(M log M + N) for M new and N existing elements. Existing elements win over equivalent new keys.
+     */
+    template <class InputIt>
+    void insert(InputIt first, InputIt last)
+    {
+        auto n = size();
+        auto cap = capacity();
+        _vec.insert(_vec.end(), first, last);
+        merge_appended(n, false);
+        stat_resized(cap, n);
+    }
+    //! @brief Insert elements of the range sorted by key without equivalent keys. O(M + N)
+    template <class InputIt>
+    void insert(sorted_unique_t, InputIt first, InputIt last)
+    {
+        auto n = size();
+        auto cap = capacity();
+        _vec.insert(_vec.end(), first, last);
+        merge_appended(n, true);
+        stat_resized(cap, n);
+    }
+    void insert(std::initializer_list<value_type> il) { insert(il.begin(), il.end()); }
+    void insert(sorted_unique_t s, std::initializer_list<value_type> il) { insert(s, il.begin(), il.end()); }
+    //! @brief Insert elements of the range (moved if rg is an rvalue)
+    template <class R>
+    void insert_range(R&& rg)
+    {
+        if constexpr(std::is_rvalue_reference<R&&>::value)
+        {
+            insert(std::make_move_iterator(std::begin(rg)), std::make_move_iterator(std::end(rg)));
+        }
+        else { insert(std::begin(rg), std::end(rg)); }
+    }
+
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(const Key& key, M&& obj) { return insert_or_assign_impl(key, std::forward<M>(obj)); }
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(Key&& key, M&& obj) { return insert_or_assign_impl(std::move(key), std::forward<M>(obj)); }
+    template <class M>
+    iterator insert_or_assign(const_iterator hint, const Key& key, M&& obj)
+    {
+        (void)hint;
+        return insert_or_assign_impl(key, std::forward<M>(obj)).first;
+    }
+    template <class M>
+    iterator insert_or_assign(const_iterator hint, Key&& key, M&& obj)
+    {
+        (void)hint;
+        return insert_or_assign_impl(std::move(key), std::forward<M>(obj)).first;
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        if constexpr(stdmap_detail::is_key_mapped_args<Key, Args...>::value) { return try_emplace_impl(std::forward<Args>(args)...); }
+        else
+        {
+            value_type v(std::forward<Args>(args)...);
+            return insert_unique(v.first, std::move(v));
+        }
+    }
+    template <class... Args>
+    iterator emplace_hint(const_iterator hint, Args&&... args)
+    {
+        if constexpr(stdmap_detail::is_key_mapped_args<Key, Args...>::value) { return try_emplace_hint_impl(hint, std::forward<Args>(args)...); }
+        else
+        {
+            value_type v(std::forward<Args>(args)...);
+            return insert_hint_unique(hint, v.first, std::move(v));
+        }
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) { return try_emplace_impl(key, std::forward<Args>(args)...); }
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(Key&& key, Args&&... args) { return try_emplace_impl(std::move(key), std::forward<Args>(args)...); }
+    template <class... Args>
+    iterator try_emplace(const_iterator hint, const Key& key, Args&&... args)
+    {
+        return try_emplace_hint_impl(hint, key, std::forward<Args>(args)...);
+    }
+    template <class... Args>
+    iterator try_emplace(const_iterator hint, Key&& key, Args&&... args)
+    {
+        return try_emplace_hint_impl(hint, std::move(key), std::forward<Args>(args)...);
+    }
+
+    iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+    iterator erase(const_iterator pos) { return erase(pos, std::next(pos)); }
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        this->stat().on_move(static_cast<size_type>(cend() - last) * sizeof(value_type));
+        return _vec.erase(first, last);
+    }
+    size_type erase(const Key& key)
+    {
+        auto it = find_pos(key);
+        if(it == cend()) { return 0; }
+        erase(it);
+        return 1;
+    }
+
+    /*!
+      @brief Splice elements of source into this in one linear pass
+      @details Elements whose key already exists in this are left in source (same as std::map::merge)
+     */
+    void merge(flat_map& source)
+    {
+        if(&source == this || source.empty()) { return; }
+        container_type out(_vec.get_allocator());
+        out.reserve(size() + source.size());
+        auto a = _vec.begin();
+        auto b = source._vec.begin();
+        auto keep = b;  // Write position of the elements left in source
+        while(a != _vec.end() && b != source._vec.end())
+        {
+            if(_comp(a->first, b->first)) { out.emplace_back(std::move(*a++)); }
+            else if(_comp(b->first, a->first)) { out.emplace_back(std::move(*b++)); }
+            else
+            {
+                out.emplace_back(std::move(*a++));
+                if(keep != b) { *keep = std::move(*b); }
+                ++keep;
+                ++b;
+            }
+        }
+        out.insert(out.end(), std::make_move_iterator(a), std::make_move_iterator(_vec.end()));
+        out.insert(out.end(), std::make_move_iterator(b), std::make_move_iterator(source._vec.end()));
+        source._vec.erase(keep, source._vec.end());
+        _vec.swap(out);
+        this->stat().on_reallocate(size() * sizeof(value_type));
+        this->stat().on_size(size());
+    }
+    void merge(flat_map&& source) { merge(source); }
+
+    void swap(flat_map& o) noexcept(std::is_nothrow_swappable<Compare>::value)
+    {
+        using std::swap;
+        _vec.swap(o._vec);
+        swap(_comp, o._comp);
+        swap(static_cast<stats_base&>(*this), static_cast<stats_base&>(o));
+    }
+    ///@}
+
+    ///@name Lookup
+    ///@{
+    size_type count(const Key& key) const { return find(key) != end() ? 1 : 0; }
+    iterator find(const Key& key) { return begin() + (find_pos(key) - cbegin()); }
+    const_iterator find(const Key& key) const { return find_pos(key); }
+    bool contains(const Key& key) const { return find(key) != end(); }
+    iterator lower_bound(const Key& key) { return std::lower_bound(begin(), end(), key, key_less()); }
+    const_iterator lower_bound(const Key& key) const { return std::lower_bound(begin(), end(), key, key_less()); }
+    iterator upper_bound(const Key& key) { return std::upper_bound(begin(), end(), key, key_less()); }
+    const_iterator upper_bound(const Key& key) const { return std::upper_bound(begin(), end(), key, key_less()); }
+    std::pair<iterator, iterator> equal_range(const Key& key)
+    {
+        auto it = lower_bound(key);
+        return { it, (it != end() && !_comp(key, it->first)) ? std::next(it) : it };
+    }
+    std::pair<const_iterator, const_iterator> equal_range(const Key& key) const
+    {
+        auto it = lower_bound(key);
+        return { it, (it != end() && !_comp(key, it->first)) ? std::next(it) : it };
+    }
+    ///@}
+
+    /*!
+      @name Heterogeneous lookup
+      @brief Available if Compare::is_transparent exists (e.g. std::less<>).
+      Query by any type comparable with Key without constructing a temporary Key
+      @code{.cpp}
+      goblib::flat_map<std::string, int, std::less<>> m;
+      m.find(std::string_view("key"));  // No std::string is constructed
+      @endcode
+     */
+    ///@{
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    size_type count(const K& key) const { return contains(key) ? 1 : 0; }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    iterator find(const K& key) { return begin() + (find_pos(key) - cbegin()); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    const_iterator find(const K& key) const { return find_pos(key); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    bool contains(const K& key) const { return find(key) != end(); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    iterator lower_bound(const K& key) { return std::lower_bound(begin(), end(), key, key_less()); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    const_iterator lower_bound(const K& key) const { return std::lower_bound(begin(), end(), key, key_less()); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    iterator upper_bound(const K& key) { return std::upper_bound(begin(), end(), key, key_less()); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    const_iterator upper_bound(const K& key) const { return std::upper_bound(begin(), end(), key, key_less()); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    std::pair<iterator, iterator> equal_range(const K& key)
+    {
+        auto it = lower_bound(key);
+        return { it, (it != end() && !_comp(key, it->first)) ? std::next(it) : it };
+    }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    std::pair<const_iterator, const_iterator> equal_range(const K& key) const
+    {
+        auto it = lower_bound(key);
+        return { it, (it != end() && !_comp(key, it->first)) ? std::next(it) : it };
+    }
+    template <class K, class C = Compare, stdmap_detail::if_transparent_erase<C, K, iterator, const_iterator> = nullptr>
+    size_type erase(K&& key)
+    {
+        auto it = find_pos(key);
+        if(it == cend()) { return 0; }
+        erase(it);
+        return 1;
+    }
+    ///@}
+
+    /*!
+      @name Range query
+      @brief Ordered scans of a key range, and lookup of many keys in one pass.
+      The K overloads are available if Compare::is_transparent exists
+      @code{.cpp}
+      for(auto& e : m.range(from, to)) { ... }  // Keys in [from, to)
+      std::vector<decltype(m)::const_iterator> found(keys.size());
+      m.find_sorted(keys.begin(), keys.end(), found.begin());  // keys sorted by key_comp()
+      @endcode
+     */
+    ///@{
+    //! @brief Elements whose keys are in [lo, hi). Empty if hi is not greater than lo
+    range_view<iterator> range(const Key& lo, const Key& hi) { return range_impl(lo, hi, begin()); }
+    range_view<const_iterator> range(const Key& lo, const Key& hi) const { return range_impl(lo, hi, cbegin()); }
+    //! @brief Number of elements whose keys are in [lo, hi). O(log N)
+    size_type count_range(const Key& lo, const Key& hi) const { return range(lo, hi).size(); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    range_view<iterator> range(const K& lo, const K& hi) { return range_impl(lo, hi, begin()); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    range_view<const_iterator> range(const K& lo, const K& hi) const { return range_impl(lo, hi, cbegin()); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    size_type count_range(const K& lo, const K& hi) const { return range(lo, hi).size(); }
+
+    /*!
+      @brief Find each key of the sorted range [first, last), writing the iterator (or end()) to out
+      @details Keys must be sorted by key_comp() (equivalent keys allowed). The search for each key starts
+      where the previous one ended and gallops forward, prefetching the next probes, so M keys cost
+      O(M log(N / M)) comparisons in total and nearby keys hit the cache lines already loaded.
+      Each key is recorded as a lookup in stats()
+      @return Output iterator past the last written
+     */
+    template <class InputIt, class OutputIt>
+    OutputIt find_sorted(InputIt first, InputIt last, OutputIt out) { return find_sorted_impl(first, last, out, begin()); }
+    template <class InputIt, class OutputIt>
+    OutputIt find_sorted(InputIt first, InputIt last, OutputIt out) const { return find_sorted_impl(first, last, out, cbegin()); }
+    ///@}
+
+    /*!
+      @name Statistics
+      @brief With Stats = map_stats, stats() returns the counters of this map (see map_stats).
+      With the default no_stats nothing is recorded and stats() returns an empty no_stats
+      @code{.cpp}
+      goblib::flat_map<int, int, std::less<int>, std::allocator<std::pair<int, int>>, goblib::map_stats> m;
+      m.stats().dump(std::clog, "m");
+      @endcode
+     */
+    ///@{
+    using stats_base::stats;
+    using stats_base::reset_stats;
+    ///@}
+
+    ///@name Observers
+    ///@{
+    key_compare key_comp() const { return _comp; }
+    value_compare value_comp() const { return value_compare(_comp); }
+    ///@}
+
+    ///@name Comparison
+    ///@{
+    friend bool operator==(const flat_map& a, const flat_map& b) { return a._vec == b._vec; }
+    friend bool operator!=(const flat_map& a, const flat_map& b) { return !(a == b); }
+    friend bool operator<(const flat_map& a, const flat_map& b) { return a._vec < b._vec; }
+    friend bool operator>(const flat_map& a, const flat_map& b) { return b < a; }
+    friend bool operator<=(const flat_map& a, const flat_map& b) { return !(b < a); }
+    friend bool operator>=(const flat_map& a, const flat_map& b) { return !(a < b); }
+    friend void swap(flat_map& a, flat_map& b) noexcept(noexcept(a.swap(b))) { a.swap(b); }
+    ///@}
+
+  private:
+    // Heterogeneous compare for std::lower_bound / std::upper_bound. Counts the calls if Stats is enabled and count is given
+    struct key_less_value
+    {
+        const Compare& comp;
+        std::size_t* count;
+        template <class K>
+        bool operator()(const value_type& v, const K& k) const
+        {
+            tally();
+            return comp(v.first, k);
+        }
+        template <class K>
+        bool operator()(const K& k, const value_type& v) const
+        {
+            tally();
+            return comp(k, v.first);
+        }
+        void tally() const
+        {
+            if constexpr(Stats::enabled) { if(count) { ++*count; } }
+        }
+    };
+    key_less_value key_less(std::size_t* count = nullptr) const { return { _comp, count }; }
+
+    // Position of the key or end(), recorded as a lookup
+    template <class K>
+    const_iterator find_pos(const K& key) const
+    {
+        std::size_t probes{};
+        auto it = std::lower_bound(cbegin(), cend(), key, key_less(&probes));
+        const bool found = it != cend() && !_comp(key, it->first);
+        this->stat().on_lookup(found, probes + (it != cend()));
+        return found ? it : cend();
+    }
+
+    template <class K, class It>
+    range_view<It> range_impl(const K& lo, const K& hi, It base) const
+    {
+        auto first = std::lower_bound(cbegin(), cend(), lo, key_less());
+        auto last = _comp(lo, hi) ? std::lower_bound(first, cend(), hi, key_less()) : first;
+        return { base + (first - cbegin()), base + (last - cbegin()) };
+    }
+
+    // Lower bound of key in [from, size()), galloping 1, 2, 4 ... elements from from and then bisecting.
+    // Prefetches the probe after the next one while galloping, and both candidates of the next bisection
+    template <class K>
+    size_type gallop_lower_bound(size_type from, const K& key, std::size_t* probes) const
+    {
+        auto less = key_less(probes);
+        const value_type* v = _vec.data();
+        const size_type n = size();
+        if(from == n || !less(v[from], key)) { return from; }
+
+        // v[from] < key <= v[hi] (hi may be n)
+        size_type step = 1, hi = from + 1;
+        while(hi < n && less(v[hi], key))
+        {
+            from = hi;
+            step <<= 1;
+            hi = from + step;
+            if(hi + step < n) { stdmap_detail::prefetch(v + hi + step); }
+        }
+        size_type lo = from + 1, len = std::min(hi, n) - lo;
+        while(len > 0)
+        {
+            auto half = len / 2;
+            stdmap_detail::prefetch(v + lo + half / 2);
+            stdmap_detail::prefetch(v + lo + half + 1 + (len - half - 1) / 2);
+            if(less(v[lo + half], key)) { lo += half + 1; len -= half + 1; }
+            else { len = half; }
+        }
+        return lo;
+    }
+
+    template <class InputIt, class OutputIt, class It>
+    OutputIt find_sorted_impl(InputIt first, InputIt last, OutputIt out, It base) const
+    {
+        size_type pos{};
+        for(; first != last; ++first)
+        {
+            const auto& key = *first;
+            std::size_t probes{};
+            pos = gallop_lower_bound(pos, key, &probes);
+            const bool found = pos < size() && !_comp(key, _vec[pos].first);
+            this->stat().on_lookup(found, probes + (pos < size()));
+            *out++ = base + (found ? pos : size());
+        }
+        return out;
+    }
+
+    // Record the size, and the reallocation if the capacity is no longer cap (n elements relocated)
+    void stat_resized(size_type cap, size_type n) const
+    {
+        if(capacity() != cap) { this->stat().on_reallocate(n * sizeof(value_type)); }
+        this->stat().on_size(size());
+    }
+
+    // Construct an element at pos, recording the shifted or relocated elements
+    template <class... Args>
+    iterator emplace_at(const_iterator pos, Args&&... args)
+    {
+        auto cap = capacity();
+        auto shifted = static_cast<size_type>(cend() - pos);
+        iterator it;
+        if constexpr(std::is_nothrow_move_constructible<value_type>::value && std::is_nothrow_move_assignable<value_type>::value)
+        {
+            it = (shifted && size() < cap) ? emplace_in_gap(pos, std::forward<Args>(args)...)
+                                           : _vec.emplace(pos, std::forward<Args>(args)...);
+        }
+        else { it = _vec.emplace(pos, std::forward<Args>(args)...); }
+        if(capacity() == cap) { this->stat().on_move(shifted * sizeof(value_type)); }
+        stat_resized(cap, size() - 1);
+        return it;
+    }
+
+    // Shift the elements from pos up by one (capacity must be available) and construct the new element in the gap.
+    // If the construction throws, the elements are shifted back.
+    // Arguments that refer to an element would see it moved, so the element is built first from those
+    template <class... Args>
+    iterator emplace_in_gap(const_iterator pos, Args&&... args)
+    {
+        using alloc_traits = std::allocator_traits<Allocator>;
+        if(stdmap_detail::args_refer_into(_vec.data(), _vec.data() + _vec.size(), args...))
+        {
+            value_type v(std::forward<Args>(args)...);
+            return emplace_in_gap(pos, std::move(v));
+        }
+        auto i = pos - cbegin();
+        _vec.emplace_back(std::move(_vec.back()));
+        auto it = _vec.begin() + i;
+        std::move_backward(it, _vec.end() - 2, _vec.end() - 1);
+
+        Allocator alloc(_vec.get_allocator());
+        auto p = std::addressof(*it);
+        alloc_traits::destroy(alloc, p);
+        struct guard
+        {
+            flat_map* self;
+            Allocator& alloc;
+            value_type* p;
+            ~guard()
+            {
+                if(!self) { return; }
+                alloc_traits::construct(alloc, p, std::move(p[1]));
+                std::move(p + 2, std::addressof(self->_vec.back()) + 1, p + 1);
+                self->_vec.pop_back();
+            }
+        } g{ this, alloc, p };
+        alloc_traits::construct(alloc, p, std::forward<Args>(args)...);
+        g.self = nullptr;
+        return it;
+    }
+
+    // Where key goes: the hint if key belongs just before it, otherwise by binary search. Second is false if key is already there
+    std::pair<const_iterator, bool> insert_position(const Key& key) const
+    {
+        auto it = lower_bound(key);
+        return { it, it == cend() || _comp(key, it->first) };
+    }
+    std::pair<const_iterator, bool> insert_position(const_iterator hint, const Key& key) const
+    {
+        if((hint == cend() || _comp(key, hint->first)) && (hint == cbegin() || _comp(std::prev(hint)->first, key))) { return { hint, true }; }
+        return insert_position(key);
+    }
+    iterator mutable_iterator(const_iterator it) { return _vec.begin() + (it - _vec.cbegin()); }
+
+    bool equivalent(const value_type& a, const value_type& b) const { return !_comp(a.first, b.first) && !_comp(b.first, a.first); }
+
+    // Sort (unless sorted) and deduplicate the elements appended after the first n, then merge them with the first n
+    void merge_appended(size_type n, bool sorted)
+    {
+        auto eq = [this](const value_type& a, const value_type& b) { return equivalent(a, b); };
+        auto mid = _vec.begin() + static_cast<difference_type>(n);
+        if(!sorted) { std::stable_sort(mid, _vec.end(), value_comp()); }
+        _vec.erase(std::unique(mid, _vec.end(), eq), _vec.end());
+        mid = _vec.begin() + static_cast<difference_type>(n);
+        if(n == 0 || mid == _vec.end() || _comp(std::prev(mid)->first, mid->first)) { return; }
+        // Stable merge puts the existing element first among equivalents, so unique keeps it
+        std::inplace_merge(_vec.begin(), mid, _vec.end(), value_comp());
+        _vec.erase(std::unique(_vec.begin(), _vec.end(), eq), _vec.end());
+    }
+
+    template <class V>
+    std::pair<iterator, bool> insert_unique(const Key& key, V&& v)
+    {
+        auto pos = insert_position(key);
+        if(!pos.second) { return { mutable_iterator(pos.first), false }; }
+        return { emplace_at(pos.first, std::forward<V>(v)), true };
+    }
+
+    template <class V>
+    iterator insert_hint_unique(const_iterator hint, const Key& key, V&& v)
+    {
+        auto pos = insert_position(hint, key);
+        return pos.second ? emplace_at(pos.first, std::forward<V>(v)) : mutable_iterator(pos.first);
+    }
+
+    template <class K, class... Args>
+    std::pair<iterator, bool> try_emplace_impl(K&& key, Args&&... args)
+    {
+        return try_emplace_at(insert_position(key), std::forward<K>(key), std::forward<Args>(args)...);
+    }
+    template <class K, class... Args>
+    iterator try_emplace_hint_impl(const_iterator hint, K&& key, Args&&... args)
+    {
+        return try_emplace_at(insert_position(hint, key), std::forward<K>(key), std::forward<Args>(args)...).first;
+    }
+    template <class K, class... Args>
+    std::pair<iterator, bool> try_emplace_at(std::pair<const_iterator, bool> pos, K&& key, Args&&... args)
+    {
+        if(!pos.second) { return { mutable_iterator(pos.first), false }; }
+        return { emplace_at(pos.first, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                            std::forward_as_tuple(std::forward<Args>(args)...)),
+                 true };
+    }
+
+    template <class K, class M>
+    std::pair<iterator, bool> insert_or_assign_impl(K&& key, M&& obj)
+    {
+        auto it = lower_bound(key);
+        if(it != end() && !_comp(key, it->first))
+        {
+            it->second = std::forward<M>(obj);
+            return { it, false };
+        }
+        return { emplace_at(it, std::forward<K>(key), std::forward<M>(obj)), true };
+    }
+
+    container_type _vec{};
+    Compare _comp{};
+};
+
+/*!
+  @brief Erase all elements satisfying the predicate
+  @return Number of erased elements
+ */
+template <class Key, class T, class Compare, class Allocator, class Stats, class Pred>
+typename flat_map<Key, T, Compare, Allocator, Stats>::size_type erase_if(flat_map<Key, T, Compare, Allocator, Stats>& c, Pred pred)
+{
+    auto it = std::remove_if(c.begin(), c.end(), pred);
+    auto n = static_cast<typename flat_map<Key, T, Compare, Allocator, Stats>::size_type>(std::distance(it, c.end()));
+    c.erase(it, c.end());
+    return n;
+}
+
+}
+#endif
@@ -0,0 +1,55 @@
+/*!
+  @file gob_flat_multimap.hpp
+  @brief std::multimap compatible associative container on a sorted vector
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_FLAT_MULTIMAP_HPP
+#define GOB_FLAT_MULTIMAP_HPP
+
+#include <functional>
+#include <memory>
+#include <utility>
+#include "internal/gob_flat_tree.hpp"
+
+namespace goblib {
+
+/*!
+  @class flat_multimap
+  @brief Sorted vector based multimap
+  @details Elements are kept as std::pair<Key, T> in a contiguous array sorted by key, and the elements
+  with equivalent keys form one contiguous run in insertion order. equal_range, count and erase by key
+  are one binary search for the start of the run followed by a gallop to its end (O(log N + log L) for
+  a run of L elements), and the run is then scanned as a plain array.
+  @tparam Key Key type
+  @tparam T Mapped type
+  @tparam Compare Compare function object for the key
+  @tparam Allocator Allocator for std::pair<Key, T>
+  @note The interface is the same as std::multimap with the following differences.
+  - value_type is std::pair<Key, T> (not const Key). Do not modify the key through an iterator.
+  - Insertion and erasure invalidate iterators, pointers and references.
+  - Insertion and erasure are O(N) due to element shifting. Use the range insert for bulk data.
+  - emplace constructs a temporary value_type before looking up the position.
+ */
+template <class Key, class T, class Compare = std::less<Key>, class Allocator = std::allocator<std::pair<Key, T>>>
+class flat_multimap : public stdmap_detail::flat_tree<Key, std::pair<Key, T>, stdmap_detail::key_of_pair, Compare, Allocator, false>
+{
+    using base = stdmap_detail::flat_tree<Key, std::pair<Key, T>, stdmap_detail::key_of_pair, Compare, Allocator, false>;
+
+  public:
+    using mapped_type = T;
+    using base::base;
+};
+
+/*!
+  @brief Erase all elements satisfying the predicate
+  @return Number of erased elements
+ */
+template <class Key, class T, class Compare, class Allocator, class Pred>
+typename flat_multimap<Key, T, Compare, Allocator>::size_type erase_if(flat_multimap<Key, T, Compare, Allocator>& c, Pred pred)
+{
+    return stdmap_detail::flat_tree_erase_if(c, pred);
+}
+
+}
+#endif
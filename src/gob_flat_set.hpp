@@ -0,0 +1,75 @@
+/*!
+  @file gob_flat_set.hpp
+  @brief std::set and std::multiset compatible containers on a sorted vector
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_FLAT_SET_HPP
+#define GOB_FLAT_SET_HPP
+
+#include <functional>
+#include <memory>
+#include "internal/gob_flat_tree.hpp"
+
+namespace goblib {
+
+/*!
+  @class flat_set
+  @brief Sorted vector based set
+  @details Keys are kept in a contiguous array sorted by Compare. Lookup is a binary search over
+  contiguous memory, and no per-element allocation is made.
+  @tparam Key Key type
+  @tparam Compare Compare function object for the key
+  @tparam Allocator Allocator for Key
+  @note The interface is the same as std::set with the following differences.
+  - Insertion and erasure invalidate iterators, pointers and references.
+  - Insertion and erasure are O(N) due to element shifting. Use the range insert for bulk data.
+ */
+template <class Key, class Compare = std::less<Key>, class Allocator = std::allocator<Key>>
+class flat_set : public stdmap_detail::flat_tree<Key, Key, stdmap_detail::key_of_self, Compare, Allocator, true>
+{
+    using base = stdmap_detail::flat_tree<Key, Key, stdmap_detail::key_of_self, Compare, Allocator, true>;
+
+  public:
+    using base::base;
+};
+
+/*!
+  @class flat_multiset
+  @brief Sorted vector based multiset
+  @details Keys are kept in a contiguous array sorted by Compare, and equivalent keys form one
+  contiguous run in insertion order. equal_range, count and erase by key are one binary search
+  for the start of the run followed by a gallop to its end.
+  @tparam Key Key type
+  @tparam Compare Compare function object for the key
+  @tparam Allocator Allocator for Key
+  @note The interface is the same as std::multiset with the following differences.
+  - Insertion and erasure invalidate iterators, pointers and references.
+  - Insertion and erasure are O(N) due to element shifting. Use the range insert for bulk data.
+ */
+template <class Key, class Compare = std::less<Key>, class Allocator = std::allocator<Key>>
+class flat_multiset : public stdmap_detail::flat_tree<Key, Key, stdmap_detail::key_of_self, Compare, Allocator, false>
+{
+    using base = stdmap_detail::flat_tree<Key, Key, stdmap_detail::key_of_self, Compare, Allocator, false>;
+
+  public:
+    using base::base;
+};
+
+/*!
+  @brief Erase all elements satisfying the predicate
+  @return Number of erased elements
+ */
+template <class Key, class Compare, class Allocator, class Pred>
+typename flat_set<Key, Compare, Allocator>::size_type erase_if(flat_set<Key, Compare, Allocator>& c, Pred pred)
+{
+    return stdmap_detail::flat_tree_erase_if(c, pred);
+}
+template <class Key, class Compare, class Allocator, class Pred>
+typename flat_multiset<Key, Compare, Allocator>::size_type erase_if(flat_multiset<Key, Compare, Allocator>& c, Pred pred)
+{
+    return stdmap_detail::flat_tree_erase_if(c, pred);
+}
+
+}
+#endif
@@ -0,0 +1,329 @@
+/*!
+  @file gob_frozen_map.hpp
+  @brief Read-mostly map with Eytzinger layout and branchless search
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_FROZEN_MAP_HPP
+#define GOB_FROZEN_MAP_HPP
+
+#include <vector>
+#include <utility>
+#include <functional>
+#include <algorithm>
+#include <iterator>
+#include <initializer_list>
+#include <type_traits>
+#include <cstddef>
+#include "internal/gob_stdmap_detail.hpp"
+
+namespace goblib {
+
+/*!
+  @class frozen_map
+  @brief Map whose key set is fixed at construction
+  @details Keys are laid out in Eytzinger (BFS) order in a dense array, and mapped values in the same order in a parallel array.
+  Search descends the implicit tree without branches (k = 2k + (key[k] < x)) and prefetches the
+  descendants a few levels ahead, so it neither mispredicts nor waits on each level's cache miss.
+  Suitable for maps built once at startup and queried many times.
+  @tparam Key Key type
+  @tparam T Mapped type
+  @tparam Compare Compare function object for the key
+  @note
+  - Keys cannot be inserted or erased after construction. Mapped values can be modified.
+  - Iterators are bidirectional proxy iterators and visit elements in key order.
+  - If the source contains equivalent keys, the first one is kept (same as std::map::insert).
+ */
+template <class Key, class T, class Compare = std::less<Key>>
+class frozen_map
+{
+    static_assert(!std::is_same<Key, bool>::value && !std::is_same<T, bool>::value,
+                  "std::vector<bool> is not supported");
+
+  public:
+    template <bool Const> class basic_iterator;
+
+    ///@name Member types
+    ///@{
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<Key, T>;
+    using key_compare = Compare;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = std::pair<const Key&, T&>;
+    using const_reference = std::pair<const Key&, const T&>;
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    ///@}
+
+    /*!
+      @brief Bidirectional proxy iterator
+      @details Walks the implicit tree in order. Index 0 is end().
+     */
+    template <bool Const>
+    class basic_iterator
+    {
+        friend class frozen_map;
+        template <bool> friend class basic_iterator;
+        using mapped_pointer = typename std::conditional<Const, const T*, T*>::type;
+
+      public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = std::pair<Key, T>;
+        using difference_type = std::ptrdiff_t;
+        using reference = std::pair<const Key&, typename std::conditional<Const, const T&, T&>::type>;
+        //! @brief Result of operator-> (holds the proxy reference)
+        struct pointer
+        {
+            reference ref;
+            reference* operator->() { return &ref; }
+        };
+
+        basic_iterator() = default;
+        template <bool C, typename std::enable_if<Const && !C, std::nullptr_t>::type = nullptr>
+        basic_iterator(const basic_iterator<C>& o) : _keys(o._keys), _values(o._values), _n(o._n), _k(o._k) {}
+
+        reference operator*() const { return { _keys[_k - 1], _values[_k - 1] }; }
+        pointer operator->() const { return { **this }; }
+
+        basic_iterator& operator++()
+        {
+            if(2 * _k + 1 <= _n)
+            {
+                _k = 2 * _k + 1;
+                while(2 * _k <= _n) { _k *= 2; }
+            }
+            else
+            {
+                _k >>= stdmap_detail::countr_one(_k) + 1;
+            }
+            return *this;
+        }
+        basic_iterator operator++(int) { auto t = *this; ++*this; return t; }
+        basic_iterator& operator--()
+        {
+            if(!_k) { _k = rightmost(1, _n); }
+            else if(2 * _k <= _n) { _k = rightmost(2 * _k, _n); }
+            else { _k >>= stdmap_detail::countr_zero(_k) + 1; }
+            return *this;
+        }
+        basic_iterator operator--(int) { auto t = *this; --*this; return t; }
+
+        template <bool C> bool operator==(const basic_iterator<C>& o) const { return _k == o._k; }
+        template <bool C> bool operator!=(const basic_iterator<C>& o) const { return _k != o._k; }
+
+      private:
+        basic_iterator(const Key* k, mapped_pointer v, size_type n, size_type idx) : _keys(k), _values(v), _n(n), _k(idx) {}
+        static size_type rightmost(size_type k, size_type n)
+        {
+            while(2 * k + 1 <= n) { k = 2 * k + 1; }
+            return k;
+        }
+        const Key* _keys{};
+        mapped_pointer _values{};
+        size_type _n{};
+        size_type _k{};  // 1-origin Eytzinger index, 0 is end
+    };
+
+    ///@name Constructor
+    ///@{
+    frozen_map() : frozen_map(Compare()) {}
+    explicit frozen_map(const Compare& comp) : _comp(comp) {}
+    //! @brief Build from the range of value_type (need not be sorted)
+    template <class InputIt>
+    frozen_map(InputIt first, InputIt last, const Compare& comp = Compare()) : _comp(comp)
+    {
+        build(std::vector<value_type>(first, last));
+    }
+    frozen_map(std::initializer_list<value_type> il, const Compare& comp = Compare())
+            : frozen_map(il.begin(), il.end(), comp) {}
+    frozen_map(const frozen_map&) = default;
+    frozen_map(frozen_map&&) = default;
+    frozen_map& operator=(const frozen_map&) = default;
+    frozen_map& operator=(frozen_map&&) = default;
+    ///@}
+
+    ///@name Element access
+    ///@{
+    T& at(const Key& key)
+    {
+        auto k = find_index(key);
+        if(!k) { stdmap_detail::throw_out_of_range("frozen_map::at"); }
+        return _values[k - 1];
+    }
+    const T& at(const Key& key) const
+    {
+        auto k = find_index(key);
+        if(!k) { stdmap_detail::throw_out_of_range("frozen_map::at"); }
+        return _values[k - 1];
+    }
+    //! @brief Keys in Eytzinger order
+    const std::vector<Key>& keys() const noexcept { return _keys; }
+    ///@}
+
+    ///@name Iterators
+    ///@{
+    iterator begin() noexcept { return make_iterator(leftmost()); }
+    const_iterator begin() const noexcept { return make_iterator(leftmost()); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    iterator end() noexcept { return make_iterator(0); }
+    const_iterator end() const noexcept { return make_iterator(0); }
+    const_iterator cend() const noexcept { return end(); }
+    reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+    const_reverse_iterator crbegin() const noexcept { return rbegin(); }
+    reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+    const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+    const_reverse_iterator crend() const noexcept { return rend(); }
+    ///@}
+
+    ///@name Capacity
+    ///@{
+    bool empty() const noexcept { return _keys.empty(); }
+    size_type size() const noexcept { return _keys.size(); }
+    ///@}
+
+    ///@name Lookup
+    ///@{
+    size_type count(const Key& key) const { return find_index(key) ? 1 : 0; }
+    bool contains(const Key& key) const { return find_index(key) != 0; }
+    iterator find(const Key& key) { return make_iterator(find_index(key)); }
+    const_iterator find(const Key& key) const { return make_iterator(find_index(key)); }
+    iterator lower_bound(const Key& key) { return make_iterator(lower_bound_index(key)); }
+    const_iterator lower_bound(const Key& key) const { return make_iterator(lower_bound_index(key)); }
+    iterator upper_bound(const Key& key) { return make_iterator(upper_bound_index(key)); }
+    const_iterator upper_bound(const Key& key) const { return make_iterator(upper_bound_index(key)); }
+    std::pair<iterator, iterator> equal_range(const Key& key)
+    {
+        auto k = find_index(key);
+        return k ? std::make_pair(make_iterator(k), std::next(make_iterator(k))) : std::make_pair(lower_bound(key), lower_bound(key));
+    }
+    std::pair<const_iterator, const_iterator> equal_range(const Key& key) const
+    {
+        auto k = find_index(key);
+        return k ? std::make_pair(make_iterator(k), std::next(make_iterator(k))) : std::make_pair(lower_bound(key), lower_bound(key));
+    }
+    ///@}
+
+    //! @name Heterogeneous lookup (if Compare::is_transparent exists)
+    ///@{
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    size_type count(const K& key) const { return find_index(key) ? 1 : 0; }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    bool contains(const K& key) const { return find_index(key) != 0; }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    iterator find(const K& key) { return make_iterator(find_index(key)); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    const_iterator find(const K& key) const { return make_iterator(find_index(key)); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    iterator lower_bound(const K& key) { return make_iterator(lower_bound_index(key)); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    const_iterator lower_bound(const K& key) const { return make_iterator(lower_bound_index(key)); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    iterator upper_bound(const K& key) { return make_iterator(upper_bound_index(key)); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    const_iterator upper_bound(const K& key) const { return make_iterator(upper_bound_index(key)); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    std::pair<iterator, iterator> equal_range(const K& key)
+    {
+        auto k = find_index(key);
+        return k ? std::make_pair(make_iterator(k), std::next(make_iterator(k))) : std::make_pair(lower_bound(key), lower_bound(key));
+    }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    std::pair<const_iterator, const_iterator> equal_range(const K& key) const
+    {
+        auto k = find_index(key);
+        return k ? std::make_pair(make_iterator(k), std::next(make_iterator(k))) : std::make_pair(lower_bound(key), lower_bound(key));
+    }
+    ///@}
+
+    ///@name Observers
+    ///@{
+    key_compare key_comp() const { return _comp; }
+    ///@}
+
+  private:
+    // Prefetch this many levels ahead (2^4 descendants cover a cache line of 4 byte keys)
+    static constexpr unsigned prefetch_levels = 4;
+
+    iterator make_iterator(size_type k) { return iterator(_keys.data(), _values.data(), size(), k); }
+    const_iterator make_iterator(size_type k) const { return const_iterator(_keys.data(), _values.data(), size(), k); }
+    size_type leftmost() const
+    {
+        size_type k = empty() ? 0 : 1;
+        while(k && 2 * k <= size()) { k *= 2; }
+        return k;
+    }
+
+    // Descend while going right if Pred(node). Returns the 1-origin index of the first node not satisfying Pred (0 if none)
+    template <class Pred>
+    size_type search(Pred pred) const
+    {
+        const Key* keys = _keys.data();
+        const size_type n = size();
+        size_type k = 1;
+        while(k <= n)
+        {
+            stdmap_detail::prefetch(keys + std::min<size_type>(k << prefetch_levels, n) - 1);
+            k = 2 * k + static_cast<size_type>(pred(keys[k - 1]));
+        }
+        // Strip the trailing right turns and the last left turn
+        return k >> (stdmap_detail::countr_one(k) + 1);
+    }
+    template <class K>
+    size_type lower_bound_index(const K& key) const
+    {
+        return search([this, &key](const Key& x) { return _comp(x, key); });
+    }
+    template <class K>
+    size_type upper_bound_index(const K& key) const
+    {
+        return search([this, &key](const Key& x) { return !_comp(key, x); });
+    }
+    template <class K>
+    size_type find_index(const K& key) const
+    {
+        auto k = lower_bound_index(key);
+        return (k && !_comp(key, _keys[k - 1])) ? k : 0;
+    }
+
+    void build(std::vector<value_type>&& src)
+    {
+        std::stable_sort(src.begin(), src.end(),
+                         [this](const value_type& a, const value_type& b) { return _comp(a.first, b.first); });
+        src.erase(std::unique(src.begin(), src.end(),
+                              [this](const value_type& a, const value_type& b) {
+                                  return !_comp(a.first, b.first) && !_comp(b.first, a.first);
+                              }),
+                  src.end());
+        // Sorted position -> Eytzinger position by in-order traversal
+        std::vector<size_type> order(src.size());
+        size_type i{};
+        fill_order(order, i, 1);
+        _keys.reserve(src.size());
+        _values.reserve(src.size());
+        for(auto idx : order)
+        {
+            _keys.emplace_back(std::move(src[idx].first));
+            _values.emplace_back(std::move(src[idx].second));
+        }
+    }
+    // order[k - 1] = sorted index of Eytzinger node k
+    void fill_order(std::vector<size_type>& order, size_type& i, size_type k)
+    {
+        if(k > order.size()) { return; }
+        fill_order(order, i, 2 * k);
+        order[k - 1] = i++;
+        fill_order(order, i, 2 * k + 1);
+    }
+
+    std::vector<Key> _keys{};
+    std::vector<T> _values{};
+    Compare _comp{};
+};
+
+}
+#endif
@@ -0,0 +1,730 @@
+/*!
+  @file gob_hash_map.hpp
+  @brief std::unordered_map compatible open addressing hash map
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_HASH_MAP_HPP
+#define GOB_HASH_MAP_HPP
+
+#include <utility>
+#include <functional>
+#include <iterator>
+#include <initializer_list>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include "internal/gob_stdmap_detail.hpp"
+#include "internal/gob_swiss_group.hpp"
+#include "gob_map_stats.hpp"
+
+namespace goblib {
+
+/*!
+  @brief Transparent hash for string keys
+  @details Hashes std::string, std::string_view and const char* alike, so that with std::equal_to<>
+  hash_map<std::string, T> can be queried without constructing a std::string.
+  @code{.cpp}
+  goblib::hash_map<std::string, int, goblib::string_hash, std::equal_to<>> m;
+  m.find(std::string_view("key"));
+  @endcode
+ */
+struct string_hash
+{
+    using is_transparent = void;
+    std::size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>{}(s); }
+};
+
+/*!
+  @class hash_map
+  @brief Open addressing hash map with SIMD scanned control bytes (Swiss table style)
+  @details Each slot has a control byte holding 7 bits of the hash. Lookup compares a whole group of
+  control bytes at once (SSE2 16 bytes, or 8 bytes by SWAR on other targets), and probes the groups linearly.
+  Keys are compared only for slots whose control byte matched. Elements live in one flat slot array,
+  so there is no per-element allocation and no pointer chasing.
+  @tparam Key Key type
+  @tparam T Mapped type
+  @tparam Hash Hash function object
+  @tparam KeyEqual Equality function object for the key
+  @tparam Allocator Allocator for std::pair<const Key, T>
+  @tparam Stats Statistics policy (no_stats or map_stats). See stats()
+  @note The interface is the same as std::unordered_map with the following differences.
+  - No bucket interface. bucket_count() is the number of slots.
+  - Rehash (growth) invalidates iterators, pointers and references.
+  - max_load_factor is fixed at 7/8.
+  - Rehash copies the bytes of elements for which goblib::is_trivially_relocatable holds, instead of moving them.
+  - Define GOB_STDMAP_DISABLE_SIMD to use the portable group implementation.
+ */
+template <class Key, class T, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>,
+          class Allocator = std::allocator<std::pair<const Key, T>>, class Stats = no_stats>
+class hash_map : private stdmap_detail::stats_holder<Stats>
+{
+    using stats_base = stdmap_detail::stats_holder<Stats>;
+    using ctrl_t = stdmap_detail::ctrl_t;
+    using group = stdmap_detail::swiss_group;
+    using alloc_traits = std::allocator_traits<Allocator>;
+    using ctrl_allocator = typename alloc_traits::template rebind_alloc<ctrl_t>;
+    using ctrl_alloc_traits = std::allocator_traits<ctrl_allocator>;
+
+  public:
+    template <bool Const> class basic_iterator;
+
+    ///@name Member types
+    ///@{
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<const Key, T>;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using allocator_type = Allocator;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = value_type*;
+    using const_pointer = const value_type*;
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+    ///@}
+
+    //! @brief Forward iterator
+    template <bool Const>
+    class basic_iterator
+    {
+        friend class hash_map;
+        template <bool> friend class basic_iterator;
+
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = typename hash_map::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference = typename std::conditional<Const, const value_type&, value_type&>::type;
+        using pointer = typename std::conditional<Const, const value_type*, value_type*>::type;
+
+        basic_iterator() = default;
+        template <bool C, typename std::enable_if<Const && !C, std::nullptr_t>::type = nullptr>
+        basic_iterator(const basic_iterator<C>& o) : _ctrl(o._ctrl), _slot(o._slot), _end(o._end) {}
+
+        reference operator*() const { return *_slot; }
+        pointer operator->() const { return _slot; }
+        basic_iterator& operator++()
+        {
+            ++_ctrl;
+            ++_slot;
+            skip_empty();
+            return *this;
+        }
+        basic_iterator operator++(int) { auto t = *this; ++*this; return t; }
+
+        template <bool C> bool operator==(const basic_iterator<C>& o) const { return _slot == o._slot; }
+        template <bool C> bool operator!=(const basic_iterator<C>& o) const { return _slot != o._slot; }
+
+      private:
+        basic_iterator(const ctrl_t* c, pointer s, const ctrl_t* e) : _ctrl(c), _slot(s), _end(e) {}
+        void skip_empty()
+        {
+            while(_ctrl != _end && !stdmap_detail::ctrl_is_full(*_ctrl)) { ++_ctrl; ++_slot; }
+        }
+        const ctrl_t* _ctrl{};
+        pointer _slot{};
+        const ctrl_t* _end{};
+    };
+
+    ///@name Constructor
+    ///@{
+    hash_map() : hash_map(0) {}
+    explicit hash_map(size_type bucket_count, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual(),
+                      const Allocator& alloc = Allocator())
+            : _hash(hash), _equal(equal), _alloc(alloc)
+    {
+        if(bucket_count) { reserve(bucket_count); }
+    }
+    explicit hash_map(const Allocator& alloc) : hash_map(0, Hash(), KeyEqual(), alloc) {}
+    template <class InputIt>
+    hash_map(InputIt first, InputIt last, size_type bucket_count = 0, const Hash& hash = Hash(),
+             const KeyEqual& equal = KeyEqual(), const Allocator& alloc = Allocator())
+            : hash_map(bucket_count, hash, equal, alloc)
+    {
+        insert(first, last);
+    }
+    hash_map(std::initializer_list<value_type> il, size_type bucket_count = 0, const Hash& hash = Hash(),
+             const KeyEqual& equal = KeyEqual(), const Allocator& alloc = Allocator())
+            : hash_map(il.begin(), il.end(), bucket_count, hash, equal, alloc) {}
+    hash_map(const hash_map& o) : hash_map(o, alloc_traits::select_on_container_copy_construction(o._alloc)) {}
+    hash_map(const hash_map& o, const Allocator& alloc) : hash_map(0, o._hash, o._equal, alloc)
+    {
+        reserve(o.size());
+        for(auto& e : o) { construct_at(prepare_insert(hash_of(_hash, e.first)), e.first, e.second); }
+        static_cast<stats_base&>(*this) = o;
+    }
+    hash_map(hash_map&& o) noexcept
+            : stats_base(o), _hash(std::move(o._hash)), _equal(std::move(o._equal)), _alloc(std::move(o._alloc))
+    {
+        steal(o);
+    }
+    ~hash_map() { destroy(); }
+    ///@}
+
+    ///@name Assignment
+    ///@{
+    //! @brief Copies o into storage from this allocator, or from the allocator of o if it propagates on copy assignment
+    hash_map& operator=(const hash_map& o)
+    {
+        if(this != &o)
+        {
+            hash_map t(o, alloc_traits::propagate_on_container_copy_assignment::value ? o._alloc : _alloc);
+            destroy();
+            _hash = std::move(t._hash);
+            _equal = std::move(t._equal);
+            if constexpr(alloc_traits::propagate_on_container_copy_assignment::value) { _alloc = o._alloc; }
+            static_cast<stats_base&>(*this) = o;
+            steal(t);
+        }
+        return *this;
+    }
+    //! @brief Takes the storage of o, or moves its elements one by one if the allocators differ and do not propagate
+    hash_map& operator=(hash_map&& o) noexcept(alloc_traits::propagate_on_container_move_assignment::value ||
+                                               alloc_traits::is_always_equal::value)
+    {
+        if(this != &o)
+        {
+            destroy();
+            _hash = std::move(o._hash);
+            _equal = std::move(o._equal);
+            if constexpr(alloc_traits::propagate_on_container_move_assignment::value) { _alloc = std::move(o._alloc); }
+            if(alloc_traits::propagate_on_container_move_assignment::value || alloc_traits::is_always_equal::value || _alloc == o._alloc)
+            {
+                steal(o);
+            }
+            else
+            {
+                reserve(o.size());
+                for(auto& e : o) { construct_at(prepare_insert(hash_of(_hash, e.first)), e.first, std::move(e.second)); }
+                o.clear();
+            }
+            static_cast<stats_base&>(*this) = o;
+        }
+        return *this;
+    }
+    hash_map& operator=(std::initializer_list<value_type> il)
+    {
+        clear();
+        insert(il);
+        return *this;
+    }
+    ///@}
+
+    allocator_type get_allocator() const noexcept { return _alloc; }
+
+    ///@name Iterators
+    ///@{
+    iterator begin() noexcept
+    {
+        iterator it(_ctrl, _slots, _ctrl + _capacity);
+        it.skip_empty();
+        return it;
+    }
+    const_iterator begin() const noexcept
+    {
+        const_iterator it(_ctrl, _slots, _ctrl + _capacity);
+        it.skip_empty();
+        return it;
+    }
+    const_iterator cbegin() const noexcept { return begin(); }
+    iterator end() noexcept { return iterator(_ctrl + _capacity, _slots + _capacity, _ctrl + _capacity); }
+    const_iterator end() const noexcept { return const_iterator(_ctrl + _capacity, _slots + _capacity, _ctrl + _capacity); }
+    const_iterator cend() const noexcept { return end(); }
+    ///@}
+
+    ///@name Capacity
+    ///@{
+    bool empty() const noexcept { return _size == 0; }
+    size_type size() const noexcept { return _size; }
+    size_type max_size() const noexcept { return alloc_traits::max_size(_alloc); }
+    ///@}
+
+    ///@name Modifiers
+    ///@{
+    void clear() noexcept
+    {
+        if(!_capacity) { return; }
+        destroy_elements();
+        reset_ctrl();
+        _size = 0;
+        _growth_left = growth_limit(_capacity);
+    }
+
+    std::pair<iterator, bool> insert(const value_type& v) { return try_emplace_impl(v.first, v.second); }
+    std::pair<iterator, bool> insert(value_type&& v) { return try_emplace_impl(v.first, std::move(v.second)); }
+    template <class P, typename std::enable_if<std::is_constructible<value_type, P&&>::value, std::nullptr_t>::type = nullptr>
+    std::pair<iterator, bool> insert(P&& v) { return emplace(std::forward<P>(v)); }
+    iterator insert(const_iterator hint, const value_type& v) { (void)hint; return insert(v).first; }
+    iterator insert(const_iterator hint, value_type&& v) { (void)hint; return insert(std::move(v)).first; }
+    template <class InputIt>
+    void insert(InputIt first, InputIt last)
+    {
+        for(; first != last; ++first) { emplace(*first); }
+    }
+    void insert(std::initializer_list<value_type> il) { insert(il.begin(), il.end()); }
+
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(const Key& key, M&& obj) { return insert_or_assign_impl(key, std::forward<M>(obj)); }
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(Key&& key, M&& obj) { return insert_or_assign_impl(std::move(key), std::forward<M>(obj)); }
+
+    template <class... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        if constexpr(stdmap_detail::is_key_mapped_args<Key, Args...>::value) { return try_emplace_impl(std::forward<Args>(args)...); }
+        else
+        {
+            value_type v(std::forward<Args>(args)...);
+            return try_emplace_impl(v.first, std::move(v.second));
+        }
+    }
+    template <class... Args>
+    iterator emplace_hint(const_iterator hint, Args&&... args)
+    {
+        (void)hint;
+        return emplace(std::forward<Args>(args)...).first;
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) { return try_emplace_impl(key, std::forward<Args>(args)...); }
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(Key&& key, Args&&... args) { return try_emplace_impl(std::move(key), std::forward<Args>(args)...); }
+    template <class... Args>
+    iterator try_emplace(const_iterator hint, const Key& key, Args&&... args)
+    {
+        (void)hint;
+        return try_emplace_impl(key, std::forward<Args>(args)...).first;
+    }
+
+    iterator erase(const_iterator pos)
+    {
+        iterator it(pos._ctrl, const_cast<pointer>(pos._slot), pos._end);
+        erase_at(static_cast<size_type>(pos._ctrl - _ctrl));
+        ++it;
+        return it;
+    }
+    iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        while(first != last) { first = erase(first); }
+        return iterator(last._ctrl, const_cast<pointer>(last._slot), last._end);
+    }
+    size_type erase(const Key& key)
+    {
+        auto i = find_index<true>(key);
+        if(i == _capacity) { return 0; }
+        erase_at(i);
+        return 1;
+    }
+
+    void swap(hash_map& o) noexcept
+    {
+        using std::swap;
+        swap(_hash, o._hash);
+        swap(_equal, o._equal);
+        if constexpr(alloc_traits::propagate_on_container_swap::value) { swap(_alloc, o._alloc); }
+        swap(_ctrl, o._ctrl);
+        swap(_slots, o._slots);
+        swap(_capacity, o._capacity);
+        swap(_size, o._size);
+        swap(_growth_left, o._growth_left);
+        swap(static_cast<stats_base&>(*this), static_cast<stats_base&>(o));
+    }
+    ///@}
+
+    ///@name Lookup
+    ///@{
+    T& at(const Key& key)
+    {
+        auto i = find_index<true>(key);
+        if(i == _capacity) { stdmap_detail::throw_out_of_range("hash_map::at"); }
+        return _slots[i].second;
+    }
+    const T& at(const Key& key) const
+    {
+        auto i = find_index<true>(key);
+        if(i == _capacity) { stdmap_detail::throw_out_of_range("hash_map::at"); }
+        return _slots[i].second;
+    }
+    T& operator[](const Key& key) { return try_emplace_impl(key).first->second; }
+    T& operator[](Key&& key) { return try_emplace_impl(std::move(key)).first->second; }
+
+    size_type count(const Key& key) const { return find_index<true>(key) != _capacity ? 1 : 0; }
+    iterator find(const Key& key) { return iterator_at(find_index<true>(key)); }
+    const_iterator find(const Key& key) const { return iterator_at(find_index<true>(key)); }
+    bool contains(const Key& key) const { return find_index<true>(key) != _capacity; }
+    std::pair<iterator, iterator> equal_range(const Key& key)
+    {
+        auto it = find(key);
+        return { it, it == end() ? it : std::next(it) };
+    }
+    std::pair<const_iterator, const_iterator> equal_range(const Key& key) const
+    {
+        auto it = find(key);
+        return { it, it == end() ? it : std::next(it) };
+    }
+    ///@}
+
+    //! @name Heterogeneous lookup (if both Hash::is_transparent and KeyEqual::is_transparent exist)
+    ///@{
+    template <class K, class H = Hash, class E = KeyEqual, stdmap_detail::if_transparent<H> = nullptr, stdmap_detail::if_transparent<E> = nullptr>
+    size_type count(const K& key) const { return find_index<true>(key) != _capacity ? 1 : 0; }
+    template <class K, class H = Hash, class E = KeyEqual, stdmap_detail::if_transparent<H> = nullptr, stdmap_detail::if_transparent<E> = nullptr>
+    iterator find(const K& key) { return iterator_at(find_index<true>(key)); }
+    template <class K, class H = Hash, class E = KeyEqual, stdmap_detail::if_transparent<H> = nullptr, stdmap_detail::if_transparent<E> = nullptr>
+    const_iterator find(const K& key) const { return iterator_at(find_index<true>(key)); }
+    template <class K, class H = Hash, class E = KeyEqual, stdmap_detail::if_transparent<H> = nullptr, stdmap_detail::if_transparent<E> = nullptr>
+    bool contains(const K& key) const { return find_index<true>(key) != _capacity; }
+    template <class K, class H = Hash, class E = KeyEqual, stdmap_detail::if_transparent<H> = nullptr, stdmap_detail::if_transparent<E> = nullptr>
+    std::pair<iterator, iterator> equal_range(const K& key)
+    {
+        auto it = find(key);
+        return { it, it == end() ? it : std::next(it) };
+    }
+    template <class K, class H = Hash, class E = KeyEqual, stdmap_detail::if_transparent<H> = nullptr, stdmap_detail::if_transparent<E> = nullptr>
+    std::pair<const_iterator, const_iterator> equal_range(const K& key) const
+    {
+        auto it = find(key);
+        return { it, it == end() ? it : std::next(it) };
+    }
+    template <class K, class H = Hash, class E = KeyEqual, stdmap_detail::if_transparent_erase<H, K, iterator, const_iterator> = nullptr,
+              stdmap_detail::if_transparent<E> = nullptr>
+    size_type erase(K&& key)
+    {
+        auto i = find_index<true>(key);
+        if(i == _capacity) { return 0; }
+        erase_at(i);
+        return 1;
+    }
+    ///@}
+
+    ///@name Hash policy
+    ///@{
+    //! @brief Number of slots
+    size_type bucket_count() const noexcept { return _capacity; }
+    float load_factor() const noexcept { return _capacity ? static_cast<float>(_size) / static_cast<float>(_capacity) : 0.0f; }
+    float max_load_factor() const noexcept { return 7.0f / 8.0f; }
+    //! @brief Number of new elements that can be inserted before the next rehash (0 if the next insertion may rehash)
+    size_type growth_left() const noexcept { return _growth_left; }
+    //! @brief Rebuild the table with at least n slots (and enough for the current elements)
+    void rehash(size_type n)
+    {
+        if(n == 0 && _size == 0)
+        {
+            destroy();
+            return;
+        }
+        auto cap = capacity_for(_size);
+        while(cap < n) { cap <<= 1; }
+        resize(cap);
+    }
+    //! @brief Make room for at least n elements without rehash
+    void reserve(size_type n)
+    {
+        if(n > _size + _growth_left) { resize(capacity_for(n)); }
+    }
+    ///@}
+
+    /*!
+      @name Statistics
+      @brief With Stats = map_stats, stats() returns the counters of this map (see map_stats).
+      Probes are the control byte groups visited per lookup (1 unless keys collide). Rehashes count as reallocations.
+      With the default no_stats nothing is recorded and stats() returns an empty no_stats
+     */
+    ///@{
+    using stats_base::stats;
+    using stats_base::reset_stats;
+    ///@}
+
+    ///@name Observers
+    ///@{
+    hasher hash_function() const { return _hash; }
+    key_equal key_eq() const { return _equal; }
+    ///@}
+
+    ///@name Comparison
+    ///@{
+    friend bool operator==(const hash_map& a, const hash_map& b)
+    {
+        if(a.size() != b.size()) { return false; }
+        for(auto& e : a)
+        {
+            auto it = b.find(e.first);
+            if(it == b.end() || !(it->second == e.second)) { return false; }
+        }
+        return true;
+    }
+    friend bool operator!=(const hash_map& a, const hash_map& b) { return !(a == b); }
+    friend void swap(hash_map& a, hash_map& b) noexcept { a.swap(b); }
+    ///@}
+
+  private:
+    static constexpr size_type width = group::width;
+
+    // Capacity is a power of 2 and at least one group, so a group load never wraps.
+    // Control bytes are followed by a copy of the first (width) bytes for loads crossing the end.
+    static size_type capacity_for(size_type n)
+    {
+        size_type cap = width;
+        while(growth_limit(cap) < n) { cap <<= 1; }
+        return cap;
+    }
+    static size_type growth_limit(size_type cap) { return cap - cap / 8; }
+
+    template <class K>
+    static std::uint64_t hash_of(const Hash& h, const K& key) { return stdmap_detail::mix_hash(static_cast<std::uint64_t>(h(key))); }
+    static size_type h1(std::uint64_t h) { return static_cast<size_type>(h >> 7); }
+    static ctrl_t h2(std::uint64_t h) { return static_cast<ctrl_t>(h & 0x7F); }
+
+    iterator iterator_at(size_type i) { return iterator(_ctrl + i, _slots + i, _ctrl + _capacity); }
+    const_iterator iterator_at(size_type i) const { return const_iterator(_ctrl + i, _slots + i, _ctrl + _capacity); }
+
+    void set_ctrl(size_type i, ctrl_t c)
+    {
+        _ctrl[i] = c;
+        if(i < width) { _ctrl[_capacity + i] = c; }
+    }
+    void reset_ctrl() { std::memset(_ctrl, static_cast<unsigned char>(stdmap_detail::ctrl_empty), _capacity + width); }
+
+    // Index of the key, or _capacity if not found. Recorded as a lookup if Record
+    template <bool Record = false, class K>
+    size_type find_index(const K& key) const { return find_index<Record>(key, hash_of(_hash, key)); }
+    template <bool Record = false, class K>
+    size_type find_index(const K& key, std::uint64_t h) const
+    {
+        if(!_capacity)
+        {
+            record_lookup<Record>(false, 0);
+            return 0;
+        }
+        const size_type mask = _capacity - 1;
+        size_type pos = h1(h) & mask;
+        for(std::size_t probes = 1;; ++probes)
+        {
+            group g(_ctrl + pos);
+            for(auto m = g.match(h2(h)); m; m.clear_lowest())
+            {
+                auto i = (pos + m.lowest()) & mask;
+                if(_equal(_slots[i].first, key))
+                {
+                    record_lookup<Record>(true, probes);
+                    return i;
+                }
+            }
+            if(g.match_empty())
+            {
+                record_lookup<Record>(false, probes);
+                return _capacity;
+            }
+            pos = (pos + width) & mask;
+        }
+    }
+    template <bool Record>
+    void record_lookup(bool found, std::size_t probes) const
+    {
+        if constexpr(Record) { this->stat().on_lookup(found, probes); }
+    }
+
+    // First empty or deleted slot on the probe sequence of h
+    size_type find_first_non_full(std::uint64_t h) const
+    {
+        const size_type mask = _capacity - 1;
+        size_type pos = h1(h) & mask;
+        for(;;)
+        {
+            auto m = group(_ctrl + pos).match_empty_or_deleted();
+            if(m) { return (pos + m.lowest()) & mask; }
+            pos = (pos + width) & mask;
+        }
+    }
+
+    // Slot to construct a new element with hash h in (grows if needed)
+    size_type prepare_insert(std::uint64_t h)
+    {
+        auto i = find_first_non_full(h);
+        if(_growth_left == 0 && _ctrl[i] != stdmap_detail::ctrl_deleted)
+        {
+            // Drop tombstones in place if they take much room, otherwise grow
+            resize(_size <= growth_limit(_capacity) / 2 ? _capacity : _capacity * 2);
+            i = find_first_non_full(h);
+        }
+        _growth_left -= (_ctrl[i] == stdmap_detail::ctrl_empty);
+        set_ctrl(i, h2(h));
+        ++_size;
+        this->stat().on_size(_size);
+        return i;
+    }
+
+    template <class K, class... Args>
+    std::pair<iterator, bool> try_emplace_impl(K&& key, Args&&... args)
+    {
+        auto h = hash_of(_hash, key);
+        auto i = find_index(key, h);
+        if(i != _capacity) { return { iterator_at(i), false }; }
+        // The key or arguments referring to an element would dangle if the table grows: build the element first from those
+        if(stdmap_detail::args_refer_into(_slots, _slots + _capacity, key, args...))
+        {
+            Key k(std::forward<K>(key));
+            T v(std::forward<Args>(args)...);
+            return try_emplace_impl(std::move(k), std::move(v));
+        }
+        if(!_capacity) { resize(width); }
+        i = prepare_insert(h);
+        construct_at(i, std::forward<K>(key), std::forward<Args>(args)...);
+        return { iterator_at(i), true };
+    }
+
+    template <class K, class M>
+    std::pair<iterator, bool> insert_or_assign_impl(K&& key, M&& obj)
+    {
+        auto r = try_emplace_impl(std::forward<K>(key), std::forward<M>(obj));
+        if(!r.second) { r.first->second = std::forward<M>(obj); }
+        return r;
+    }
+
+    // Construct the element at the prepared slot. On exception the slot is given back
+    template <class K, class... Args>
+    void construct_at(size_type i, K&& key, Args&&... args)
+    {
+        struct guard
+        {
+            hash_map* self;
+            size_type i;
+            ~guard()
+            {
+                if(self)
+                {
+                    self->set_ctrl(i, stdmap_detail::ctrl_deleted);
+                    --self->_size;
+                }
+            }
+        } g{ this, i };
+        alloc_traits::construct(_alloc, _slots + i, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                                std::forward_as_tuple(std::forward<Args>(args)...));
+        g.self = nullptr;
+    }
+
+    // Move an element known not to be in the table
+    template <class V>
+    void emplace_unique_new(V&& v)
+    {
+        auto h = hash_of(_hash, v.first);
+        auto i = prepare_insert(h);
+        alloc_traits::construct(_alloc, _slots + i, std::forward<V>(v));
+    }
+
+    void erase_at(size_type i)
+    {
+        alloc_traits::destroy(_alloc, _slots + i);
+        set_ctrl(i, stdmap_detail::ctrl_deleted);
+        --_size;
+    }
+
+    void resize(size_type new_cap)
+    {
+        auto old_ctrl = _ctrl;
+        auto old_slots = _slots;
+        auto old_cap = _capacity;
+
+        ctrl_allocator ca(_alloc);
+        _ctrl = ctrl_alloc_traits::allocate(ca, new_cap + width);
+        _slots = alloc_traits::allocate(_alloc, new_cap);
+        _capacity = new_cap;
+        reset_ctrl();
+        _growth_left = growth_limit(new_cap);
+        _size = 0;
+
+        for(size_type i = 0; i < old_cap; ++i)
+        {
+            if(!stdmap_detail::ctrl_is_full(old_ctrl[i])) { continue; }
+            if constexpr(is_trivially_relocatable<value_type>::value)
+            {
+                auto j = prepare_insert(hash_of(_hash, old_slots[i].first));
+                std::memcpy(static_cast<void*>(_slots + j), static_cast<const void*>(old_slots + i), sizeof(value_type));
+            }
+            else
+            {
+                emplace_unique_new(std::move(old_slots[i]));
+                alloc_traits::destroy(_alloc, old_slots + i);
+            }
+        }
+        if(old_cap)
+        {
+            ctrl_alloc_traits::deallocate(ca, old_ctrl, old_cap + width);
+            alloc_traits::deallocate(_alloc, old_slots, old_cap);
+        }
+        this->stat().on_reallocate(_size * sizeof(value_type));
+    }
+
+    void destroy_elements()
+    {
+        if(!std::is_trivially_destructible<value_type>::value)
+        {
+            for(size_type i = 0; i < _capacity; ++i)
+            {
+                if(stdmap_detail::ctrl_is_full(_ctrl[i])) { alloc_traits::destroy(_alloc, _slots + i); }
+            }
+        }
+    }
+
+    void destroy()
+    {
+        if(!_capacity) { return; }
+        destroy_elements();
+        ctrl_allocator ca(_alloc);
+        ctrl_alloc_traits::deallocate(ca, _ctrl, _capacity + width);
+        alloc_traits::deallocate(_alloc, _slots, _capacity);
+        _ctrl = nullptr;
+        _slots = nullptr;
+        _capacity = _size = _growth_left = 0;
+    }
+
+    void steal(hash_map& o) noexcept
+    {
+        _ctrl = o._ctrl;
+        _slots = o._slots;
+        _capacity = o._capacity;
+        _size = o._size;
+        _growth_left = o._growth_left;
+        o._ctrl = nullptr;
+        o._slots = nullptr;
+        o._capacity = o._size = o._growth_left = 0;
+    }
+
+    Hash _hash{};
+    KeyEqual _equal{};
+    Allocator _alloc{};
+    ctrl_t* _ctrl{};
+    pointer _slots{};
+    size_type _capacity{};
+    size_type _size{};
+    size_type _growth_left{};
+};
+
+/*!
+  @brief Erase all elements satisfying the predicate
+  @return Number of erased elements
+ */
+template <class Key, class T, class Hash, class KeyEqual, class Allocator, class Stats, class Pred>
+typename hash_map<Key, T, Hash, KeyEqual, Allocator, Stats>::size_type erase_if(hash_map<Key, T, Hash, KeyEqual, Allocator, Stats>& c,
+                                                                                 Pred pred)
+{
+    typename hash_map<Key, T, Hash, KeyEqual, Allocator, Stats>::size_type n{};
+    for(auto it = c.begin(); it != c.end();)
+    {
+        if(pred(*it)) { it = c.erase(it); ++n; }
+        else { ++it; }
+    }
+    return n;
+}
+
+}
+#endif
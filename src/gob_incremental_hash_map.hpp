@@ -0,0 +1,545 @@
+/*!
+  @file gob_incremental_hash_map.hpp
+  @brief hash_map whose growth migrates the elements a few at a time
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_INCREMENTAL_HASH_MAP_HPP
+#define GOB_INCREMENTAL_HASH_MAP_HPP
+
+#include <utility>
+#include <functional>
+#include <iterator>
+#include <initializer_list>
+#include <memory>
+#include <type_traits>
+#include <cstddef>
+#include "internal/gob_stdmap_detail.hpp"
+#include "gob_hash_map.hpp"
+
+namespace goblib {
+
+/*!
+  @class incremental_hash_map
+  @brief hash_map with incremental rehash, for bounded insertion latency
+  @details When the table is full, a table of twice the slots is allocated and becomes the target of new
+  insertions, while the elements stay in the old table. Each later insertion of a new key moves
+  MigrationStep elements from the old table into the new one, so no insertion pays for moving the whole
+  table (a std::unordered_map or hash_map of 10M elements stalls for tens of milliseconds on growth).
+  While a migration is in progress, lookups search the new table and then the old one.
+  The migration is always finished before the new table fills up.
+  @tparam Key Key type
+  @tparam T Mapped type
+  @tparam Hash Hash function object
+  @tparam KeyEqual Equality function object for the key
+  @tparam Allocator Allocator for std::pair<const Key, T>
+  @tparam MigrationStep Number of elements moved per insertion during a migration (at least 1)
+  @note The interface is the same as hash_map (see there) with the following differences.
+  - Insertion of a new key invalidates iterators (elements may be migrated), erasure and lookup do not.
+  - bucket_count() is the number of slots of the table receiving insertions.
+  - reserve and rehash finish a migration in progress and rebuild at once.
+  - The growing insertion still allocates the new table and clears its control bytes (one byte per slot).
+  @code{.cpp}
+  goblib::incremental_hash_map<std::uint64_t, Order> orders;
+  orders.try_emplace(id, order);  // Never moves the whole table
+  if(idle) { orders.rehash_step(4096); }  // Optionally advance a migration when there is time
+  @endcode
+ */
+template <class Key, class T, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>,
+          class Allocator = std::allocator<std::pair<const Key, T>>, std::size_t MigrationStep = 8>
+class incremental_hash_map
+{
+    static_assert(MigrationStep >= 1, "MigrationStep must be at least 1");
+
+    using table_type = hash_map<Key, T, Hash, KeyEqual, Allocator>;
+
+  public:
+    template <bool Const> class basic_iterator;
+
+    ///@name Member types
+    ///@{
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<const Key, T>;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using allocator_type = Allocator;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = value_type*;
+    using const_pointer = const value_type*;
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+    ///@}
+
+    //! @brief Forward iterator over the new table, then the old table
+    template <bool Const>
+    class basic_iterator
+    {
+        friend class incremental_hash_map;
+        template <bool> friend class basic_iterator;
+        using table_iterator = typename std::conditional<Const, typename table_type::const_iterator, typename table_type::iterator>::type;
+        using table_pointer = typename std::conditional<Const, const table_type*, table_type*>::type;
+
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = typename incremental_hash_map::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference = typename std::conditional<Const, const value_type&, value_type&>::type;
+        using pointer = typename std::conditional<Const, const value_type*, value_type*>::type;
+
+        basic_iterator() = default;
+        template <bool C, typename std::enable_if<Const && !C, std::nullptr_t>::type = nullptr>
+        basic_iterator(const basic_iterator<C>& o) : _it(o._it), _end(o._end), _next(o._next) {}
+
+        reference operator*() const { return *_it; }
+        pointer operator->() const { return &*_it; }
+        basic_iterator& operator++()
+        {
+            ++_it;
+            skip_table();
+            return *this;
+        }
+        basic_iterator operator++(int) { auto t = *this; ++*this; return t; }
+
+        // The end of the table tells the tables apart
+        template <bool C> bool operator==(const basic_iterator<C>& o) const { return _it == o._it && _end == o._end; }
+        template <bool C> bool operator!=(const basic_iterator<C>& o) const { return !(*this == o); }
+
+      private:
+        basic_iterator(table_iterator it, table_iterator end, table_pointer next) : _it(it), _end(end), _next(next) { skip_table(); }
+        // Continue in the old table at the end of the new one
+        void skip_table()
+        {
+            if(_it == _end && _next && _next->bucket_count())
+            {
+                _it = _next->begin();
+                _end = _next->end();
+                _next = nullptr;
+            }
+        }
+        table_iterator _it{};
+        table_iterator _end{};
+        table_pointer _next{};  // Old table while walking the new one
+    };
+
+    ///@name Constructor
+    ///@{
+    incremental_hash_map() : incremental_hash_map(0) {}
+    explicit incremental_hash_map(size_type bucket_count, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual(),
+                                  const Allocator& alloc = Allocator())
+            : _cur(bucket_count, hash, equal, alloc), _old(0, hash, equal, alloc) {}
+    explicit incremental_hash_map(const Allocator& alloc) : incremental_hash_map(0, Hash(), KeyEqual(), alloc) {}
+    template <class InputIt>
+    incremental_hash_map(InputIt first, InputIt last, size_type bucket_count = 0, const Hash& hash = Hash(),
+                         const KeyEqual& equal = KeyEqual(), const Allocator& alloc = Allocator())
+            : incremental_hash_map(bucket_count, hash, equal, alloc)
+    {
+        insert(first, last);
+    }
+    incremental_hash_map(std::initializer_list<value_type> il, size_type bucket_count = 0, const Hash& hash = Hash(),
+                         const KeyEqual& equal = KeyEqual(), const Allocator& alloc = Allocator())
+            : incremental_hash_map(il.begin(), il.end(), bucket_count, hash, equal, alloc) {}
+    //! @brief The copy holds all elements in one table
+    incremental_hash_map(const incremental_hash_map& o)
+            : _cur(o.size(), o.hash_function(), o.key_eq(),
+                   std::allocator_traits<Allocator>::select_on_container_copy_construction(o.get_allocator())),
+              _old(0, o.hash_function(), o.key_eq(), _cur.get_allocator())
+    {
+        for(auto& e : o) { _cur.try_emplace(e.first, e.second); }
+    }
+    incremental_hash_map(incremental_hash_map&& o) noexcept
+            : _cur(std::move(o._cur)), _old(std::move(o._old)), _cursor(o._cursor)
+    {
+        o._cursor = {};
+    }
+    ///@}
+
+    ///@name Assignment
+    ///@{
+    incremental_hash_map& operator=(const incremental_hash_map& o)
+    {
+        if(this != &o)
+        {
+            incremental_hash_map t(o);
+            swap(t);
+        }
+        return *this;
+    }
+    incremental_hash_map& operator=(incremental_hash_map&& o) noexcept(std::is_nothrow_move_assignable<table_type>::value)
+    {
+        if(this != &o)
+        {
+            // The tables move element by element if the allocators differ and do not propagate: the cursor would not follow
+            if(!std::is_nothrow_move_assignable<table_type>::value && !(get_allocator() == o.get_allocator())) { o.finish_rehash(); }
+            _cur = std::move(o._cur);
+            _old = std::move(o._old);
+            _cursor = o._cursor;
+            o._cursor = {};
+        }
+        return *this;
+    }
+    incremental_hash_map& operator=(std::initializer_list<value_type> il)
+    {
+        clear();
+        insert(il);
+        return *this;
+    }
+    ///@}
+
+    allocator_type get_allocator() const noexcept { return _cur.get_allocator(); }
+
+    ///@name Iterators
+    ///@{
+    iterator begin() noexcept { return iterator(_cur.begin(), _cur.end(), &_old); }
+    const_iterator begin() const noexcept { return const_iterator(_cur.begin(), _cur.end(), &_old); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    iterator end() noexcept { return end_of(*this); }
+    const_iterator end() const noexcept { return end_of(*this); }
+    const_iterator cend() const noexcept { return end(); }
+    ///@}
+
+    ///@name Capacity
+    ///@{
+    bool empty() const noexcept { return size() == 0; }
+    size_type size() const noexcept { return _cur.size() + _old.size(); }
+    size_type max_size() const noexcept { return _cur.max_size(); }
+    ///@}
+
+    ///@name Modifiers
+    ///@{
+    //! @brief Erase all elements. A migration in progress is dropped and the old table is freed
+    void clear() noexcept
+    {
+        _cur.clear();
+        drop_old();
+    }
+
+    std::pair<iterator, bool> insert(const value_type& v) { return try_emplace_impl(v.first, v.second); }
+    std::pair<iterator, bool> insert(value_type&& v) { return try_emplace_impl(v.first, std::move(v.second)); }
+    template <class P, typename std::enable_if<std::is_constructible<value_type, P&&>::value, std::nullptr_t>::type = nullptr>
+    std::pair<iterator, bool> insert(P&& v) { return emplace(std::forward<P>(v)); }
+    iterator insert(const_iterator hint, const value_type& v) { (void)hint; return insert(v).first; }
+    iterator insert(const_iterator hint, value_type&& v) { (void)hint; return insert(std::move(v)).first; }
+    template <class InputIt>
+    void insert(InputIt first, InputIt last)
+    {
+        for(; first != last; ++first) { emplace(*first); }
+    }
+    void insert(std::initializer_list<value_type> il) { insert(il.begin(), il.end()); }
+
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(const Key& key, M&& obj) { return insert_or_assign_impl(key, std::forward<M>(obj)); }
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(Key&& key, M&& obj) { return insert_or_assign_impl(std::move(key), std::forward<M>(obj)); }
+
+    template <class... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        if constexpr(stdmap_detail::is_key_mapped_args<Key, Args...>::value) { return try_emplace_impl(std::forward<Args>(args)...); }
+        else
+        {
+            value_type v(std::forward<Args>(args)...);
+            return try_emplace_impl(v.first, std::move(v.second));
+        }
+    }
+    template <class... Args>
+    iterator emplace_hint(const_iterator hint, Args&&... args)
+    {
+        (void)hint;
+        return emplace(std::forward<Args>(args)...).first;
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) { return try_emplace_impl(key, std::forward<Args>(args)...); }
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(Key&& key, Args&&... args) { return try_emplace_impl(std::move(key), std::forward<Args>(args)...); }
+    template <class... Args>
+    iterator try_emplace(const_iterator hint, const Key& key, Args&&... args)
+    {
+        (void)hint;
+        return try_emplace_impl(key, std::forward<Args>(args)...).first;
+    }
+
+    //! @brief Erase the element. Erasure migrates nothing, so erasing while iterating is safe
+    iterator erase(const_iterator pos)
+    {
+        if(pos._end == _cur.cend()) { return iterator(_cur.erase(pos._it), _cur.end(), &_old); }
+        return iterator(erase_old(pos._it), _old.end(), nullptr);
+    }
+    iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        while(first != last) { first = erase(first); }
+        // An empty erase turns the position into a mutable iterator of its table
+        table_type& t = last._end == _cur.cend() ? _cur : _old;
+        return iterator(t.erase(last._it, last._it), t.end(), last._next ? &_old : nullptr);
+    }
+    size_type erase(const Key& key) { return erase_key(key); }
+
+    void swap(incremental_hash_map& o) noexcept
+    {
+        using std::swap;
+        _cur.swap(o._cur);
+        _old.swap(o._old);
+        swap(_cursor, o._cursor);
+    }
+    ///@}
+
+    ///@name Lookup
+    ///@{
+    T& at(const Key& key)
+    {
+        auto it = find(key);
+        if(it == end()) { stdmap_detail::throw_out_of_range("incremental_hash_map::at"); }
+        return it->second;
+    }
+    const T& at(const Key& key) const
+    {
+        auto it = find(key);
+        if(it == end()) { stdmap_detail::throw_out_of_range("incremental_hash_map::at"); }
+        return it->second;
+    }
+    T& operator[](const Key& key) { return try_emplace_impl(key).first->second; }
+    T& operator[](Key&& key) { return try_emplace_impl(std::move(key)).first->second; }
+
+    size_type count(const Key& key) const { return contains(key) ? 1 : 0; }
+    iterator find(const Key& key) { return find_in(*this, key); }
+    const_iterator find(const Key& key) const { return find_in(*this, key); }
+    bool contains(const Key& key) const { return _cur.contains(key) || (rehashing() && _old.contains(key)); }
+    std::pair<iterator, iterator> equal_range(const Key& key)
+    {
+        auto it = find(key);
+        return { it, it == end() ? it : std::next(it) };
+    }
+    std::pair<const_iterator, const_iterator> equal_range(const Key& key) const
+    {
+        auto it = find(key);
+        return { it, it == end() ? it : std::next(it) };
+    }
+    ///@}
+
+    //! @name Heterogeneous lookup (if both Hash::is_transparent and KeyEqual::is_transparent exist)
+    ///@{
+    template <class K, class H = Hash, class E = KeyEqual, stdmap_detail::if_transparent<H> = nullptr, stdmap_detail::if_transparent<E> = nullptr>
+    size_type count(const K& key) const { return contains(key) ? 1 : 0; }
+    template <class K, class H = Hash, class E = KeyEqual, stdmap_detail::if_transparent<H> = nullptr, stdmap_detail::if_transparent<E> = nullptr>
+    iterator find(const K& key) { return find_in(*this, key); }
+    template <class K, class H = Hash, class E = KeyEqual, stdmap_detail::if_transparent<H> = nullptr, stdmap_detail::if_transparent<E> = nullptr>
+    const_iterator find(const K& key) const { return find_in(*this, key); }
+    template <class K, class H = Hash, class E = KeyEqual, stdmap_detail::if_transparent<H> = nullptr, stdmap_detail::if_transparent<E> = nullptr>
+    bool contains(const K& key) const { return _cur.contains(key) || (rehashing() && _old.contains(key)); }
+    template <class K, class H = Hash, class E = KeyEqual, stdmap_detail::if_transparent<H> = nullptr, stdmap_detail::if_transparent<E> = nullptr>
+    std::pair<iterator, iterator> equal_range(const K& key)
+    {
+        auto it = find(key);
+        return { it, it == end() ? it : std::next(it) };
+    }
+    template <class K, class H = Hash, class E = KeyEqual, stdmap_detail::if_transparent<H> = nullptr, stdmap_detail::if_transparent<E> = nullptr>
+    std::pair<const_iterator, const_iterator> equal_range(const K& key) const
+    {
+        auto it = find(key);
+        return { it, it == end() ? it : std::next(it) };
+    }
+    template <class K, class H = Hash, class E = KeyEqual, stdmap_detail::if_transparent_erase<H, K, iterator, const_iterator> = nullptr,
+              stdmap_detail::if_transparent<E> = nullptr>
+    size_type erase(K&& key) { return erase_key(key); }
+    ///@}
+
+    ///@name Hash policy
+    ///@{
+    //! @brief Number of slots of the table receiving insertions
+    size_type bucket_count() const noexcept { return _cur.bucket_count(); }
+    float load_factor() const noexcept { return _cur.bucket_count() ? static_cast<float>(size()) / static_cast<float>(_cur.bucket_count()) : 0.0f; }
+    float max_load_factor() const noexcept { return _cur.max_load_factor(); }
+    //! @brief Finish a migration in progress and rebuild the table with at least n slots at once
+    void rehash(size_type n)
+    {
+        finish_rehash();
+        _cur.rehash(n);
+    }
+    //! @brief Finish a migration in progress and make room for at least n elements at once
+    void reserve(size_type n)
+    {
+        finish_rehash();
+        _cur.reserve(n);
+    }
+    ///@}
+
+    /*!
+      @name Incremental rehash
+      @brief Control of the migration from the old table. Insertions advance it by themselves;
+      these let a caller move more of it when latency does not matter (e.g. in an idle loop)
+     */
+    ///@{
+    //! @brief True while elements remain in the old table
+    bool rehashing() const noexcept { return _old.bucket_count() != 0; }
+    //! @brief Number of elements still in the old table
+    size_type rehash_pending() const noexcept { return _old.size(); }
+    /*!
+      @brief Migrate up to n elements
+      @return True if the migration is still in progress
+     */
+    bool rehash_step(size_type n)
+    {
+        migrate(n);
+        return rehashing();
+    }
+    //! @brief Migrate all remaining elements
+    void finish_rehash() { migrate(_old.size()); }
+    ///@}
+
+    ///@name Observers
+    ///@{
+    hasher hash_function() const { return _cur.hash_function(); }
+    key_equal key_eq() const { return _cur.key_eq(); }
+    ///@}
+
+    ///@name Comparison
+    ///@{
+    friend bool operator==(const incremental_hash_map& a, const incremental_hash_map& b)
+    {
+        if(a.size() != b.size()) { return false; }
+        for(auto& e : a)
+        {
+            auto it = b.find(e.first);
+            if(it == b.end() || !(it->second == e.second)) { return false; }
+        }
+        return true;
+    }
+    friend bool operator!=(const incremental_hash_map& a, const incremental_hash_map& b) { return !(a == b); }
+    friend void swap(incremental_hash_map& a, incremental_hash_map& b) noexcept { a.swap(b); }
+    ///@}
+
+  private:
+    template <class Self>
+    static auto end_of(Self& self) noexcept -> decltype(self.begin())
+    {
+        using It = decltype(self.begin());
+        auto& t = self.rehashing() ? self._old : self._cur;
+        return It(t.end(), t.end(), nullptr);
+    }
+    template <class Self, class K>
+    static auto find_in(Self& self, const K& key) -> decltype(self.begin())
+    {
+        using It = decltype(self.begin());
+        auto it = self._cur.find(key);
+        if(it != self._cur.end()) { return It(it, self._cur.end(), &self._old); }
+        if(self.rehashing())
+        {
+            auto o = self._old.find(key);
+            if(o != self._old.end()) { return It(o, self._old.end(), nullptr); }
+        }
+        return end_of(self);
+    }
+    template <class K, class... Args>
+    std::pair<iterator, bool> try_emplace_impl(K&& key, Args&&... args)
+    {
+        if(rehashing())
+        {
+            auto o = _old.find(key);
+            if(o != _old.end()) { return { iterator(o, _old.end(), nullptr), false }; }
+        }
+        if(!_cur.growth_left() && _cur.bucket_count())
+        {
+            auto it = _cur.find(key);
+            if(it != _cur.end()) { return { iterator(it, _cur.end(), &_old), false }; }
+            grow();
+        }
+        auto r = _cur.try_emplace(std::forward<K>(key), std::forward<Args>(args)...);
+        // The new table does not grow while migrated elements are added, so r.first stays valid
+        if(r.second) { migrate(MigrationStep); }
+        return { iterator(r.first, _cur.end(), &_old), r.second };
+    }
+    template <class K, class M>
+    std::pair<iterator, bool> insert_or_assign_impl(K&& key, M&& obj)
+    {
+        auto r = try_emplace_impl(std::forward<K>(key), std::forward<M>(obj));
+        if(!r.second) { r.first->second = std::forward<M>(obj); }
+        return r;
+    }
+
+    /*
+      Start a migration, since the next insertion would make the table rehash.
+      The new table has twice the slots (the same number if most of the old slots are tombstones).
+      A full table of N slots holds at most 7N/8 elements and the new one takes 7N/4 (7N/8) insertions,
+      so migrating at least one element per insertion empties the old table before the new one is full
+    */
+    void grow()
+    {
+        if(rehashing())
+        {
+            finish_rehash();
+            if(_cur.growth_left()) { return; }
+        }
+        const size_type cap = _cur.bucket_count();
+        const size_type limit = cap - cap / 8;
+        const size_type new_cap = _cur.size() <= limit / 2 ? cap : cap * 2;
+        // Allocated before anything changes, so a throwing allocation leaves this intact
+        table_type t(new_cap - new_cap / 8, _cur.hash_function(), _cur.key_eq(), _cur.get_allocator());
+        _old.swap(_cur);
+        _cur.swap(t);
+        _cursor = _old.begin();
+    }
+    // Move up to n elements from the old table, and free it when empty
+    void migrate(size_type n)
+    {
+        if(!rehashing()) { return; }
+        for(; n && _cursor != _old.end(); --n)
+        {
+            _cur.try_emplace(_cursor->first, std::move(_cursor->second));
+            _cursor = _old.erase(_cursor);
+        }
+        if(_cursor == _old.end()) { drop_old(); }
+    }
+    void drop_old() noexcept
+    {
+        _old.clear();
+        _old.rehash(0);
+        _cursor = {};
+    }
+    // Erase from the old table, keeping the migration cursor valid
+    typename table_type::iterator erase_old(typename table_type::const_iterator it)
+    {
+        const bool at_cursor = it == _cursor;
+        auto next = _old.erase(it);
+        if(at_cursor) { _cursor = next; }
+        return next;
+    }
+    template <class K>
+    size_type erase_key(const K& key)
+    {
+        if(_cur.erase(key)) { return 1; }
+        if(!rehashing()) { return 0; }
+        auto it = _old.find(key);
+        if(it == _old.end()) { return 0; }
+        erase_old(it);
+        return 1;
+    }
+
+    table_type _cur;  // Receives insertions
+    table_type _old;  // Being migrated into _cur (no slots if not rehashing)
+    typename table_type::iterator _cursor{};
+};
+
+/*!
+  @brief Erase all elements satisfying the predicate
+  @return Number of erased elements
+ */
+template <class Key, class T, class Hash, class KeyEqual, class Allocator, std::size_t MigrationStep, class Pred>
+typename incremental_hash_map<Key, T, Hash, KeyEqual, Allocator, MigrationStep>::size_type erase_if(
+    incremental_hash_map<Key, T, Hash, KeyEqual, Allocator, MigrationStep>& c, Pred pred)
+{
+    typename incremental_hash_map<Key, T, Hash, KeyEqual, Allocator, MigrationStep>::size_type n{};
+    for(auto it = c.begin(); it != c.end();)
+    {
+        if(pred(*it)) { it = c.erase(it); ++n; }
+        else { ++it; }
+    }
+    return n;
+}
+
+}
+#endif
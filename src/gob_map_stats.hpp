@@ -0,0 +1,165 @@
+/*!
+  @file gob_map_stats.hpp
+  @brief Statistics policies for gob_stdmap containers
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_MAP_STATS_HPP
+#define GOB_MAP_STATS_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+namespace goblib {
+
+/*!
+  @brief Statistics policy that records nothing (default)
+  @details All hooks are empty inline functions and the container holds it as an empty base,
+  so a container with no_stats has the same size and code as one without the policy.
+ */
+struct no_stats
+{
+    static constexpr bool enabled = false;
+
+    void on_lookup(bool, std::size_t) const noexcept {}
+    void on_size(std::size_t) const noexcept {}
+    void on_move(std::size_t) const noexcept {}
+    void on_reallocate(std::size_t) const noexcept {}
+    void reset() noexcept {}
+    void dump(std::ostream&, std::string_view = {}) const {}
+};
+
+/*!
+  @class map_stats
+  @brief Statistics policy that counts the operations of one container
+  @details Pass as the Stats template parameter of flat_map or hash_map.
+  - lookups, hits, misses: find, count, contains, at and erase by key
+  - probes: key comparisons (flat_map) or probed groups (hash_map) of those lookups
+  - reallocations: storage grown or rebuilt. bytes_moved includes the elements relocated by it
+  - bytes_moved: bytes of the elements shifted by insertion and erasure, or relocated by reallocation
+  - peak_size: largest number of elements held
+  @code{.cpp}
+  goblib::flat_map<int, int, std::less<int>, std::allocator<std::pair<int, int>>, goblib::map_stats> m;
+  ...
+  m.stats().dump(std::clog, "sessions");
+  // sessions: lookups=1000 hits=998 misses=2 avg_probes=11.02 reallocations=11 bytes_moved=409600 peak_size=1024
+  @endcode
+  @note Counters are relaxed atomics updated by plain load and store, so lookups from several threads
+  on a shared const container do not race, but concurrent updates may be lost.
+ */
+class map_stats
+{
+  public:
+    static constexpr bool enabled = true;
+
+    map_stats() = default;
+    map_stats(const map_stats& o) noexcept { assign(o); }
+    map_stats& operator=(const map_stats& o) noexcept
+    {
+        assign(o);
+        return *this;
+    }
+
+    ///@name Counters
+    ///@{
+    std::uint64_t lookups() const noexcept { return _lookups.load(std::memory_order_relaxed); }
+    std::uint64_t hits() const noexcept { return _hits.load(std::memory_order_relaxed); }
+    std::uint64_t misses() const noexcept { return lookups() - hits(); }
+    std::uint64_t probes() const noexcept { return _probes.load(std::memory_order_relaxed); }
+    //! @brief Probes per lookup
+    double average_probes() const noexcept { return lookups() ? static_cast<double>(probes()) / static_cast<double>(lookups()) : 0.0; }
+    std::uint64_t reallocations() const noexcept { return _reallocations.load(std::memory_order_relaxed); }
+    std::uint64_t bytes_moved() const noexcept { return _bytes_moved.load(std::memory_order_relaxed); }
+    std::uint64_t peak_size() const noexcept { return _peak_size.load(std::memory_order_relaxed); }
+    ///@}
+
+    ///@name Hooks called by the container
+    ///@{
+    void on_lookup(bool hit, std::size_t probes) noexcept
+    {
+        add(_lookups, 1);
+        add(_hits, hit);
+        add(_probes, probes);
+    }
+    void on_size(std::size_t size) noexcept
+    {
+        if(size > peak_size()) { _peak_size.store(size, std::memory_order_relaxed); }
+    }
+    void on_move(std::size_t bytes) noexcept { add(_bytes_moved, bytes); }
+    void on_reallocate(std::size_t bytes) noexcept
+    {
+        add(_reallocations, 1);
+        add(_bytes_moved, bytes);
+    }
+    ///@}
+
+    //! @brief Zero all counters
+    void reset() noexcept { assign(map_stats{}); }
+
+    //! @brief Write the counters in one line, prefixed by name if given
+    void dump(std::ostream& os, std::string_view name = {}) const
+    {
+        if(!name.empty()) { os << name << ": "; }
+        os << "lookups=" << lookups() << " hits=" << hits() << " misses=" << misses() << " avg_probes=" << average_probes()
+           << " reallocations=" << reallocations() << " bytes_moved=" << bytes_moved() << " peak_size=" << peak_size() << '\n';
+    }
+    friend std::ostream& operator<<(std::ostream& os, const map_stats& s)
+    {
+        s.dump(os);
+        return os;
+    }
+
+  private:
+    using counter = std::atomic<std::uint64_t>;
+
+    static void add(counter& c, std::uint64_t n) noexcept { c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+    void assign(const map_stats& o) noexcept
+    {
+        _lookups.store(o.lookups(), std::memory_order_relaxed);
+        _hits.store(o.hits(), std::memory_order_relaxed);
+        _probes.store(o.probes(), std::memory_order_relaxed);
+        _reallocations.store(o.reallocations(), std::memory_order_relaxed);
+        _bytes_moved.store(o.bytes_moved(), std::memory_order_relaxed);
+        _peak_size.store(o.peak_size(), std::memory_order_relaxed);
+    }
+
+    counter _lookups{}, _hits{}, _probes{}, _reallocations{}, _bytes_moved{}, _peak_size{};
+};
+
+namespace stdmap_detail {
+
+// Base of containers taking a Stats policy. Empty for no_stats, otherwise holds the (mutable) policy.
+// Copied, moved and swapped along with the container contents
+template <class Stats>
+class stats_holder
+{
+  public:
+    //! @brief Statistics of this container
+    const Stats& stats() const noexcept { return _stats; }
+    //! @brief Zero the statistics
+    void reset_stats() noexcept { _stats.reset(); }
+
+  protected:
+    Stats& stat() const noexcept { return _stats; }
+
+  private:
+    mutable Stats _stats{};
+};
+
+template <>
+class stats_holder<no_stats>
+{
+  public:
+    no_stats stats() const noexcept { return {}; }
+    void reset_stats() noexcept {}
+
+  protected:
+    static no_stats stat() noexcept { return {}; }
+};
+
+}  // namespace stdmap_detail
+}
+#endif
@@ -0,0 +1,580 @@
+/*!
+  @file gob_mapped_map.hpp
+  @brief Immutable sorted map file format, used in place through mmap
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_MAPPED_MAP_HPP
+#define GOB_MAPPED_MAP_HPP
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <functional>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <fstream>
+#include <ostream>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "internal/gob_stdmap_detail.hpp"
+#include "internal/gob_string_key.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define GOB_STDMAP_MAPPED_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace goblib {
+
+namespace stdmap_detail {
+
+/*
+  File layout (version 1, native endianness, every section aligned to 64 bytes, offsets from the file head)
+  - header
+  - keys    : Key[count], or for string keys uint64 big-endian prefix[count]
+  - key offsets / key blob (string keys) : uint64[count + 1] offsets into the blob, then the chars
+  - values  : T[count], or for string values uint64[count + 1] offsets into the value blob
+  - value blob (string values)
+ */
+struct mapped_map_header
+{
+    static constexpr char magic_string[8] = { 'G', 'O', 'B', 'S', 'M', 'A', 'P', '\0' };
+    static constexpr std::uint32_t current_version = 1;
+    static constexpr std::uint32_t endian_mark = 0x01020304;
+
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t endian;
+    std::uint32_t key_size;     // 0 for string keys
+    std::uint32_t mapped_size;  // 0 for string values
+    std::uint64_t count;
+    std::uint64_t keys_offset;
+    std::uint64_t key_offsets_offset;
+    std::uint64_t key_blob_offset;
+    std::uint64_t key_blob_size;
+    std::uint64_t values_offset;
+    std::uint64_t value_blob_offset;
+    std::uint64_t value_blob_size;
+    std::uint64_t file_size;
+};
+
+constexpr std::size_t mapped_section_align = 64;
+inline std::uint64_t mapped_align_up(std::uint64_t v) { return (v + mapped_section_align - 1) & ~std::uint64_t(mapped_section_align - 1); }
+
+// Field of the file: trivially copyable, or std::string_view stored in a blob
+template <class V>
+struct mapped_field
+{
+    static_assert(std::is_trivially_copyable<V>::value, "Key and T must be trivially copyable or std::string_view");
+    static constexpr bool is_string = false;
+    using reference = const V&;
+    using owned_type = V;
+    static constexpr std::uint32_t size = sizeof(V);
+};
+template <>
+struct mapped_field<std::string_view>
+{
+    static constexpr bool is_string = true;
+    using reference = std::string_view;
+    using owned_type = std::string;
+    static constexpr std::uint32_t size = 0;
+};
+
+}  // namespace stdmap_detail
+
+/*!
+  @class mapped_map
+  @brief Read-only sorted map that runs lookups directly on the bytes of a file written by write_mapped_map
+  @details Opening maps the file (mmap on POSIX, otherwise the file is read into memory) and validates the header.
+  There is no deserialization: lookups binary search the mapped arrays, and the OS pages in only the touched parts.
+  Processes opening the same file share its page cache. The format is position independent (offsets, no pointers).
+  String keys carry a big-endian 8 byte prefix array searched first, so most comparisons do not touch the chars.
+  @tparam Key Trivially copyable key type ordered by std::less, or std::string_view
+  @tparam T Trivially copyable mapped type, or std::string_view
+  @code{.cpp}
+  std::map<std::string, std::uint32_t> src = load();
+  goblib::write_mapped_map<std::string_view, std::uint32_t>("table.bin", src.begin(), src.end());
+
+  goblib::mapped_map<std::string_view, std::uint32_t> m("table.bin");
+  if(m.is_open()) { auto it = m.find("key"); }
+  @endcode
+  @note The file is written in native byte order and layout; opening a file of another endianness or
+  another Key/T size fails. Only the header and section bounds are validated.
+ */
+template <class Key, class T>
+class mapped_map
+{
+    using key_field = stdmap_detail::mapped_field<Key>;
+    using mapped_field = stdmap_detail::mapped_field<T>;
+    using header = stdmap_detail::mapped_map_header;
+
+  public:
+    ///@name Member types
+    ///@{
+    using key_type = Key;
+    using mapped_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using key_reference = typename key_field::reference;
+    using mapped_reference = typename mapped_field::reference;
+    using reference = std::pair<key_reference, mapped_reference>;
+    ///@}
+
+    //! @brief Random access proxy iterator. Dereference yields std::pair<key_reference, mapped_reference>
+    class const_iterator
+    {
+        friend class mapped_map;
+
+      public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = std::pair<typename key_field::owned_type, typename mapped_field::owned_type>;
+        using difference_type = std::ptrdiff_t;
+        using reference = typename mapped_map::reference;
+        //! @brief Result of operator-> (holds the proxy reference)
+        struct pointer
+        {
+            reference ref;
+            reference* operator->() { return &ref; }
+        };
+
+        const_iterator() = default;
+
+        reference operator*() const { return { _map->key_at(_i), _map->mapped_at(_i) }; }
+        pointer operator->() const { return { **this }; }
+        reference operator[](difference_type n) const { return *(*this + n); }
+
+        const_iterator& operator++() { ++_i; return *this; }
+        const_iterator operator++(int) { auto t = *this; ++_i; return t; }
+        const_iterator& operator--() { --_i; return *this; }
+        const_iterator operator--(int) { auto t = *this; --_i; return t; }
+        const_iterator& operator+=(difference_type n) { _i += n; return *this; }
+        const_iterator& operator-=(difference_type n) { _i -= n; return *this; }
+        friend const_iterator operator+(const_iterator it, difference_type n) { return it += n; }
+        friend const_iterator operator+(difference_type n, const_iterator it) { return it += n; }
+        friend const_iterator operator-(const_iterator it, difference_type n) { return it -= n; }
+        difference_type operator-(const const_iterator& o) const { return static_cast<difference_type>(_i) - static_cast<difference_type>(o._i); }
+
+        bool operator==(const const_iterator& o) const { return _i == o._i; }
+        bool operator!=(const const_iterator& o) const { return _i != o._i; }
+        bool operator<(const const_iterator& o) const { return _i < o._i; }
+        bool operator>(const const_iterator& o) const { return _i > o._i; }
+        bool operator<=(const const_iterator& o) const { return _i <= o._i; }
+        bool operator>=(const const_iterator& o) const { return _i >= o._i; }
+
+      private:
+        const_iterator(const mapped_map* m, size_type i) : _map(m), _i(i) {}
+        const mapped_map* _map{};
+        size_type _i{};
+    };
+    using iterator = const_iterator;
+    using reverse_iterator = std::reverse_iterator<const_iterator>;
+    using const_reverse_iterator = reverse_iterator;
+
+    ///@name Constructor
+    ///@{
+    mapped_map() = default;
+    //! @brief Open the file (check is_open())
+    explicit mapped_map(const std::string& path) { open(path); }
+    mapped_map(const mapped_map&) = delete;
+    mapped_map& operator=(const mapped_map&) = delete;
+    mapped_map(mapped_map&& o) noexcept { steal(o); }
+    mapped_map& operator=(mapped_map&& o) noexcept
+    {
+        if(this != &o)
+        {
+            close();
+            steal(o);
+        }
+        return *this;
+    }
+    ~mapped_map() { close(); }
+    ///@}
+
+    ///@name File
+    ///@{
+    /*!
+      @brief Map the file
+      @return False if the file cannot be opened or is not a valid file for Key and T
+     */
+    bool open(const std::string& path)
+    {
+        close();
+#if defined(GOB_STDMAP_MAPPED_MMAP)
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0) { return false; }
+        struct stat st;
+        if(::fstat(fd, &st) != 0 || st.st_size <= 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        auto size = static_cast<size_type>(st.st_size);
+        void* p = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if(p == MAP_FAILED) { return false; }
+        _mapping = p;
+        _mapping_size = size;
+#else
+        std::ifstream ifs(path, std::ios::binary | std::ios::ate);
+        if(!ifs) { return false; }
+        auto size = static_cast<size_type>(ifs.tellg());
+        _owned.reset(new std::uint64_t[(size + 7) / 8]);
+        ifs.seekg(0);
+        if(!ifs.read(reinterpret_cast<char*>(_owned.get()), static_cast<std::streamsize>(size)))
+        {
+            _owned.reset();
+            return false;
+        }
+        _mapping_size = size;
+#endif
+        if(!attach(mapping_data(), size))
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+    /*!
+      @brief Use the image in memory without copying (not owned; it must outlive this map)
+      @return False if data is not a valid image for Key and T, or is not aligned to 64 bytes
+     */
+    bool open(const void* data, size_type size)
+    {
+        close();
+        return attach(static_cast<const unsigned char*>(data), size);
+    }
+    void close() noexcept
+    {
+#if defined(GOB_STDMAP_MAPPED_MMAP)
+        if(_mapping) { ::munmap(_mapping, _mapping_size); }
+        _mapping = nullptr;
+#else
+        _owned.reset();
+#endif
+        _mapping_size = 0;
+        _base = nullptr;
+        _count = 0;
+    }
+    bool is_open() const noexcept { return _base != nullptr; }
+    ///@}
+
+    ///@name Element access
+    ///@{
+    mapped_reference at(const Key& key) const
+    {
+        auto i = find_index(key);
+        if(i == size()) { stdmap_detail::throw_out_of_range("mapped_map::at"); }
+        return mapped_at(i);
+    }
+    ///@}
+
+    ///@name Iterators
+    ///@{
+    const_iterator begin() const noexcept { return const_iterator(this, 0); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    const_iterator end() const noexcept { return const_iterator(this, size()); }
+    const_iterator cend() const noexcept { return end(); }
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+    const_reverse_iterator crbegin() const noexcept { return rbegin(); }
+    const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+    const_reverse_iterator crend() const noexcept { return rend(); }
+    ///@}
+
+    ///@name Capacity
+    ///@{
+    bool empty() const noexcept { return _count == 0; }
+    size_type size() const noexcept { return _count; }
+    ///@}
+
+    ///@name Lookup
+    ///@{
+    size_type count(const Key& key) const { return contains(key) ? 1 : 0; }
+    bool contains(const Key& key) const { return find_index(key) != size(); }
+    const_iterator find(const Key& key) const { return const_iterator(this, find_index(key)); }
+    const_iterator lower_bound(const Key& key) const { return const_iterator(this, bound_index<false>(key)); }
+    const_iterator upper_bound(const Key& key) const { return const_iterator(this, bound_index<true>(key)); }
+    std::pair<const_iterator, const_iterator> equal_range(const Key& key) const
+    {
+        auto i = bound_index<false>(key);
+        return { const_iterator(this, i), const_iterator(this, i + (i != size() && compare(i, probe_of(key)) == 0)) };
+    }
+    ///@}
+
+  private:
+    using probe_type = typename std::conditional<key_field::is_string, stdmap_detail::string_probe, const Key&>::type;
+
+    const unsigned char* mapping_data() const
+    {
+#if defined(GOB_STDMAP_MAPPED_MMAP)
+        return static_cast<const unsigned char*>(_mapping);
+#else
+        return reinterpret_cast<const unsigned char*>(_owned.get());
+#endif
+    }
+
+    template <class U>
+    const U* section(std::uint64_t offset) const { return reinterpret_cast<const U*>(_base + offset); }
+
+    // Header, section bounds and string offsets check
+    bool attach(const unsigned char* data, size_type size)
+    {
+        if(!data || size < sizeof(header) || reinterpret_cast<std::uintptr_t>(data) % stdmap_detail::mapped_section_align) { return false; }
+        header h;
+        std::memcpy(&h, data, sizeof(h));
+        if(std::memcmp(h.magic, header::magic_string, sizeof(h.magic)) != 0 || h.version != header::current_version ||
+           h.endian != header::endian_mark || h.key_size != key_field::size || h.mapped_size != mapped_field::size || h.file_size != size)
+        {
+            return false;
+        }
+        auto within = [size](std::uint64_t off, std::uint64_t bytes) { return off <= size && bytes <= size - off; };
+        const auto n = h.count;
+        if(n > size) { return false; }
+        const std::uint64_t key_bytes = key_field::is_string ? n * 8 : n * key_field::size;
+        const std::uint64_t value_bytes = mapped_field::is_string ? (n + 1) * 8 : n * mapped_field::size;
+        if(!within(h.keys_offset, key_bytes) || !within(h.values_offset, value_bytes)) { return false; }
+        if(key_field::is_string && (!within(h.key_offsets_offset, (n + 1) * 8) || !within(h.key_blob_offset, h.key_blob_size))) { return false; }
+        if(mapped_field::is_string && !within(h.value_blob_offset, h.value_blob_size)) { return false; }
+        if(key_field::is_string && !valid_offsets(data + h.key_offsets_offset, n, h.key_blob_size)) { return false; }
+        if(mapped_field::is_string && !valid_offsets(data + h.values_offset, n, h.value_blob_size)) { return false; }
+        _base = data;
+        _count = static_cast<size_type>(n);
+        _keys = section<unsigned char>(h.keys_offset);
+        _key_offsets = section<std::uint64_t>(h.key_offsets_offset);
+        _key_blob = section<char>(h.key_blob_offset);
+        _values = section<unsigned char>(h.values_offset);
+        _value_blob = section<char>(h.value_blob_offset);
+        return true;
+    }
+    // n + 1 offsets into a blob of blob_size bytes: ascending, and the last one at the end of the blob
+    static bool valid_offsets(const unsigned char* p, std::uint64_t n, std::uint64_t blob_size)
+    {
+        auto offsets = reinterpret_cast<const std::uint64_t*>(p);
+        for(std::uint64_t i = 0; i < n; ++i)
+        {
+            if(offsets[i] > offsets[i + 1]) { return false; }
+        }
+        return offsets[n] == blob_size;
+    }
+
+    key_reference key_at(size_type i) const
+    {
+        if constexpr(key_field::is_string)
+        {
+            return std::string_view(_key_blob + _key_offsets[i], static_cast<size_type>(_key_offsets[i + 1] - _key_offsets[i]));
+        }
+        else { return reinterpret_cast<const Key*>(_keys)[i]; }
+    }
+    mapped_reference mapped_at(size_type i) const
+    {
+        if constexpr(mapped_field::is_string)
+        {
+            auto offsets = reinterpret_cast<const std::uint64_t*>(_values);
+            return std::string_view(_value_blob + offsets[i], static_cast<size_type>(offsets[i + 1] - offsets[i]));
+        }
+        else { return reinterpret_cast<const T*>(_values)[i]; }
+    }
+
+    static probe_type probe_of(const Key& key)
+    {
+        if constexpr(key_field::is_string) { return stdmap_detail::string_probe(key); }
+        else { return key; }
+    }
+    // Three-way compare of key i with the probe. String keys are decided by the prefix array when possible
+    int compare(size_type i, const probe_type& p) const
+    {
+        if constexpr(key_field::is_string)
+        {
+            const auto kp = reinterpret_cast<const std::uint64_t*>(_keys)[i];
+            if(kp != p.prefix) { return kp < p.prefix ? -1 : 1; }
+            return key_at(i).compare(p.str);
+        }
+        else
+        {
+            const Key& k = key_at(i);
+            return std::less<Key>()(k, p) ? -1 : (std::less<Key>()(p, k) ? 1 : 0);
+        }
+    }
+    template <bool Upper>
+    size_type bound_index(const Key& key) const
+    {
+        const probe_type p = probe_of(key);
+        size_type lo{}, n{ size() };
+        while(n > 0)
+        {
+            const size_type half = n / 2;
+            const int c = compare(lo + half, p);
+            if(Upper ? c <= 0 : c < 0) { lo += half + 1; n -= half + 1; }
+            else { n = half; }
+        }
+        return lo;
+    }
+    size_type find_index(const Key& key) const
+    {
+        auto i = bound_index<false>(key);
+        return (i != size() && compare(i, probe_of(key)) == 0) ? i : size();
+    }
+
+    void steal(mapped_map& o) noexcept
+    {
+#if defined(GOB_STDMAP_MAPPED_MMAP)
+        _mapping = o._mapping;
+        o._mapping = nullptr;
+#else
+        _owned = std::move(o._owned);
+#endif
+        _mapping_size = o._mapping_size;
+        _base = o._base;
+        _count = o._count;
+        _keys = o._keys;
+        _key_offsets = o._key_offsets;
+        _key_blob = o._key_blob;
+        _values = o._values;
+        _value_blob = o._value_blob;
+        o._mapping_size = 0;
+        o._base = nullptr;
+        o._count = 0;
+    }
+
+#if defined(GOB_STDMAP_MAPPED_MMAP)
+    void* _mapping{};
+#else
+    std::unique_ptr<std::uint64_t[]> _owned{};
+#endif
+    size_type _mapping_size{};
+    const unsigned char* _base{};
+    size_type _count{};
+    const unsigned char* _keys{};
+    const std::uint64_t* _key_offsets{};
+    const char* _key_blob{};
+    const unsigned char* _values{};
+    const char* _value_blob{};
+};
+
+/*!
+  @brief Write the elements of the range as a mapped_map<Key, T> image
+  @details Elements are sorted by key once; of equivalent keys the first one is written.
+  @tparam Key Key type of the mapped_map (std::string_view for string keys)
+  @tparam T Mapped type of the mapped_map (std::string_view for string values)
+  @param os Binary output stream
+  @param first,last Range of pairs whose first / second are convertible to Key / T
+  @return True on success
+ */
+template <class Key, class T, class InputIt>
+bool write_mapped_map(std::ostream& os, InputIt first, InputIt last)
+{
+    using key_field = stdmap_detail::mapped_field<Key>;
+    using mapped_field = stdmap_detail::mapped_field<T>;
+    using header = stdmap_detail::mapped_map_header;
+
+    std::vector<std::pair<typename key_field::owned_type, typename mapped_field::owned_type>> src;
+    for(; first != last; ++first)
+    {
+        auto&& e = *first;
+        src.emplace_back(typename key_field::owned_type(Key(e.first)), typename mapped_field::owned_type(T(e.second)));
+    }
+    std::stable_sort(src.begin(), src.end(), [](const auto& a, const auto& b) { return std::less<>()(a.first, b.first); });
+    src.erase(std::unique(src.begin(), src.end(), [](const auto& a, const auto& b) { return !std::less<>()(a.first, b.first); }),
+              src.end());
+    const std::uint64_t n = src.size();
+
+    // Layout
+    header h{};
+    std::memcpy(h.magic, header::magic_string, sizeof(h.magic));
+    h.version = header::current_version;
+    h.endian = header::endian_mark;
+    h.key_size = key_field::size;
+    h.mapped_size = mapped_field::size;
+    h.count = n;
+    std::uint64_t pos = stdmap_detail::mapped_align_up(sizeof(header));
+    h.keys_offset = pos;
+    pos = stdmap_detail::mapped_align_up(pos + (key_field::is_string ? n * 8 : n * key_field::size));
+    if constexpr(key_field::is_string)
+    {
+        for(auto& e : src) { h.key_blob_size += e.first.size(); }
+        h.key_offsets_offset = pos;
+        pos = stdmap_detail::mapped_align_up(pos + (n + 1) * 8);
+        h.key_blob_offset = pos;
+        pos = stdmap_detail::mapped_align_up(pos + h.key_blob_size);
+    }
+    h.values_offset = pos;
+    pos = stdmap_detail::mapped_align_up(pos + (mapped_field::is_string ? (n + 1) * 8 : n * mapped_field::size));
+    if constexpr(mapped_field::is_string)
+    {
+        for(auto& e : src) { h.value_blob_size += e.second.size(); }
+        h.value_blob_offset = pos;
+        pos = stdmap_detail::mapped_align_up(pos + h.value_blob_size);
+    }
+    h.file_size = pos;
+
+    // Sections in file order, padded to their offsets
+    std::uint64_t written{};
+    auto put = [&os, &written](const void* p, std::uint64_t bytes) {
+        os.write(static_cast<const char*>(p), static_cast<std::streamsize>(bytes));
+        written += bytes;
+    };
+    auto pad_to = [&os, &written](std::uint64_t offset) {
+        static const char zeros[stdmap_detail::mapped_section_align]{};
+        if(written < offset) { os.write(zeros, static_cast<std::streamsize>(offset - written)); }
+        written = offset;
+    };
+    auto put_offsets = [&](auto member) {
+        std::uint64_t off{};
+        for(auto& e : src)
+        {
+            put(&off, 8);
+            off += (e.*member).size();
+        }
+        put(&off, 8);
+    };
+
+    put(&h, sizeof(h));
+    pad_to(h.keys_offset);
+    if constexpr(key_field::is_string)
+    {
+        for(auto& e : src)
+        {
+            auto pfx = stdmap_detail::load_prefix(e.first.data(), e.first.size());
+            put(&pfx, 8);
+        }
+        pad_to(h.key_offsets_offset);
+        put_offsets(&std::decay_t<decltype(src.front())>::first);
+        pad_to(h.key_blob_offset);
+        for(auto& e : src) { put(e.first.data(), e.first.size()); }
+    }
+    else
+    {
+        for(auto& e : src) { put(&e.first, sizeof(Key)); }
+    }
+    pad_to(h.values_offset);
+    if constexpr(mapped_field::is_string)
+    {
+        put_offsets(&std::decay_t<decltype(src.front())>::second);
+        pad_to(h.value_blob_offset);
+        for(auto& e : src) { put(e.second.data(), e.second.size()); }
+    }
+    else
+    {
+        for(auto& e : src) { put(&e.second, sizeof(T)); }
+    }
+    pad_to(h.file_size);
+    return static_cast<bool>(os);
+}
+
+//! @brief Write the elements of the range to the file as a mapped_map<Key, T> image
+template <class Key, class T, class InputIt>
+bool write_mapped_map(const std::string& path, InputIt first, InputIt last)
+{
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    return ofs && write_mapped_map<Key, T>(ofs, first, last) && static_cast<bool>(ofs.flush());
+}
+
+}
+#endif
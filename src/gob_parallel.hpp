@@ -0,0 +1,393 @@
+/*!
+  @file gob_parallel.hpp
+  @brief Parallel bulk build, merge and set operations for the sorted maps
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_PARALLEL_HPP
+#define GOB_PARALLEL_HPP
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <utility>
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+#include <cstddef>
+#include "internal/gob_stdmap_detail.hpp"
+
+/*
+  The algorithms split the work into ranges and run them on std::thread workers (fork-join per call).
+  std::execution policies are not used: libstdc++ needs TBB for them and falls back to serial otherwise.
+ */
+
+namespace goblib {
+
+namespace parallel_detail {
+
+// Minimum number of elements per task; smaller inputs run on fewer threads
+constexpr std::size_t grain_size = 1U << 14;
+
+inline unsigned resolve_threads(unsigned threads)
+{
+    return threads ? threads : std::max(1U, std::thread::hardware_concurrency());
+}
+
+// Number of ranges to split n elements into (several per thread for load balance)
+inline std::size_t part_count(std::size_t n, unsigned threads)
+{
+    if(threads <= 1) { return 1; }
+    return std::max<std::size_t>(1, std::min<std::size_t>(std::size_t(threads) * 4, n / grain_size));
+}
+
+/*
+  Call f(i) for i in [0, count) on up to threads threads (the caller is one of them).
+  The first exception thrown by f is rethrown after all threads are joined.
+ */
+template <class F>
+void parallel_for(std::size_t count, unsigned threads, F&& f)
+{
+    const auto workers = static_cast<unsigned>(std::min<std::size_t>(threads, count));
+    if(workers <= 1)
+    {
+        for(std::size_t i = 0; i < count; ++i) { f(i); }
+        return;
+    }
+    std::atomic<std::size_t> next{};
+    std::exception_ptr error{};
+    std::mutex error_mutex{};
+    auto work = [&] {
+        for(;;)
+        {
+            const auto i = next.fetch_add(1, std::memory_order_relaxed);
+            if(i >= count) { return; }
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+            try
+            {
+                f(i);
+            }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if(!error) { error = std::current_exception(); }
+                next.store(count, std::memory_order_relaxed);
+                return;
+            }
+#else
+            f(i);
+#endif
+        }
+    };
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    for(unsigned t = 1; t < workers; ++t) { pool.emplace_back(work); }
+    work();
+    for(auto& th : pool) { th.join(); }
+    if(error) { std::rethrow_exception(error); }
+}
+
+// Orders value_type (std::pair) by key
+template <class Compare>
+struct value_less
+{
+    const Compare& comp;
+    template <class A, class B>
+    bool operator()(const A& a, const B& b) const { return comp(a.first, b.first); }
+};
+
+/*
+  Stable sort: each range is sorted on its own, then runs are merged pairwise per round.
+  Each pair is merged in pieces cut at the same key in both runs, so all threads work in every round
+ */
+template <class V, class Less>
+void stable_sort(std::vector<V>& v, const Less& less, unsigned threads)
+{
+    const std::size_t n = v.size();
+    const std::size_t parts = part_count(n, threads);
+    if(parts <= 1)
+    {
+        std::stable_sort(v.begin(), v.end(), less);
+        return;
+    }
+    std::vector<std::size_t> bounds(parts + 1);
+    for(std::size_t i = 0; i <= parts; ++i) { bounds[i] = n * i / parts; }
+    parallel_for(parts, threads, [&](std::size_t i) {
+        std::stable_sort(v.begin() + static_cast<std::ptrdiff_t>(bounds[i]), v.begin() + static_cast<std::ptrdiff_t>(bounds[i + 1]), less);
+    });
+
+    struct task
+    {
+        std::size_t a0, a1, b0, b1, out;
+    };
+    std::vector<V> buf(n);
+    std::vector<V>* src = &v;
+    std::vector<V>* dst = &buf;
+    while(bounds.size() > 2)
+    {
+        const std::size_t runs = bounds.size() - 1;
+        const std::size_t pieces = std::max<std::size_t>(1, part_count(n, threads) / std::max<std::size_t>(1, runs / 2));
+        std::vector<task> tasks;
+        std::vector<std::size_t> next_bounds{ 0 };
+        auto at = [src](std::size_t i) { return src->begin() + static_cast<std::ptrdiff_t>(i); };
+        for(std::size_t r = 0; r + 1 < runs; r += 2)
+        {
+            const std::size_t a0 = bounds[r], a1 = bounds[r + 1], b1 = bounds[r + 2];
+            // Piece s takes run A [sa(s), sa(s + 1)) and the elements of run B less than A[sa(s + 1)] not taken yet
+            std::size_t prev_a = a0, prev_b = a1;
+            for(std::size_t s = 1; s <= pieces; ++s)
+            {
+                const std::size_t sa = a0 + (a1 - a0) * s / pieces;
+                const std::size_t sb = (s == pieces) ? b1 : static_cast<std::size_t>(std::lower_bound(at(a1), at(b1), (*src)[sa], less) - src->begin());
+                tasks.push_back({ prev_a, sa, prev_b, sb, prev_a + (prev_b - a1) });
+                prev_a = sa;
+                prev_b = sb;
+            }
+            next_bounds.push_back(b1);
+        }
+        if(runs % 2)
+        {
+            tasks.push_back({ bounds[runs - 1], bounds[runs], n, n, bounds[runs - 1] });
+            next_bounds.push_back(n);
+        }
+        parallel_for(tasks.size(), threads, [&](std::size_t i) {
+            const auto& t = tasks[i];
+            std::merge(std::make_move_iterator(at(t.a0)), std::make_move_iterator(at(t.a1)), std::make_move_iterator(at(t.b0)),
+                       std::make_move_iterator(at(t.b1)), dst->begin() + static_cast<std::ptrdiff_t>(t.out), less);
+        });
+        std::swap(src, dst);
+        bounds.swap(next_bounds);
+    }
+    if(src != &v) { v.swap(buf); }
+}
+
+// Keep the first of each run of equivalent elements of the sorted v
+template <class V, class Less>
+std::vector<V> unique(std::vector<V>& v, const Less& less, unsigned threads)
+{
+    const std::size_t n = v.size();
+    const std::size_t parts = part_count(n, threads);
+    std::vector<std::size_t> offset(parts + 1);
+    std::vector<char> first_kept(parts);
+    auto begin_of = [n, parts](std::size_t k) { return n * k / parts; };
+    parallel_for(parts, threads, [&](std::size_t k) {
+        const std::size_t b = begin_of(k), e = begin_of(k + 1);
+        std::size_t c{};
+        for(std::size_t i = b; i < e; ++i) { c += (i == 0 || less(v[i - 1], v[i])); }
+        offset[k + 1] = c;
+        first_kept[k] = (b == 0 || (b < e && less(v[b - 1], v[b])));
+    });
+    for(std::size_t k = 0; k < parts; ++k) { offset[k + 1] += offset[k]; }
+
+    std::vector<V> out(offset[parts]);
+    parallel_for(parts, threads, [&](std::size_t k) {
+        const std::size_t b = begin_of(k), e = begin_of(k + 1);
+        std::size_t w = offset[k];
+        const V* prev{};  // Element equivalent to v[i - 1] which is still intact
+        for(std::size_t i = b; i < e; ++i)
+        {
+            if(i == b ? first_kept[k] : less(*prev, v[i]))
+            {
+                out[w] = std::move(v[i]);
+                prev = &out[w++];
+            }
+            else { prev = &v[i]; }
+        }
+    });
+    return out;
+}
+
+enum class set_op
+{
+    union_op,
+    intersection_op,
+    difference_op
+};
+
+// Merge walk over one piece of both maps, calling emit_a / emit_b for the elements in the result
+template <set_op Op, class ItA, class ItB, class Compare, class EmitA, class EmitB>
+void set_op_piece(ItA a, ItA ae, ItB b, ItB be, const Compare& comp, EmitA&& emit_a, EmitB&& emit_b)
+{
+    while(a != ae && b != be)
+    {
+        if(comp((*a).first, (*b).first))
+        {
+            if(Op != set_op::intersection_op) { emit_a(a); }
+            ++a;
+        }
+        else if(comp((*b).first, (*a).first))
+        {
+            if(Op == set_op::union_op) { emit_b(b); }
+            ++b;
+        }
+        else
+        {
+            if(Op != set_op::difference_op) { emit_a(a); }
+            ++a;
+            ++b;
+        }
+    }
+    if(Op != set_op::intersection_op)
+    {
+        for(; a != ae; ++a) { emit_a(a); }
+    }
+    if(Op == set_op::union_op)
+    {
+        for(; b != be; ++b) { emit_b(b); }
+    }
+}
+
+// Iterators at about every size / parts elements of m (begin and end included)
+template <class Map>
+auto split_points(Map& m, std::size_t parts)
+{
+    using It = decltype(m.begin());
+    std::vector<It> pos;
+    pos.reserve(parts + 1);
+    const std::size_t n = m.size();
+    if constexpr(std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<It>::iterator_category>::value)
+    {
+        for(std::size_t j = 0; j <= parts; ++j) { pos.push_back(m.begin() + static_cast<std::ptrdiff_t>(n * j / parts)); }
+    }
+    else
+    {
+        // One walk over the linked elements
+        auto it = m.begin();
+        std::size_t i{};
+        for(std::size_t j = 0; j <= parts; ++j)
+        {
+            for(const std::size_t target = n * j / parts; i < target; ++i) { ++it; }
+            pos.push_back(it);
+        }
+    }
+    return pos;
+}
+
+/*
+  Result of the set operation as a sorted vector. Both maps are cut at the same keys (taken from the larger),
+  pieces are counted in parallel, then written in parallel at their offsets. Elements are moved if Move
+ */
+template <set_op Op, bool Move, class Map>
+std::vector<typename std::remove_const<Map>::type::value_type> set_operation(Map& a, Map& b, unsigned threads)
+{
+    using value_type = typename std::remove_const<Map>::type::value_type;
+    threads = resolve_threads(threads);
+    const auto comp = a.key_comp();
+    const std::size_t parts = part_count(a.size() + b.size(), threads);
+
+    using It = decltype(a.begin());
+    std::vector<It> pa, pb;
+    {
+        auto& big = a.size() >= b.size() ? a : b;
+        auto cut = split_points(big, parts);
+        pa.push_back(a.begin());
+        pb.push_back(b.begin());
+        for(std::size_t j = 1; j < parts; ++j)
+        {
+            const auto& key = (*cut[j]).first;
+            pa.push_back(&big == &a ? cut[j] : a.lower_bound(key));
+            pb.push_back(&big == &b ? cut[j] : b.lower_bound(key));
+        }
+        pa.push_back(a.end());
+        pb.push_back(b.end());
+    }
+
+    auto run_piece = [&](std::size_t j, auto&& emit) {
+        if constexpr(Move)
+        {
+            set_op_piece<Op>(std::make_move_iterator(pa[j]), std::make_move_iterator(pa[j + 1]), std::make_move_iterator(pb[j]),
+                             std::make_move_iterator(pb[j + 1]), comp, emit, emit);
+        }
+        else { set_op_piece<Op>(pa[j], pa[j + 1], pb[j], pb[j + 1], comp, emit, emit); }
+    };
+    std::vector<std::size_t> offset(parts + 1);
+    parallel_for(parts, threads, [&](std::size_t j) {
+        std::size_t c{};
+        run_piece(j, [&c](auto&) { ++c; });
+        offset[j + 1] = c;
+    });
+    for(std::size_t j = 0; j < parts; ++j) { offset[j + 1] += offset[j]; }
+
+    std::vector<value_type> out(offset[parts]);
+    parallel_for(parts, threads, [&](std::size_t j) {
+        auto w = out.begin() + static_cast<std::ptrdiff_t>(offset[j]);
+        run_piece(j, [&w](auto& it) { *w++ = *it; });
+    });
+    return out;
+}
+
+// Map adopting (flat_map) or bulk loading the sorted unique elements
+template <class Map, class V>
+Map make_map(std::vector<V>&& v, const typename Map::key_compare& comp)
+{
+    if constexpr(std::is_constructible<Map, sorted_unique_t, std::vector<V>&&, const typename Map::key_compare&>::value)
+    {
+        return Map(sorted_unique, std::move(v), comp);
+    }
+    else { return Map(sorted_unique, std::make_move_iterator(v.begin()), std::make_move_iterator(v.end()), comp); }
+}
+
+}  // namespace parallel_detail
+
+/*!
+  @brief Build the map from an unsorted range with a parallel sort and deduplication
+  @details Of equivalent keys the first in the range is kept (same as insert).
+  @tparam Map Sorted map constructible from (sorted_unique, first, last, comp), e.g. goblib::flat_map, goblib::btree_map
+  @param threads Number of threads (0: hardware threads)
+  @note value_type must be default constructible
+  @code{.cpp}
+  auto m = goblib::parallel_build<goblib::flat_map<std::uint64_t, Row>>(rows.begin(), rows.end());
+  @endcode
+ */
+template <class Map, class InputIt>
+Map parallel_build(InputIt first, InputIt last, unsigned threads = 0, const typename Map::key_compare& comp = typename Map::key_compare())
+{
+    threads = parallel_detail::resolve_threads(threads);
+    const parallel_detail::value_less<typename Map::key_compare> less{ comp };
+    std::vector<typename Map::value_type> v(first, last);
+    parallel_detail::stable_sort(v, less, threads);
+    return parallel_detail::make_map<Map>(parallel_detail::unique(v, less, threads), comp);
+}
+
+/*!
+  @brief Elements whose key is in a or b (a wins for keys in both)
+  @param threads Number of threads (0: hardware threads)
+  @note Maps with random access iterators (flat maps) are split in O(threads log N), others with one walk
+ */
+template <class Map>
+Map parallel_union(const Map& a, const Map& b, unsigned threads = 0)
+{
+    return parallel_detail::make_map<Map>(parallel_detail::set_operation<parallel_detail::set_op::union_op, false>(a, b, threads), a.key_comp());
+}
+//! @brief Elements of a whose key is also in b
+template <class Map>
+Map parallel_intersection(const Map& a, const Map& b, unsigned threads = 0)
+{
+    return parallel_detail::make_map<Map>(parallel_detail::set_operation<parallel_detail::set_op::intersection_op, false>(a, b, threads),
+                                          a.key_comp());
+}
+//! @brief Elements of a whose key is not in b
+template <class Map>
+Map parallel_difference(const Map& a, const Map& b, unsigned threads = 0)
+{
+    return parallel_detail::make_map<Map>(parallel_detail::set_operation<parallel_detail::set_op::difference_op, false>(a, b, threads),
+                                          a.key_comp());
+}
+
+/*!
+  @brief Move all elements of source into target in parallel
+  @details target becomes the union (target wins for keys in both), and source is cleared.
+  Unlike std::map::merge, elements with existing keys are not left in source.
+ */
+template <class Map>
+void parallel_merge(Map& target, Map&& source, unsigned threads = 0)
+{
+    auto v = parallel_detail::set_operation<parallel_detail::set_op::union_op, true>(target, source, threads);
+    target = parallel_detail::make_map<Map>(std::move(v), target.key_comp());
+    source.clear();
+}
+
+}
+#endif
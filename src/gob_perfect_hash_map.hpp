@@ -0,0 +1,515 @@
+/*!
+  @file gob_perfect_hash_map.hpp
+  @brief Maps with a fixed key set located by a minimal perfect hash
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_PERFECT_HASH_MAP_HPP
+#define GOB_PERFECT_HASH_MAP_HPP
+
+#include <vector>
+#include <array>
+#include <utility>
+#include <functional>
+#include <algorithm>
+#include <iterator>
+#include <initializer_list>
+#include <string_view>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+#include "internal/gob_stdmap_detail.hpp"
+
+namespace goblib {
+
+/*!
+  @brief Hash usable in constant expressions
+  @details Integers and enums hash to their value, strings (std::string_view, const char*, std::string)
+  by 64-bit FNV-1a. The perfect hash maps mix the result, so identity is fine.
+  Transparent, so string keys can be queried by any string type.
+ */
+struct constexpr_hash
+{
+    using is_transparent = void;
+
+    template <class K, typename std::enable_if<std::is_integral<K>::value || std::is_enum<K>::value, std::nullptr_t>::type = nullptr>
+    constexpr std::uint64_t operator()(K k) const noexcept { return static_cast<std::uint64_t>(k); }
+    constexpr std::uint64_t operator()(std::string_view s) const noexcept
+    {
+        std::uint64_t h = 0xCBF29CE484222325ULL;
+        for(char c : s) { h = (h ^ static_cast<unsigned char>(c)) * 0x100000001B3ULL; }
+        return h;
+    }
+};
+
+namespace stdmap_detail {
+// Not constexpr. Reaching this while constant evaluating makes the program ill-formed, and at run time it throws
+[[noreturn]] inline void perfect_hash_duplicate_key()
+{
+    throw_invalid_argument("constexpr_perfect_hash_map: duplicate keys or distinct keys with the same hash");
+}
+
+/*
+  Minimal perfect hash in PTHash style.
+  A key of hash h falls into bucket phf_bucket(h), and bucket b sends its keys to phf_slot(h, pilot[b]).
+  Buckets are placed largest first, each taking the smallest pilot for which all its keys land on free and
+  distinct slots of [0, n). Lookup is one hash, one pilot load and one slot probe, and the slots hold the
+  elements only. About 3 keys share a bucket, so the pilots cost 4 / 3 bytes per key.
+ */
+constexpr std::uint64_t phf_mix(std::uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+// Key hash for the seed (a bijection of the user hash, so distinct user hashes stay distinct)
+constexpr std::uint64_t phf_hash(std::uint64_t h, std::uint64_t seed) { return phf_mix(h ^ seed); }
+// Map the upper 32 bits of x onto [0, n) without division
+constexpr std::size_t phf_range(std::uint64_t x, std::size_t n)
+{
+    return static_cast<std::size_t>(((x >> 32) * static_cast<std::uint64_t>(n)) >> 32);
+}
+constexpr std::size_t phf_bucket_count(std::size_t n) { return n / 3 + 1; }
+constexpr std::size_t phf_bucket(std::uint64_t h, std::size_t buckets) { return phf_range(h, buckets); }
+constexpr std::size_t phf_slot(std::uint64_t h, std::uint32_t pilot, std::uint64_t seed, std::size_t n)
+{
+    return phf_range(phf_mix(h ^ phf_mix(seed + pilot)), n);
+}
+// Seed of the attempt
+constexpr std::uint64_t phf_seed(unsigned attempt) { return phf_mix(0x9E3779B97F4A7C15ULL * (attempt + 1)); }
+
+enum class phf_result
+{
+    ok,
+    retry,      // A bucket ran out of pilots, try another seed
+    duplicate,  // Keys with the same hash
+};
+
+// Place the n keys of hashes h (already mixed with seed) into the slots.
+// start has buckets + 1 entries, members and slot_key n, order and pilots buckets.
+// On success slot_key[s] is the key index at slot s
+template <class Hashes, class Start, class Members, class Order, class Pilots, class Slots>
+constexpr phf_result phf_place(const Hashes& h, std::size_t n, std::uint64_t seed, std::size_t buckets, Start& start,
+                               Members& members, Order& order, Pilots& pilots, Slots& slot_key)
+{
+    // Keys grouped by bucket (counting sort; order is the fill cursor for now)
+    for(std::size_t b = 0; b <= buckets; ++b) { start[b] = 0; }
+    for(std::size_t i = 0; i < n; ++i) { ++start[phf_bucket(h[i], buckets) + 1]; }
+    for(std::size_t b = 0; b < buckets; ++b)
+    {
+        start[b + 1] += start[b];
+        order[b] = start[b];
+    }
+    for(std::size_t i = 0; i < n; ++i) { members[order[phf_bucket(h[i], buckets)]++] = i; }
+    for(std::size_t b = 0; b < buckets; ++b)
+    {
+        for(std::size_t i = start[b]; i < start[b + 1]; ++i)
+        {
+            for(std::size_t j = start[b]; j < i; ++j)
+            {
+                if(h[members[i]] == h[members[j]]) { return phf_result::duplicate; }
+            }
+        }
+    }
+
+    // Buckets by decreasing size (counting sort, sizes above max_class share the first class)
+    constexpr std::size_t max_class = 63;
+    std::size_t pos[max_class + 2]{};
+    for(std::size_t b = 0; b < buckets; ++b) { ++pos[max_class - std::min(start[b + 1] - start[b], max_class) + 1]; }
+    for(std::size_t c = 0; c <= max_class; ++c) { pos[c + 1] += pos[c]; }
+    for(std::size_t b = 0; b < buckets; ++b) { order[pos[max_class - std::min(start[b + 1] - start[b], max_class)]++] = b; }
+
+    // The last singletons wait for one of few free slots, so allow about n tries per bucket
+    const std::uint64_t max_pilot = std::min<std::uint64_t>(0xFFFFFFFFULL, 16 * static_cast<std::uint64_t>(n) + 65536);
+    for(std::size_t s = 0; s < n; ++s) { slot_key[s] = n; }
+    for(std::size_t o = 0; o < buckets; ++o)
+    {
+        const std::size_t b = order[o];
+        const std::size_t first = start[b], last = start[b + 1];
+        pilots[b] = 0;
+        if(first == last) { continue; }
+        for(std::uint64_t p = 0;; ++p)
+        {
+            if(p == max_pilot) { return phf_result::retry; }
+            const auto pilot = static_cast<std::uint32_t>(p);
+            std::size_t i = first;
+            for(; i < last; ++i)
+            {
+                const std::size_t s = phf_slot(h[members[i]], pilot, seed, n);
+                if(slot_key[s] != n) { break; }
+                slot_key[s] = members[i];
+            }
+            if(i == last)
+            {
+                pilots[b] = pilot;
+                break;
+            }
+            while(i-- > first) { slot_key[phf_slot(h[members[i]], pilot, seed, n)] = n; }
+        }
+    }
+    return phf_result::ok;
+}
+
+}  // namespace stdmap_detail
+
+/*!
+  @class perfect_hash_map
+  @brief Map whose key set is fixed at construction, located by a minimal perfect hash
+  @details The constructor computes a minimal perfect hash of the keys (PTHash style: per-bucket pilots
+  found largest bucket first), and stores the elements in the slots it assigns, n elements in n slots.
+  Lookup is one hash, one pilot load and one slot probe comparing a single key. There are no control bytes,
+  empty slots or probe sequences, only a pilot array of about 4 / 3 bytes per key.
+  Suitable for static dictionaries built once at startup and queried on every message.
+  @tparam Key Key type
+  @tparam T Mapped type
+  @tparam Hash Hash function object. Distinct keys must have distinct hashes (true for integers with std::hash,
+  and in practice for 64-bit string hashes)
+  @tparam KeyEqual Equality function object for the key
+  @note
+  - Keys cannot be inserted or erased after construction. Mapped values can be modified. Do not modify the key through an iterator.
+  - Iteration is in slot order (unordered).
+  - If the source contains equivalent keys, the first one is kept (same as std::unordered_map::insert).
+  - Construction throws std::invalid_argument if distinct keys have the same hash.
+  - See constexpr_perfect_hash_map to build the table at compile time.
+ */
+template <class Key, class T, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>>
+class perfect_hash_map
+{
+  public:
+    ///@name Member types
+    ///@{
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<Key, T>;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using iterator = typename std::vector<value_type>::iterator;
+    using const_iterator = typename std::vector<value_type>::const_iterator;
+    ///@}
+
+    ///@name Constructor
+    ///@{
+    perfect_hash_map() : perfect_hash_map(Hash()) {}
+    explicit perfect_hash_map(const Hash& hash, const KeyEqual& equal = KeyEqual()) : _hash(hash), _equal(equal) {}
+    //! @brief Build from the range of value_type
+    template <class InputIt>
+    perfect_hash_map(InputIt first, InputIt last, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual())
+            : _hash(hash), _equal(equal)
+    {
+        build(std::vector<value_type>(first, last));
+    }
+    perfect_hash_map(std::initializer_list<value_type> il, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual())
+            : perfect_hash_map(il.begin(), il.end(), hash, equal) {}
+    perfect_hash_map(const perfect_hash_map&) = default;
+    perfect_hash_map(perfect_hash_map&&) = default;
+    perfect_hash_map& operator=(const perfect_hash_map&) = default;
+    perfect_hash_map& operator=(perfect_hash_map&&) = default;
+    ///@}
+
+    ///@name Element access
+    ///@{
+    T& at(const Key& key)
+    {
+        auto s = find_index(key);
+        if(s == size()) { stdmap_detail::throw_out_of_range("perfect_hash_map::at"); }
+        return _data[s].second;
+    }
+    const T& at(const Key& key) const
+    {
+        auto s = find_index(key);
+        if(s == size()) { stdmap_detail::throw_out_of_range("perfect_hash_map::at"); }
+        return _data[s].second;
+    }
+    ///@}
+
+    ///@name Iterators
+    ///@{
+    iterator begin() noexcept { return _data.begin(); }
+    const_iterator begin() const noexcept { return _data.begin(); }
+    const_iterator cbegin() const noexcept { return _data.cbegin(); }
+    iterator end() noexcept { return _data.end(); }
+    const_iterator end() const noexcept { return _data.end(); }
+    const_iterator cend() const noexcept { return _data.cend(); }
+    ///@}
+
+    ///@name Capacity
+    ///@{
+    bool empty() const noexcept { return _data.empty(); }
+    size_type size() const noexcept { return _data.size(); }
+    //! @brief Number of pilots (buckets of the perfect hash)
+    size_type bucket_count() const noexcept { return _pilots.size(); }
+    ///@}
+
+    ///@name Lookup
+    ///@{
+    size_type count(const Key& key) const { return find_index(key) != size() ? 1 : 0; }
+    bool contains(const Key& key) const { return find_index(key) != size(); }
+    iterator find(const Key& key) { return begin() + static_cast<difference_type>(find_index(key)); }
+    const_iterator find(const Key& key) const { return begin() + static_cast<difference_type>(find_index(key)); }
+    std::pair<iterator, iterator> equal_range(const Key& key)
+    {
+        auto it = find(key);
+        return { it, it == end() ? it : std::next(it) };
+    }
+    std::pair<const_iterator, const_iterator> equal_range(const Key& key) const
+    {
+        auto it = find(key);
+        return { it, it == end() ? it : std::next(it) };
+    }
+    ///@}
+
+    //! @name Heterogeneous lookup (if both Hash::is_transparent and KeyEqual::is_transparent exist)
+    ///@{
+    template <class K, class H = Hash, class E = KeyEqual, stdmap_detail::if_transparent<H> = nullptr, stdmap_detail::if_transparent<E> = nullptr>
+    size_type count(const K& key) const { return find_index(key) != size() ? 1 : 0; }
+    template <class K, class H = Hash, class E = KeyEqual, stdmap_detail::if_transparent<H> = nullptr, stdmap_detail::if_transparent<E> = nullptr>
+    bool contains(const K& key) const { return find_index(key) != size(); }
+    template <class K, class H = Hash, class E = KeyEqual, stdmap_detail::if_transparent<H> = nullptr, stdmap_detail::if_transparent<E> = nullptr>
+    iterator find(const K& key) { return begin() + static_cast<difference_type>(find_index(key)); }
+    template <class K, class H = Hash, class E = KeyEqual, stdmap_detail::if_transparent<H> = nullptr, stdmap_detail::if_transparent<E> = nullptr>
+    const_iterator find(const K& key) const { return begin() + static_cast<difference_type>(find_index(key)); }
+    ///@}
+
+    ///@name Observers
+    ///@{
+    hasher hash_function() const { return _hash; }
+    key_equal key_eq() const { return _equal; }
+    ///@}
+
+  private:
+    template <class K>
+    std::uint64_t user_hash(const K& key) const { return static_cast<std::uint64_t>(_hash(key)); }
+
+    // Slot of key if it is in the map, otherwise size()
+    template <class K>
+    size_type find_index(const K& key) const
+    {
+        const size_type n = size();
+        if(n == 0) { return n; }
+        const auto h = stdmap_detail::phf_hash(user_hash(key), _seed);
+        const auto s = stdmap_detail::phf_slot(h, _pilots[stdmap_detail::phf_bucket(h, _pilots.size())], _seed, n);
+        return _equal(_data[s].first, key) ? s : n;
+    }
+
+    void build(std::vector<value_type>&& src)
+    {
+        // Drop later duplicates. Keys are grouped by hash, so distinct keys with the same hash are caught here
+        std::vector<std::uint64_t> uh;
+        uh.reserve(src.size());
+        for(auto& e : src) { uh.push_back(user_hash(e.first)); }
+        std::vector<size_type> idx(src.size());
+        for(size_type i = 0; i < idx.size(); ++i) { idx[i] = i; }
+        std::stable_sort(idx.begin(), idx.end(), [&uh](size_type a, size_type b) { return uh[a] < uh[b]; });
+        std::vector<bool> drop(src.size());
+        for(size_type i = 1; i < idx.size(); ++i)
+        {
+            if(uh[idx[i]] != uh[idx[i - 1]]) { continue; }
+            if(!_equal(src[idx[i]].first, src[idx[i - 1]].first))
+            {
+                stdmap_detail::throw_invalid_argument("perfect_hash_map: distinct keys with the same hash");
+            }
+            drop[idx[i]] = true;
+        }
+        size_type n{};
+        for(size_type i = 0; i < src.size(); ++i)
+        {
+            if(drop[i]) { continue; }
+            if(n != i)
+            {
+                src[n] = std::move(src[i]);
+                uh[n] = uh[i];
+            }
+            ++n;
+        }
+        src.erase(src.begin() + static_cast<difference_type>(n), src.end());
+
+        const size_type buckets = stdmap_detail::phf_bucket_count(n);
+        std::vector<std::uint64_t> h(n);
+        std::vector<size_type> start(buckets + 1), members(n), order(buckets), slot_key(n);
+        _pilots.assign(buckets, 0);
+        for(unsigned attempt = 0;; ++attempt)
+        {
+            _seed = stdmap_detail::phf_seed(attempt);
+            for(size_type i = 0; i < n; ++i) { h[i] = stdmap_detail::phf_hash(uh[i], _seed); }
+            if(stdmap_detail::phf_place(h, n, _seed, buckets, start, members, order, _pilots, slot_key) == stdmap_detail::phf_result::ok)
+            {
+                break;
+            }
+        }
+        _data.reserve(n);
+        for(auto k : slot_key) { _data.emplace_back(std::move(src[k])); }
+    }
+
+    std::vector<value_type> _data{};
+    std::vector<std::uint32_t> _pilots{};
+    std::uint64_t _seed{};
+    Hash _hash{};
+    KeyEqual _equal{};
+};
+
+/*!
+  @class constexpr_perfect_hash_map
+  @brief Immutable map whose minimal perfect hash is computed at compile time
+  @details Same layout and lookup as perfect_hash_map in std::array storage. A constexpr object is placed in
+  read-only data and costs nothing at startup, and lookups can be evaluated as constant expressions.
+  @tparam Key Key type (literal type, e.g. integers, enums, std::string_view)
+  @tparam T Mapped type (literal type)
+  @tparam N Number of elements
+  @tparam Hash Hash function object (constexpr callable, e.g. constexpr_hash)
+  @tparam KeyEqual Equality function object for the key (constexpr callable)
+  @note Duplicate keys (or distinct keys with the same hash) are a compile error when constructed in a constant expression,
+  and throw std::invalid_argument when constructed at run time.
+  @code{.cpp}
+  constexpr auto fields = goblib::make_perfect_hash_map<std::string_view, int>({ {"id", 0}, {"price", 1}, {"qty", 2} });
+  static_assert(fields.at("qty") == 2);
+  @endcode
+ */
+template <class Key, class T, std::size_t N, class Hash = constexpr_hash, class KeyEqual = std::equal_to<>>
+class constexpr_perfect_hash_map
+{
+    static constexpr std::size_t buckets = stdmap_detail::phf_bucket_count(N);
+
+  public:
+    ///@name Member types
+    ///@{
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<Key, T>;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = const value_type&;
+    using const_reference = const value_type&;
+    using iterator = const value_type*;
+    using const_iterator = const value_type*;
+    ///@}
+
+    ///@name Constructor
+    ///@{
+    //! @brief Build from the array of elements
+    constexpr explicit constexpr_perfect_hash_map(const value_type (&src)[N], const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual())
+            : constexpr_perfect_hash_map(src, plan(src, hash), hash, equal, std::make_index_sequence<N>{}) {}
+    ///@}
+
+    ///@name Element access
+    ///@{
+    template <class K>
+    constexpr const T& at(const K& key) const
+    {
+        auto s = find_index(key);
+        if(s == N) { stdmap_detail::throw_out_of_range("constexpr_perfect_hash_map::at"); }
+        return _data[s].second;
+    }
+    //! @brief Mapped value of key, or def if not found
+    template <class K>
+    constexpr T value_or(const K& key, const T& def) const
+    {
+        auto s = find_index(key);
+        return s != N ? _data[s].second : def;
+    }
+    ///@}
+
+    ///@name Iterators
+    ///@{
+    constexpr const_iterator begin() const noexcept { return _data.data(); }
+    constexpr const_iterator cbegin() const noexcept { return begin(); }
+    constexpr const_iterator end() const noexcept { return _data.data() + N; }
+    constexpr const_iterator cend() const noexcept { return end(); }
+    ///@}
+
+    ///@name Capacity
+    ///@{
+    constexpr bool empty() const noexcept { return N == 0; }
+    constexpr size_type size() const noexcept { return N; }
+    constexpr size_type max_size() const noexcept { return N; }
+    ///@}
+
+    /*!
+      @name Lookup
+      @brief Keys of any type accepted by Hash and KeyEqual (both transparent by default)
+     */
+    ///@{
+    template <class K>
+    constexpr size_type count(const K& key) const { return find_index(key) != N ? 1 : 0; }
+    template <class K>
+    constexpr bool contains(const K& key) const { return find_index(key) != N; }
+    template <class K>
+    constexpr const_iterator find(const K& key) const { return begin() + find_index(key); }
+    ///@}
+
+    ///@name Observers
+    ///@{
+    constexpr hasher hash_function() const { return _hash; }
+    constexpr key_equal key_eq() const { return _equal; }
+    ///@}
+
+  private:
+    struct layout
+    {
+        std::array<std::uint32_t, buckets> pilots{};
+        std::array<std::size_t, N> slot_key{};
+        std::uint64_t seed{};
+    };
+
+    static constexpr layout plan(const value_type (&src)[N], const Hash& hash)
+    {
+        layout l{};
+        std::array<std::uint64_t, N> uh{}, h{};
+        std::array<std::size_t, buckets + 1> start{};
+        std::array<std::size_t, N> members{};
+        std::array<std::size_t, buckets> order{};
+        for(std::size_t i = 0; i < N; ++i) { uh[i] = static_cast<std::uint64_t>(hash(src[i].first)); }
+        for(unsigned attempt = 0;; ++attempt)
+        {
+            l.seed = stdmap_detail::phf_seed(attempt);
+            for(std::size_t i = 0; i < N; ++i) { h[i] = stdmap_detail::phf_hash(uh[i], l.seed); }
+            auto r = stdmap_detail::phf_place(h, N, l.seed, buckets, start, members, order, l.pilots, l.slot_key);
+            if(r == stdmap_detail::phf_result::ok) { return l; }
+            if(r == stdmap_detail::phf_result::duplicate) { stdmap_detail::perfect_hash_duplicate_key(); }
+        }
+    }
+
+    template <std::size_t... I>
+    constexpr constexpr_perfect_hash_map(const value_type (&src)[N], const layout& l, const Hash& hash, const KeyEqual& equal,
+                                         std::index_sequence<I...>)
+            : _data{ { src[l.slot_key[I]]... } }, _pilots(l.pilots), _seed(l.seed), _hash(hash), _equal(equal) {}
+
+    template <class K>
+    constexpr size_type find_index(const K& key) const
+    {
+        if(N == 0) { return N; }
+        const auto h = stdmap_detail::phf_hash(static_cast<std::uint64_t>(_hash(key)), _seed);
+        const auto s = stdmap_detail::phf_slot(h, _pilots[stdmap_detail::phf_bucket(h, buckets)], _seed, N);
+        return _equal(_data[s].first, key) ? s : N;
+    }
+
+    std::array<value_type, N> _data;
+    std::array<std::uint32_t, buckets> _pilots;
+    std::uint64_t _seed;
+    Hash _hash;
+    KeyEqual _equal;
+};
+
+/*!
+  @brief Make constexpr_perfect_hash_map from the braced list of elements
+  @code{.cpp}
+  constexpr auto m = goblib::make_perfect_hash_map<int, char>({ {1, 'a'}, {0, 'b'} });
+  @endcode
+ */
+template <class Key, class T, class Hash = constexpr_hash, class KeyEqual = std::equal_to<>, std::size_t N>
+constexpr constexpr_perfect_hash_map<Key, T, N, Hash, KeyEqual> make_perfect_hash_map(const std::pair<Key, T> (&src)[N],
+                                                                                     const Hash& hash = Hash(),
+                                                                                     const KeyEqual& equal = KeyEqual())
+{
+    return constexpr_perfect_hash_map<Key, T, N, Hash, KeyEqual>(src, hash, equal);
+}
+
+}
+#endif
@@ -0,0 +1,306 @@
+/*!
+  @file gob_rcu_map.hpp
+  @brief Read-optimized concurrent map publishing immutable snapshots (RCU style)
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_RCU_MAP_HPP
+#define GOB_RCU_MAP_HPP
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <utility>
+#include <algorithm>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+#include "internal/gob_stdmap_detail.hpp"
+
+namespace goblib {
+
+/*!
+  @class rcu_map
+  @brief Wrapper which lets many threads read a map while writers publish new versions
+  @details The current map is an immutable version behind an atomic pointer.
+  Readers pin it with a snapshot: entering stores the global epoch into the reader's own
+  cache line padded slot and issues a fence. There are no read-modify-write atomics and no writes to shared
+  cache lines on the read path, so readers scale with the number of cores.
+  Writers are serialized by a mutex. An update copies the current version, applies the changes and
+  publishes the copy. Replaced versions are retired and freed once no reader slot can still refer to them
+  (epoch based deferred reclamation); writers never wait for readers.
+  @tparam Map Map type (any copyable container, e.g. goblib::flat_map or goblib::frozen_map)
+  @code{.cpp}
+  goblib::rcu_map<goblib::flat_map<std::string, int>> table;
+  // Reader thread
+  auto rd = table.make_reader();
+  {
+      auto snap = rd.lock();
+      auto it = snap->find("route");
+  }
+  // Writer thread
+  table.enqueue([](auto& m) { m["route"] = 1; });
+  table.enqueue([](auto& m) { m.erase("old"); });
+  table.publish();  // One copy for the whole batch
+  @endcode
+  @note Each update copies the whole map (O(N)). Batch updates with enqueue() and publish().
+  @warning All readers must be destroyed before the rcu_map.
+ */
+template <class Map>
+class rcu_map
+{
+    // Epoch a reader entered at. 0 while the reader holds no snapshot
+    struct alignas(stdmap_detail::cache_line_size) reader_slot
+    {
+        std::atomic<std::uint64_t> epoch{};
+        bool in_use{};  // Guarded by the writer mutex
+    };
+
+  public:
+    using map_type = Map;
+    using size_type = std::size_t;
+    class reader;
+
+    /*!
+      @brief Pinned version of the map
+      @details The version stays valid while the snapshot lives, whatever writers publish meanwhile.
+     */
+    class snapshot
+    {
+        friend class reader;
+
+      public:
+        snapshot(snapshot&& o) noexcept : _reader(o._reader), _map(o._map) { o._reader = nullptr; }
+        snapshot(const snapshot&) = delete;
+        snapshot& operator=(const snapshot&) = delete;
+        snapshot& operator=(snapshot&&) = delete;
+        ~snapshot()
+        {
+            if(_reader) { _reader->leave(); }
+        }
+
+        const Map& operator*() const noexcept { return *_map; }
+        const Map* operator->() const noexcept { return _map; }
+        const Map* get() const noexcept { return _map; }
+
+      private:
+        snapshot(reader* r, const Map* m) : _reader(r), _map(m) {}
+        reader* _reader;
+        const Map* _map;
+    };
+
+    /*!
+      @brief Per-thread read handle owning a reader slot
+      @note A reader must be used by one thread at a time. Snapshots of the same reader may nest.
+     */
+    class reader
+    {
+        friend class rcu_map;
+
+      public:
+        reader(reader&& o) noexcept : _owner(o._owner), _slot(o._slot), _depth(o._depth) { o._owner = nullptr; }
+        reader(const reader&) = delete;
+        reader& operator=(const reader&) = delete;
+        reader& operator=(reader&&) = delete;
+        ~reader()
+        {
+            if(_owner) { _owner->release_slot(_slot); }
+        }
+
+        //! @brief Pin the current version
+        snapshot lock()
+        {
+            if(_depth++ == 0)
+            {
+                _slot->epoch.store(_owner->_epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+                // Make the slot visible before reading the version (pairs with the fence in reclaim_locked)
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+            return snapshot(this, _owner->_current.load(std::memory_order_acquire));
+        }
+        //! @brief Call f(const Map&) on the current version and return its result
+        template <class F>
+        decltype(auto) read(F&& f)
+        {
+            auto s = lock();
+            return std::forward<F>(f)(*s);
+        }
+
+      private:
+        explicit reader(rcu_map& m) : _owner(&m), _slot(m.acquire_slot()) {}
+        void leave()
+        {
+            if(--_depth == 0) { _slot->epoch.store(0, std::memory_order_release); }
+        }
+
+        rcu_map* _owner;
+        reader_slot* _slot;
+        std::size_t _depth{};
+    };
+
+    ///@name Constructor
+    ///@{
+    explicit rcu_map(Map m = Map()) : _current(new Map(std::move(m))) {}
+    rcu_map(const rcu_map&) = delete;
+    rcu_map& operator=(const rcu_map&) = delete;
+    ~rcu_map() { delete _current.load(std::memory_order_relaxed); }
+    ///@}
+
+    ///@name Readers
+    ///@{
+    //! @brief Make a read handle for the calling thread
+    reader make_reader() { return reader(*this); }
+    ///@}
+
+    ///@name Writers (thread-safe, serialized)
+    ///@{
+    //! @brief Copy the current version, apply f(Map&) with the pending changes and publish
+    template <class F>
+    void update(F&& f)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto next = std::make_unique<Map>(*_current.load(std::memory_order_relaxed));
+        apply_pending(*next);
+        std::forward<F>(f)(*next);
+        publish_locked(std::move(next));
+    }
+    //! @brief Publish m as the new version (pending changes are applied on top)
+    void assign(Map m)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto next = std::make_unique<Map>(std::move(m));
+        apply_pending(*next);
+        publish_locked(std::move(next));
+    }
+    //! @brief Queue a change f(Map&) for the next publish()
+    template <class F>
+    void enqueue(F&& f)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _pending.emplace_back(std::forward<F>(f));
+    }
+    /*!
+      @brief Apply the queued changes to one copy and publish it
+      @return False if nothing was queued
+     */
+    bool publish()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(_pending.empty()) { return false; }
+        auto next = std::make_unique<Map>(*_current.load(std::memory_order_relaxed));
+        apply_pending(*next);
+        publish_locked(std::move(next));
+        return true;
+    }
+    //! @brief Number of queued changes
+    size_type pending() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _pending.size();
+    }
+    ///@}
+
+    ///@name Reclamation
+    ///@{
+    //! @brief Free the retired versions no reader can refer to
+    void reclaim()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        reclaim_locked();
+    }
+    //! @brief Wait until every retired version is freed (readers holding old snapshots must release them)
+    void synchronize()
+    {
+        for(;;)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                reclaim_locked();
+                if(_retired.empty()) { return; }
+            }
+            std::this_thread::yield();
+        }
+    }
+    //! @brief Number of retired versions not freed yet
+    size_type retired() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _retired.size();
+    }
+    //! @brief Number of versions published so far
+    std::uint64_t version() const noexcept { return _epoch.load(std::memory_order_acquire) - 1; }
+    ///@}
+
+  private:
+    struct retired_version
+    {
+        std::uint64_t epoch;  // Epoch in which the version was replaced
+        std::unique_ptr<const Map> map;
+    };
+
+    void apply_pending(Map& m)
+    {
+        for(auto& f : _pending) { f(m); }
+        _pending.clear();
+    }
+
+    void publish_locked(std::unique_ptr<Map> next)
+    {
+        const Map* old = _current.load(std::memory_order_relaxed);
+        _current.store(next.release(), std::memory_order_release);
+        const auto e = _epoch.load(std::memory_order_relaxed);
+        _epoch.store(e + 1, std::memory_order_release);
+        _retired.push_back({ e, std::unique_ptr<const Map>(old) });
+        reclaim_locked();
+    }
+
+    // A version retired in epoch e may be used only by readers which entered in epoch <= e
+    void reclaim_locked()
+    {
+        if(_retired.empty()) { return; }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto oldest = std::numeric_limits<std::uint64_t>::max();
+        for(auto& s : _slots)
+        {
+            auto e = s->epoch.load(std::memory_order_acquire);
+            if(e && e < oldest) { oldest = e; }
+        }
+        _retired.erase(std::remove_if(_retired.begin(), _retired.end(), [oldest](const retired_version& r) { return r.epoch < oldest; }),
+                       _retired.end());
+    }
+
+    reader_slot* acquire_slot()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for(auto& s : _slots)
+        {
+            if(!s->in_use)
+            {
+                s->in_use = true;
+                return s.get();
+            }
+        }
+        _slots.emplace_back(new reader_slot);
+        _slots.back()->in_use = true;
+        return _slots.back().get();
+    }
+    void release_slot(reader_slot* s)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        s->epoch.store(0, std::memory_order_release);
+        s->in_use = false;
+    }
+
+    alignas(stdmap_detail::cache_line_size) std::atomic<const Map*> _current;
+    std::atomic<std::uint64_t> _epoch{ 1 };
+    alignas(stdmap_detail::cache_line_size) mutable std::mutex _mutex{};
+    std::vector<std::unique_ptr<reader_slot>> _slots{};
+    std::vector<retired_version> _retired{};
+    std::vector<std::function<void(Map&)>> _pending{};
+};
+
+}
+#endif
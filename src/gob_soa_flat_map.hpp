@@ -0,0 +1,587 @@
+/*!
+  @file gob_soa_flat_map.hpp
+  @brief Sorted vector based map which stores keys and values in separate arrays
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_SOA_FLAT_MAP_HPP
+#define GOB_SOA_FLAT_MAP_HPP
+
+#include <vector>
+#include <utility>
+#include <functional>
+#include <algorithm>
+#include <iterator>
+#include <initializer_list>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <cstddef>
+#include "internal/gob_stdmap_detail.hpp"
+#include "internal/gob_simd_search.hpp"
+
+namespace goblib {
+
+/*!
+  @class soa_flat_map
+  @brief Sorted vector based map (structure of arrays)
+  @details Keys and mapped values are kept in two parallel arrays sorted by key.
+  Binary search touches only the dense key array, so large mapped types do not pollute the cache during lookup.
+  Integer and enum keys ordered by std::less are searched by branchless bisection down to a small window,
+  then the window is scanned with SSE2/AVX2 (scalar if unavailable or GOB_STDMAP_DISABLE_SIMD is defined).
+  @tparam Key Key type (must be nothrow move constructible)
+  @tparam T Mapped type
+  @tparam Compare Compare function object for the key
+  @tparam KeyAllocator Allocator for Key
+  @tparam MappedAllocator Allocator for T
+  @note The interface is the same as std::map with the following differences.
+  - Iterators are proxy iterators. Dereference yields std::pair<const Key&, T&> by value.
+  - Insertion and erasure invalidate iterators, pointers and references.
+  - Insertion and erasure are O(N) due to element shifting.
+ */
+template <class Key, class T, class Compare = std::less<Key>,
+          class KeyAllocator = std::allocator<Key>, class MappedAllocator = std::allocator<T>>
+class soa_flat_map
+{
+    static_assert(std::is_nothrow_move_constructible<Key>::value, "Key must be nothrow move constructible");
+    static_assert(!std::is_same<Key, bool>::value && !std::is_same<T, bool>::value,
+                  "std::vector<bool> is not supported");
+
+  public:
+    template <bool Const> class basic_iterator;
+
+    ///@name Member types
+    ///@{
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<Key, T>;
+    using key_compare = Compare;
+    using key_container_type = std::vector<Key, KeyAllocator>;
+    using mapped_container_type = std::vector<T, MappedAllocator>;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = std::pair<const Key&, T&>;
+    using const_reference = std::pair<const Key&, const T&>;
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    ///@}
+
+    /*!
+      @brief Random access proxy iterator
+      @details Holds a pointer into each of the key and mapped arrays.
+     */
+    template <bool Const>
+    class basic_iterator
+    {
+        friend class soa_flat_map;
+        template <bool> friend class basic_iterator;
+        using mapped_pointer = typename std::conditional<Const, const T*, T*>::type;
+
+      public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = std::pair<Key, T>;
+        using difference_type = std::ptrdiff_t;
+        using reference = std::pair<const Key&, typename std::conditional<Const, const T&, T&>::type>;
+        //! @brief Result of operator-> (holds the proxy reference)
+        struct pointer
+        {
+            reference ref;
+            reference* operator->() { return &ref; }
+        };
+
+        basic_iterator() = default;
+        template <bool C, typename std::enable_if<Const && !C, std::nullptr_t>::type = nullptr>
+        basic_iterator(const basic_iterator<C>& o) : _k(o._k), _v(o._v) {}
+
+        reference operator*() const { return { *_k, *_v }; }
+        pointer operator->() const { return { **this }; }
+        reference operator[](difference_type n) const { return { _k[n], _v[n] }; }
+
+        basic_iterator& operator++() { ++_k; ++_v; return *this; }
+        basic_iterator operator++(int) { auto t = *this; ++*this; return t; }
+        basic_iterator& operator--() { --_k; --_v; return *this; }
+        basic_iterator operator--(int) { auto t = *this; --*this; return t; }
+        basic_iterator& operator+=(difference_type n) { _k += n; _v += n; return *this; }
+        basic_iterator& operator-=(difference_type n) { _k -= n; _v -= n; return *this; }
+        friend basic_iterator operator+(basic_iterator it, difference_type n) { return it += n; }
+        friend basic_iterator operator+(difference_type n, basic_iterator it) { return it += n; }
+        friend basic_iterator operator-(basic_iterator it, difference_type n) { return it -= n; }
+
+        template <bool C> difference_type operator-(const basic_iterator<C>& o) const { return _k - o._k; }
+        template <bool C> bool operator==(const basic_iterator<C>& o) const { return _k == o._k; }
+        template <bool C> bool operator!=(const basic_iterator<C>& o) const { return _k != o._k; }
+        template <bool C> bool operator<(const basic_iterator<C>& o) const { return _k < o._k; }
+        template <bool C> bool operator>(const basic_iterator<C>& o) const { return _k > o._k; }
+        template <bool C> bool operator<=(const basic_iterator<C>& o) const { return _k <= o._k; }
+        template <bool C> bool operator>=(const basic_iterator<C>& o) const { return _k >= o._k; }
+
+        //! @brief Pointer to the key
+        const Key* key_ptr() const { return _k; }
+        //! @brief Pointer to the mapped value
+        mapped_pointer mapped_ptr() const { return _v; }
+
+      private:
+        basic_iterator(const Key* k, mapped_pointer v) : _k(k), _v(v) {}
+        const Key* _k{};
+        mapped_pointer _v{};
+    };
+
+    //! @brief Compare value_type by key
+    class value_compare
+    {
+        friend class soa_flat_map;
+      public:
+        template <class A, class B>
+        bool operator()(const A& a, const B& b) const { return comp(a.first, b.first); }
+      protected:
+        explicit value_compare(Compare c) : comp(c) {}
+        Compare comp;
+    };
+
+    ///@name Constructor
+    ///@{
+    soa_flat_map() : soa_flat_map(Compare()) {}
+    explicit soa_flat_map(const Compare& comp, const KeyAllocator& ka = KeyAllocator(),
+                          const MappedAllocator& ma = MappedAllocator())
+            : _keys(ka), _values(ma), _comp(comp) {}
+    template <class InputIt>
+    soa_flat_map(InputIt first, InputIt last, const Compare& comp = Compare()) : soa_flat_map(comp)
+    {
+        insert(first, last);
+    }
+    //! @brief Construct from the range sorted by key without equivalent keys
+    template <class InputIt>
+    soa_flat_map(sorted_unique_t s, InputIt first, InputIt last, const Compare& comp = Compare()) : soa_flat_map(comp)
+    {
+        insert(s, first, last);
+    }
+    /*!
+      @brief Adopt the key and mapped containers sorted by key without equivalent keys
+      @pre keys.size() == values.size()
+     */
+    soa_flat_map(sorted_unique_t, key_container_type keys, mapped_container_type values, const Compare& comp = Compare())
+            : _keys(std::move(keys)), _values(std::move(values)), _comp(comp) {}
+    soa_flat_map(std::initializer_list<value_type> il, const Compare& comp = Compare())
+            : soa_flat_map(il.begin(), il.end(), comp) {}
+    soa_flat_map(const soa_flat_map&) = default;
+    soa_flat_map(soa_flat_map&&) = default;
+    ///@}
+
+    ///@name Assignment
+    ///@{
+    soa_flat_map& operator=(const soa_flat_map&) = default;
+    soa_flat_map& operator=(soa_flat_map&&) = default;
+    soa_flat_map& operator=(std::initializer_list<value_type> il)
+    {
+        clear();
+        insert(il);
+        return *this;
+    }
+    ///@}
+
+    ///@name Element access
+    ///@{
+    T& at(const Key& key)
+    {
+        auto it = find(key);
+        if(it == end()) { stdmap_detail::throw_out_of_range("soa_flat_map::at"); }
+        return *it._v;
+    }
+    const T& at(const Key& key) const
+    {
+        auto it = find(key);
+        if(it == end()) { stdmap_detail::throw_out_of_range("soa_flat_map::at"); }
+        return *it._v;
+    }
+    T& operator[](const Key& key) { return *try_emplace(key).first._v; }
+    T& operator[](Key&& key) { return *try_emplace(std::move(key)).first._v; }
+
+    //! @brief Sorted key array
+    const key_container_type& keys() const noexcept { return _keys; }
+    //! @brief Mapped values in key order
+    const mapped_container_type& values() const noexcept { return _values; }
+    ///@}
+
+    ///@name Iterators
+    ///@{
+    iterator begin() noexcept { return make_iterator(0); }
+    const_iterator begin() const noexcept { return make_iterator(0); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    iterator end() noexcept { return make_iterator(size()); }
+    const_iterator end() const noexcept { return make_iterator(size()); }
+    const_iterator cend() const noexcept { return end(); }
+    reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+    const_reverse_iterator crbegin() const noexcept { return rbegin(); }
+    reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+    const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+    const_reverse_iterator crend() const noexcept { return rend(); }
+    ///@}
+
+    ///@name Capacity
+    ///@{
+    bool empty() const noexcept { return _keys.empty(); }
+    size_type size() const noexcept { return _keys.size(); }
+    size_type max_size() const noexcept { return std::min<size_type>(_keys.max_size(), _values.max_size()); }
+    //! @brief Reserve storage for at least n elements
+    void reserve(size_type n)
+    {
+        _keys.reserve(n);
+        _values.reserve(n);
+    }
+    //! @brief Release unused capacity
+    void shrink_to_fit()
+    {
+        _keys.shrink_to_fit();
+        _values.shrink_to_fit();
+    }
+    ///@}
+
+    ///@name Modifiers
+    ///@{
+    void clear() noexcept
+    {
+        _keys.clear();
+        _values.clear();
+    }
+
+    std::pair<iterator, bool> insert(const value_type& v) { return try_emplace(v.first, v.second); }
+    std::pair<iterator, bool> insert(value_type&& v) { return try_emplace(std::move(v.first), std::move(v.second)); }
+    iterator insert(const_iterator hint, const value_type& v) { (void)hint; return insert(v).first; }
+    iterator insert(const_iterator hint, value_type&& v) { (void)hint; return insert(std::move(v)).first; }
+    /*!
+      @brief Insert elements of the range
+      @details Elements are sorted and deduplicated once and merged with the existing elements.
+      O(M log M + N) for M new and N existing elements. Existing elements win over equivalent new keys.
+     */
+    template <class InputIt>
+    void insert(InputIt first, InputIt last)
+    {
+        std::vector<value_type> src(first, last);
+        std::stable_sort(src.begin(), src.end(), value_comp());
+        merge_sorted(src);
+    }
+    //! @brief Insert elements of the range sorted by key without equivalent keys. O(M + N)
+    template <class InputIt>
+    void insert(sorted_unique_t, InputIt first, InputIt last)
+    {
+        std::vector<value_type> src(first, last);
+        merge_sorted(src);
+    }
+    void insert(std::initializer_list<value_type> il) { insert(il.begin(), il.end()); }
+    void insert(sorted_unique_t s, std::initializer_list<value_type> il) { insert(s, il.begin(), il.end()); }
+    //! @brief Insert elements of the range (moved if rg is an rvalue)
+    template <class R>
+    void insert_range(R&& rg)
+    {
+        if constexpr(std::is_rvalue_reference<R&&>::value)
+        {
+            insert(std::make_move_iterator(std::begin(rg)), std::make_move_iterator(std::end(rg)));
+        }
+        else { insert(std::begin(rg), std::end(rg)); }
+    }
+
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(const Key& key, M&& obj) { return insert_or_assign_impl(key, std::forward<M>(obj)); }
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(Key&& key, M&& obj) { return insert_or_assign_impl(std::move(key), std::forward<M>(obj)); }
+
+    template <class... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        value_type v(std::forward<Args>(args)...);
+        return try_emplace(std::move(v.first), std::move(v.second));
+    }
+    template <class... Args>
+    iterator emplace_hint(const_iterator hint, Args&&... args)
+    {
+        (void)hint;
+        return emplace(std::forward<Args>(args)...).first;
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) { return try_emplace_impl(key, std::forward<Args>(args)...); }
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(Key&& key, Args&&... args) { return try_emplace_impl(std::move(key), std::forward<Args>(args)...); }
+
+    iterator erase(const_iterator pos) { return erase(pos, std::next(pos)); }
+    iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        auto b = index_of(first);
+        auto e = index_of(last);
+        _keys.erase(_keys.begin() + b, _keys.begin() + e);
+        _values.erase(_values.begin() + b, _values.begin() + e);
+        return make_iterator(b);
+    }
+    size_type erase(const Key& key)
+    {
+        auto it = find(key);
+        if(it == end()) { return 0; }
+        erase(it);
+        return 1;
+    }
+
+    /*!
+      @brief Splice elements of source into this in one linear pass
+      @details Elements whose key already exists in this are left in source (same as std::map::merge)
+     */
+    void merge(soa_flat_map& source)
+    {
+        if(&source == this || source.empty()) { return; }
+        key_container_type keys(_keys.get_allocator());
+        mapped_container_type values(_values.get_allocator());
+        keys.reserve(size() + source.size());
+        values.reserve(size() + source.size());
+        size_type a{}, b{}, keep{};
+        auto take = [&keys, &values](key_container_type& kc, mapped_container_type& vc, size_type i) {
+            keys.emplace_back(std::move(kc[i]));
+            values.emplace_back(std::move(vc[i]));
+        };
+        while(a < size() && b < source.size())
+        {
+            if(_comp(_keys[a], source._keys[b])) { take(_keys, _values, a++); }
+            else if(_comp(source._keys[b], _keys[a])) { take(source._keys, source._values, b++); }
+            else
+            {
+                take(_keys, _values, a++);
+                if(keep != b)
+                {
+                    source._keys[keep] = std::move(source._keys[b]);
+                    source._values[keep] = std::move(source._values[b]);
+                }
+                ++keep;
+                ++b;
+            }
+        }
+        while(a < size()) { take(_keys, _values, a++); }
+        while(b < source.size()) { take(source._keys, source._values, b++); }
+        source._keys.erase(source._keys.begin() + keep, source._keys.end());
+        source._values.erase(source._values.begin() + keep, source._values.end());
+        _keys.swap(keys);
+        _values.swap(values);
+    }
+    void merge(soa_flat_map&& source) { merge(source); }
+
+    void swap(soa_flat_map& o) noexcept(std::is_nothrow_swappable<Compare>::value)
+    {
+        using std::swap;
+        _keys.swap(o._keys);
+        _values.swap(o._values);
+        swap(_comp, o._comp);
+    }
+    ///@}
+
+    ///@name Lookup
+    ///@{
+    size_type count(const Key& key) const { return find(key) != end() ? 1 : 0; }
+    iterator find(const Key& key) { return make_iterator(find_index(key)); }
+    const_iterator find(const Key& key) const { return make_iterator(find_index(key)); }
+    bool contains(const Key& key) const { return find_index(key) != size(); }
+    iterator lower_bound(const Key& key) { return make_iterator(lower_bound_index(key)); }
+    const_iterator lower_bound(const Key& key) const { return make_iterator(lower_bound_index(key)); }
+    iterator upper_bound(const Key& key) { return make_iterator(upper_bound_index(key)); }
+    const_iterator upper_bound(const Key& key) const { return make_iterator(upper_bound_index(key)); }
+    std::pair<iterator, iterator> equal_range(const Key& key)
+    {
+        auto i = lower_bound_index(key);
+        return { make_iterator(i), make_iterator(i + (i != size() && !_comp(key, _keys[i]))) };
+    }
+    std::pair<const_iterator, const_iterator> equal_range(const Key& key) const
+    {
+        auto i = lower_bound_index(key);
+        return { make_iterator(i), make_iterator(i + (i != size() && !_comp(key, _keys[i]))) };
+    }
+    ///@}
+
+    //! @name Heterogeneous lookup (if Compare::is_transparent exists)
+    ///@{
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    size_type count(const K& key) const { return contains(key) ? 1 : 0; }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    iterator find(const K& key) { return make_iterator(find_index(key)); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    const_iterator find(const K& key) const { return make_iterator(find_index(key)); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    bool contains(const K& key) const { return find_index(key) != size(); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    iterator lower_bound(const K& key) { return make_iterator(lower_bound_index(key)); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    const_iterator lower_bound(const K& key) const { return make_iterator(lower_bound_index(key)); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    iterator upper_bound(const K& key) { return make_iterator(upper_bound_index(key)); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    const_iterator upper_bound(const K& key) const { return make_iterator(upper_bound_index(key)); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    std::pair<iterator, iterator> equal_range(const K& key)
+    {
+        auto i = lower_bound_index(key);
+        return { make_iterator(i), make_iterator(i + (i != size() && !_comp(key, _keys[i]))) };
+    }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    std::pair<const_iterator, const_iterator> equal_range(const K& key) const
+    {
+        auto i = lower_bound_index(key);
+        return { make_iterator(i), make_iterator(i + (i != size() && !_comp(key, _keys[i]))) };
+    }
+    template <class K, class C = Compare, stdmap_detail::if_transparent_erase<C, K, iterator, const_iterator> = nullptr>
+    size_type erase(K&& key)
+    {
+        auto i = find_index(key);
+        if(i == size()) { return 0; }
+        erase(make_iterator(i));
+        return 1;
+    }
+    ///@}
+
+    ///@name Observers
+    ///@{
+    key_compare key_comp() const { return _comp; }
+    value_compare value_comp() const { return value_compare(_comp); }
+    ///@}
+
+    ///@name Comparison
+    ///@{
+    friend bool operator==(const soa_flat_map& a, const soa_flat_map& b) { return a._keys == b._keys && a._values == b._values; }
+    friend bool operator!=(const soa_flat_map& a, const soa_flat_map& b) { return !(a == b); }
+    friend bool operator<(const soa_flat_map& a, const soa_flat_map& b)
+    {
+        return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(),
+                                            [](const const_reference& x, const const_reference& y) {
+                                                return x.first < y.first || (!(y.first < x.first) && x.second < y.second);
+                                            });
+    }
+    friend bool operator>(const soa_flat_map& a, const soa_flat_map& b) { return b < a; }
+    friend bool operator<=(const soa_flat_map& a, const soa_flat_map& b) { return !(b < a); }
+    friend bool operator>=(const soa_flat_map& a, const soa_flat_map& b) { return !(a < b); }
+    friend void swap(soa_flat_map& a, soa_flat_map& b) noexcept(noexcept(a.swap(b))) { a.swap(b); }
+    ///@}
+
+  private:
+    template <class K, class V, class C, class KA, class MA, class Pred>
+    friend typename soa_flat_map<K, V, C, KA, MA>::size_type erase_if(soa_flat_map<K, V, C, KA, MA>&, Pred);
+
+    // Compact both arrays in one pass
+    template <class Pred>
+    size_type remove_if(Pred& pred)
+    {
+        size_type w{};
+        for(size_type r = 0; r < size(); ++r)
+        {
+            if(pred(reference(_keys[r], _values[r]))) { continue; }
+            if(w != r)
+            {
+                _keys[w] = std::move(_keys[r]);
+                _values[w] = std::move(_values[r]);
+            }
+            ++w;
+        }
+        auto n = size() - w;
+        _keys.erase(_keys.begin() + w, _keys.end());
+        _values.erase(_values.begin() + w, _values.end());
+        return n;
+    }
+
+    iterator make_iterator(size_type i) { return iterator(_keys.data() + i, _values.data() + i); }
+    const_iterator make_iterator(size_type i) const { return const_iterator(_keys.data() + i, _values.data() + i); }
+    size_type index_of(const_iterator it) const { return static_cast<size_type>(it._k - _keys.data()); }
+
+    template <class K>
+    size_type lower_bound_index(const K& key) const { return stdmap_detail::lower_bound_index(_keys.data(), size(), key, _comp); }
+    template <class K>
+    size_type upper_bound_index(const K& key) const { return stdmap_detail::upper_bound_index(_keys.data(), size(), key, _comp); }
+    template <class K>
+    size_type find_index(const K& key) const
+    {
+        auto i = lower_bound_index(key);
+        return (i != size() && !_comp(key, _keys[i])) ? i : size();
+    }
+
+    // Merge src (sorted by key) with the existing elements. The first of equivalent keys wins, existing ones first
+    void merge_sorted(std::vector<value_type>& src)
+    {
+        if(src.empty()) { return; }
+        key_container_type keys(_keys.get_allocator());
+        mapped_container_type values(_values.get_allocator());
+        keys.reserve(size() + src.size());
+        values.reserve(size() + src.size());
+        size_type a{};
+        auto s = src.begin();
+        // Existing elements are copied if moving them may throw, so they are intact if the merge fails
+        auto push = [&](auto&& k, auto&& v) {
+            if(!keys.empty() && !_comp(keys.back(), k)) { return; }  // Equivalent to the last one
+            keys.emplace_back(std::forward<decltype(k)>(k));
+            values.emplace_back(std::forward<decltype(v)>(v));
+        };
+        while(a < size() && s != src.end())
+        {
+            if(_comp(s->first, _keys[a])) { push(std::move(s->first), std::move(s->second)); ++s; }
+            else { push(std::move(_keys[a]), std::move_if_noexcept(_values[a])); ++a; }
+        }
+        for(; a < size(); ++a) { push(std::move(_keys[a]), std::move_if_noexcept(_values[a])); }
+        for(; s != src.end(); ++s) { push(std::move(s->first), std::move(s->second)); }
+        _keys.swap(keys);
+        _values.swap(values);
+    }
+
+    // Insert the value first, then the key. With capacity reserved the key move cannot throw,
+    // so both arrays stay in step even if constructing T throws.
+    // Arguments that refer to an element would dangle after the growth or the shift, so the value is built first from those
+    template <class K, class... Args>
+    iterator emplace_at(size_type i, K&& key, Args&&... args)
+    {
+        Key k(std::forward<K>(key));
+        if(stdmap_detail::args_refer_into(_keys.data(), _keys.data() + size(), args...) ||
+           stdmap_detail::args_refer_into(_values.data(), _values.data() + size(), args...))
+        {
+            T v(std::forward<Args>(args)...);
+            return emplace_at(i, std::move(k), std::move(v));
+        }
+        // Grow geometrically, both arrays in step
+        const auto cap = std::min(_keys.capacity(), _values.capacity());
+        if(size() == cap) { reserve(std::max<size_type>(1, 2 * cap)); }
+        _values.emplace(_values.begin() + i, std::forward<Args>(args)...);
+        _keys.insert(_keys.begin() + i, std::move(k));
+        return make_iterator(i);
+    }
+
+    template <class K, class... Args>
+    std::pair<iterator, bool> try_emplace_impl(K&& key, Args&&... args)
+    {
+        auto i = lower_bound_index(key);
+        if(i != size() && !_comp(key, _keys[i])) { return { make_iterator(i), false }; }
+        return { emplace_at(i, std::forward<K>(key), std::forward<Args>(args)...), true };
+    }
+
+    template <class K, class M>
+    std::pair<iterator, bool> insert_or_assign_impl(K&& key, M&& obj)
+    {
+        auto i = lower_bound_index(key);
+        if(i != size() && !_comp(key, _keys[i]))
+        {
+            _values[i] = std::forward<M>(obj);
+            return { make_iterator(i), false };
+        }
+        return { emplace_at(i, std::forward<K>(key), std::forward<M>(obj)), true };
+    }
+
+    key_container_type _keys{};
+    mapped_container_type _values{};
+    Compare _comp{};
+};
+
+/*!
+  @brief Erase all elements satisfying the predicate
+  @param pred Called with std::pair<const Key&, T&>
+  @return Number of erased elements
+ */
+template <class Key, class T, class Compare, class KA, class MA, class Pred>
+typename soa_flat_map<Key, T, Compare, KA, MA>::size_type erase_if(soa_flat_map<Key, T, Compare, KA, MA>& c, Pred pred)
+{
+    return c.remove_if(pred);
+}
+
+}
+#endif
@@ -0,0 +1,461 @@
+/*!
+  @file gob_static_flat_map.hpp
+  @brief Fixed capacity sorted map with inline storage (no heap allocation)
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_STATIC_FLAT_MAP_HPP
+#define GOB_STATIC_FLAT_MAP_HPP
+
+#include <utility>
+#include <functional>
+#include <algorithm>
+#include <iterator>
+#include <initializer_list>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <cstddef>
+#include "internal/gob_stdmap_detail.hpp"
+
+namespace goblib {
+
+/*!
+  @class static_flat_map
+  @brief Sorted map with capacity fixed at compile time
+  @details Elements are kept as std::pair<Key, T> sorted by key in storage inside the object.
+  Never calls operator new, so it can be placed on the stack or in static memory.
+  @tparam Key Key type
+  @tparam T Mapped type
+  @tparam N Capacity
+  @tparam Compare Compare function object for the key
+  @note Capacity overflow
+  - insert, emplace, try_emplace and insert_or_assign return {end(), false} if the key is new and the map is full().
+  - operator[] with a new key on a full map throws std::length_error (calls std::abort() if exceptions are disabled).
+  @note Other differences from std::map are the same as flat_map.
+ */
+template <class Key, class T, std::size_t N, class Compare = std::less<Key>>
+class static_flat_map
+{
+    static_assert(N > 0, "Capacity must be greater than 0");
+
+  public:
+    ///@name Member types
+    ///@{
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<Key, T>;
+    using key_compare = Compare;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = value_type*;
+    using const_pointer = const value_type*;
+    using iterator = value_type*;
+    using const_iterator = const value_type*;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    ///@}
+
+    //! @brief Compare value_type by key
+    class value_compare
+    {
+        friend class static_flat_map;
+      public:
+        bool operator()(const value_type& a, const value_type& b) const { return comp(a.first, b.first); }
+      protected:
+        explicit value_compare(Compare c) : comp(c) {}
+        Compare comp;
+    };
+
+    ///@name Constructor
+    ///@{
+    static_flat_map() : static_flat_map(Compare()) {}
+    explicit static_flat_map(const Compare& comp) : _comp(comp) {}
+    //! @brief Construct from the range. Elements over capacity are ignored
+    template <class InputIt>
+    static_flat_map(InputIt first, InputIt last, const Compare& comp = Compare()) : _comp(comp)
+    {
+        insert(first, last);
+    }
+    static_flat_map(std::initializer_list<value_type> il, const Compare& comp = Compare())
+            : static_flat_map(il.begin(), il.end(), comp) {}
+    // Delegating, so the elements built so far are destroyed if a copy (move) throws
+    static_flat_map(const static_flat_map& o) : static_flat_map(o._comp)
+    {
+        for(auto& e : o) { ::new(static_cast<void*>(slot(_size))) value_type(e); ++_size; }
+    }
+    static_flat_map(static_flat_map&& o) noexcept(std::is_nothrow_move_constructible<value_type>::value)
+            : static_flat_map(o._comp)
+    {
+        for(auto& e : o) { ::new(static_cast<void*>(slot(_size))) value_type(std::move(e)); ++_size; }
+        o.clear();
+    }
+    ~static_flat_map() { clear(); }
+    ///@}
+
+    ///@name Assignment
+    ///@{
+    static_flat_map& operator=(const static_flat_map& o)
+    {
+        if(this != &o)
+        {
+            clear();
+            _comp = o._comp;
+            for(auto& e : o) { ::new(static_cast<void*>(slot(_size))) value_type(e); ++_size; }
+        }
+        return *this;
+    }
+    static_flat_map& operator=(static_flat_map&& o) noexcept(std::is_nothrow_move_constructible<value_type>::value)
+    {
+        if(this != &o)
+        {
+            clear();
+            _comp = o._comp;
+            for(auto& e : o) { ::new(static_cast<void*>(slot(_size))) value_type(std::move(e)); ++_size; }
+            o.clear();
+        }
+        return *this;
+    }
+    static_flat_map& operator=(std::initializer_list<value_type> il)
+    {
+        clear();
+        insert(il);
+        return *this;
+    }
+    ///@}
+
+    ///@name Element access
+    ///@{
+    T& at(const Key& key)
+    {
+        auto it = find(key);
+        if(it == end()) { stdmap_detail::throw_out_of_range("static_flat_map::at"); }
+        return it->second;
+    }
+    const T& at(const Key& key) const
+    {
+        auto it = find(key);
+        if(it == end()) { stdmap_detail::throw_out_of_range("static_flat_map::at"); }
+        return it->second;
+    }
+    T& operator[](const Key& key) { return subscript(key); }
+    T& operator[](Key&& key) { return subscript(std::move(key)); }
+    ///@}
+
+    ///@name Iterators
+    ///@{
+    iterator begin() noexcept { return data(); }
+    const_iterator begin() const noexcept { return data(); }
+    const_iterator cbegin() const noexcept { return data(); }
+    iterator end() noexcept { return slot(_size); }
+    const_iterator end() const noexcept { return slot(_size); }
+    const_iterator cend() const noexcept { return end(); }
+    reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+    const_reverse_iterator crbegin() const noexcept { return rbegin(); }
+    reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+    const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+    const_reverse_iterator crend() const noexcept { return rend(); }
+    ///@}
+
+    ///@name Capacity
+    ///@{
+    bool empty() const noexcept { return _size == 0; }
+    //! @brief Is the capacity exhausted?
+    bool full() const noexcept { return _size == N; }
+    size_type size() const noexcept { return _size; }
+    static constexpr size_type max_size() noexcept { return N; }
+    static constexpr size_type capacity() noexcept { return N; }
+    ///@}
+
+    ///@name Modifiers
+    ///@{
+    void clear() noexcept
+    {
+        for(auto& e : *this) { e.~value_type(); }
+        _size = 0;
+    }
+
+    std::pair<iterator, bool> insert(const value_type& v) { return try_emplace(v.first, v.second); }
+    std::pair<iterator, bool> insert(value_type&& v) { return try_emplace(std::move(v.first), std::move(v.second)); }
+    iterator insert(const_iterator hint, const value_type& v) { (void)hint; return insert(v).first; }
+    iterator insert(const_iterator hint, value_type&& v) { (void)hint; return insert(std::move(v)).first; }
+    //! @brief Insert elements of the range. Elements over capacity are ignored
+    template <class InputIt>
+    void insert(InputIt first, InputIt last)
+    {
+        for(; first != last; ++first) { insert(*first); }
+    }
+    void insert(std::initializer_list<value_type> il) { insert(il.begin(), il.end()); }
+
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(const Key& key, M&& obj) { return insert_or_assign_impl(key, std::forward<M>(obj)); }
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(Key&& key, M&& obj) { return insert_or_assign_impl(std::move(key), std::forward<M>(obj)); }
+
+    template <class... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        value_type v(std::forward<Args>(args)...);
+        return try_emplace(std::move(v.first), std::move(v.second));
+    }
+    template <class... Args>
+    iterator emplace_hint(const_iterator hint, Args&&... args)
+    {
+        (void)hint;
+        return emplace(std::forward<Args>(args)...).first;
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) { return try_emplace_impl(key, std::forward<Args>(args)...); }
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(Key&& key, Args&&... args) { return try_emplace_impl(std::move(key), std::forward<Args>(args)...); }
+
+    iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        iterator f = begin() + (first - cbegin());
+        iterator l = begin() + (last - cbegin());
+        if(f != l)
+        {
+            iterator e = std::move(l, end(), f);
+            for(auto it = e; it != end(); ++it) { it->~value_type(); }
+            _size -= static_cast<size_type>(l - f);
+        }
+        return f;
+    }
+    size_type erase(const Key& key)
+    {
+        auto it = find(key);
+        if(it == end()) { return 0; }
+        erase(it);
+        return 1;
+    }
+
+    void swap(static_flat_map& o)
+    {
+        static_flat_map t(std::move(o));
+        o = std::move(*this);
+        *this = std::move(t);
+    }
+    ///@}
+
+    ///@name Lookup
+    ///@{
+    size_type count(const Key& key) const { return find(key) != end() ? 1 : 0; }
+    iterator find(const Key& key)
+    {
+        auto it = lower_bound(key);
+        return (it != end() && !_comp(key, it->first)) ? it : end();
+    }
+    const_iterator find(const Key& key) const
+    {
+        auto it = lower_bound(key);
+        return (it != end() && !_comp(key, it->first)) ? it : end();
+    }
+    bool contains(const Key& key) const { return find(key) != end(); }
+    iterator lower_bound(const Key& key) { return std::lower_bound(begin(), end(), key, key_less()); }
+    const_iterator lower_bound(const Key& key) const { return std::lower_bound(begin(), end(), key, key_less()); }
+    iterator upper_bound(const Key& key) { return std::upper_bound(begin(), end(), key, key_less()); }
+    const_iterator upper_bound(const Key& key) const { return std::upper_bound(begin(), end(), key, key_less()); }
+    std::pair<iterator, iterator> equal_range(const Key& key)
+    {
+        auto it = lower_bound(key);
+        return { it, (it != end() && !_comp(key, it->first)) ? it + 1 : it };
+    }
+    std::pair<const_iterator, const_iterator> equal_range(const Key& key) const
+    {
+        auto it = lower_bound(key);
+        return { it, (it != end() && !_comp(key, it->first)) ? it + 1 : it };
+    }
+    ///@}
+
+    //! @name Heterogeneous lookup (if Compare::is_transparent exists)
+    ///@{
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    size_type count(const K& key) const { return contains(key) ? 1 : 0; }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    iterator find(const K& key)
+    {
+        auto it = lower_bound(key);
+        return (it != end() && !_comp(key, it->first)) ? it : end();
+    }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    const_iterator find(const K& key) const
+    {
+        auto it = lower_bound(key);
+        return (it != end() && !_comp(key, it->first)) ? it : end();
+    }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    bool contains(const K& key) const { return find(key) != end(); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    iterator lower_bound(const K& key) { return std::lower_bound(begin(), end(), key, key_less()); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    const_iterator lower_bound(const K& key) const { return std::lower_bound(begin(), end(), key, key_less()); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    iterator upper_bound(const K& key) { return std::upper_bound(begin(), end(), key, key_less()); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    const_iterator upper_bound(const K& key) const { return std::upper_bound(begin(), end(), key, key_less()); }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    std::pair<iterator, iterator> equal_range(const K& key)
+    {
+        auto it = lower_bound(key);
+        return { it, (it != end() && !_comp(key, it->first)) ? it + 1 : it };
+    }
+    template <class K, class C = Compare, stdmap_detail::if_transparent<C> = nullptr>
+    std::pair<const_iterator, const_iterator> equal_range(const K& key) const
+    {
+        auto it = lower_bound(key);
+        return { it, (it != end() && !_comp(key, it->first)) ? it + 1 : it };
+    }
+    template <class K, class C = Compare, stdmap_detail::if_transparent_erase<C, K, iterator, const_iterator> = nullptr>
+    size_type erase(K&& key)
+    {
+        auto it = find(key);
+        if(it == end()) { return 0; }
+        erase(it);
+        return 1;
+    }
+    ///@}
+
+    ///@name Observers
+    ///@{
+    key_compare key_comp() const { return _comp; }
+    value_compare value_comp() const { return value_compare(_comp); }
+    ///@}
+
+    ///@name Comparison
+    ///@{
+    friend bool operator==(const static_flat_map& a, const static_flat_map& b)
+    {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+    }
+    friend bool operator!=(const static_flat_map& a, const static_flat_map& b) { return !(a == b); }
+    friend bool operator<(const static_flat_map& a, const static_flat_map& b)
+    {
+        return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+    }
+    friend bool operator>(const static_flat_map& a, const static_flat_map& b) { return b < a; }
+    friend bool operator<=(const static_flat_map& a, const static_flat_map& b) { return !(b < a); }
+    friend bool operator>=(const static_flat_map& a, const static_flat_map& b) { return !(a < b); }
+    friend void swap(static_flat_map& a, static_flat_map& b) { a.swap(b); }
+    ///@}
+
+  private:
+    struct key_less_value
+    {
+        const Compare& comp;
+        template <class K>
+        bool operator()(const value_type& v, const K& k) const { return comp(v.first, k); }
+        template <class K>
+        bool operator()(const K& k, const value_type& v) const { return comp(k, v.first); }
+    };
+    key_less_value key_less() const { return { _comp }; }
+
+    // Address of slot i in the storage, whether or not an element lives there
+    value_type* slot(size_type i) noexcept { return reinterpret_cast<value_type*>(_storage + i * sizeof(value_type)); }
+    const value_type* slot(size_type i) const noexcept { return reinterpret_cast<const value_type*>(_storage + i * sizeof(value_type)); }
+    // First element, laundered only if one lives there
+    value_type* data() noexcept { return _size ? std::launder(slot(0)) : slot(0); }
+    const value_type* data() const noexcept { return _size ? std::launder(slot(0)) : slot(0); }
+
+    // Open a slot at pos and construct the element there. Capacity must be available.
+    // Nothrow movable elements are shifted first and the new one is built in place (shifted back if that throws),
+    // unless the arguments refer to an element that moves. Otherwise the new element is built first and moved in
+    template <class... Args>
+    iterator emplace_at(iterator pos, Args&&... args)
+    {
+        if(pos == end())
+        {
+            ::new(static_cast<void*>(pos)) value_type(std::forward<Args>(args)...);
+            ++_size;
+            return pos;
+        }
+        if constexpr(std::is_nothrow_move_constructible<value_type>::value && std::is_nothrow_move_assignable<value_type>::value)
+        {
+            if(!stdmap_detail::args_refer_into(data(), end(), args...))
+            {
+                ::new(static_cast<void*>(slot(_size))) value_type(std::move(data()[_size - 1]));
+                ++_size;
+                std::move_backward(pos, end() - 2, end() - 1);
+                pos->~value_type();
+                struct guard
+                {
+                    static_flat_map* self;
+                    value_type* p;
+                    ~guard()
+                    {
+                        if(!self) { return; }
+                        ::new(static_cast<void*>(p)) value_type(std::move(p[1]));
+                        std::move(p + 2, self->end(), p + 1);
+                        (self->end() - 1)->~value_type();
+                        --self->_size;
+                    }
+                } g{ this, pos };
+                ::new(static_cast<void*>(pos)) value_type(std::forward<Args>(args)...);
+                g.self = nullptr;
+                return pos;
+            }
+        }
+        value_type tmp(std::forward<Args>(args)...);
+        ::new(static_cast<void*>(slot(_size))) value_type(std::move(data()[_size - 1]));
+        ++_size;
+        std::move_backward(pos, end() - 2, end() - 1);
+        *pos = std::move(tmp);
+        return pos;
+    }
+
+    template <class K, class... Args>
+    std::pair<iterator, bool> try_emplace_impl(K&& key, Args&&... args)
+    {
+        auto it = lower_bound(key);
+        if(it != end() && !_comp(key, it->first)) { return { it, false }; }
+        if(full()) { return { end(), false }; }
+        return { emplace_at(it, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                            std::forward_as_tuple(std::forward<Args>(args)...)),
+                 true };
+    }
+
+    template <class K, class M>
+    std::pair<iterator, bool> insert_or_assign_impl(K&& key, M&& obj)
+    {
+        auto it = lower_bound(key);
+        if(it != end() && !_comp(key, it->first))
+        {
+            it->second = std::forward<M>(obj);
+            return { it, false };
+        }
+        if(full()) { return { end(), false }; }
+        return { emplace_at(it, std::forward<K>(key), std::forward<M>(obj)), true };
+    }
+
+    template <class K>
+    T& subscript(K&& key)
+    {
+        auto r = try_emplace_impl(std::forward<K>(key));
+        if(r.first == end()) { stdmap_detail::throw_length_error("static_flat_map::operator[]"); }
+        return r.first->second;
+    }
+
+    alignas(value_type) unsigned char _storage[sizeof(value_type) * N];
+    size_type _size{};
+    Compare _comp{};
+};
+
+/*!
+  @brief Erase all elements satisfying the predicate
+  @return Number of erased elements
+ */
+template <class Key, class T, std::size_t N, class Compare, class Pred>
+typename static_flat_map<Key, T, N, Compare>::size_type erase_if(static_flat_map<Key, T, N, Compare>& c, Pred pred)
+{
+    auto it = std::remove_if(c.begin(), c.end(), pred);
+    auto n = static_cast<typename static_flat_map<Key, T, N, Compare>::size_type>(c.end() - it);
+    c.erase(it, c.end());
+    return n;
+}
+
+}
+#endif
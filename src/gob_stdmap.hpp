@@ -0,0 +1,31 @@
+/*!
+  @file gob_stdmap.hpp
+  @brief std::map compatible containers with cache friendly storage
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_STDMAP_HPP
+#define GOB_STDMAP_HPP
+
+#include "gob_flat_map.hpp"
+#include "gob_flat_multimap.hpp"
+#include "gob_flat_set.hpp"
+#include "gob_buffered_flat_map.hpp"
+#include "gob_soa_flat_map.hpp"
+#include "gob_static_flat_map.hpp"
+#include "gob_btree_map.hpp"
+#include "gob_art_map.hpp"
+#include "gob_frozen_map.hpp"
+#include "gob_constexpr_map.hpp"
+#include "gob_perfect_hash_map.hpp"
+#include "gob_mapped_map.hpp"
+#include "gob_string_flat_map.hpp"
+#include "gob_hash_map.hpp"
+#include "gob_incremental_hash_map.hpp"
+#include "gob_concurrent_hash_map.hpp"
+#include "gob_rcu_map.hpp"
+#include "gob_parallel.hpp"
+#include "gob_allocator.hpp"
+#include "gob_map_stats.hpp"
+
+#endif
@@ -0,0 +1,591 @@
+/*!
+  @file gob_string_flat_map.hpp
+  @brief Sorted vector based map for string keys with pooled key storage
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_STRING_FLAT_MAP_HPP
+#define GOB_STRING_FLAT_MAP_HPP
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <functional>
+#include <algorithm>
+#include <iterator>
+#include <initializer_list>
+#include <memory>
+#include <type_traits>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+#include "internal/gob_stdmap_detail.hpp"
+#include "internal/gob_string_key.hpp"
+
+namespace goblib {
+
+/*!
+  @class string_flat_map
+  @brief Sorted vector based map for string keys without per-key heap blocks
+  @details Each key is a 16 byte entry. Keys up to 12 chars are stored inline in the entry,
+  longer ones in one contiguous character pool referenced by offset. The first 8 chars are kept
+  in the entry as a big-endian prefix, so most comparisons finish without touching the pool.
+  Mapped values are kept in a parallel array (same as soa_flat_map).
+  Compared with std::map<std::string, T> there is no node, no std::string header and no heap block per key.
+  @tparam T Mapped type
+  @tparam MappedAllocator Allocator for T
+  @note The interface is the same as std::map<std::string_view, T> with the following differences.
+  - Keys are copied into the map. Any string_view-convertible type can be used for insertion and lookup.
+  - Iterators are proxy iterators. Dereference yields std::pair<std::string_view, T&> by value.
+  - Insertion and erasure invalidate iterators, references and the string_view of keys.
+  - Insertion and erasure are O(N) due to entry shifting (16 bytes each, strings are not moved).
+  - Erased long keys leave garbage in the pool. It is compacted when it exceeds half of the pool, or by shrink_to_fit().
+  - A key and the whole pool are limited to 4 GiB (std::length_error).
+ */
+template <class T, class MappedAllocator = std::allocator<T>>
+class string_flat_map
+{
+    static_assert(!std::is_same<T, bool>::value, "std::vector<bool> is not supported");
+    using entry = stdmap_detail::string_key;
+    using probe = stdmap_detail::string_probe;
+
+  public:
+    template <bool Const> class basic_iterator;
+
+    ///@name Member types
+    ///@{
+    using key_type = std::string_view;
+    using mapped_type = T;
+    using value_type = std::pair<std::string_view, T>;
+    using key_compare = std::less<std::string_view>;
+    using mapped_container_type = std::vector<T, MappedAllocator>;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = std::pair<std::string_view, T&>;
+    using const_reference = std::pair<std::string_view, const T&>;
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    ///@}
+
+    /*!
+      @brief Random access proxy iterator
+      @details Holds pointers to the key entry, the pool and the mapped value.
+     */
+    template <bool Const>
+    class basic_iterator
+    {
+        friend class string_flat_map;
+        template <bool> friend class basic_iterator;
+        using mapped_pointer = typename std::conditional<Const, const T*, T*>::type;
+
+      public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = std::pair<std::string_view, T>;
+        using difference_type = std::ptrdiff_t;
+        using reference = std::pair<std::string_view, typename std::conditional<Const, const T&, T&>::type>;
+        //! @brief Result of operator-> (holds the proxy reference)
+        struct pointer
+        {
+            reference ref;
+            reference* operator->() { return &ref; }
+        };
+
+        basic_iterator() = default;
+        template <bool C, typename std::enable_if<Const && !C, std::nullptr_t>::type = nullptr>
+        basic_iterator(const basic_iterator<C>& o) : _k(o._k), _pool(o._pool), _v(o._v) {}
+
+        reference operator*() const { return { _k->view(_pool), *_v }; }
+        pointer operator->() const { return { **this }; }
+        reference operator[](difference_type n) const { return { _k[n].view(_pool), _v[n] }; }
+
+        basic_iterator& operator++() { ++_k; ++_v; return *this; }
+        basic_iterator operator++(int) { auto t = *this; ++*this; return t; }
+        basic_iterator& operator--() { --_k; --_v; return *this; }
+        basic_iterator operator--(int) { auto t = *this; --*this; return t; }
+        basic_iterator& operator+=(difference_type n) { _k += n; _v += n; return *this; }
+        basic_iterator& operator-=(difference_type n) { _k -= n; _v -= n; return *this; }
+        friend basic_iterator operator+(basic_iterator it, difference_type n) { return it += n; }
+        friend basic_iterator operator+(difference_type n, basic_iterator it) { return it += n; }
+        friend basic_iterator operator-(basic_iterator it, difference_type n) { return it -= n; }
+
+        template <bool C> difference_type operator-(const basic_iterator<C>& o) const { return _k - o._k; }
+        template <bool C> bool operator==(const basic_iterator<C>& o) const { return _k == o._k; }
+        template <bool C> bool operator!=(const basic_iterator<C>& o) const { return _k != o._k; }
+        template <bool C> bool operator<(const basic_iterator<C>& o) const { return _k < o._k; }
+        template <bool C> bool operator>(const basic_iterator<C>& o) const { return _k > o._k; }
+        template <bool C> bool operator<=(const basic_iterator<C>& o) const { return _k <= o._k; }
+        template <bool C> bool operator>=(const basic_iterator<C>& o) const { return _k >= o._k; }
+
+        //! @brief The key
+        std::string_view key() const { return _k->view(_pool); }
+        //! @brief Pointer to the mapped value
+        mapped_pointer mapped_ptr() const { return _v; }
+
+      private:
+        basic_iterator(const entry* k, const char* pool, mapped_pointer v) : _k(k), _pool(pool), _v(v) {}
+        const entry* _k{};
+        const char* _pool{};
+        mapped_pointer _v{};
+    };
+
+    ///@name Constructor
+    ///@{
+    string_flat_map() = default;
+    explicit string_flat_map(const MappedAllocator& alloc) : _values(alloc) {}
+    //! @brief Construct from the range of pairs whose first is convertible to std::string_view
+    template <class InputIt>
+    string_flat_map(InputIt first, InputIt last, const MappedAllocator& alloc = MappedAllocator()) : _values(alloc)
+    {
+        insert(first, last);
+    }
+    string_flat_map(std::initializer_list<value_type> il, const MappedAllocator& alloc = MappedAllocator())
+            : string_flat_map(il.begin(), il.end(), alloc) {}
+    string_flat_map(const string_flat_map&) = default;
+    string_flat_map(string_flat_map&&) = default;
+    ///@}
+
+    ///@name Assignment
+    ///@{
+    string_flat_map& operator=(const string_flat_map&) = default;
+    string_flat_map& operator=(string_flat_map&&) = default;
+    string_flat_map& operator=(std::initializer_list<value_type> il)
+    {
+        clear();
+        insert(il);
+        return *this;
+    }
+    ///@}
+
+    ///@name Element access
+    ///@{
+    T& at(std::string_view key)
+    {
+        auto i = find_index(key);
+        if(i == size()) { stdmap_detail::throw_out_of_range("string_flat_map::at"); }
+        return _values[i];
+    }
+    const T& at(std::string_view key) const
+    {
+        auto i = find_index(key);
+        if(i == size()) { stdmap_detail::throw_out_of_range("string_flat_map::at"); }
+        return _values[i];
+    }
+    T& operator[](std::string_view key) { return *try_emplace(key).first._v; }
+
+    //! @brief Mapped values in key order
+    const mapped_container_type& values() const noexcept { return _values; }
+    ///@}
+
+    ///@name Iterators
+    ///@{
+    iterator begin() noexcept { return make_iterator(0); }
+    const_iterator begin() const noexcept { return make_iterator(0); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    iterator end() noexcept { return make_iterator(size()); }
+    const_iterator end() const noexcept { return make_iterator(size()); }
+    const_iterator cend() const noexcept { return end(); }
+    reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+    const_reverse_iterator crbegin() const noexcept { return rbegin(); }
+    reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+    const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+    const_reverse_iterator crend() const noexcept { return rend(); }
+    ///@}
+
+    ///@name Capacity
+    ///@{
+    bool empty() const noexcept { return _keys.empty(); }
+    size_type size() const noexcept { return _keys.size(); }
+    size_type max_size() const noexcept { return std::min<size_type>(_keys.max_size(), _values.max_size()); }
+    /*!
+      @brief Reserve storage
+      @param n Number of elements
+      @param pool_bytes Total length of the keys longer than entry::inline_capacity (12)
+     */
+    void reserve(size_type n, size_type pool_bytes = 0)
+    {
+        _keys.reserve(n);
+        _values.reserve(n);
+        _pool.reserve(pool_bytes);
+    }
+    //! @brief Compact the pool and release unused capacity
+    void shrink_to_fit()
+    {
+        compact();
+        _keys.shrink_to_fit();
+        _values.shrink_to_fit();
+        _pool.shrink_to_fit();
+    }
+    //! @brief Bytes used in the character pool (including garbage of erased keys)
+    size_type pool_size() const noexcept { return _pool.size(); }
+    ///@}
+
+    ///@name Modifiers
+    ///@{
+    void clear() noexcept
+    {
+        _keys.clear();
+        _values.clear();
+        _pool.clear();
+        _garbage = 0;
+    }
+
+    std::pair<iterator, bool> insert(const value_type& v) { return try_emplace(v.first, v.second); }
+    std::pair<iterator, bool> insert(value_type&& v) { return try_emplace(v.first, std::move(v.second)); }
+    iterator insert(const_iterator hint, const value_type& v) { (void)hint; return insert(v).first; }
+    iterator insert(const_iterator hint, value_type&& v) { (void)hint; return insert(std::move(v)).first; }
+    /*!
+      @brief Insert elements of the range
+      @details Keys are staged in one buffer, sorted and deduplicated once and merged with the existing elements.
+      O(M log M + N) for M new and N existing elements. Existing elements win over equivalent new keys.
+     */
+    template <class InputIt>
+    void insert(InputIt first, InputIt last)
+    {
+        std::vector<char> chars;
+        std::vector<size_type> ends;
+        mapped_container_type vals(_values.get_allocator());
+        for(; first != last; ++first)
+        {
+            auto&& v = *first;
+            std::string_view s(v.first);
+            chars.insert(chars.end(), s.begin(), s.end());
+            ends.push_back(chars.size());
+            vals.emplace_back(std::forward<decltype(v)>(v).second);
+        }
+        // Views are made after the buffer stopped growing
+        std::vector<std::string_view> views(ends.size());
+        for(size_type i = 0, b = 0; i < ends.size(); b = ends[i++]) { views[i] = std::string_view(chars.data() + b, ends[i] - b); }
+        std::vector<size_type> order(views.size());
+        for(size_type i = 0; i < order.size(); ++i) { order[i] = i; }
+        std::stable_sort(order.begin(), order.end(), [&views](size_type a, size_type b) { return views[a] < views[b]; });
+        merge_sorted(views, vals, order);
+    }
+    void insert(std::initializer_list<value_type> il) { insert(il.begin(), il.end()); }
+
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(std::string_view key, M&& obj)
+    {
+        auto i = lower_bound_index(key);
+        if(i != size() && _keys[i].view(_pool.data()) == key)
+        {
+            _values[i] = std::forward<M>(obj);
+            return { make_iterator(i), false };
+        }
+        return { emplace_at(i, key, std::forward<M>(obj)), true };
+    }
+
+    //! @brief Emplace from arguments of std::pair<std::string_view, T>
+    template <class... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        value_type v(std::forward<Args>(args)...);
+        return try_emplace(v.first, std::move(v.second));
+    }
+    template <class... Args>
+    iterator emplace_hint(const_iterator hint, Args&&... args)
+    {
+        (void)hint;
+        return emplace(std::forward<Args>(args)...).first;
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(std::string_view key, Args&&... args)
+    {
+        auto i = lower_bound_index(key);
+        if(i != size() && _keys[i].view(_pool.data()) == key) { return { make_iterator(i), false }; }
+        return { emplace_at(i, key, std::forward<Args>(args)...), true };
+    }
+    template <class... Args>
+    iterator try_emplace(const_iterator hint, std::string_view key, Args&&... args)
+    {
+        (void)hint;
+        return try_emplace(key, std::forward<Args>(args)...).first;
+    }
+
+    iterator erase(const_iterator pos) { return erase(pos, std::next(pos)); }
+    iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        auto b = index_of(first);
+        auto e = index_of(last);
+        for(auto i = b; i < e; ++i) { discard(_keys[i]); }
+        _keys.erase(_keys.begin() + b, _keys.begin() + e);
+        _values.erase(_values.begin() + b, _values.begin() + e);
+        maybe_compact();
+        return make_iterator(b);
+    }
+    size_type erase(std::string_view key)
+    {
+        auto i = find_index(key);
+        if(i == size()) { return 0; }
+        erase(make_iterator(i));
+        return 1;
+    }
+
+    void swap(string_flat_map& o) noexcept
+    {
+        using std::swap;
+        _keys.swap(o._keys);
+        _values.swap(o._values);
+        _pool.swap(o._pool);
+        swap(_garbage, o._garbage);
+    }
+    ///@}
+
+    ///@name Lookup
+    ///@{
+    size_type count(std::string_view key) const { return contains(key) ? 1 : 0; }
+    iterator find(std::string_view key) { return make_iterator(find_index(key)); }
+    const_iterator find(std::string_view key) const { return make_iterator(find_index(key)); }
+    bool contains(std::string_view key) const { return find_index(key) != size(); }
+    iterator lower_bound(std::string_view key) { return make_iterator(lower_bound_index(key)); }
+    const_iterator lower_bound(std::string_view key) const { return make_iterator(lower_bound_index(key)); }
+    iterator upper_bound(std::string_view key) { return make_iterator(upper_bound_index(key)); }
+    const_iterator upper_bound(std::string_view key) const { return make_iterator(upper_bound_index(key)); }
+    std::pair<iterator, iterator> equal_range(std::string_view key)
+    {
+        auto i = lower_bound_index(key);
+        return { make_iterator(i), make_iterator(i + (i != size() && _keys[i].view(_pool.data()) == key)) };
+    }
+    std::pair<const_iterator, const_iterator> equal_range(std::string_view key) const
+    {
+        auto i = lower_bound_index(key);
+        return { make_iterator(i), make_iterator(i + (i != size() && _keys[i].view(_pool.data()) == key)) };
+    }
+    ///@}
+
+    ///@name Observers
+    ///@{
+    key_compare key_comp() const { return key_compare(); }
+    ///@}
+
+    ///@name Comparison
+    ///@{
+    friend bool operator==(const string_flat_map& a, const string_flat_map& b)
+    {
+        if(a.size() != b.size()) { return false; }
+        for(size_type i = 0; i < a.size(); ++i)
+        {
+            if(a._keys[i].view(a._pool.data()) != b._keys[i].view(b._pool.data()) || !(a._values[i] == b._values[i])) { return false; }
+        }
+        return true;
+    }
+    friend bool operator!=(const string_flat_map& a, const string_flat_map& b) { return !(a == b); }
+    friend void swap(string_flat_map& a, string_flat_map& b) noexcept { a.swap(b); }
+    ///@}
+
+    //! @cond
+    template <class Pred>
+    size_type remove_if(Pred& pred)
+    {
+        size_type w{};
+        for(size_type r = 0; r < size(); ++r)
+        {
+            if(pred(reference(_keys[r].view(_pool.data()), _values[r])))
+            {
+                discard(_keys[r]);
+                continue;
+            }
+            if(w != r)
+            {
+                _keys[w] = _keys[r];
+                _values[w] = std::move(_values[r]);
+            }
+            ++w;
+        }
+        auto n = size() - w;
+        _keys.erase(_keys.begin() + w, _keys.end());
+        _values.erase(_values.begin() + w, _values.end());
+        maybe_compact();
+        return n;
+    }
+    //! @endcond
+
+  private:
+    // Compact only when the garbage is worth the copy
+    static constexpr size_type compact_threshold = 4096;
+
+    iterator make_iterator(size_type i) { return iterator(_keys.data() + i, _pool.data(), _values.data() + i); }
+    const_iterator make_iterator(size_type i) const { return const_iterator(_keys.data() + i, _pool.data(), _values.data() + i); }
+    size_type index_of(const_iterator it) const { return static_cast<size_type>(it._k - _keys.data()); }
+
+    size_type lower_bound_index(std::string_view key) const
+    {
+        const probe p(key);
+        const char* pool = _pool.data();
+        size_type lo{}, n{ size() };
+        while(n > 0)
+        {
+            const size_type half = n / 2;
+            if(stdmap_detail::compare_key(_keys[lo + half], pool, p) < 0) { lo += half + 1; n -= half + 1; }
+            else { n = half; }
+        }
+        return lo;
+    }
+    size_type upper_bound_index(std::string_view key) const
+    {
+        const probe p(key);
+        const char* pool = _pool.data();
+        size_type lo{}, n{ size() };
+        while(n > 0)
+        {
+            const size_type half = n / 2;
+            if(stdmap_detail::compare_key(_keys[lo + half], pool, p) <= 0) { lo += half + 1; n -= half + 1; }
+            else { n = half; }
+        }
+        return lo;
+    }
+    size_type find_index(std::string_view key) const
+    {
+        const probe p(key);
+        const char* pool = _pool.data();
+        size_type lo{}, n{ size() };
+        while(n > 0)
+        {
+            const size_type half = n / 2;
+            const int c = stdmap_detail::compare_key(_keys[lo + half], pool, p);
+            if(c == 0) { return lo + half; }
+            if(c < 0) { lo += half + 1; n -= half + 1; }
+            else { n = half; }
+        }
+        return size();
+    }
+
+    // Make the entry of the key, copying long keys into the pool
+    entry make_entry(std::string_view s)
+    {
+        if(s.size() <= entry::inline_capacity) { return entry::make_inline(s); }
+        constexpr size_type limit = std::numeric_limits<std::uint32_t>::max();
+        if(s.size() > limit || _pool.size() > limit - s.size()) { stdmap_detail::throw_length_error("string_flat_map pool"); }
+        auto offset = static_cast<std::uint32_t>(_pool.size());
+        _pool.insert(_pool.end(), s.begin(), s.end());
+        return entry::make_pooled(s, offset);
+    }
+    void discard(const entry& e)
+    {
+        if(!e.is_inline()) { _garbage += e.size; }
+    }
+
+    // Some of args refer into the entries, the values or the pool
+    template <class... Args>
+    bool refer_into_storage(const Args&... args) const
+    {
+        return stdmap_detail::args_refer_into(_keys.data(), _keys.data() + _keys.size(), args...) ||
+               stdmap_detail::args_refer_into(_values.data(), _values.data() + _values.size(), args...) ||
+               stdmap_detail::args_refer_into(_pool.data(), _pool.data() + _pool.size(), args...);
+    }
+
+    // The key is copied into the pool first. If constructing T throws the pool is truncated back.
+    // A key or arguments that refer into the map would dangle after the growth or the shift, so those are copied first
+    template <class... Args>
+    iterator emplace_at(size_type i, std::string_view key, Args&&... args)
+    {
+        if(refer_into_storage(key.data()))
+        {
+            const std::string k(key);
+            return emplace_at(i, std::string_view(k), std::forward<Args>(args)...);
+        }
+        if(refer_into_storage(args...))
+        {
+            T v(std::forward<Args>(args)...);
+            return emplace_at(i, key, std::move(v));
+        }
+        // Grow geometrically, both arrays in step
+        const auto cap = std::min(_keys.capacity(), _values.capacity());
+        if(size() == cap) { reserve(std::max<size_type>(1, 2 * cap)); }
+        struct guard
+        {
+            std::vector<char>* pool;
+            size_type size;
+            ~guard()
+            {
+                if(pool) { pool->resize(size); }
+            }
+        } g{ &_pool, _pool.size() };
+        auto e = make_entry(key);
+        _values.emplace(_values.begin() + i, std::forward<Args>(args)...);
+        g.pool = nullptr;
+        _keys.insert(_keys.begin() + i, e);
+        return make_iterator(i);
+    }
+
+    // Merge the new elements (views[order[j]], vals[order[j]]) sorted by key. The first of equivalent keys wins, existing ones first
+    void merge_sorted(const std::vector<std::string_view>& views, mapped_container_type& vals, const std::vector<size_type>& order)
+    {
+        if(order.empty()) { return; }
+        std::vector<entry> keys;
+        mapped_container_type values(_values.get_allocator());
+        keys.reserve(size() + order.size());
+        values.reserve(size() + order.size());
+        auto last_is = [&](std::string_view s) { return !keys.empty() && keys.back().view(_pool.data()) == s; };
+        size_type a{}, j{};
+        auto push_old = [&] {
+            keys.push_back(_keys[a]);
+            values.emplace_back(std::move_if_noexcept(_values[a]));  // Intact if the merge fails
+            ++a;
+        };
+        auto push_new = [&] {
+            auto s = views[order[j]];
+            if(!last_is(s))
+            {
+                keys.push_back(make_entry(s));
+                values.emplace_back(std::move(vals[order[j]]));
+            }
+            ++j;
+        };
+        while(a < size() && j < order.size())
+        {
+            if(views[order[j]] < _keys[a].view(_pool.data())) { push_new(); }
+            else { push_old(); }
+        }
+        while(a < size()) { push_old(); }
+        while(j < order.size()) { push_new(); }
+        _keys.swap(keys);
+        _values.swap(values);
+    }
+
+    void maybe_compact()
+    {
+        if(_garbage >= compact_threshold && _garbage * 2 > _pool.size()) { compact(); }
+    }
+    // Rebuild the pool without the garbage
+    void compact()
+    {
+        if(!_garbage) { return; }
+        std::vector<char> pool;
+        pool.reserve(_pool.size() - _garbage);
+        for(auto& e : _keys)
+        {
+            if(e.is_inline()) { continue; }
+            auto s = e.view(_pool.data());
+            auto offset = static_cast<std::uint32_t>(pool.size());
+            pool.insert(pool.end(), s.begin(), s.end());
+            e = entry::make_pooled(s, offset);
+        }
+        _pool.swap(pool);
+        _garbage = 0;
+    }
+
+    std::vector<entry> _keys{};
+    mapped_container_type _values{};
+    std::vector<char> _pool{};
+    size_type _garbage{};  // Bytes of erased keys in the pool
+};
+
+/*!
+  @brief Erase all elements satisfying the predicate
+  @param pred Called with std::pair<std::string_view, T&>
+  @return Number of erased elements
+ */
+template <class T, class MA, class Pred>
+typename string_flat_map<T, MA>::size_type erase_if(string_flat_map<T, MA>& c, Pred pred)
+{
+    return c.remove_if(pred);
+}
+
+}
+#endif
@@ -0,0 +1,478 @@
+/*!
+  @file gob_flat_tree.hpp
+  @brief Sorted vector engine shared by flat_multimap, flat_set and flat_multiset
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_STDMAP_INTERNAL_FLAT_TREE_HPP
+#define GOB_STDMAP_INTERNAL_FLAT_TREE_HPP
+
+#include <vector>
+#include <utility>
+#include <functional>
+#include <algorithm>
+#include <iterator>
+#include <initializer_list>
+#include <memory>
+#include <type_traits>
+#include "gob_stdmap_detail.hpp"
+
+namespace goblib {
+namespace stdmap_detail {
+
+// Key of an element: the element itself (sets)
+struct key_of_self
+{
+    template <class V>
+    const V& operator()(const V& v) const noexcept { return v; }
+};
+// Key of an element: first of the pair (maps)
+struct key_of_pair
+{
+    template <class P>
+    const typename P::first_type& operator()(const P& p) const noexcept { return p.first; }
+};
+
+/*
+  Elements sorted by KeyOf(element) in one std::vector.
+  Unique: no equivalent keys (set). Otherwise equivalent keys are adjacent in insertion order,
+  so equal_range is a binary search for the first of the run and a gallop to its end.
+  Elements of sets are immutable (iterator is const_iterator).
+ */
+template <class Key, class Value, class KeyOf, class Compare, class Allocator, bool Unique>
+class flat_tree
+{
+    static constexpr bool is_set = std::is_same<KeyOf, key_of_self>::value;
+
+  public:
+    ///@name Member types
+    ///@{
+    using key_type = Key;
+    using value_type = Value;
+    using key_compare = Compare;
+    using allocator_type = Allocator;
+    using container_type = std::vector<value_type, Allocator>;
+    using size_type = typename container_type::size_type;
+    using difference_type = typename container_type::difference_type;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = typename std::allocator_traits<Allocator>::pointer;
+    using const_pointer = typename std::allocator_traits<Allocator>::const_pointer;
+    using const_iterator = typename container_type::const_iterator;
+    using iterator = typename std::conditional<is_set, const_iterator, typename container_type::iterator>::type;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    //! @brief Tag of the sorted range constructor and insert (sorted_unique_t or sorted_equivalent_t)
+    using sorted_tag = typename std::conditional<Unique, sorted_unique_t, sorted_equivalent_t>::type;
+    //! @brief Result of insert and emplace (std::pair<iterator, bool> if keys are unique, otherwise iterator)
+    using insert_result = typename std::conditional<Unique, std::pair<iterator, bool>, iterator>::type;
+    ///@}
+
+    //! @brief Compare pairs by key
+    class pair_compare
+    {
+        friend class flat_tree;
+      public:
+        bool operator()(const value_type& a, const value_type& b) const { return comp(a.first, b.first); }
+      protected:
+        explicit pair_compare(Compare c) : comp(c) {}
+        Compare comp;
+    };
+    using value_compare = typename std::conditional<is_set, Compare, pair_compare>::type;
+
+    ///@name Constructor
+    ///@{
+    flat_tree() : flat_tree(Compare()) {}
+    explicit flat_tree(const Compare& comp, const Allocator& alloc = Allocator()) : _vec(alloc), _comp(comp) {}
+    explicit flat_tree(const Allocator& alloc) : _vec(alloc), _comp() {}
+    template <class InputIt>
+    flat_tree(InputIt first, InputIt last, const Compare& comp = Compare(), const Allocator& alloc = Allocator())
+            : _vec(alloc), _comp(comp)
+    {
+        insert(first, last);
+    }
+    template <class InputIt>
+    flat_tree(InputIt first, InputIt last, const Allocator& alloc) : flat_tree(first, last, Compare(), alloc) {}
+    //! @brief Construct from the range already sorted by key (without equivalent keys for sets)
+    template <class InputIt>
+    flat_tree(sorted_tag, InputIt first, InputIt last, const Compare& comp = Compare(), const Allocator& alloc = Allocator())
+            : _vec(first, last, alloc), _comp(comp) {}
+    //! @brief Adopt the container (need not be sorted)
+    explicit flat_tree(container_type cont, const Compare& comp = Compare()) : _vec(std::move(cont)), _comp(comp)
+    {
+        merge_appended(0, false);
+    }
+    //! @brief Adopt the container already sorted by key (without equivalent keys for sets)
+    flat_tree(sorted_tag, container_type cont, const Compare& comp = Compare()) : _vec(std::move(cont)), _comp(comp) {}
+    flat_tree(std::initializer_list<value_type> il, const Compare& comp = Compare(), const Allocator& alloc = Allocator())
+            : flat_tree(il.begin(), il.end(), comp, alloc) {}
+    flat_tree(std::initializer_list<value_type> il, const Allocator& alloc) : flat_tree(il, Compare(), alloc) {}
+    flat_tree(const flat_tree&) = default;
+    flat_tree(const flat_tree& o, const Allocator& alloc) : _vec(o._vec, alloc), _comp(o._comp) {}
+    flat_tree(flat_tree&&) = default;
+    flat_tree(flat_tree&& o, const Allocator& alloc) : _vec(std::move(o._vec), alloc), _comp(std::move(o._comp)) {}
+    ///@}
+
+    ///@name Assignment
+    ///@{
+    flat_tree& operator=(const flat_tree&) = default;
+    flat_tree& operator=(flat_tree&&) = default;
+    ///@}
+
+    allocator_type get_allocator() const noexcept { return _vec.get_allocator(); }
+
+    ///@name Iterators
+    ///@{
+    iterator begin() noexcept { return _vec.begin(); }
+    const_iterator begin() const noexcept { return _vec.begin(); }
+    const_iterator cbegin() const noexcept { return _vec.cbegin(); }
+    iterator end() noexcept { return _vec.end(); }
+    const_iterator end() const noexcept { return _vec.end(); }
+    const_iterator cend() const noexcept { return _vec.cend(); }
+    reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+    const_reverse_iterator crbegin() const noexcept { return const_reverse_iterator(end()); }
+    reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+    const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+    const_reverse_iterator crend() const noexcept { return const_reverse_iterator(begin()); }
+    ///@}
+
+    ///@name Capacity
+    ///@{
+    bool empty() const noexcept { return _vec.empty(); }
+    size_type size() const noexcept { return _vec.size(); }
+    size_type max_size() const noexcept { return _vec.max_size(); }
+    size_type capacity() const noexcept { return _vec.capacity(); }
+    void reserve(size_type n) { _vec.reserve(n); }
+    void shrink_to_fit() { _vec.shrink_to_fit(); }
+    ///@}
+
+    ///@name Modifiers
+    ///@{
+    void clear() noexcept { _vec.clear(); }
+
+    //! @brief Insert v. Sets keep the existing element, multi containers insert after the equivalent ones
+    insert_result insert(const value_type& v) { return insert_value(v); }
+    insert_result insert(value_type&& v) { return insert_value(std::move(v)); }
+    template <class P, typename std::enable_if<std::is_constructible<value_type, P&&>::value, std::nullptr_t>::type = nullptr>
+    insert_result insert(P&& v) { return emplace(std::forward<P>(v)); }
+    //! @brief Insert v as close as possible to just before hint
+    iterator insert(const_iterator hint, const value_type& v) { return insert_hint(hint, v); }
+    iterator insert(const_iterator hint, value_type&& v) { return insert_hint(hint, std::move(v)); }
+    template <class P, typename std::enable_if<std::is_constructible<value_type, P&&>::value, std::nullptr_t>::type = nullptr>
+    iterator insert(const_iterator hint, P&& v) { return emplace_hint(hint, std::forward<P>(v)); }
+    /*!
+      @brief Insert elements of the range
+      @details Elements are appended, then sorted once and merged with the existing elements.
+      O(M log M + N) for M new and N existing elements. Equivalent elements keep their order,
+      existing ones first (and only the first is kept by sets).
+     */
+    template <class InputIt>
+    void insert(InputIt first, InputIt last)
+    {
+        auto n = size();
+        _vec.insert(_vec.end(), first, last);
+        merge_appended(n, false);
+    }
+    //! @brief Insert elements of the range already sorted by key (without equivalent keys for sets). O(M + N)
+    template <class InputIt>
+    void insert(sorted_tag, InputIt first, InputIt last)
+    {
+        auto n = size();
+        _vec.insert(_vec.end(), first, last);
+        merge_appended(n, true);
+    }
+    void insert(std::initializer_list<value_type> il) { insert(il.begin(), il.end()); }
+    void insert(sorted_tag s, std::initializer_list<value_type> il) { insert(s, il.begin(), il.end()); }
+    //! @brief Insert elements of the range (moved if rg is an rvalue)
+    template <class R>
+    void insert_range(R&& rg)
+    {
+        if constexpr(std::is_rvalue_reference<R&&>::value)
+        {
+            insert(std::make_move_iterator(std::begin(rg)), std::make_move_iterator(std::end(rg)));
+        }
+        else { insert(std::begin(rg), std::end(rg)); }
+    }
+
+    template <class... Args>
+    insert_result emplace(Args&&... args)
+    {
+        value_type v(std::forward<Args>(args)...);
+        return insert_value(std::move(v));
+    }
+    template <class... Args>
+    iterator emplace_hint(const_iterator hint, Args&&... args)
+    {
+        value_type v(std::forward<Args>(args)...);
+        return insert_hint(hint, std::move(v));
+    }
+
+    iterator erase(const_iterator pos) { return _vec.erase(pos); }
+    iterator erase(const_iterator first, const_iterator last) { return _vec.erase(first, last); }
+    //! @brief Erase all elements equivalent to key
+    size_type erase(const Key& key) { return erase_key(key); }
+
+    /*!
+      @brief Splice elements of source into this in one linear pass
+      @details Sets leave the elements whose key already exists in this in source (same as std::set::merge).
+      Multi containers take all, placed after the equivalent elements of this
+     */
+    void merge(flat_tree& source)
+    {
+        if(&source == this || source.empty()) { return; }
+        container_type out(_vec.get_allocator());
+        out.reserve(size() + source.size());
+        auto a = _vec.begin();
+        auto b = source._vec.begin();
+        auto keep = b;  // Write position of the elements left in source
+        while(a != _vec.end() && b != source._vec.end())
+        {
+            if(_comp(key_of(*b), key_of(*a))) { out.emplace_back(std::move(*b++)); }
+            else if(Unique && !_comp(key_of(*a), key_of(*b)))
+            {
+                out.emplace_back(std::move(*a++));
+                if(keep != b) { *keep = std::move(*b); }
+                ++keep;
+                ++b;
+            }
+            else { out.emplace_back(std::move(*a++)); }
+        }
+        out.insert(out.end(), std::make_move_iterator(a), std::make_move_iterator(_vec.end()));
+        out.insert(out.end(), std::make_move_iterator(b), std::make_move_iterator(source._vec.end()));
+        source._vec.erase(keep, source._vec.end());
+        _vec.swap(out);
+    }
+    void merge(flat_tree&& source) { merge(source); }
+
+    //! @brief Move out the underlying container, leaving this empty
+    container_type extract() &&
+    {
+        container_type v(std::move(_vec));
+        _vec.clear();
+        return v;
+    }
+    //! @brief Replace the underlying container, which must be sorted by key (without equivalent keys for sets)
+    void replace(container_type&& cont) { _vec = std::move(cont); }
+
+    void swap(flat_tree& o) noexcept(std::is_nothrow_swappable<Compare>::value)
+    {
+        using std::swap;
+        _vec.swap(o._vec);
+        swap(_comp, o._comp);
+    }
+    ///@}
+
+    ///@name Lookup
+    ///@{
+    size_type count(const Key& key) const { return count_impl(key); }
+    //! @brief The first element equivalent to key, or end()
+    iterator find(const Key& key) { return begin() + find_index(key); }
+    const_iterator find(const Key& key) const { return cbegin() + find_index(key); }
+    bool contains(const Key& key) const { return find_index(key) != size(); }
+    iterator lower_bound(const Key& key) { return begin() + lower_bound_index(key); }
+    const_iterator lower_bound(const Key& key) const { return cbegin() + lower_bound_index(key); }
+    iterator upper_bound(const Key& key) { return begin() + upper_bound_index(key); }
+    const_iterator upper_bound(const Key& key) const { return cbegin() + upper_bound_index(key); }
+    //! @brief Run of the elements equivalent to key. One binary search, then a gallop over the run
+    std::pair<iterator, iterator> equal_range(const Key& key) { return equal_range_impl(key, begin()); }
+    std::pair<const_iterator, const_iterator> equal_range(const Key& key) const { return equal_range_impl(key, cbegin()); }
+    ///@}
+
+    /*!
+      @name Heterogeneous lookup
+      @brief Available if Compare::is_transparent exists (e.g. std::less<>).
+      Query by any type comparable with Key without constructing a temporary Key
+     */
+    ///@{
+    template <class K, class C = Compare, if_transparent<C> = nullptr>
+    size_type count(const K& key) const { return count_impl(key); }
+    template <class K, class C = Compare, if_transparent<C> = nullptr>
+    iterator find(const K& key) { return begin() + find_index(key); }
+    template <class K, class C = Compare, if_transparent<C> = nullptr>
+    const_iterator find(const K& key) const { return cbegin() + find_index(key); }
+    template <class K, class C = Compare, if_transparent<C> = nullptr>
+    bool contains(const K& key) const { return find_index(key) != size(); }
+    template <class K, class C = Compare, if_transparent<C> = nullptr>
+    iterator lower_bound(const K& key) { return begin() + lower_bound_index(key); }
+    template <class K, class C = Compare, if_transparent<C> = nullptr>
+    const_iterator lower_bound(const K& key) const { return cbegin() + lower_bound_index(key); }
+    template <class K, class C = Compare, if_transparent<C> = nullptr>
+    iterator upper_bound(const K& key) { return begin() + upper_bound_index(key); }
+    template <class K, class C = Compare, if_transparent<C> = nullptr>
+    const_iterator upper_bound(const K& key) const { return cbegin() + upper_bound_index(key); }
+    template <class K, class C = Compare, if_transparent<C> = nullptr>
+    std::pair<iterator, iterator> equal_range(const K& key) { return equal_range_impl(key, begin()); }
+    template <class K, class C = Compare, if_transparent<C> = nullptr>
+    std::pair<const_iterator, const_iterator> equal_range(const K& key) const { return equal_range_impl(key, cbegin()); }
+    template <class K, class C = Compare, if_transparent_erase<C, K, iterator, const_iterator> = nullptr>
+    size_type erase(K&& key) { return erase_key(key); }
+    ///@}
+
+    ///@name Observers
+    ///@{
+    key_compare key_comp() const { return _comp; }
+    value_compare value_comp() const { return value_compare(_comp); }
+    ///@}
+
+    ///@name Comparison
+    ///@{
+    friend bool operator==(const flat_tree& a, const flat_tree& b) { return a._vec == b._vec; }
+    friend bool operator!=(const flat_tree& a, const flat_tree& b) { return !(a == b); }
+    friend bool operator<(const flat_tree& a, const flat_tree& b) { return a._vec < b._vec; }
+    friend bool operator>(const flat_tree& a, const flat_tree& b) { return b < a; }
+    friend bool operator<=(const flat_tree& a, const flat_tree& b) { return !(b < a); }
+    friend bool operator>=(const flat_tree& a, const flat_tree& b) { return !(a < b); }
+    friend void swap(flat_tree& a, flat_tree& b) noexcept(noexcept(a.swap(b))) { a.swap(b); }
+    ///@}
+
+  private:
+    static const Key& key_of(const value_type& v) noexcept { return KeyOf{}(v); }
+    const Key& key_at(size_type i) const noexcept { return key_of(_vec[i]); }
+
+    // Heterogeneous compare of an element and a key for std::lower_bound / std::upper_bound
+    struct key_less_value
+    {
+        const Compare& comp;
+        template <class K>
+        bool operator()(const value_type& v, const K& k) const { return comp(v.first, k); }
+        template <class K>
+        bool operator()(const K& k, const value_type& v) const { return comp(k, v.first); }
+    };
+    // Elements of sets are the keys themselves
+    auto key_less() const
+    {
+        if constexpr(is_set) { return std::cref(_comp); }
+        else { return key_less_value{ _comp }; }
+    }
+    bool equivalent(const value_type& a, const value_type& b) const { return !_comp(key_of(a), key_of(b)) && !_comp(key_of(b), key_of(a)); }
+
+    template <class K>
+    size_type lower_bound_index(const K& key) const
+    {
+        return static_cast<size_type>(std::lower_bound(cbegin(), cend(), key, key_less()) - cbegin());
+    }
+    template <class K>
+    size_type upper_bound_index(const K& key) const
+    {
+        return static_cast<size_type>(std::upper_bound(cbegin(), cend(), key, key_less()) - cbegin());
+    }
+    template <class K>
+    size_type find_index(const K& key) const
+    {
+        auto i = lower_bound_index(key);
+        return (i != size() && !_comp(key, key_at(i))) ? i : size();
+    }
+    // End of the run of elements equivalent to key starting at first. Gallops 1, 2, 4 ... elements and bisects,
+    // so a run of length L costs O(log L) instead of a second search over the whole vector
+    template <class K>
+    size_type run_end(size_type first, const K& key) const
+    {
+        const size_type n = size();
+        if(first == n || _comp(key, key_at(first))) { return first; }
+        if constexpr(Unique) { return first + 1; }
+        else
+        {
+            size_type lo = first, step = 1, hi = first + 1;
+            while(hi < n && !_comp(key, key_at(hi)))
+            {
+                lo = hi;
+                step <<= 1;
+                hi = lo + step;
+            }
+            auto b = cbegin();
+            return static_cast<size_type>(
+                std::upper_bound(b + static_cast<difference_type>(lo + 1), b + static_cast<difference_type>(std::min(hi, n)), key, key_less()) - b);
+        }
+    }
+    template <class K, class It>
+    std::pair<It, It> equal_range_impl(const K& key, It base) const
+    {
+        auto first = lower_bound_index(key);
+        auto last = run_end(first, key);
+        return { base + static_cast<difference_type>(first), base + static_cast<difference_type>(last) };
+    }
+    template <class K>
+    size_type count_impl(const K& key) const
+    {
+        auto first = lower_bound_index(key);
+        return run_end(first, key) - first;
+    }
+    template <class K>
+    size_type erase_key(const K& key)
+    {
+        auto r = equal_range_impl(key, cbegin());
+        auto n = static_cast<size_type>(r.second - r.first);
+        _vec.erase(r.first, r.second);
+        return n;
+    }
+
+    template <class V>
+    insert_result insert_value(V&& v)
+    {
+        const auto& key = key_of(v);
+        if constexpr(Unique)
+        {
+            auto i = lower_bound_index(key);
+            if(i != size() && !_comp(key, key_at(i))) { return { begin() + static_cast<difference_type>(i), false }; }
+            return { _vec.insert(cbegin() + static_cast<difference_type>(i), std::forward<V>(v)), true };
+        }
+        else { return _vec.insert(cbegin() + static_cast<difference_type>(upper_bound_index(key)), std::forward<V>(v)); }
+    }
+    // Insert at hint if prev(hint) <= v <= hint, otherwise at the nearest valid position on that side
+    template <class V>
+    iterator insert_hint(const_iterator hint, V&& v)
+    {
+        const auto& key = key_of(v);
+        if constexpr(Unique)
+        {
+            if((hint == cbegin() || _comp(key_of(*std::prev(hint)), key)) && (hint == cend() || _comp(key, key_of(*hint))))
+            {
+                return _vec.insert(hint, std::forward<V>(v));
+            }
+            return insert_value(std::forward<V>(v)).first;
+        }
+        else
+        {
+            if(hint == cend() || !_comp(key_of(*hint), key))
+            {
+                if(hint == cbegin() || !_comp(key, key_of(*std::prev(hint)))) { return _vec.insert(hint, std::forward<V>(v)); }
+                return _vec.insert(std::upper_bound(cbegin(), hint, key, key_less()), std::forward<V>(v));
+            }
+            return _vec.insert(std::lower_bound(hint, cend(), key, key_less()), std::forward<V>(v));
+        }
+    }
+
+    // Sort (unless sorted) the elements from n, and merge them with [0, n)
+    void merge_appended(size_type n, bool sorted)
+    {
+        auto eq = [this](const value_type& a, const value_type& b) { return equivalent(a, b); };
+        auto mid = _vec.begin() + static_cast<difference_type>(n);
+        if(!sorted) { std::stable_sort(mid, _vec.end(), value_comp()); }
+        if constexpr(Unique) { _vec.erase(std::unique(mid, _vec.end(), eq), _vec.end()); }
+        mid = _vec.begin() + static_cast<difference_type>(n);
+        if(n == 0 || mid == _vec.end() || _comp(key_of(*std::prev(mid)), key_of(*mid))) { return; }
+        // Stable merge puts the existing elements first among equivalents
+        std::inplace_merge(_vec.begin(), mid, _vec.end(), value_comp());
+        if constexpr(Unique) { _vec.erase(std::unique(_vec.begin(), _vec.end(), eq), _vec.end()); }
+    }
+
+    container_type _vec{};
+    Compare _comp{};
+};
+
+// Erase the elements satisfying pred, through extract and replace (elements of sets are const)
+template <class Tree, class Pred>
+typename Tree::size_type flat_tree_erase_if(Tree& c, Pred pred)
+{
+    auto v = std::move(c).extract();
+    auto it = std::remove_if(v.begin(), v.end(), pred);
+    auto n = static_cast<typename Tree::size_type>(std::distance(it, v.end()));
+    v.erase(it, v.end());
+    c.replace(std::move(v));
+    return n;
+}
+
+}  // namespace stdmap_detail
+}
+#endif
@@ -0,0 +1,172 @@
+/*!
+  @file gob_simd_search.hpp
+  @brief Lower/upper bound on a sorted key array with SIMD final stage for integer keys
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_STDMAP_INTERNAL_SIMD_SEARCH_HPP
+#define GOB_STDMAP_INTERNAL_SIMD_SEARCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <functional>
+#include <algorithm>
+#include "gob_stdmap_detail.hpp"
+
+#if !defined(GOB_STDMAP_DISABLE_SIMD)
+#if defined(__AVX2__)
+#define GOB_STDMAP_SEARCH_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GOB_STDMAP_SEARCH_SSE2
+#include <emmintrin.h>
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+#endif
+#endif
+
+/*!
+  @def GOB_STDMAP_SEARCH_WINDOW
+  @brief Number of keys scanned linearly at the end of the search
+ */
+#ifndef GOB_STDMAP_SEARCH_WINDOW
+#define GOB_STDMAP_SEARCH_WINDOW 64
+#endif
+
+namespace goblib { namespace stdmap_detail {
+
+// Integer and enum keys ordered by std::less are searched by counting
+template <class Key, class Compare>
+struct is_count_searchable
+        : std::integral_constant<bool, (std::is_integral<Key>::value || std::is_enum<Key>::value) && !std::is_same<Key, bool>::value &&
+                                           (std::is_same<Compare, std::less<Key>>::value || std::is_same<Compare, std::less<>>::value)>
+{
+};
+
+template <class Key, bool = std::is_enum<Key>::value>
+struct search_int
+{
+    using type = Key;
+};
+template <class Key>
+struct search_int<Key, true>
+{
+    using type = typename std::underlying_type<Key>::type;
+};
+
+// Number of keys less than (Upper: not greater than) key, one by one
+template <bool Upper, class Key>
+std::size_t count_scalar(const Key* p, std::size_t n, const Key& key)
+{
+    std::size_t c{};
+    for(std::size_t i = 0; i < n; ++i) { c += Upper ? !(key < p[i]) : (p[i] < key); }
+    return c;
+}
+
+#if defined(GOB_STDMAP_SEARCH_SSE2) || defined(GOB_STDMAP_SEARCH_AVX2)
+// Vector operations on lanes of S bytes. Unsigned values are biased into signed order
+#if defined(GOB_STDMAP_SEARCH_AVX2)
+using search_vec = __m256i;
+inline search_vec vec_load(const void* p) { return _mm256_loadu_si256(static_cast<const __m256i*>(p)); }
+inline search_vec vec_xor(search_vec a, search_vec b) { return _mm256_xor_si256(a, b); }
+inline unsigned vec_mask_bits(search_vec m) { return popcount(static_cast<std::uint32_t>(_mm256_movemask_epi8(m))); }
+template <std::size_t S> struct lane_ops;
+template <> struct lane_ops<1> { static search_vec set1(std::int64_t v) { return _mm256_set1_epi8(static_cast<char>(v)); } static search_vec gt(search_vec a, search_vec b) { return _mm256_cmpgt_epi8(a, b); } };
+template <> struct lane_ops<2> { static search_vec set1(std::int64_t v) { return _mm256_set1_epi16(static_cast<short>(v)); } static search_vec gt(search_vec a, search_vec b) { return _mm256_cmpgt_epi16(a, b); } };
+template <> struct lane_ops<4> { static search_vec set1(std::int64_t v) { return _mm256_set1_epi32(static_cast<int>(v)); } static search_vec gt(search_vec a, search_vec b) { return _mm256_cmpgt_epi32(a, b); } };
+template <> struct lane_ops<8> { static search_vec set1(std::int64_t v) { return _mm256_set1_epi64x(static_cast<long long>(v)); } static search_vec gt(search_vec a, search_vec b) { return _mm256_cmpgt_epi64(a, b); } };
+#define GOB_STDMAP_SEARCH_HAS_64
+#else
+using search_vec = __m128i;
+inline search_vec vec_load(const void* p) { return _mm_loadu_si128(static_cast<const __m128i*>(p)); }
+inline search_vec vec_xor(search_vec a, search_vec b) { return _mm_xor_si128(a, b); }
+inline unsigned vec_mask_bits(search_vec m) { return popcount(static_cast<std::uint32_t>(_mm_movemask_epi8(m))); }
+template <std::size_t S> struct lane_ops;
+template <> struct lane_ops<1> { static search_vec set1(std::int64_t v) { return _mm_set1_epi8(static_cast<char>(v)); } static search_vec gt(search_vec a, search_vec b) { return _mm_cmpgt_epi8(a, b); } };
+template <> struct lane_ops<2> { static search_vec set1(std::int64_t v) { return _mm_set1_epi16(static_cast<short>(v)); } static search_vec gt(search_vec a, search_vec b) { return _mm_cmpgt_epi16(a, b); } };
+template <> struct lane_ops<4> { static search_vec set1(std::int64_t v) { return _mm_set1_epi32(static_cast<int>(v)); } static search_vec gt(search_vec a, search_vec b) { return _mm_cmpgt_epi32(a, b); } };
+#if defined(__SSE4_2__)
+template <> struct lane_ops<8> { static search_vec set1(std::int64_t v) { return _mm_set1_epi64x(static_cast<long long>(v)); } static search_vec gt(search_vec a, search_vec b) { return _mm_cmpgt_epi64(a, b); } };
+#define GOB_STDMAP_SEARCH_HAS_64
+#endif
+#endif
+
+// Number of keys less than (Upper: not greater than) key, a vector at a time
+// Keys are loaded as vectors of the integer type U (the key itself or the underlying type of the enum)
+template <bool Upper, class Key>
+std::size_t count_simd(const Key* p, std::size_t n, const Key& key)
+{
+    using U = typename search_int<Key>::type;
+    constexpr std::size_t S = sizeof(U);
+    constexpr std::size_t lanes = sizeof(search_vec) / S;
+    using ops = lane_ops<S>;
+    // Flip the sign bit so unsigned order becomes signed order
+    const std::int64_t bias = std::is_signed<U>::value ? 0 : static_cast<std::int64_t>(std::uint64_t(1) << (S * 8 - 1));
+    const search_vec vbias = ops::set1(bias);
+    const search_vec vkey = vec_xor(ops::set1(static_cast<std::int64_t>(static_cast<U>(key))), vbias);
+    std::size_t c{}, i{};
+    for(; i + lanes <= n; i += lanes)
+    {
+        auto d = vec_xor(vec_load(p + i), vbias);
+        // Upper counts d > key and subtracts from the lanes
+        c += Upper ? lanes - vec_mask_bits(ops::gt(d, vkey)) / S : vec_mask_bits(ops::gt(vkey, d)) / S;
+    }
+    return c + count_scalar<Upper>(p + i, n - i, key);
+}
+#endif
+
+template <bool Upper, class Key>
+std::size_t count_keys(const Key* p, std::size_t n, const Key& key)
+{
+#if defined(GOB_STDMAP_SEARCH_SSE2) || defined(GOB_STDMAP_SEARCH_AVX2)
+#if defined(GOB_STDMAP_SEARCH_HAS_64)
+    return count_simd<Upper>(p, n, key);
+#else
+    if constexpr(sizeof(Key) < 8) { return count_simd<Upper>(p, n, key); }
+    else { return count_scalar<Upper>(p, n, key); }
+#endif
+#else
+    return count_scalar<Upper>(p, n, key);
+#endif
+}
+
+// Branchless narrowing to the window, then count in the window
+template <bool Upper, class Key>
+std::size_t count_search(const Key* keys, std::size_t n, const Key& key)
+{
+    std::size_t lo{};
+    while(n > GOB_STDMAP_SEARCH_WINDOW)
+    {
+        const std::size_t half = n / 2;
+        lo = (Upper ? !(key < keys[lo + half]) : (keys[lo + half] < key)) ? lo + half : lo;
+        n -= half;
+    }
+    return lo + count_keys<Upper>(keys + lo, n, key);
+}
+
+/*!
+  @brief Index of the first key not less than key
+  @details Integer and enum keys ordered by std::less use the count search, others (and heterogeneous keys) std::lower_bound.
+ */
+template <class Key, class K, class Compare>
+std::size_t lower_bound_index(const Key* keys, std::size_t n, const K& key, const Compare& comp)
+{
+    if constexpr(std::is_same<K, Key>::value && is_count_searchable<Key, Compare>::value) { return count_search<false>(keys, n, key); }
+    else { return static_cast<std::size_t>(std::lower_bound(keys, keys + n, key, comp) - keys); }
+}
+
+/*!
+  @brief Index of the first key greater than key
+  @details Integer and enum keys ordered by std::less use the count search, others (and heterogeneous keys) std::upper_bound.
+ */
+template <class Key, class K, class Compare>
+std::size_t upper_bound_index(const Key* keys, std::size_t n, const K& key, const Compare& comp)
+{
+    if constexpr(std::is_same<K, Key>::value && is_count_searchable<Key, Compare>::value) { return count_search<true>(keys, n, key); }
+    else { return static_cast<std::size_t>(std::upper_bound(keys, keys + n, key, comp) - keys); }
+}
+
+}}
+#endif
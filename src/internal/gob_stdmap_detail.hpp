@@ -0,0 +1,267 @@
+/*!
+  @file gob_stdmap_detail.hpp
+  @brief Internal helpers shared by gob_stdmap containers
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_STDMAP_INTERNAL_DETAIL_HPP
+#define GOB_STDMAP_INTERNAL_DETAIL_HPP
+
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace goblib {
+
+/*!
+  @brief Tag to indicate that the input range is already sorted by key and has no equivalent keys
+  @details Containers skip sorting and deduplication when given this tag.
+ */
+struct sorted_unique_t
+{
+    explicit sorted_unique_t() = default;
+};
+constexpr sorted_unique_t sorted_unique{};
+
+/*!
+  @brief Tag to indicate that the input range is already sorted by key (equivalent keys allowed)
+  @details Multi containers skip sorting when given this tag.
+ */
+struct sorted_equivalent_t
+{
+    explicit sorted_equivalent_t() = default;
+};
+constexpr sorted_equivalent_t sorted_equivalent{};
+
+/*!
+  @brief Whether moving a T and destroying the source is equivalent to copying its bytes
+  @details Containers relocate such elements with memcpy / memmove when they grow or shift,
+  without calling the move constructor, the destructor or the allocator's construct / destroy.
+  True for trivially copyable types, std::unique_ptr with the default deleter, std::shared_ptr
+  and pairs of such types. Specialize it for your own types that hold no pointer into themselves.
+  @code{.cpp}
+  template <> struct goblib::is_trivially_relocatable<my_buffer> : std::true_type {};
+  @endcode
+ */
+template <class T>
+struct is_trivially_relocatable : std::is_trivially_copyable<T>
+{
+};
+template <class T>
+struct is_trivially_relocatable<const T> : is_trivially_relocatable<T>
+{
+};
+template <class T>
+struct is_trivially_relocatable<std::unique_ptr<T>> : std::true_type
+{
+};
+template <class T>
+struct is_trivially_relocatable<std::shared_ptr<T>> : std::true_type
+{
+};
+template <class A, class B>
+struct is_trivially_relocatable<std::pair<A, B>>
+        : std::integral_constant<bool, is_trivially_relocatable<A>::value && is_trivially_relocatable<B>::value>
+{
+};
+
+/*!
+  @class range_view
+  @brief Pair of iterators viewing the elements whose keys are in [lo, hi)
+  @details Returned by range() of the ordered maps. Usable in range-based for and with the standard algorithms.
+  Invalidated together with the iterators of the container.
+ */
+template <class Iterator>
+class range_view
+{
+  public:
+    using iterator = Iterator;
+
+    range_view() = default;
+    range_view(Iterator first, Iterator last) : _first(first), _last(last) {}
+
+    Iterator begin() const { return _first; }
+    Iterator end() const { return _last; }
+    bool empty() const { return _first == _last; }
+    //! @brief Number of elements. O(1) for random access iterators, otherwise linear
+    std::size_t size() const { return static_cast<std::size_t>(std::distance(_first, _last)); }
+
+  private:
+    Iterator _first{}, _last{};
+};
+
+namespace stdmap_detail {
+
+/*!
+  @brief Throw std::out_of_range
+  @note Calls std::abort() if exceptions are disabled (-fno-exceptions)
+ */
+[[noreturn]] inline void throw_out_of_range(const char* what)
+{
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+    throw std::out_of_range(what);
+#else
+    (void)what;
+    std::abort();
+#endif
+}
+
+/*!
+  @brief Throw std::length_error
+  @note Calls std::abort() if exceptions are disabled (-fno-exceptions)
+ */
+[[noreturn]] inline void throw_length_error(const char* what)
+{
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+    throw std::length_error(what);
+#else
+    (void)what;
+    std::abort();
+#endif
+}
+
+/*!
+  @brief Throw std::invalid_argument
+  @note Calls std::abort() if exceptions are disabled (-fno-exceptions)
+ */
+[[noreturn]] inline void throw_invalid_argument(const char* what)
+{
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+    throw std::invalid_argument(what);
+#else
+    (void)what;
+    std::abort();
+#endif
+}
+
+/*!
+  @brief Throw std::bad_array_new_length
+  @note Calls std::abort() if exceptions are disabled (-fno-exceptions)
+ */
+[[noreturn]] inline void throw_bad_array_new_length()
+{
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+    throw std::bad_array_new_length();
+#else
+    std::abort();
+#endif
+}
+
+// Comparator (hasher) declares is_transparent
+template <class C, class = void>
+struct is_transparent : std::false_type
+{
+};
+template <class C>
+struct is_transparent<C, std::void_t<typename C::is_transparent>> : std::true_type
+{
+};
+
+// Enables the heterogeneous lookup overloads
+template <class C>
+using if_transparent = typename std::enable_if<is_transparent<C>::value, std::nullptr_t>::type;
+
+// Enables the heterogeneous erase(K&&). K must not be an iterator, so erase(it) keeps working
+template <class C, class K, class Iterator, class ConstIterator>
+using if_transparent_erase =
+    typename std::enable_if<is_transparent<C>::value && !std::is_convertible<K, Iterator>::value && !std::is_convertible<K, ConstIterator>::value,
+                            std::nullptr_t>::type;
+
+// emplace(key, mapped) whose first argument is a Key: the key can be looked up before the element is constructed in place
+template <class Key, class... Args>
+struct is_key_mapped_args : std::false_type
+{
+};
+template <class Key, class K, class M>
+struct is_key_mapped_args<Key, K, M> : std::is_same<Key, typename std::remove_cv<typename std::remove_reference<K>::type>::type>
+{
+};
+
+// Whether an emplace argument refers into [first, last) of the element storage (the argument itself, or the object a pointer
+// argument points to). Looks into the reference tuples of a piecewise construction
+template <class T>
+bool refers_into(const T& arg, const void* first, const void* last)
+{
+    std::less<const void*> lt;
+    auto in = [&](const void* p) { return !lt(p, first) && lt(p, last); };
+    using pointee = typename std::remove_pointer<T>::type;
+    if constexpr(std::is_pointer<T>::value && std::is_object<pointee>::value && !std::is_volatile<pointee>::value)
+    {
+        if(in(static_cast<const void*>(arg))) { return true; }
+    }
+    return in(static_cast<const void*>(std::addressof(arg)));
+}
+template <class... Ts>
+bool refers_into(const std::tuple<Ts...>& args, const void* first, const void* last)
+{
+    return std::apply([&](const auto&... a) { return (false || ... || refers_into(a, first, last)); }, args);
+}
+// Some of the emplace arguments refer into [first, last), so they would be invalidated by moving the elements there
+template <class... Args>
+bool args_refer_into(const void* first, const void* last, const Args&... args)
+{
+    (void)first;
+    (void)last;
+    return (false || ... || refers_into(args, first, last));
+}
+
+// Assumed cache line size for padding shared data (std::hardware_destructive_interference_size is not portable yet)
+constexpr std::size_t cache_line_size = 64;
+
+//! @brief Hint to bring the cache line containing p into the cache (read)
+inline void prefetch(const void* p)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(p, 0, 3);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#else
+    (void)p;
+#endif
+}
+
+//! @brief Number of consecutive 0 bits from the LSB
+inline unsigned countr_zero(std::uint64_t v)
+{
+    if(!v) { return 64; }
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctzll(v));
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long idx;
+    _BitScanForward64(&idx, v);
+    return static_cast<unsigned>(idx);
+#else
+    unsigned n{};
+    while(!(v & 1)) { v >>= 1; ++n; }
+    return n;
+#endif
+}
+
+//! @brief Number of 1 bits
+inline unsigned popcount(std::uint64_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_popcountll(v));
+#else
+    unsigned n{};
+    for(; v; v &= v - 1) { ++n; }
+    return n;
+#endif
+}
+
+//! @brief Number of consecutive 1 bits from the LSB
+inline unsigned countr_one(std::uint64_t v) { return countr_zero(~v); }
+
+}}
+#endif
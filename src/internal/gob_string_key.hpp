@@ -0,0 +1,90 @@
+/*!
+  @file gob_string_key.hpp
+  @brief Compact string key entry with inline short keys and a cached prefix
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_STDMAP_INTERNAL_STRING_KEY_HPP
+#define GOB_STDMAP_INTERNAL_STRING_KEY_HPP
+
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace goblib { namespace stdmap_detail {
+
+// First 8 chars as a big-endian integer (zero padded), so integer order is lexicographic order
+inline std::uint64_t load_prefix(const char* p, std::size_t n)
+{
+    unsigned char b[8]{};
+    if(n) { std::memcpy(b, p, n < 8 ? n : 8); }  // p may be null for an empty key
+    std::uint64_t v{};
+    for(auto c : b) { v = (v << 8) | c; }
+    return v;
+}
+
+/*
+  16 byte key entry
+  - size <= inline_capacity : bytes holds the whole key (zero padded)
+  - otherwise               : bytes holds the first 8 chars and the 32-bit offset of the whole key in the pool
+  The first 8 bytes are the cached prefix in both cases.
+ */
+struct string_key
+{
+    static constexpr std::size_t inline_capacity = 12;
+
+    char bytes[inline_capacity];
+    std::uint32_t size;
+
+    bool is_inline() const { return size <= inline_capacity; }
+    std::uint64_t prefix() const { return load_prefix(bytes, 8); }
+    std::uint32_t offset() const
+    {
+        std::uint32_t o;
+        std::memcpy(&o, bytes + 8, sizeof(o));
+        return o;
+    }
+    std::string_view view(const char* pool) const
+    {
+        return is_inline() ? std::string_view(bytes, size) : std::string_view(pool + offset(), size);
+    }
+
+    static string_key make_inline(std::string_view s)
+    {
+        string_key k{};
+        if(!s.empty()) { std::memcpy(k.bytes, s.data(), s.size()); }  // data() may be null for an empty key
+        k.size = static_cast<std::uint32_t>(s.size());
+        return k;
+    }
+    static string_key make_pooled(std::string_view s, std::uint32_t offset)
+    {
+        string_key k{};
+        std::memcpy(k.bytes, s.data(), 8);
+        std::memcpy(k.bytes + 8, &offset, sizeof(offset));
+        k.size = static_cast<std::uint32_t>(s.size());
+        return k;
+    }
+};
+static_assert(sizeof(string_key) == 16, "string_key must be 16 bytes");
+
+// Lookup key with its prefix computed once
+struct string_probe
+{
+    explicit string_probe(std::string_view s) : str(s), prefix(load_prefix(s.data(), s.size())) {}
+    std::string_view str;
+    std::uint64_t prefix;
+};
+
+// Three-way compare. Most calls finish on the prefix without touching the pool
+inline int compare_key(const string_key& k, const char* pool, const string_probe& p)
+{
+    const auto kp = k.prefix();
+    if(kp != p.prefix) { return kp < p.prefix ? -1 : 1; }
+    // Equal zero padded prefixes of keys up to 8 chars: the shorter is a prefix of the other
+    if(k.size <= 8 && p.str.size() <= 8) { return (k.size > p.str.size()) - (k.size < p.str.size()); }
+    return k.view(pool).compare(p.str);
+}
+
+}}
+#endif
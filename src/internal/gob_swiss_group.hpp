@@ -0,0 +1,113 @@
+/*!
+  @file gob_swiss_group.hpp
+  @brief Control byte group scanning for open addressing hash tables
+  @copyright 2024 GOB
+  @copyright Licensed under the MIT license. See LICENSE file in the project root for full license information.
+*/
+#ifndef GOB_STDMAP_INTERNAL_SWISS_GROUP_HPP
+#define GOB_STDMAP_INTERNAL_SWISS_GROUP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "gob_stdmap_detail.hpp"
+
+#if !defined(GOB_STDMAP_DISABLE_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define GOB_STDMAP_SWISS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace goblib { namespace stdmap_detail {
+
+/*
+  Control byte per slot
+  - full    : 0b0xxxxxxx (7 bits of the hash, "H2")
+  - empty   : 0b10000000
+  - deleted : 0b11111110
+ */
+using ctrl_t = signed char;
+constexpr ctrl_t ctrl_empty = -128;
+constexpr ctrl_t ctrl_deleted = -2;
+inline bool ctrl_is_full(ctrl_t c) { return c >= 0; }
+
+// Set of slot positions in a group
+template <unsigned Shift>
+class group_bitmask
+{
+  public:
+    explicit group_bitmask(std::uint64_t m) : _mask(m) {}
+    explicit operator bool() const { return _mask != 0; }
+    //! @brief Position of the lowest slot
+    unsigned lowest() const { return countr_zero(_mask) >> Shift; }
+    void clear_lowest() { _mask &= _mask - 1; }
+
+  private:
+    std::uint64_t _mask;
+};
+
+#if defined(GOB_STDMAP_SWISS_SSE2)
+// 16 control bytes at once with SSE2
+struct group_sse2
+{
+    static constexpr std::size_t width = 16;
+    using bitmask = group_bitmask<0>;
+
+    explicit group_sse2(const ctrl_t* p) : _ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) {}
+    bitmask match(ctrl_t h2) const
+    {
+        return bitmask(static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), _ctrl))));
+    }
+    bitmask match_empty() const { return match(ctrl_empty); }
+    // Empty and deleted are the only negative values less than -1
+    bitmask match_empty_or_deleted() const
+    {
+        return bitmask(static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), _ctrl))));
+    }
+
+  private:
+    __m128i _ctrl;
+};
+#endif
+
+// 8 control bytes at once in a 64-bit word (SWAR). Result bits are the MSB of each byte
+struct group_portable
+{
+    static constexpr std::size_t width = 8;
+    using bitmask = group_bitmask<3>;
+
+    explicit group_portable(const ctrl_t* p)
+    {
+        _ctrl = 0;
+        for(unsigned i = 0; i < width; ++i) { _ctrl |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(p[i])) << (i * 8); }
+    }
+    // May report a false positive next to a real match; callers compare the key anyway
+    bitmask match(ctrl_t h2) const
+    {
+        auto x = _ctrl ^ (lsbs * static_cast<std::uint8_t>(h2));
+        return bitmask((x - lsbs) & ~x & msbs);
+    }
+    // MSB set and bit 1 clear
+    bitmask match_empty() const { return bitmask(_ctrl & ~(_ctrl << 6) & msbs); }
+    // MSB set and bit 0 clear
+    bitmask match_empty_or_deleted() const { return bitmask(_ctrl & ~(_ctrl << 7) & msbs); }
+
+  private:
+    static constexpr std::uint64_t lsbs = 0x0101010101010101ULL;
+    static constexpr std::uint64_t msbs = 0x8080808080808080ULL;
+    std::uint64_t _ctrl;
+};
+
+#if defined(GOB_STDMAP_SWISS_SSE2)
+using swiss_group = group_sse2;
+#else
+using swiss_group = group_portable;
+#endif
+
+//! @brief Spread the bits of a (possibly identity) hash value
+inline std::uint64_t mix_hash(std::uint64_t h)
+{
+    h *= 0x9E3779B97F4A7C15ULL;
+    return h ^ (h >> 32);
+}
+
+}}
+#endif
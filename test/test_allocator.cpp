@@ -0,0 +1,126 @@
+/*
+  Unit testing for arena / pool allocators
+*/
+#include <gob_stdmap.hpp>
+#include <gob_allocator.hpp>
+#include <gtest/gtest.h>
+#include <map>
+#include <cstdint>
+#include <new>
+
+using goblib::arena;
+using goblib::arena_allocator;
+using goblib::pool;
+using goblib::pool_allocator;
+
+namespace {
+struct alignas(64) Aligned
+{
+    int v;
+};
+}  // namespace
+
+TEST(Arena, Basic)
+{
+    arena ar(256);
+    auto p = ar.allocate(10, 1);
+    auto q = ar.allocate(sizeof(double), alignof(double));
+    EXPECT_NE(p, nullptr);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(q) % alignof(double), 0U);
+    auto a = ar.allocate(sizeof(Aligned), alignof(Aligned));
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(a) % 64, 0U);
+    auto big = ar.allocate(10000);  // Larger than a block
+    EXPECT_NE(big, nullptr);
+    EXPECT_EQ(ar.used(), 10 + sizeof(double) + sizeof(Aligned) + 10000);
+    ar.release();
+    EXPECT_EQ(ar.used(), 0U);
+}
+
+TEST(Arena, UserBuffer)
+{
+    alignas(std::max_align_t) unsigned char buf[128];
+    arena ar(buf, sizeof(buf));
+    auto p = static_cast<unsigned char*>(ar.allocate(64));
+    EXPECT_TRUE(p >= buf && p < buf + sizeof(buf));
+    auto q = static_cast<unsigned char*>(ar.allocate(128));  // Spills to the heap
+    EXPECT_FALSE(q >= buf && q < buf + sizeof(buf));
+    ar.release();
+    EXPECT_EQ(ar.allocate(8), buf);
+}
+
+TEST(Arena, FlatMap)
+{
+    arena ar;
+    using alloc_t = arena_allocator<std::pair<int, int>>;
+    goblib::flat_map<int, int, std::less<int>, alloc_t> m{ alloc_t(ar) };
+    m.reserve(100);
+    for(int i = 0; i < 100; ++i) { m[99 - i] = i; }
+    EXPECT_EQ(m.size(), 100U);
+    EXPECT_EQ(m.begin()->first, 0);
+    EXPECT_EQ(&m.get_allocator().resource(), &ar);
+    EXPECT_GE(ar.used(), 100 * sizeof(std::pair<int, int>));
+
+    auto copy = m;
+    EXPECT_EQ(copy, m);
+
+    using kalloc_t = arena_allocator<int>;
+    goblib::soa_flat_map<int, double, std::less<int>, kalloc_t, arena_allocator<double>> s{ std::less<int>{}, kalloc_t(ar),
+                                                                                          arena_allocator<double>(ar) };
+    s[1] = 1.0;
+    s[0] = 0.5;
+    EXPECT_EQ(s.begin()->second, 0.5);
+}
+
+TEST(Arena, Overflow)
+{
+    // The byte count of n elements (plus alignment and block header) must not wrap to a small allocation
+    arena ar(256);
+    arena_allocator<Aligned> a(ar);
+    EXPECT_EQ(a.max_size(), SIZE_MAX / sizeof(Aligned));
+    EXPECT_THROW(a.allocate(a.max_size() + 1), std::bad_array_new_length);
+    EXPECT_THROW(a.allocate(SIZE_MAX / 2), std::bad_array_new_length);
+    EXPECT_THROW(ar.allocate(SIZE_MAX - 8), std::bad_array_new_length);
+    EXPECT_EQ(ar.used(), 0U);
+
+    pool pl(sizeof(Aligned), 4, alignof(Aligned));
+    pool_allocator<Aligned> b(pl);
+    EXPECT_THROW(b.allocate(b.max_size() + 1), std::bad_array_new_length);
+}
+
+TEST(Pool, Basic)
+{
+    pool pl(24, 4);
+    EXPECT_GE(pl.block_size(), 24U);
+    void* p[10];
+    for(auto& e : p) { e = pl.allocate(); }
+    EXPECT_EQ(pl.in_use(), 10U);
+    pl.deallocate(p[3]);
+    EXPECT_EQ(pl.allocate(), p[3]);  // Freed slot is reused
+    for(auto& e : p) { pl.deallocate(e); }
+    EXPECT_EQ(pl.in_use(), 0U);
+
+    pool apl(sizeof(Aligned), 4, alignof(Aligned));
+    for(int i = 0; i < 8; ++i) { EXPECT_EQ(reinterpret_cast<std::uintptr_t>(apl.allocate()) % 64, 0U); }
+}
+
+TEST(Pool, NodeContainer)
+{
+    pool pl(64);
+    using alloc_t = pool_allocator<std::pair<const int, int>>;
+    {
+        std::map<int, int, std::less<int>, alloc_t> m{ alloc_t(pl) };
+        for(int i = 0; i < 1000; ++i) { m[i] = i; }
+        EXPECT_EQ(pl.in_use(), 1000U);
+        for(int i = 0; i < 1000; i += 2) { m.erase(i); }
+        EXPECT_EQ(pl.in_use(), 500U);
+        for(int i = 0; i < 1000; i += 2) { m[i] = i; }
+        EXPECT_EQ(pl.in_use(), 1000U);
+    }
+    EXPECT_EQ(pl.in_use(), 0U);
+
+    // Arrays go to the global heap
+    using valloc_t = pool_allocator<std::pair<int, int>>;
+    goblib::flat_map<int, int, std::less<int>, valloc_t> fm{ valloc_t(pl) };
+    for(int i = 0; i < 100; ++i) { fm[i] = i; }
+    EXPECT_EQ(fm.at(50), 50);
+}
@@ -0,0 +1,427 @@
+/*
+  Unit testing for art_map
+*/
+#include <gob_stdmap.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using goblib::art_map;
+
+namespace {
+// Compare all elements in both directions
+template <class M, class R>
+void expect_same(const M& m, const R& ref)
+{
+    ASSERT_EQ(m.size(), ref.size());
+    EXPECT_TRUE(std::equal(m.begin(), m.end(), ref.begin(), ref.end(),
+                           [](auto& a, auto& b) { return a.first == b.first && a.second == b.second; }));
+    EXPECT_TRUE(std::equal(m.rbegin(), m.rend(), ref.rbegin(), ref.rend(),
+                           [](auto& a, auto& b) { return a.first == b.first && a.second == b.second; }));
+}
+
+// Random insert / erase / bounds against std::map. make_key maps a random number to a key
+template <class Key, class MakeKey>
+void fuzz(std::uint32_t seed, int ops, MakeKey make_key)
+{
+    art_map<Key, int> m;
+    std::map<Key, int> ref;
+    std::mt19937 rng(seed);
+    for(int i = 0; i < ops; ++i)
+    {
+        auto k = make_key(rng);
+        switch(rng() % 7)
+        {
+        case 0:
+        case 1:
+        case 2:
+            EXPECT_EQ(m.try_emplace(k, i).second, ref.try_emplace(k, i).second);
+            break;
+        case 3:
+            EXPECT_EQ(m.erase(k), ref.erase(k));
+            break;
+        case 4:
+        {
+            auto it = m.lower_bound(k);
+            auto rit = ref.lower_bound(k);
+            ASSERT_EQ(it == m.end(), rit == ref.end());
+            if(it != m.end())
+            {
+                EXPECT_EQ(it->first, rit->first);
+                it = m.erase(it);
+                rit = ref.erase(rit);
+                ASSERT_EQ(it == m.end(), rit == ref.end());
+                if(it != m.end()) { EXPECT_EQ(it->first, rit->first); }
+            }
+            break;
+        }
+        case 5:
+        {
+            auto it = m.upper_bound(k);
+            auto rit = ref.upper_bound(k);
+            ASSERT_EQ(it == m.end(), rit == ref.end());
+            if(it != m.end()) { EXPECT_EQ(it->first, rit->first); }
+            break;
+        }
+        default:
+        {
+            auto it = m.find(k);
+            auto rit = ref.find(k);
+            ASSERT_EQ(it == m.end(), rit == ref.end());
+            if(it != m.end()) { EXPECT_EQ(it->second, rit->second); }
+            break;
+        }
+        }
+    }
+    expect_same(m, ref);
+    while(!ref.empty())
+    {
+        auto k = std::next(ref.begin(), static_cast<std::ptrdiff_t>(rng() % ref.size()))->first;
+        ASSERT_EQ(m.erase(k), 1u);
+        ref.erase(k);
+    }
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.begin(), m.end());
+}
+
+// Path like strings over a small alphabet: many shared prefixes, keys that are prefixes of others
+std::string path_key(std::mt19937& rng)
+{
+    static const char* parts[] = { "/", "a", "api", "v1", "users", "x" };
+    std::string s;
+    for(auto n = rng() % 5; n-- > 0;) { s += parts[rng() % 6]; }
+    return s;
+}
+
+// Throws on the construction from a negative value
+struct block
+{
+    int v{};
+    block() = default;
+    explicit block(int x) : v(x)
+    {
+        if(x < 0) { throw std::runtime_error("block"); }
+    }
+};
+
+// Allocation fails while fail_allocation is set
+bool fail_allocation{};
+template <class T>
+struct failing_allocator
+{
+    using value_type = T;
+    failing_allocator() = default;
+    template <class U>
+    failing_allocator(const failing_allocator<U>&) {}
+    T* allocate(std::size_t n)
+    {
+        if(fail_allocation) { throw std::bad_alloc(); }
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* p, std::size_t n) { std::allocator<T>().deallocate(p, n); }
+    template <class U>
+    bool operator==(const failing_allocator<U>&) const { return true; }
+    template <class U>
+    bool operator!=(const failing_allocator<U>&) const { return false; }
+};
+}
+
+TEST(ArtMap, Basic)
+{
+    art_map<std::string, int> m = { { "banana", 2 }, { "apple", 1 }, { "cherry", 3 } };
+    EXPECT_EQ(m.size(), 3u);
+    EXPECT_EQ(m.begin()->first, "apple");
+    EXPECT_EQ(m.at("cherry"), 3);
+    EXPECT_THROW(m.at("durian"), std::out_of_range);
+    m["durian"] = 4;
+    EXPECT_EQ(m.rbegin()->first, "durian");
+    EXPECT_TRUE(m.contains(std::string_view("banana")));
+    EXPECT_FALSE(m.insert({ "apple", 9 }).second);
+    EXPECT_TRUE(m.insert_or_assign("apple", 10).second == false);
+    EXPECT_EQ(m.at("apple"), 10);
+    EXPECT_TRUE(m.emplace(std::make_pair(std::string("app"), 5)).second);
+    EXPECT_EQ(m.begin()->first, "app");
+    EXPECT_EQ(m.erase("apple"), 1u);
+    EXPECT_EQ(m.erase("apple"), 0u);
+    EXPECT_EQ(m.find("app")->second, 5);
+
+    // Other elements stay where they are
+    auto* p = &m.at("banana");
+    for(int i = 0; i < 1000; ++i) { m.try_emplace("banana" + std::to_string(i), i); }
+    EXPECT_EQ(p, &m.at("banana"));
+    EXPECT_EQ(goblib::erase_if(m, [](auto& e) { return e.first.size() > 6; }), 1000u);
+    EXPECT_EQ(p, &m.at("banana"));
+
+    // Empty key
+    m[""] = -1;
+    EXPECT_EQ(m.begin()->first, "");
+    EXPECT_EQ(m.erase(""), 1u);
+
+    art_map<std::string, int> c(m);
+    EXPECT_EQ(c, m);
+    art_map<std::string, int> mv(std::move(c));
+    EXPECT_EQ(mv, m);
+    EXPECT_TRUE(c.empty());
+    c = mv;
+    c["zzz"] = 0;
+    EXPECT_LT(m, c);
+    swap(c, mv);
+    EXPECT_EQ(mv.rbegin()->first, "zzz");
+    EXPECT_EQ(std::prev(c.end())->first, "durian");
+    mv.clear();
+    EXPECT_TRUE(mv.empty());
+    EXPECT_EQ(mv.begin(), mv.end());
+}
+
+TEST(ArtMap, IntegerKeys)
+{
+    // Signed keys iterate in numeric order
+    art_map<int, int> m;
+    std::vector<int> keys = { 0, -1, 1, -256, 255, 256, INT32_MIN, INT32_MAX, 65536, -65536 };
+    for(auto k : keys) { m[k] = k; }
+    std::sort(keys.begin(), keys.end());
+    EXPECT_TRUE(std::equal(m.begin(), m.end(), keys.begin(), keys.end(), [](auto& a, int b) { return a.first == b; }));
+    EXPECT_EQ(m.lower_bound(2)->first, 255);
+    EXPECT_EQ(m.upper_bound(-256)->first, -1);
+
+    art_map<std::uint8_t, int> small;
+    for(int i = 255; i >= 0; --i) { small[static_cast<std::uint8_t>(i)] = i; }
+    EXPECT_EQ(small.size(), 256u);
+    EXPECT_EQ(small.begin()->first, 0);
+    EXPECT_EQ(small.rbegin()->first, 255);
+}
+
+TEST(ArtMap, CompatibleWithStdMap)
+{
+    for(std::uint32_t seed = 0; seed < 4; ++seed)
+    {
+        // Dense integers fill node256, sparse ones keep node4 and node16 with compressed prefixes
+        fuzz<std::uint32_t>(seed, 20000, [](std::mt19937& rng) { return static_cast<std::uint32_t>(rng() % 3000); });
+        fuzz<std::uint32_t>(seed, 20000, [](std::mt19937& rng) { return static_cast<std::uint32_t>(rng()); });
+        fuzz<std::int64_t>(seed, 20000, [](std::mt19937& rng) { return static_cast<std::int64_t>(rng() % 2000) - 1000; });
+        fuzz<std::string>(seed, 20000, path_key);
+    }
+    // Long shared prefixes beyond the bytes stored in a node
+    fuzz<std::string>(9, 20000, [](std::mt19937& rng) {
+        std::string s(20, 'p');
+        s[rng() % 20] = 'q';
+        s += std::to_string(rng() % 50);
+        return s.substr(0, 12 + rng() % 12);
+    });
+}
+
+TEST(ArtMap, NodeGrowthAndShrink)
+{
+    // Children of one node pass every size boundary up and down
+    art_map<std::string, int> m;
+    std::map<std::string, int> ref;
+    for(int c = 0; c < 256; ++c)
+    {
+        std::string k = "k" + std::string(1, static_cast<char>(c));
+        m[k] = c;
+        ref[k] = c;
+        ASSERT_EQ(m.lower_bound("k" + std::string(1, static_cast<char>(c)))->second, c);
+    }
+    expect_same(m, ref);
+    for(int c = 255; c >= 0; c -= 2)
+    {
+        std::string k = "k" + std::string(1, static_cast<char>(c));
+        m.erase(k);
+        ref.erase(k);
+    }
+    expect_same(m, ref);
+    for(int c = 0; c < 256; c += 2)
+    {
+        std::string k = "k" + std::string(1, static_cast<char>(c));
+        m.erase(k);
+        ref.erase(k);
+        expect_same(m, ref);
+    }
+    EXPECT_TRUE(m.empty());
+}
+
+TEST(ArtMap, EraseWithoutAllocation)
+{
+    // Erasure does not throw when the smaller node cannot be allocated: the node keeps its size
+    art_map<std::string, int, failing_allocator<std::pair<const std::string, int>>> m;
+    std::map<std::string, int> ref;
+    auto key = [](int c) { return "k" + std::string(1, static_cast<char>(c)); };
+    for(int c = 0; c < 256; ++c) { m[key(c)] = ref[key(c)] = c; }
+    fail_allocation = true;
+    for(int c = 255; c >= 3; --c)
+    {
+        EXPECT_NO_THROW(m.erase(key(c)));
+        ref.erase(key(c));
+    }
+    fail_allocation = false;
+    expect_same(m, ref);
+    // The oversized node still grows, and shrinks once allocation works again
+    for(int c = 100; c < 120; ++c) { m[key(c)] = ref[key(c)] = c; }
+    expect_same(m, ref);
+    for(int c = 119; c >= 100; --c)
+    {
+        m.erase(key(c));
+        ref.erase(key(c));
+    }
+    expect_same(m, ref);
+
+    // A node16 kept at 3 children shrinks to a node4 of 2
+    m.clear();
+    ref.clear();
+    for(int c = 0; c < 16; ++c) { m[key(c)] = ref[key(c)] = c; }
+    fail_allocation = true;
+    for(int c = 15; c >= 3; --c)
+    {
+        EXPECT_NO_THROW(m.erase(key(c)));
+        ref.erase(key(c));
+    }
+    fail_allocation = false;
+    m.erase(key(2));
+    ref.erase(key(2));
+    expect_same(m, ref);
+    m[key(9)] = ref[key(9)] = 9;
+    expect_same(m, ref);
+}
+
+TEST(ArtMap, PrefixQuery)
+{
+    art_map<std::string, int> routes;
+    for(const char* p : { "/", "/api", "/api/", "/api/users", "/api/users/", "/apix", "/static/", "/static/css/" })
+    {
+        routes[p] = static_cast<int>(routes.size());
+    }
+    auto keys = [](auto r) {
+        std::vector<std::string> v;
+        for(auto& e : r) { v.push_back(e.first); }
+        return v;
+    };
+    EXPECT_EQ(keys(routes.prefix_range("/api/")), (std::vector<std::string>{ "/api/", "/api/users", "/api/users/" }));
+    EXPECT_EQ(keys(routes.prefix_range("/api")),
+              (std::vector<std::string>{ "/api", "/api/", "/api/users", "/api/users/", "/apix" }));
+    EXPECT_EQ(keys(routes.prefix_range("/st")), (std::vector<std::string>{ "/static/", "/static/css/" }));
+    EXPECT_EQ(routes.prefix_range("").size(), routes.size());
+    EXPECT_TRUE(routes.prefix_range("/b").empty());
+    EXPECT_TRUE(routes.prefix_range("/api/users/x").empty());
+
+    EXPECT_EQ(routes.longest_prefix("/api/users/42")->first, "/api/users/");
+    EXPECT_EQ(routes.longest_prefix("/api/users")->first, "/api/users");
+    EXPECT_EQ(routes.longest_prefix("/api/user")->first, "/api/");
+    EXPECT_EQ(routes.longest_prefix("/apiv2")->first, "/api");
+    EXPECT_EQ(routes.longest_prefix("/static/js/app.js")->first, "/static/");
+    EXPECT_EQ(routes.longest_prefix("/other")->first, "/");
+    EXPECT_EQ(routes.longest_prefix("other"), routes.end());
+
+    // Against a scan of std::map
+    std::map<std::string, int> ref;
+    art_map<std::string, int> m;
+    std::mt19937 rng(3);
+    for(int i = 0; i < 3000; ++i)
+    {
+        auto k = path_key(rng);
+        m[k] = i;
+        ref[k] = i;
+    }
+    for(int i = 0; i < 2000; ++i)
+    {
+        auto q = path_key(rng) + path_key(rng);
+        auto r = m.prefix_range(q);
+        auto first = ref.lower_bound(q);
+        auto last = std::find_if(first, ref.end(), [&](auto& e) { return e.first.compare(0, q.size(), q) != 0; });
+        ASSERT_EQ(r.size(), static_cast<std::size_t>(std::distance(first, last))) << q;
+        if(!r.empty()) { EXPECT_EQ(r.begin()->first, first->first); }
+
+        std::string best;
+        bool found{};
+        for(std::size_t n = 0; n <= q.size(); ++n)
+        {
+            if(ref.count(q.substr(0, n)))
+            {
+                best = q.substr(0, n);
+                found = true;
+            }
+        }
+        auto it = m.longest_prefix(q);
+        ASSERT_EQ(it != m.end(), found) << q;
+        if(found) { EXPECT_EQ(it->first, best); }
+    }
+
+    // CIDR blocks over IPv4 addresses
+    art_map<std::uint32_t, int> table;
+    for(std::uint32_t a : { 0x0A000001u, 0xC0A80001u, 0xC0A80101u, 0xC0A90001u, 0xC0A800FFu }) { table[a] = 0; }
+    EXPECT_EQ(table.prefix_range(0xC0A80000u, 16).size(), 3u);
+    EXPECT_EQ(table.prefix_range(0xC0A80000u, 24).size(), 2u);
+    EXPECT_EQ(table.prefix_range(0xC0A80000u, 8).size(), 4u);
+    EXPECT_EQ(table.prefix_range(0u, 0).size(), 5u);
+    EXPECT_EQ(table.prefix_range(0x0A000001u, 32).size(), 1u);
+    EXPECT_TRUE(table.prefix_range(0x0B000000u, 8).empty());
+    art_map<std::int8_t, int> neg;
+    for(int i = -128; i < 128; ++i) { neg[static_cast<std::int8_t>(i)] = i; }
+    // The leading bit of the offset binary value splits negative and non negative keys
+    EXPECT_EQ(neg.prefix_range(-5, 1).begin()->first, -128);
+    EXPECT_EQ(neg.prefix_range(-5, 1).size(), 128u);
+    EXPECT_EQ(neg.prefix_range(5, 1).begin()->first, 0);
+}
+
+TEST(ArtMap, Merge)
+{
+    art_map<std::string, int> a = { { "a", 1 }, { "ab", 2 } };
+    art_map<std::string, int> b = { { "ab", 20 }, { "abc", 30 }, { "b", 40 } };
+    a.merge(b);
+    EXPECT_EQ(a.size(), 4u);
+    EXPECT_EQ(a.at("ab"), 2);
+    EXPECT_EQ(a.at("abc"), 30);
+    ASSERT_EQ(b.size(), 1u);
+    EXPECT_EQ(b.begin()->first, "ab");
+}
+
+TEST(ArtMap, PolymorphicAllocator)
+{
+    // Allocators that propagate on neither copy, move nor swap
+    using map = art_map<std::string, int, std::pmr::polymorphic_allocator<std::pair<const std::string, int>>>;
+    std::pmr::monotonic_buffer_resource r1, r2;
+    map a(&r1);
+    map b(&r2);
+    for(int i = 0; i < 100; ++i) { a.try_emplace(std::to_string(i), i); }
+    b = a;
+    EXPECT_EQ(b.get_allocator().resource(), &r2);
+    EXPECT_EQ(b, a);
+
+    // Unequal allocators: the elements move into nodes of this allocator
+    map c(&r1);
+    c.try_emplace("x", -1);
+    c = std::move(b);
+    EXPECT_EQ(c.get_allocator().resource(), &r1);
+    EXPECT_EQ(c, a);
+    EXPECT_TRUE(b.empty());
+    map d(&r1);
+    swap(c, d);
+    EXPECT_EQ(d, a);
+    EXPECT_TRUE(c.empty());
+}
+
+TEST(ArtMap, ThrowingConstruction)
+{
+    art_map<std::string, block> m;
+    std::map<std::string, int> ref;
+    std::mt19937 rng(7);
+    for(int i = 0; i < 3000; ++i)
+    {
+        auto k = path_key(rng);
+        if(i % 3 == 0 && !ref.count(k)) { EXPECT_THROW(m.try_emplace(k, -1), std::runtime_error); }
+        else if(m.try_emplace(k, i).second) { ref.emplace(k, i); }
+    }
+    ASSERT_EQ(m.size(), ref.size());
+    EXPECT_TRUE(std::equal(m.begin(), m.end(), ref.begin(), ref.end(),
+                           [](auto& a, auto& b) { return a.first == b.first && a.second.v == b.second; }));
+}
@@ -0,0 +1,401 @@
+/*
+  Unit testing for btree_map
+*/
+#include <gob_stdmap.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <memory_resource>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using goblib::btree_map;
+
+namespace {
+// Compare all elements in both directions
+template <class M, class R>
+void expect_same(const M& m, const R& ref)
+{
+    ASSERT_EQ(m.size(), ref.size());
+    EXPECT_TRUE(std::equal(m.begin(), m.end(), ref.begin(), ref.end(),
+                           [](auto& a, auto& b) { return a.first == b.first && a.second == b.second; }));
+    EXPECT_TRUE(std::equal(m.rbegin(), m.rend(), ref.rbegin(), ref.rend(),
+                           [](auto& a, auto& b) { return a.first == b.first && a.second == b.second; }));
+}
+
+// Random insert / erase against std::map
+template <class M>
+void fuzz(std::uint32_t seed, int ops, std::uint32_t range)
+{
+    M m;
+    std::map<std::uint32_t, std::string> ref;
+    std::mt19937 rng(seed);
+    for(int i = 0; i < ops; ++i)
+    {
+        auto k = static_cast<std::uint32_t>(rng() % range);
+        switch(rng() % 6)
+        {
+        case 0:
+        case 1:
+        case 2:
+            EXPECT_EQ(m.try_emplace(k, std::to_string(k)).second, ref.try_emplace(k, std::to_string(k)).second);
+            break;
+        case 3:
+            EXPECT_EQ(m.erase(k), ref.erase(k));
+            break;
+        case 4:
+        {
+            auto it = m.lower_bound(k);
+            auto rit = ref.lower_bound(k);
+            ASSERT_EQ(it == m.end(), rit == ref.end());
+            if(it != m.end())
+            {
+                EXPECT_EQ(it->first, rit->first);
+                it = m.erase(it);
+                rit = ref.erase(rit);
+                ASSERT_EQ(it == m.end(), rit == ref.end());
+                if(it != m.end()) { EXPECT_EQ(it->first, rit->first); }
+            }
+            break;
+        }
+        default:
+            EXPECT_EQ(m.contains(k), ref.count(k) == 1);
+            break;
+        }
+    }
+    expect_same(m, ref);
+    while(!m.empty())
+    {
+        auto k = m.begin()->first;
+        EXPECT_EQ(m.erase(k), 1U);
+    }
+    EXPECT_EQ(m.begin(), m.end());
+    EXPECT_EQ(m.height(), 0U);
+}
+}  // namespace
+
+TEST(BtreeMap, Basic)
+{
+    btree_map<int, std::string> m;
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.begin(), m.end());
+    EXPECT_EQ(m.find(1), m.end());
+
+    EXPECT_TRUE(m.insert({ 2, "two" }).second);
+    EXPECT_FALSE(m.insert({ 2, "zwei" }).second);
+    m.emplace(1, "one");
+    m.try_emplace(3, "three");
+    m[4] = "four";
+    EXPECT_EQ(m.size(), 4U);
+    EXPECT_EQ(m.at(2), "two");
+    EXPECT_THROW(m.at(5), std::out_of_range);
+    EXPECT_FALSE(m.insert_or_assign(4, "FOUR").second);
+    EXPECT_EQ(m[4], "FOUR");
+
+    int i = 1;
+    for(auto& e : m) { EXPECT_EQ(e.first, i++); }
+    EXPECT_EQ(m.lower_bound(0)->first, 1);
+    EXPECT_EQ(m.upper_bound(3)->first, 4);
+    EXPECT_EQ(m.upper_bound(4), m.end());
+    auto r = m.equal_range(3);
+    EXPECT_EQ(std::distance(r.first, r.second), 1);
+    EXPECT_EQ(std::prev(m.end())->first, 4);
+
+    EXPECT_EQ(m.erase(5), 0U);
+    EXPECT_EQ(m.erase(1), 1U);
+    EXPECT_EQ(m.erase(m.begin())->first, 3);
+    EXPECT_EQ(m.size(), 2U);
+
+    btree_map<int, std::string> c(m);
+    EXPECT_EQ(c, m);
+    c[0] = "zero";
+    EXPECT_NE(c, m);
+    EXPECT_LT(c, m);
+    auto moved = std::move(c);
+    EXPECT_TRUE(c.empty());
+    EXPECT_EQ(moved.size(), 3U);
+    m.clear();
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.begin(), m.end());
+}
+
+TEST(BtreeMap, NodeLayout)
+{
+    using map = btree_map<std::uint64_t, std::uint64_t>;
+    EXPECT_GE(map::leaf_capacity, 12U);
+    EXPECT_GE(map::internal_capacity, 12U);
+    EXPECT_EQ((btree_map<std::uint64_t, std::uint64_t, std::less<>, std::allocator<std::pair<std::uint64_t, std::uint64_t>>, 4096>::leaf_capacity), 254U);
+    // Large elements still get 3 per node
+    EXPECT_EQ((btree_map<int, std::array<char, 1000>>::leaf_capacity), 3U);
+
+    // Ascending insertion fills the leaves and keeps the tree shallow
+    map m;
+    for(std::uint64_t i = 0; i < 100000; ++i) { m.emplace(i, i); }
+    EXPECT_LE(m.height(), 5U);
+    for(std::uint64_t i = 0; i < 100000; i += 7) { EXPECT_EQ(m.at(i), i); }
+}
+
+TEST(BtreeMap, CompatibleWithStdMap)
+{
+    fuzz<btree_map<std::uint32_t, std::string>>(1, 20000, 3000);
+    // Smallest nodes give deep trees and exercise every split, borrow and merge path
+    fuzz<btree_map<std::uint32_t, std::string, std::less<std::uint32_t>, std::allocator<std::pair<std::uint32_t, std::string>>, 64>>(
+        2, 20000, 1000);
+    fuzz<btree_map<std::uint32_t, std::string, std::less<std::uint32_t>, std::allocator<std::pair<std::uint32_t, std::string>>, 64>>(
+        3, 5000, 100000);
+}
+
+TEST(BtreeMap, Bulk)
+{
+    std::vector<std::pair<std::string, int>> src;
+    for(int i = 0; i < 5000; ++i) { src.emplace_back("key" + std::to_string(10000 + i), i); }
+    btree_map<std::string, int> m(goblib::sorted_unique, src.begin(), src.end());
+    expect_same(m, src);
+    for(auto& e : src) { EXPECT_EQ(m.at(e.first), e.second); }
+    // Remove all but a few from the middle (merges up to the root)
+    auto first = m.find("key10010");
+    auto it = m.erase(first, m.find("key14990"));
+    EXPECT_EQ(it->first, "key14990");
+    EXPECT_EQ(m.size(), 20U);
+    EXPECT_EQ(goblib::erase_if(m, [](const auto& e) { return e.second % 2; }), 10U);
+    EXPECT_EQ(m.size(), 10U);
+
+    // Unsorted range
+    std::vector<std::pair<int, int>> v = { { 5, 0 }, { 1, 0 }, { 3, 0 }, { 1, 1 } };
+    btree_map<int, int> u(v.begin(), v.end());
+    EXPECT_EQ(u.size(), 3U);
+    EXPECT_EQ(u.at(1), 0);
+}
+
+TEST(BtreeMap, Merge)
+{
+    btree_map<int, std::string> a = { { 1, "a1" }, { 3, "a3" } };
+    btree_map<int, std::string> b = { { 1, "b1" }, { 2, "b2" }, { 4, "b4" } };
+    a.merge(b);
+    EXPECT_EQ(a.size(), 4U);
+    EXPECT_EQ(a.at(1), "a1");
+    EXPECT_EQ(a.at(2), "b2");
+    ASSERT_EQ(b.size(), 1U);
+    EXPECT_EQ(b.begin()->second, "b1");
+}
+
+TEST(BtreeMap, HeterogeneousLookup)
+{
+    btree_map<std::string, int, std::less<>> m = { { "apple", 1 }, { "banana", 2 } };
+    EXPECT_EQ(m.find(std::string_view("banana"))->second, 2);
+    EXPECT_TRUE(m.contains("apple"));
+    EXPECT_EQ(m.lower_bound(std::string_view("b"))->first, "banana");
+    EXPECT_EQ(m.erase(std::string_view("apple")), 1U);
+    EXPECT_EQ(m.size(), 1U);
+}
+
+namespace {
+// Move-only, over-aligned value which counts its moves
+struct alignas(64) block
+{
+    static inline int moves = 0;
+    explicit block(int n) : v(n)
+    {
+        if(n < 0) { throw std::runtime_error("block"); }
+    }
+    block(block&& o) noexcept : v(o.v) { ++moves; }
+    block& operator=(block&& o) noexcept
+    {
+        v = o.v;
+        ++moves;
+        return *this;
+    }
+    int v;
+};
+struct relocatable_block : block
+{
+    using block::block;
+};
+}  // namespace
+
+template <>
+struct goblib::is_trivially_relocatable<relocatable_block> : std::true_type
+{
+};
+
+TEST(BtreeMap, InPlaceEmplace)
+{
+    btree_map<int, block> m;
+    block::moves = 0;
+    for(int i = 0; i < 1000; ++i) { m.try_emplace(i * 7 % 1000, i); }
+    // Shifts and splits move the elements
+    EXPECT_GT(block::moves, 0);
+    for(auto& e : m) { EXPECT_EQ(reinterpret_cast<std::uintptr_t>(&e.second) % 64, 0U); }
+
+    // Relocatable elements are memmoved, and new ones are built in place
+    btree_map<int, relocatable_block> r;
+    block::moves = 0;
+    for(int i = 0; i < 1000; ++i)
+    {
+        r.try_emplace(i * 7 % 1000, i);
+        r.emplace(1000 + i, i);
+        r.insert_or_assign(2000 + i, relocatable_block(i));
+    }
+    EXPECT_EQ(block::moves, 1000);  // Only the insert_or_assign arguments
+    EXPECT_EQ(r.size(), 3000U);
+    for(int i = 0; i < 1000; ++i) { EXPECT_EQ(r.at(i * 7 % 1000).v, i); }
+    while(r.size() > 10) { r.erase(r.begin()); }
+    EXPECT_EQ(block::moves, 1000);
+    EXPECT_EQ(r.begin()->first, 2990);
+}
+
+TEST(BtreeMap, AliasedArguments)
+{
+    // Arguments referring to an element that is relocated by the shift or the split of its leaf
+    btree_map<int, std::string> m{ { 1, "one" }, { 3, "three" }, { 5, std::string(40, 'x') } };
+    EXPECT_TRUE(m.try_emplace(2, m.at(3)).second);
+    EXPECT_TRUE(m.insert_or_assign(0, m.at(5)).second);
+    EXPECT_TRUE(m.try_emplace(-1, m.at(1).c_str()).second);
+    EXPECT_EQ(m.at(2), "three");
+    EXPECT_EQ(m.at(0), std::string(40, 'x'));
+    EXPECT_EQ(m.at(-1), "one");
+    for(int i = 10; i < 1000; i += 2) { m.try_emplace(i, std::to_string(i)); }
+    for(int i = 11; i < 1000; i += 2) { ASSERT_TRUE(m.try_emplace(i, m.at(i - 1)).second); }
+    for(int i = 11; i < 1000; i += 2) { ASSERT_EQ(m.at(i), std::to_string(i - 1)); }
+    EXPECT_EQ(m.at(3), "three");
+}
+
+TEST(BtreeMap, ThrowingConstruction)
+{
+    // Small nodes, so the failing insertions hit both the plain and the splitting path
+    btree_map<int, block, std::less<int>, std::allocator<std::pair<int, block>>, 64> m;
+    std::map<int, int> ref;
+    std::mt19937 rng(7);
+    for(int i = 0; i < 2000; ++i)
+    {
+        auto k = static_cast<int>(rng() % 4000);
+        if(i % 3 == 0 && !ref.count(k)) { EXPECT_THROW(m.try_emplace(k, -1), std::runtime_error); }
+        else if(m.try_emplace(k, k).second) { ref.emplace(k, k); }
+    }
+    ASSERT_EQ(m.size(), ref.size());
+    EXPECT_TRUE(std::equal(m.begin(), m.end(), ref.begin(), ref.end(),
+                           [](auto& a, auto& b) { return a.first == b.first && a.second.v == b.second; }));
+}
+
+namespace {
+// Key whose copy throws while fail is set. Moves never throw
+struct fragile_key
+{
+    static inline bool fail = false;
+    int v;
+    explicit fragile_key(int n) : v(n) {}
+    fragile_key(const fragile_key& o) : v(o.v)
+    {
+        if(fail) { throw std::runtime_error("fragile_key"); }
+    }
+    fragile_key(fragile_key&& o) noexcept : v(o.v) {}
+    fragile_key& operator=(const fragile_key&) = default;
+    fragile_key& operator=(fragile_key&&) noexcept = default;
+    bool operator<(const fragile_key& o) const { return v < o.v; }
+};
+}  // namespace
+
+TEST(BtreeMap, ThrowingSeparatorCopy)
+{
+    // A split copies the first key of the new leaf as the separator. If that throws, the tree is unchanged
+    btree_map<fragile_key, int, std::less<fragile_key>, std::allocator<std::pair<const fragile_key, int>>, 64> m;
+    std::map<int, int> ref;
+    std::mt19937 rng(3);
+    int failed{};
+    for(int i = 0; i < 2000; ++i)
+    {
+        auto k = static_cast<int>(rng() % 4000);
+        fragile_key::fail = i % 2 == 0;
+        try
+        {
+            if(m.try_emplace(fragile_key(k), k).second) { ref.emplace(k, k); }
+        }
+        catch(const std::runtime_error&)
+        {
+            ++failed;
+        }
+        fragile_key::fail = false;
+    }
+    EXPECT_GT(failed, 0);
+    ASSERT_EQ(m.size(), ref.size());
+    EXPECT_TRUE(std::equal(m.begin(), m.end(), ref.begin(), ref.end(),
+                           [](auto& a, auto& b) { return a.first.v == b.first && a.second == b.second; }));
+    for(auto& e : ref) { ASSERT_EQ(m.at(fragile_key(e.first)), e.second); }
+}
+
+TEST(BtreeMap, PolymorphicAllocator)
+{
+    // Allocators that propagate on neither copy, move nor swap
+    using map = btree_map<int, std::string, std::less<int>, std::pmr::polymorphic_allocator<std::pair<const int, std::string>>>;
+    std::pmr::monotonic_buffer_resource r1, r2;
+    map a(&r1);
+    map b(&r2);
+    for(int i = 0; i < 1000; ++i) { a.try_emplace(i, std::to_string(i)); }
+    b = a;
+    EXPECT_EQ(b.get_allocator().resource(), &r2);
+    EXPECT_EQ(b, a);
+
+    // Unequal allocators: the elements move into nodes of this allocator
+    map c(&r1);
+    c.try_emplace(-1, "x");
+    c = std::move(b);
+    EXPECT_EQ(c.get_allocator().resource(), &r1);
+    EXPECT_EQ(c, a);
+    EXPECT_TRUE(b.empty());
+    map d(&r1);
+    swap(c, d);
+    EXPECT_EQ(d, a);
+    EXPECT_TRUE(c.empty());
+}
+
+TEST(BtreeMap, RangeQuery)
+{
+    // Small nodes, so ranges and probe runs span many leaves
+    btree_map<std::uint32_t, std::uint32_t, std::less<std::uint32_t>, std::allocator<std::pair<std::uint32_t, std::uint32_t>>, 64> m;
+    std::map<std::uint32_t, std::uint32_t> ref;
+    std::mt19937 rng(12);
+    for(int i = 0; i < 5000; ++i)
+    {
+        auto k = static_cast<std::uint32_t>(rng() % 20000);
+        m.try_emplace(k, i);
+        ref.try_emplace(k, i);
+    }
+
+    for(int i = 0; i < 1000; ++i)
+    {
+        auto lo = static_cast<std::uint32_t>(rng() % 21000), hi = static_cast<std::uint32_t>(rng() % 21000);
+        auto r = m.range(lo, hi);
+        auto expect = lo < hi ? std::distance(ref.lower_bound(lo), ref.lower_bound(hi)) : 0;
+        ASSERT_EQ(r.size(), static_cast<std::size_t>(expect));
+        EXPECT_EQ(m.count_range(lo, hi), r.size());
+        if(!r.empty()) { EXPECT_EQ(r.begin()->first, ref.lower_bound(lo)->first); }
+    }
+    EXPECT_EQ(m.count_range(0, 0xFFFFFFFF), m.size());
+
+    for(std::uint32_t range : { 100U, 25000U })
+    {
+        std::vector<std::uint32_t> keys(3000);
+        for(auto& k : keys) { k = static_cast<std::uint32_t>(rng() % range) + (range == 100 ? 9000 : 0); }
+        keys.push_back(0xFFFFFFFF);
+        std::sort(keys.begin(), keys.end());
+        std::vector<decltype(m)::const_iterator> found(keys.size());
+        EXPECT_EQ(std::as_const(m).find_sorted(keys.begin(), keys.end(), found.begin()), found.end());
+        for(std::size_t i = 0; i < keys.size(); ++i) { ASSERT_EQ(found[i], std::as_const(m).find(keys[i])) << keys[i]; }
+    }
+    std::vector<decltype(m)::iterator> out;
+    std::vector<std::uint32_t> keys = { 1, 2 };
+    decltype(m)().find_sorted(keys.begin(), keys.end(), std::back_inserter(out));
+    ASSERT_EQ(out.size(), 2U);
+    EXPECT_EQ(out[0], out[1]);
+
+    btree_map<std::string, int, std::less<>> h = { { "apple", 1 }, { "banana", 2 }, { "cherry", 3 } };
+    EXPECT_EQ(h.count_range(std::string_view("b"), std::string_view("d")), 2U);
+    EXPECT_TRUE(h.range(std::string_view("c"), std::string_view("a")).empty());
+}
@@ -0,0 +1,196 @@
+/*
+  Unit testing for buffered_flat_map
+*/
+#include <gob_stdmap.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using goblib::buffered_flat_map;
+
+TEST(BufferedFlatMap, Basic)
+{
+    buffered_flat_map<int, std::string> m;
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.begin(), m.end());
+    EXPECT_EQ(m.find(1), m.end());
+
+    EXPECT_TRUE(m.insert({ 3, "three" }).second);
+    EXPECT_FALSE(m.insert({ 3, "drei" }).second);
+    m.emplace(1, "one");
+    m.try_emplace(2, "two");
+    m[5] = "five";
+    EXPECT_FALSE(m.insert_or_assign(5, "FIVE").second);
+    EXPECT_EQ(m.size(), 4U);
+    EXPECT_EQ(m.buffered(), 4U);
+    EXPECT_EQ(m.at(5), "FIVE");
+    EXPECT_THROW(m.at(4), std::out_of_range);
+    EXPECT_TRUE(m.contains(2));
+    EXPECT_EQ(m.count(4), 0U);
+
+    // Ordered access merges the tail
+    int expect[] = { 1, 2, 3, 5 };
+    int i{};
+    for(auto& e : m) { EXPECT_EQ(e.first, expect[i++]); }
+    EXPECT_EQ(m.buffered(), 0U);
+    EXPECT_EQ(m.rbegin()->first, 5);
+
+    m.emplace(4, "four");
+    EXPECT_EQ(m.buffered(), 1U);
+    EXPECT_EQ(m.lower_bound(4)->second, "four");
+    EXPECT_EQ(m.buffered(), 0U);
+    EXPECT_EQ(m.upper_bound(5), m.end());
+    auto r = m.equal_range(3);
+    EXPECT_EQ(std::distance(r.first, r.second), 1);
+
+    // Erase from the body and from the tail
+    m.emplace(0, "zero");
+    m.emplace(9, "nine");
+    EXPECT_EQ(m.erase(9), 1U);
+    EXPECT_EQ(m.erase(2), 1U);
+    EXPECT_EQ(m.erase(2), 0U);
+    EXPECT_EQ(m.buffered(), 1U);
+    EXPECT_EQ(m.begin()->second, "zero");
+    EXPECT_EQ(m.size(), 5U);
+
+    const auto c = m;
+    EXPECT_EQ(c, m);
+    m.emplace(6, "six");
+    EXPECT_NE(c, m);
+    EXPECT_LT(c, m);
+    auto moved = std::move(m);
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.buffered(), 0U);
+    EXPECT_EQ(moved.size(), 6U);
+    EXPECT_EQ(goblib::erase_if(moved, [](const auto& e) { return e.first % 2; }), 3U);
+    EXPECT_EQ(moved.size(), 3U);
+}
+
+TEST(BufferedFlatMap, BufferLimit)
+{
+    buffered_flat_map<std::uint32_t, std::uint32_t> m;
+    EXPECT_EQ(m.buffer_limit(), (buffered_flat_map<std::uint32_t, std::uint32_t>::min_buffer_limit));
+    for(std::uint32_t i = 0; i < 10000; ++i)
+    {
+        m.try_emplace(i * 7919 % 10000, i);
+        ASSERT_LE(m.buffered(), m.buffer_limit());
+    }
+    // About sqrt(N) once large
+    EXPECT_GE(m.buffer_limit(), 90U);
+    EXPECT_LE(m.buffer_limit(), 100U);
+
+    m.set_buffer_limit(1000);
+    EXPECT_EQ(m.buffer_limit(), 1000U);
+    m.clear();
+    for(std::uint32_t i = 0; i < 1000; ++i) { m.try_emplace(1000 - i, i); }
+    EXPECT_EQ(m.buffered(), 1000U);
+    EXPECT_EQ(m.find(1)->second, 999U);
+    // Iterator into the tail is valid for erase
+    m.erase(m.find(500));
+    EXPECT_FALSE(m.contains(500));
+    EXPECT_TRUE(m.contains(499));
+    EXPECT_EQ(m.size(), 999U);
+    m.flush();
+    EXPECT_EQ(m.buffered(), 0U);
+    EXPECT_TRUE(std::is_sorted(m.begin(), m.end(), m.value_comp()));
+
+    // Arguments referring to a tail element that the merge of the full tail moves
+    buffered_flat_map<int, std::string> s;
+    s.set_buffer_limit(4);
+    s.try_emplace(50, "fifty");
+    s.try_emplace(40, "forty");
+    s.try_emplace(30, "thirty");
+    s.try_emplace(20, "twenty");
+    EXPECT_EQ(s.buffered(), 4U);
+    EXPECT_TRUE(s.try_emplace(60, s.at(50)).second);
+    EXPECT_EQ(s.at(60), "fifty");
+    EXPECT_EQ(s.at(50), "fifty");
+}
+
+TEST(BufferedFlatMap, CompatibleWithStdMap)
+{
+    for(std::size_t limit : { 0U, 1U, 64U })
+    {
+        buffered_flat_map<std::uint32_t, std::string> m;
+        m.set_buffer_limit(limit);
+        std::map<std::uint32_t, std::string> ref;
+        std::mt19937 rng(static_cast<std::uint32_t>(limit));
+        for(int i = 0; i < 20000; ++i)
+        {
+            auto k = static_cast<std::uint32_t>(rng() % 3000);
+            switch(rng() % 8)
+            {
+            case 0:
+            case 1:
+            case 2:
+                EXPECT_EQ(m.try_emplace(k, std::to_string(k)).second, ref.try_emplace(k, std::to_string(k)).second);
+                break;
+            case 3:
+                EXPECT_EQ(m.insert_or_assign(k, std::to_string(i)).second, ref.insert_or_assign(k, std::to_string(i)).second);
+                break;
+            case 4:
+                EXPECT_EQ(m.erase(k), ref.erase(k));
+                break;
+            case 5:
+            {
+                auto it = m.lower_bound(k);
+                auto rit = ref.lower_bound(k);
+                ASSERT_EQ(it == m.end(), rit == ref.end());
+                if(it != m.end()) { EXPECT_EQ(it->first, rit->first); }
+                break;
+            }
+            default:
+            {
+                auto it = m.find(k);
+                auto rit = ref.find(k);
+                ASSERT_EQ(it == m.end(), rit == ref.end());
+                if(it != m.end()) { EXPECT_EQ(it->second, rit->second); }
+                break;
+            }
+            }
+        }
+        ASSERT_EQ(m.size(), ref.size());
+        EXPECT_TRUE(std::equal(m.begin(), m.end(), ref.begin(), ref.end(),
+                               [](auto& a, auto& b) { return a.first == b.first && a.second == b.second; }));
+    }
+}
+
+TEST(BufferedFlatMap, BulkInsert)
+{
+    buffered_flat_map<int, int> m = { { 5, 0 }, { 1, 0 }, { 3, 0 }, { 1, 1 } };
+    EXPECT_EQ(m.size(), 3U);
+    EXPECT_EQ(m.buffered(), 0U);
+    EXPECT_EQ(m.at(1), 0);
+    m.emplace(2, 0);
+    std::vector<std::pair<int, int>> v = { { 4, 1 }, { 2, 1 }, { 0, 1 } };
+    m.insert(v.begin(), v.end());
+    EXPECT_EQ(m.size(), 6U);
+    EXPECT_EQ(m.buffered(), 0U);
+    EXPECT_EQ(m.at(2), 0);  // Existing element wins
+    std::vector<std::pair<int, int>> s = { { 6, 2 }, { 7, 2 } };
+    m.insert(goblib::sorted_unique, s.begin(), s.end());
+    EXPECT_EQ(std::prev(m.end())->first, 7);
+
+    buffered_flat_map<int, int> sorted(goblib::sorted_unique, s.begin(), s.end());
+    EXPECT_EQ(sorted.buffered(), 0U);
+    EXPECT_EQ(sorted.at(6), 2);
+}
+
+TEST(BufferedFlatMap, Heterogeneous)
+{
+    buffered_flat_map<std::string, int, std::less<>> m;
+    m.emplace("banana", 2);
+    m.flush();
+    m.emplace("apple", 1);
+    EXPECT_EQ(m.find(std::string_view("apple"))->second, 1);
+    EXPECT_EQ(m.find(std::string_view("banana"))->second, 2);
+    EXPECT_TRUE(m.contains("apple"));
+    EXPECT_EQ(m.count(std::string_view("cherry")), 0U);
+    EXPECT_EQ(m.erase(std::string_view("apple")), 1U);
+    EXPECT_EQ(m.lower_bound(std::string_view("b"))->first, "banana");
+}
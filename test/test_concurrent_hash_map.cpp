@@ -0,0 +1,84 @@
+/*
+  Unit testing for concurrent_hash_map
+*/
+#include <gob_stdmap.hpp>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using goblib::concurrent_hash_map;
+
+TEST(ConcurrentHashMap, Basic)
+{
+    concurrent_hash_map<std::string, int> m(5);
+    EXPECT_EQ(m.shard_count(), 8U);
+    EXPECT_TRUE(m.empty());
+
+    EXPECT_TRUE(m.try_emplace("a", 1));
+    EXPECT_FALSE(m.try_emplace("a", 2));
+    EXPECT_TRUE(m.insert({ "b", 2 }));
+    EXPECT_TRUE(m.insert_or_assign("c", 3));
+    EXPECT_FALSE(m.insert_or_assign("c", 30));
+    EXPECT_EQ(m.size(), 3U);
+    EXPECT_EQ(m.get("a").value(), 1);
+    EXPECT_EQ(m.get("c").value(), 30);
+    EXPECT_FALSE(m.get("z").has_value());
+    EXPECT_TRUE(m.contains("b"));
+    EXPECT_EQ(m.count("z"), 0U);
+
+    EXPECT_TRUE(m.update("a", [](int& v) { v += 10; }));
+    EXPECT_FALSE(m.update("z", [](int& v) { v += 10; }));
+    int seen{};
+    EXPECT_TRUE(m.visit("a", [&seen](const int& v) { seen = v; }));
+    EXPECT_EQ(seen, 11);
+
+    EXPECT_TRUE(m.emplace_or_update("d", [](int& v) { ++v; }, 1));
+    EXPECT_FALSE(m.emplace_or_update("d", [](int& v) { ++v; }, 1));
+    EXPECT_EQ(m.get("d").value(), 2);
+
+    EXPECT_FALSE(m.erase_if("d", [](int& v) { return v > 5; }));
+    EXPECT_TRUE(m.erase_if("d", [](int& v) { return v == 2; }));
+    EXPECT_EQ(m.erase("b"), 1U);
+    EXPECT_EQ(m.erase("b"), 0U);
+
+    int sum{};
+    m.for_each([&sum](const std::string&, int& v) { sum += v; });
+    EXPECT_EQ(sum, 11 + 30);
+    EXPECT_EQ(goblib::erase_if(m, [](const auto& e) { return e.second > 20; }), 1U);
+    EXPECT_EQ(m.size(), 1U);
+    m.clear();
+    EXPECT_TRUE(m.empty());
+}
+
+TEST(ConcurrentHashMap, SingleShard)
+{
+    concurrent_hash_map<int, int> m(1);
+    EXPECT_EQ(m.shard_count(), 1U);
+    for(int i = 0; i < 100; ++i) { m.try_emplace(i, i); }
+    EXPECT_EQ(m.size(), 100U);
+    EXPECT_EQ(m.get(42).value(), 42);
+}
+
+TEST(ConcurrentHashMap, ConcurrentWriters)
+{
+    constexpr int threads = 4;
+    constexpr int keys = 2000;
+    concurrent_hash_map<int, int> m;
+    m.reserve(keys);
+    std::vector<std::thread> ts;
+    for(int t = 0; t < threads; ++t)
+    {
+        ts.emplace_back([&m, t] {
+            for(int i = 0; i < keys; ++i)
+            {
+                m.emplace_or_update(i, [](int& v) { ++v; }, 1);
+                if(i % 7 == t) { m.try_emplace(keys + i, t); }
+            }
+        });
+    }
+    for(auto& t : ts) { t.join(); }
+    for(int i = 0; i < keys; ++i) { EXPECT_EQ(m.get(i).value(), threads); }
+    EXPECT_EQ(m.size(), static_cast<std::size_t>(keys + (keys / 7) * 4 + std::min(keys % 7, 4)));
+}
@@ -0,0 +1,82 @@
+/*
+  Unit testing for constexpr_map
+*/
+#include <gob_stdmap.hpp>
+#include <gtest/gtest.h>
+#include <string_view>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+enum class Command : int { Stop, Start, Reset, Status };
+
+constexpr auto command_name = goblib::make_constexpr_map<Command, std::string_view>({
+    { Command::Status, "status" },
+    { Command::Stop, "stop" },
+    { Command::Reset, "reset" },
+    { Command::Start, "start" },
+});
+
+constexpr auto name_to_id = goblib::make_constexpr_map<std::string_view, int>({
+    { "delta", 4 }, { "alpha", 1 }, { "charlie", 3 }, { "bravo", 2 },
+});
+
+int twice(int v) { return v * 2; }
+int square(int v) { return v * v; }
+constexpr auto handlers = goblib::make_constexpr_map<int, int (*)(int)>({ { 20, square }, { 10, twice } });
+
+// Evaluated at compile time
+static_assert(command_name.size() == 4, "");
+static_assert(command_name.at(Command::Reset) == "reset", "");
+static_assert(command_name.begin()->first == Command::Stop, "");
+static_assert(name_to_id.at("charlie") == 3, "");
+static_assert(name_to_id.contains("alpha") && !name_to_id.contains("echo"), "");
+static_assert(name_to_id.value_or("echo", -1) == -1, "");
+static_assert(name_to_id.find("foxtrot") == name_to_id.end(), "");
+static_assert(name_to_id.lower_bound("b")->second == 2, "");
+static_assert(name_to_id.upper_bound("bravo")->second == 3, "");
+static_assert(name_to_id.equal_range("delta").second == name_to_id.end(), "");
+}  // namespace
+
+TEST(ConstexprMap, Runtime)
+{
+    std::string_view key = "bravo";
+    EXPECT_EQ(name_to_id.at(key), 2);
+    EXPECT_THROW(name_to_id.at("zulu"), std::out_of_range);
+    EXPECT_EQ(name_to_id.count("zulu"), 0U);
+
+    EXPECT_EQ(handlers.at(10)(3), 6);
+    EXPECT_EQ(handlers.at(20)(3), 9);
+
+    std::string_view prev{};
+    for(auto& e : name_to_id)
+    {
+        EXPECT_LT(prev, e.first);
+        prev = e.first;
+    }
+    EXPECT_EQ(name_to_id.rbegin()->first, "delta");
+
+    // Built at run time, duplicate keys throw instead of leaving an ambiguous lookup
+    EXPECT_THROW((goblib::make_constexpr_map<int, char>({ { 1, 'a' }, { 2, 'b' }, { 1, 'z' } })), std::invalid_argument);
+}
+
+TEST(ConstexprMap, CustomCompare)
+{
+    constexpr auto m = goblib::make_constexpr_map<int, char>({ { 1, 'a' }, { 3, 'c' }, { 2, 'b' } }, std::greater<int>());
+    static_assert(m.begin()->second == 'c', "");
+    static_assert(m.lower_bound(2)->second == 'b', "");
+    EXPECT_EQ(m.at(1), 'a');
+}
+
+TEST(ConstexprMap, Heterogeneous)
+{
+    constexpr auto m = goblib::make_constexpr_map<std::string_view, int, std::less<>>({ { "one", 1 }, { "two", 2 }, { "three", 3 } });
+    static_assert(m.find("two")->second == 2, "");
+    static_assert(m.contains("three") && !m.contains("four"), "");
+    static_assert(m.lower_bound("p")->second == 3, "");
+    static_assert(m.equal_range("one").first->second == 1, "");
+    const char* key = "three";
+    EXPECT_EQ(m.find(key)->second, 3);
+    EXPECT_EQ(m.count(key), 1U);
+    EXPECT_EQ(m.upper_bound(key)->second, 2);
+}
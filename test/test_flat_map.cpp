@@ -0,0 +1,464 @@
+/*
+  Unit testing for flat_map
+*/
+#include <gob_stdmap.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <string>
+#include <string_view>
+#include <random>
+#include <sstream>
+#include <memory>
+#include <utility>
+#include <vector>
+
+using goblib::flat_map;
+
+TEST(FlatMap, Basic)
+{
+    flat_map<int, std::string> m;
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.size(), 0U);
+    EXPECT_EQ(m.begin(), m.end());
+
+    auto r = m.insert({ 3, "three" });
+    EXPECT_TRUE(r.second);
+    EXPECT_EQ(r.first->first, 3);
+    r = m.insert({ 3, "san" });
+    EXPECT_FALSE(r.second);
+    EXPECT_EQ(r.first->second, "three");
+
+    m.insert({ 1, "one" });
+    m.emplace(2, "two");
+    m[0] = "zero";
+    EXPECT_EQ(m.size(), 4U);
+
+    int expect = 0;
+    for(auto& e : m) { EXPECT_EQ(e.first, expect++); }
+
+    EXPECT_EQ(m.at(2), "two");
+    EXPECT_THROW(m.at(42), std::out_of_range);
+    EXPECT_EQ(m.count(1), 1U);
+    EXPECT_EQ(m.count(42), 0U);
+    EXPECT_TRUE(m.contains(0));
+    EXPECT_FALSE(m.contains(-1));
+}
+
+TEST(FlatMap, Lookup)
+{
+    flat_map<int, int> m{ { 10, 1 }, { 20, 2 }, { 30, 3 } };
+    const auto& cm = m;
+
+    EXPECT_EQ(cm.find(20)->second, 2);
+    EXPECT_EQ(cm.find(25), cm.end());
+    EXPECT_EQ(m.lower_bound(15)->first, 20);
+    EXPECT_EQ(m.lower_bound(20)->first, 20);
+    EXPECT_EQ(m.upper_bound(20)->first, 30);
+    EXPECT_EQ(m.lower_bound(31), m.end());
+    EXPECT_EQ(m.upper_bound(5), m.begin());
+
+    auto er = m.equal_range(20);
+    EXPECT_EQ(std::distance(er.first, er.second), 1);
+    er = m.equal_range(25);
+    EXPECT_EQ(er.first, er.second);
+    EXPECT_EQ(er.first->first, 30);
+}
+
+TEST(FlatMap, Modifiers)
+{
+    flat_map<int, std::string> m;
+    auto r = m.try_emplace(5, 3, 'a');
+    EXPECT_TRUE(r.second);
+    EXPECT_EQ(r.first->second, "aaa");
+    r = m.try_emplace(5, 3, 'b');
+    EXPECT_FALSE(r.second);
+    EXPECT_EQ(r.first->second, "aaa");
+
+    r = m.insert_or_assign(5, "x");
+    EXPECT_FALSE(r.second);
+    EXPECT_EQ(m[5], "x");
+    r = m.insert_or_assign(6, "y");
+    EXPECT_TRUE(r.second);
+
+    // Hints, right and wrong
+    auto it = m.insert(m.end(), { 9, "nine" });
+    EXPECT_EQ(it->first, 9);
+    it = m.insert(m.begin(), { 7, "seven" });
+    EXPECT_EQ(it->first, 7);
+    it = m.emplace_hint(m.begin(), 1, "one");
+    EXPECT_EQ(it, m.begin());
+    EXPECT_TRUE(std::is_sorted(m.begin(), m.end(), m.value_comp()));
+
+    EXPECT_EQ(m.erase(6), 1U);
+    EXPECT_EQ(m.erase(6), 0U);
+    it = m.erase(m.find(7));
+    EXPECT_EQ(it->first, 9);
+    m.erase(m.begin(), m.end());
+    EXPECT_TRUE(m.empty());
+}
+
+TEST(FlatMap, EraseIf)
+{
+    flat_map<int, int> m;
+    for(int i = 0; i < 100; ++i) { m[i] = i * i; }
+    auto n = goblib::erase_if(m, [](const std::pair<int, int>& e) { return e.first % 2; });
+    EXPECT_EQ(n, 50U);
+    EXPECT_EQ(m.size(), 50U);
+    for(auto& e : m) { EXPECT_EQ(e.first % 2, 0); }
+}
+
+TEST(FlatMap, CopyMoveCompare)
+{
+    flat_map<int, int> a{ { 1, 1 }, { 2, 2 } };
+    flat_map<int, int> b = a;
+    EXPECT_EQ(a, b);
+    b[3] = 3;
+    EXPECT_NE(a, b);
+    EXPECT_LT(a, b);
+
+    flat_map<int, int> c = std::move(b);
+    EXPECT_EQ(c.size(), 3U);
+    swap(a, c);
+    EXPECT_EQ(a.size(), 3U);
+    EXPECT_EQ(c.size(), 2U);
+
+    a = { { 9, 9 } };
+    EXPECT_EQ(a.size(), 1U);
+    EXPECT_EQ(a.begin()->first, 9);
+}
+
+TEST(FlatMap, CustomCompare)
+{
+    flat_map<int, int, std::greater<int>> m{ { 1, 1 }, { 3, 3 }, { 2, 2 } };
+    EXPECT_EQ(m.begin()->first, 3);
+    EXPECT_EQ(m.rbegin()->first, 1);
+    EXPECT_EQ(m.lower_bound(2)->first, 2);
+}
+
+TEST(FlatMap, MoveOnly)
+{
+    flat_map<int, std::unique_ptr<int>> m;
+    m.try_emplace(2, new int(2));
+    m.emplace(1, std::unique_ptr<int>(new int(1)));
+    m[3] = std::unique_ptr<int>(new int(3));
+    EXPECT_EQ(*m.at(1), 1);
+    EXPECT_EQ(*m.at(3), 3);
+}
+
+TEST(FlatMap, CompatibleWithStdMap)
+{
+    std::mt19937 rng(123);
+    std::uniform_int_distribution<int> dist(0, 999);
+    std::map<int, int> sm;
+    flat_map<int, int> fm;
+
+    for(int i = 0; i < 5000; ++i)
+    {
+        int k = dist(rng);
+        switch(i % 4)
+        {
+        case 0:
+        case 1: sm[k] = i; fm[k] = i; break;
+        case 2: EXPECT_EQ(sm.erase(k), fm.erase(k)); break;
+        default: EXPECT_EQ(sm.count(k), fm.count(k)); break;
+        }
+    }
+    ASSERT_EQ(sm.size(), fm.size());
+    EXPECT_TRUE(std::equal(sm.begin(), sm.end(), fm.begin(),
+                           [](const std::pair<const int, int>& a, const std::pair<int, int>& b) { return a.first == b.first && a.second == b.second; }));
+}
+
+TEST(FlatMap, BulkInsert)
+{
+    std::vector<std::pair<int, int>> src;
+    for(int i = 0; i < 1000; ++i) { src.emplace_back((i * 7919) % 1000, i); }
+    src.emplace_back(5, -1);  // Duplicated key, first one wins
+
+    flat_map<int, int> m(src.begin(), src.end());
+    EXPECT_EQ(m.size(), 1000U);
+    EXPECT_TRUE(std::is_sorted(m.begin(), m.end(), m.value_comp()));
+    EXPECT_NE(m.at(5), -1);
+
+    // Existing elements win over new equivalent keys
+    std::vector<std::pair<int, int>> more{ { 2000, 1 }, { 5, -2 }, { -3, 3 }, { 2000, 2 }, { 1500, 4 } };
+    m.insert(more.begin(), more.end());
+    EXPECT_EQ(m.size(), 1003U);
+    EXPECT_NE(m.at(5), -2);
+    EXPECT_EQ(m.at(2000), 1);
+    EXPECT_EQ(m.begin()->first, -3);
+    EXPECT_TRUE(std::is_sorted(m.begin(), m.end(), m.value_comp()));
+
+    // Appending after the last key
+    m.insert(goblib::sorted_unique, { { 3000, 0 }, { 3001, 1 } });
+    EXPECT_EQ(m.rbegin()->first, 3001);
+
+    std::map<int, std::string> sm{ { 1, "a" }, { 2, "b" } };
+    flat_map<int, std::string> fm{ { 2, "x" }, { 3, "c" } };
+    fm.insert_range(sm);
+    EXPECT_EQ(fm.size(), 3U);
+    EXPECT_EQ(fm.at(2), "x");
+    EXPECT_EQ(sm.at(1), "a");
+
+    flat_map<int, int>::container_type cont{ { 3, 3 }, { 1, 1 }, { 3, 4 } };
+    flat_map<int, int> adopted(std::move(cont));
+    EXPECT_EQ(adopted.size(), 2U);
+    EXPECT_EQ(adopted.at(3), 3);
+    flat_map<int, int> presorted(goblib::sorted_unique, src.begin(), src.begin());
+    EXPECT_TRUE(presorted.empty());
+}
+
+TEST(FlatMap, Merge)
+{
+    flat_map<int, std::string> a{ { 1, "a1" }, { 3, "a3" }, { 5, "a5" } };
+    flat_map<int, std::string> b{ { 0, "b0" }, { 3, "b3" }, { 4, "b4" }, { 5, "b5" }, { 9, "b9" } };
+    a.merge(b);
+    EXPECT_EQ(a, (flat_map<int, std::string>{ { 0, "b0" }, { 1, "a1" }, { 3, "a3" }, { 4, "b4" }, { 5, "a5" }, { 9, "b9" } }));
+    EXPECT_EQ(b, (flat_map<int, std::string>{ { 3, "b3" }, { 5, "b5" } }));
+
+    std::map<int, std::string> sa{ { 1, "a1" }, { 3, "a3" }, { 5, "a5" } };
+    std::map<int, std::string> sb{ { 0, "b0" }, { 3, "b3" }, { 4, "b4" }, { 5, "b5" }, { 9, "b9" } };
+    sa.merge(sb);
+    EXPECT_TRUE(std::equal(sa.begin(), sa.end(), a.begin(), [](const std::pair<const int, std::string>& x, const std::pair<int, std::string>& y) {
+        return x.first == y.first && x.second == y.second;
+    }));
+    EXPECT_EQ(sb.size(), b.size());
+
+    a.merge(flat_map<int, std::string>{ { 100, "c" } });
+    EXPECT_EQ(a.rbegin()->second, "c");
+}
+
+namespace {
+// Counts constructions to detect temporary keys
+struct counted_key
+{
+    static int constructed;
+    int v;
+    counted_key(int x) : v(x) { ++constructed; }
+    counted_key(const counted_key& o) : v(o.v) { ++constructed; }
+};
+int counted_key::constructed{};
+
+struct counted_less
+{
+    using is_transparent = void;
+    bool operator()(const counted_key& a, const counted_key& b) const { return a.v < b.v; }
+    bool operator()(const counted_key& a, int b) const { return a.v < b; }
+    bool operator()(int a, const counted_key& b) const { return a < b.v; }
+};
+}  // namespace
+
+TEST(FlatMap, Heterogeneous)
+{
+    flat_map<std::string, int, std::less<>> m = { { "apple", 1 }, { "banana", 2 }, { "cherry", 3 } };
+    std::string_view sv("banana");
+    EXPECT_EQ(m.find(sv)->second, 2);
+    EXPECT_EQ(m.find("cherry")->second, 3);
+    EXPECT_EQ(m.find("durian"), m.end());
+    EXPECT_EQ(m.count(std::string_view("apple")), 1U);
+    EXPECT_TRUE(m.contains("apple"));
+    EXPECT_FALSE(m.contains("a"));
+    EXPECT_EQ(m.lower_bound("b")->first, "banana");
+    EXPECT_EQ(m.upper_bound("banana")->first, "cherry");
+    auto r = m.equal_range(sv);
+    EXPECT_EQ(std::distance(r.first, r.second), 1);
+    r = m.equal_range("bb");
+    EXPECT_EQ(r.first, r.second);
+
+    EXPECT_EQ(m.erase("banana"), 1U);
+    EXPECT_EQ(m.erase(std::string_view("banana")), 0U);
+    EXPECT_EQ(m.size(), 2U);
+    // Iterator erase still selects the positional overload
+    m.erase(m.begin());
+    EXPECT_EQ(m.begin()->first, "cherry");
+
+    flat_map<counted_key, int, counted_less> c;
+    for(int i = 0; i < 8; ++i) { c.emplace(i * 2, i); }
+    counted_key::constructed = 0;
+    EXPECT_EQ(c.find(6)->second, 3);
+    EXPECT_EQ(c.count(7), 0U);
+    EXPECT_EQ(c.lower_bound(7)->first.v, 8);
+    EXPECT_EQ(c.erase(4), 1U);
+    EXPECT_EQ(counted_key::constructed, 0);
+}
+
+TEST(FlatMap, Stats)
+{
+    // Disabled policy takes no room
+    struct plain
+    {
+        std::vector<std::pair<int, int>> v;
+        std::less<int> c;
+    };
+    EXPECT_EQ(sizeof(flat_map<int, int>), sizeof(plain));
+    EXPECT_FALSE(decltype(flat_map<int, int>{}.stats())::enabled);
+
+    using map = flat_map<int, int, std::less<int>, std::allocator<std::pair<int, int>>, goblib::map_stats>;
+    map m;
+    for(int i = 0; i < 100; ++i) { m.try_emplace(i, i); }
+    EXPECT_EQ(m.stats().peak_size(), 100U);
+    EXPECT_GT(m.stats().reallocations(), 0U);
+    EXPECT_EQ(m.stats().lookups(), 0U);
+
+    // Inserting at the front shifts every element
+    auto moved = m.stats().bytes_moved();
+    m.reserve(200);
+    EXPECT_EQ(m.stats().bytes_moved(), moved + 100 * sizeof(std::pair<int, int>));
+    auto reallocations = m.stats().reallocations();
+    m.try_emplace(-1, 0);
+    EXPECT_EQ(m.stats().reallocations(), reallocations);
+    EXPECT_EQ(m.stats().bytes_moved(), moved + 200 * sizeof(std::pair<int, int>));
+
+    EXPECT_TRUE(m.contains(50));
+    EXPECT_EQ(m.count(1000), 0U);
+    EXPECT_EQ(m.at(7), 7);
+    EXPECT_EQ(m.erase(1000), 0U);
+    EXPECT_EQ(m.stats().lookups(), 4U);
+    EXPECT_EQ(m.stats().hits(), 2U);
+    EXPECT_EQ(m.stats().misses(), 2U);
+    // Binary search over 101 elements
+    EXPECT_GE(m.stats().average_probes(), 7.0);
+    EXPECT_LE(m.stats().average_probes(), 9.0);
+
+    std::ostringstream os;
+    m.stats().dump(os, "m");
+    EXPECT_EQ(os.str().rfind("m: lookups=4 hits=2 misses=2 avg_probes=", 0), 0U);
+    EXPECT_NE(os.str().find(" peak_size=101\n"), std::string::npos);
+
+    auto c = m;
+    EXPECT_EQ(c.stats().lookups(), 4U);
+    m.reset_stats();
+    EXPECT_EQ(m.stats().lookups(), 0U);
+    EXPECT_EQ(m.stats().peak_size(), 0U);
+    swap(c, m);
+    EXPECT_EQ(m.stats().lookups(), 4U);
+    EXPECT_EQ(goblib::erase_if(m, [](const auto& e) { return e.first < 0; }), 1U);
+}
+
+namespace {
+// Move-only, over-aligned value which counts its moves
+struct alignas(64) block
+{
+    static inline int moves = 0;
+    explicit block(int n) : v(n) {}
+    block(block&& o) noexcept : v(o.v) { ++moves; }
+    block& operator=(block&& o) noexcept
+    {
+        v = o.v;
+        ++moves;
+        return *this;
+    }
+    int v;
+};
+}  // namespace
+
+TEST(FlatMap, InPlaceEmplace)
+{
+    flat_map<int, block> m;
+    m.reserve(16);
+    for(int i = 0; i < 10; ++i) { m.try_emplace(i * 10, i); }
+
+    // Only the elements after the position move, the new element is built in place
+    block::moves = 0;
+    EXPECT_TRUE(m.try_emplace(35, 100).second);
+    EXPECT_EQ(block::moves, 6);
+    block::moves = 0;
+    EXPECT_TRUE(m.emplace(75, 200).second);
+    EXPECT_EQ(block::moves, 2);
+    block::moves = 0;
+    EXPECT_FALSE(m.emplace(75, 300).second);
+    EXPECT_EQ(block::moves, 0);
+    // A correct hint skips the search
+    block::moves = 0;
+    auto it = m.try_emplace(m.find(90), 85, 400);
+    EXPECT_EQ(it->first, 85);
+    EXPECT_EQ(block::moves, 1);
+    it = m.emplace_hint(m.end(), 95, 500);
+    EXPECT_EQ(it->first, 95);
+    it = m.emplace_hint(m.begin(), 45, 600);  // Wrong hint
+    EXPECT_EQ(it->second.v, 600);
+
+    EXPECT_EQ(m.at(35).v, 100);
+    EXPECT_EQ(m.at(75).v, 200);
+    EXPECT_TRUE(std::is_sorted(m.begin(), m.end(), m.value_comp()));
+    for(auto& e : m) { EXPECT_EQ(reinterpret_cast<std::uintptr_t>(&e.second) % 64, 0U); }
+}
+
+TEST(FlatMap, AliasedArguments)
+{
+    // Arguments referring to an element that shifts to make room
+    flat_map<int, std::string> m{ { 1, "one" }, { 3, "three" }, { 5, std::string(40, 'x') } };
+    m.reserve(16);
+    EXPECT_TRUE(m.try_emplace(2, m.at(3)).second);
+    EXPECT_TRUE(m.insert_or_assign(0, m.at(5)).second);
+    EXPECT_TRUE(m.try_emplace(-1, m.at(1).c_str()).second);
+    auto it = m.emplace_hint(m.find(5), 4, m.at(5));
+    EXPECT_EQ(it->first, 4);
+    EXPECT_EQ(m.at(2), "three");
+    EXPECT_EQ(m.at(3), "three");
+    EXPECT_EQ(m.at(0), std::string(40, 'x'));
+    EXPECT_EQ(m.at(-1), "one");
+    EXPECT_EQ(m.at(4), std::string(40, 'x'));
+    EXPECT_EQ(m.at(5), std::string(40, 'x'));
+}
+
+TEST(FlatMap, RangeQuery)
+{
+    flat_map<std::uint32_t, std::uint32_t, std::less<std::uint32_t>, std::allocator<std::pair<std::uint32_t, std::uint32_t>>, goblib::map_stats> m;
+    std::map<std::uint32_t, std::uint32_t> ref;
+    std::mt19937 rng(11);
+    for(int i = 0; i < 5000; ++i)
+    {
+        auto k = static_cast<std::uint32_t>(rng() % 20000);
+        m.try_emplace(k, i);
+        ref.try_emplace(k, i);
+    }
+
+    for(int i = 0; i < 1000; ++i)
+    {
+        auto lo = static_cast<std::uint32_t>(rng() % 21000), hi = static_cast<std::uint32_t>(rng() % 21000);
+        auto r = m.range(lo, hi);
+        auto expect = lo < hi ? std::distance(ref.lower_bound(lo), ref.lower_bound(hi)) : 0;
+        ASSERT_EQ(r.size(), static_cast<std::size_t>(expect));
+        EXPECT_EQ(m.count_range(lo, hi), r.size());
+        if(!r.empty()) { EXPECT_EQ(r.begin()->first, ref.lower_bound(lo)->first); }
+    }
+    std::uint32_t sum{};
+    for(auto& e : std::as_const(m).range(100, 200)) { sum += e.first; }
+    std::uint32_t expect_sum{};
+    for(auto it = ref.lower_bound(100); it != ref.lower_bound(200); ++it) { expect_sum += it->first; }
+    EXPECT_EQ(sum, expect_sum);
+
+    // Sparse and dense sorted probes, with duplicates and misses past both ends
+    for(std::uint32_t range : { 100U, 25000U })
+    {
+        std::vector<std::uint32_t> keys(3000);
+        for(auto& k : keys) { k = static_cast<std::uint32_t>(rng() % range) + (range == 100 ? 9000 : 0); }
+        keys.push_back(0xFFFFFFFF);
+        std::sort(keys.begin(), keys.end());
+        std::vector<decltype(m)::const_iterator> found(keys.size());
+        m.reset_stats();
+        EXPECT_EQ(std::as_const(m).find_sorted(keys.begin(), keys.end(), found.begin()), found.end());
+        EXPECT_EQ(m.stats().lookups(), keys.size());
+        for(std::size_t i = 0; i < keys.size(); ++i) { ASSERT_EQ(found[i], std::as_const(m).find(keys[i])) << keys[i]; }
+    }
+    std::vector<decltype(m)::iterator> out;
+    std::vector<std::uint32_t> keys = { m.begin()->first, std::prev(m.end())->first };
+    m.find_sorted(keys.begin(), keys.end(), std::back_inserter(out));
+    ASSERT_EQ(out.size(), 2U);
+    out[1]->second = 42;
+    EXPECT_EQ(std::prev(m.end())->second, 42U);
+
+    flat_map<std::string, int, std::less<>> h = { { "apple", 1 }, { "banana", 2 }, { "cherry", 3 } };
+    EXPECT_EQ(h.count_range(std::string_view("b"), std::string_view("d")), 2U);
+    EXPECT_TRUE(h.range(std::string_view("c"), std::string_view("a")).empty());
+    std::vector<std::string_view> sv = { "apple", "apricot", "cherry" };
+    std::vector<decltype(h)::const_iterator> hf(3);
+    std::as_const(h).find_sorted(sv.begin(), sv.end(), hf.begin());
+    EXPECT_EQ(hf[0]->second, 1);
+    EXPECT_EQ(hf[1], h.cend());
+    EXPECT_EQ(hf[2]->second, 3);
+    EXPECT_TRUE((flat_map<int, int>().range(0, 10).empty()));
+}
@@ -0,0 +1,158 @@
+/*
+  Unit testing for flat_multimap
+*/
+#include <gob_stdmap.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using goblib::flat_multimap;
+
+namespace {
+template <class M, class R>
+void expect_same(const M& m, const R& ref)
+{
+    ASSERT_EQ(m.size(), ref.size());
+    EXPECT_TRUE(std::equal(m.begin(), m.end(), ref.begin(), ref.end(),
+                           [](auto& a, auto& b) { return a.first == b.first && a.second == b.second; }));
+}
+}  // namespace
+
+TEST(FlatMultimap, Basic)
+{
+    flat_multimap<int, std::string> m;
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.find(1), m.end());
+
+    EXPECT_EQ(m.insert({ 2, "a" })->second, "a");
+    m.insert({ 1, "b" });
+    m.emplace(2, "c");
+    m.insert(std::pair<int, const char*>(2, "d"));
+    EXPECT_EQ(m.size(), 4U);
+    EXPECT_EQ(m.count(2), 3U);
+    EXPECT_EQ(m.count(3), 0U);
+    EXPECT_TRUE(m.contains(1));
+
+    // Equivalent keys keep their insertion order, and find returns the first
+    auto r = m.equal_range(2);
+    std::vector<std::string> v;
+    for(auto it = r.first; it != r.second; ++it) { v.push_back(it->second); }
+    EXPECT_EQ(v, (std::vector<std::string>{ "a", "c", "d" }));
+    EXPECT_EQ(m.find(2)->second, "a");
+    EXPECT_EQ(m.lower_bound(2), r.first);
+    EXPECT_EQ(m.upper_bound(2), r.second);
+    EXPECT_EQ(m.upper_bound(2), m.end());
+
+    // Hints
+    auto it = m.emplace_hint(m.find(2), 2, "e");  // Before the run
+    EXPECT_EQ(it, m.find(2));
+    it = m.insert(m.begin(), { 3, "f" });  // Wrong hint
+    EXPECT_EQ(it->first, 3);
+    EXPECT_TRUE(std::is_sorted(m.begin(), m.end(), m.value_comp()));
+
+    EXPECT_EQ(m.erase(2), 4U);
+    EXPECT_EQ(m.size(), 2U);
+    EXPECT_EQ(m.erase(m.begin())->first, 3);
+    EXPECT_EQ(m.erase(9), 0U);
+
+    flat_multimap<int, std::string> c = { { 1, "x" }, { 1, "y" }, { 0, "z" } };
+    auto d = c;
+    EXPECT_EQ(c, d);
+    d.insert({ 1, "w" });
+    EXPECT_NE(c, d);
+    EXPECT_LT(c, d);
+    EXPECT_EQ(c.begin()->second, "z");
+    EXPECT_EQ(std::next(c.begin())->second, "x");
+    c.swap(d);
+    EXPECT_EQ(c.size(), 4U);
+    EXPECT_EQ(goblib::erase_if(c, [](const auto& e) { return e.first == 1; }), 3U);
+    EXPECT_EQ(c.size(), 1U);
+}
+
+TEST(FlatMultimap, CompatibleWithStdMultimap)
+{
+    flat_multimap<std::uint32_t, std::uint32_t> m;
+    std::multimap<std::uint32_t, std::uint32_t> ref;
+    std::mt19937 rng(21);
+    for(std::uint32_t i = 0; i < 20000; ++i)
+    {
+        auto k = static_cast<std::uint32_t>(rng() % 500);
+        switch(rng() % 5)
+        {
+        case 0:
+        case 1:
+            m.emplace(k, i);
+            ref.emplace(k, i);
+            break;
+        case 2:
+        {
+            auto h = rng() % (m.size() + 1);
+            m.emplace_hint(m.begin() + static_cast<std::ptrdiff_t>(h), k, i);
+            ref.emplace_hint(std::next(ref.begin(), static_cast<std::ptrdiff_t>(h)), k, i);
+            break;
+        }
+        case 3:
+            if(rng() % 8 == 0) { EXPECT_EQ(m.erase(k), ref.erase(k)); }
+            break;
+        default:
+        {
+            auto r = m.equal_range(k);
+            auto rr = ref.equal_range(k);
+            ASSERT_EQ(std::distance(r.first, r.second), std::distance(rr.first, rr.second));
+            EXPECT_TRUE(std::equal(r.first, r.second, rr.first, [](auto& a, auto& b) { return a.second == b.second; }));
+            EXPECT_EQ(m.count(k), ref.count(k));
+            break;
+        }
+        }
+    }
+    expect_same(m, ref);
+}
+
+TEST(FlatMultimap, BulkInsert)
+{
+    std::vector<std::pair<int, int>> src;
+    std::mt19937 rng(22);
+    for(int i = 0; i < 3000; ++i) { src.emplace_back(static_cast<int>(rng() % 100), i); }
+    flat_multimap<int, int> m(src.begin(), src.end());
+    std::multimap<int, int> ref(src.begin(), src.end());
+    expect_same(m, ref);
+
+    // Existing elements stay before the new equivalent ones
+    m.insert(src.begin(), src.end());
+    ref.insert(src.begin(), src.end());
+    expect_same(m, ref);
+
+    std::vector<std::pair<int, int>> sorted = { { 1, 0 }, { 1, 1 }, { 5, 2 } };
+    flat_multimap<int, int> s(goblib::sorted_equivalent, sorted.begin(), sorted.end());
+    s.insert(goblib::sorted_equivalent, { { 0, 3 }, { 1, 4 } });
+    EXPECT_EQ(s.count(1), 3U);
+    EXPECT_EQ(std::prev(s.upper_bound(1))->second, 4);
+
+    flat_multimap<int, int> a = { { 1, 1 }, { 2, 2 } }, b = { { 1, 10 }, { 3, 30 } };
+    a.merge(b);
+    EXPECT_TRUE(b.empty());
+    EXPECT_EQ(a.count(1), 2U);
+    EXPECT_EQ(a.find(1)->second, 1);
+
+    auto v = std::move(a).extract();
+    EXPECT_TRUE(a.empty());
+    EXPECT_EQ(v.size(), 4U);
+    a.replace(std::move(v));
+    EXPECT_EQ(a.size(), 4U);
+}
+
+TEST(FlatMultimap, Heterogeneous)
+{
+    flat_multimap<std::string, int, std::less<>> m = { { "apple", 1 }, { "banana", 2 }, { "apple", 3 } };
+    EXPECT_EQ(m.count(std::string_view("apple")), 2U);
+    EXPECT_EQ(m.find(std::string_view("banana"))->second, 2);
+    EXPECT_EQ(m.lower_bound(std::string_view("b"))->first, "banana");
+    EXPECT_EQ(m.erase(std::string_view("apple")), 2U);
+    EXPECT_EQ(m.size(), 1U);
+}
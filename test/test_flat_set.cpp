@@ -0,0 +1,139 @@
+/*
+  Unit testing for flat_set and flat_multiset
+*/
+#include <gob_stdmap.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+using goblib::flat_multiset;
+using goblib::flat_set;
+
+TEST(FlatSet, Basic)
+{
+    flat_set<int> s;
+    EXPECT_TRUE(s.empty());
+    EXPECT_TRUE(s.insert(3).second);
+    EXPECT_FALSE(s.insert(3).second);
+    s.emplace(1);
+    s.insert(s.end(), 5);
+    s.insert(s.begin(), 4);  // Wrong hint
+    EXPECT_EQ(s.size(), 4U);
+    EXPECT_EQ(std::vector<int>(s.begin(), s.end()), (std::vector<int>{ 1, 3, 4, 5 }));
+    EXPECT_EQ(s.count(3), 1U);
+    EXPECT_EQ(s.count(2), 0U);
+    EXPECT_EQ(*s.lower_bound(2), 3);
+    EXPECT_EQ(*s.upper_bound(3), 4);
+    auto r = s.equal_range(4);
+    EXPECT_EQ(std::distance(r.first, r.second), 1);
+    EXPECT_EQ(s.erase(4), 1U);
+    EXPECT_EQ(*s.erase(s.begin()), 3);
+    static_assert(std::is_same<flat_set<int>::iterator, flat_set<int>::const_iterator>::value, "set elements are immutable");
+    static_assert(std::is_same<flat_set<int>::value_compare, std::less<int>>::value, "");
+
+    flat_set<int> a = { 5, 1, 3, 1 }, b = { 3, 4 };
+    EXPECT_EQ(a.size(), 3U);
+    a.merge(b);
+    EXPECT_EQ(a.size(), 4U);
+    EXPECT_EQ(std::vector<int>(b.begin(), b.end()), std::vector<int>{ 3 });
+    EXPECT_EQ(goblib::erase_if(a, [](int v) { return v % 2; }), 3U);
+    EXPECT_EQ(a, (flat_set<int>{ 4 }));
+    EXPECT_LT(a, (flat_set<int>{ 5 }));
+}
+
+TEST(FlatSet, CompatibleWithStdSet)
+{
+    flat_set<std::uint32_t> s;
+    std::set<std::uint32_t> ref;
+    std::mt19937 rng(31);
+    for(int i = 0; i < 20000; ++i)
+    {
+        auto k = static_cast<std::uint32_t>(rng() % 3000);
+        switch(rng() % 4)
+        {
+        case 0:
+        case 1:
+            EXPECT_EQ(s.insert(k).second, ref.insert(k).second);
+            break;
+        case 2:
+            EXPECT_EQ(s.erase(k), ref.erase(k));
+            break;
+        default:
+            EXPECT_EQ(s.contains(k), ref.count(k) == 1);
+            break;
+        }
+    }
+    EXPECT_TRUE(std::equal(s.begin(), s.end(), ref.begin(), ref.end()));
+
+    std::vector<std::uint32_t> src(5000);
+    for(auto& v : src) { v = static_cast<std::uint32_t>(rng() % 10000); }
+    s.insert(src.begin(), src.end());
+    ref.insert(src.begin(), src.end());
+    EXPECT_TRUE(std::equal(s.begin(), s.end(), ref.begin(), ref.end()));
+    EXPECT_TRUE(std::equal(s.rbegin(), s.rend(), ref.rbegin(), ref.rend()));
+}
+
+TEST(FlatMultiset, Basic)
+{
+    flat_multiset<int> s = { 3, 1, 3, 2, 3 };
+    EXPECT_EQ(s.size(), 5U);
+    EXPECT_EQ(s.count(3), 3U);
+    EXPECT_EQ(*s.insert(1), 1);
+    EXPECT_EQ(s.count(1), 2U);
+    auto r = s.equal_range(3);
+    EXPECT_EQ(std::distance(r.first, r.second), 3);
+    EXPECT_EQ(r.second, s.end());
+    EXPECT_EQ(s.erase(3), 3U);
+    EXPECT_EQ(std::vector<int>(s.begin(), s.end()), (std::vector<int>{ 1, 1, 2 }));
+
+    flat_multiset<int> b(goblib::sorted_equivalent, { 1, 4, 4 });
+    s.merge(b);
+    EXPECT_TRUE(b.empty());
+    EXPECT_EQ(std::vector<int>(s.begin(), s.end()), (std::vector<int>{ 1, 1, 1, 2, 4, 4 }));
+    EXPECT_EQ(goblib::erase_if(s, [](int v) { return v == 1; }), 3U);
+    EXPECT_EQ(s.size(), 3U);
+}
+
+TEST(FlatMultiset, CompatibleWithStdMultiset)
+{
+    flat_multiset<std::uint32_t> s;
+    std::multiset<std::uint32_t> ref;
+    std::mt19937 rng(32);
+    for(int i = 0; i < 20000; ++i)
+    {
+        auto k = static_cast<std::uint32_t>(rng() % 300);
+        switch(rng() % 4)
+        {
+        case 0:
+        case 1:
+            s.insert(k);
+            ref.insert(k);
+            break;
+        case 2:
+            if(rng() % 8 == 0) { EXPECT_EQ(s.erase(k), ref.erase(k)); }
+            break;
+        default:
+            EXPECT_EQ(s.count(k), ref.count(k));
+            break;
+        }
+    }
+    EXPECT_TRUE(std::equal(s.begin(), s.end(), ref.begin(), ref.end()));
+}
+
+TEST(FlatSet, Heterogeneous)
+{
+    flat_set<std::string, std::less<>> s = { "apple", "banana" };
+    EXPECT_TRUE(s.contains(std::string_view("apple")));
+    EXPECT_EQ(*s.find(std::string_view("banana")), "banana");
+    EXPECT_EQ(s.erase(std::string_view("apple")), 1U);
+    flat_multiset<std::string, std::less<>> m = { "a", "b", "a" };
+    EXPECT_EQ(m.count(std::string_view("a")), 2U);
+    EXPECT_EQ(*m.upper_bound(std::string_view("a")), "b");
+}
@@ -0,0 +1,100 @@
+/*
+  Unit testing for frozen_map
+*/
+#include <gob_stdmap.hpp>
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+#include <string_view>
+#include <random>
+#include <vector>
+
+using goblib::frozen_map;
+
+TEST(FrozenMap, Empty)
+{
+    frozen_map<int, int> m;
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.begin(), m.end());
+    EXPECT_EQ(m.find(0), m.end());
+    EXPECT_EQ(m.lower_bound(0), m.end());
+    EXPECT_FALSE(m.contains(0));
+}
+
+TEST(FrozenMap, Basic)
+{
+    frozen_map<int, std::string> m{ { 3, "three" }, { 1, "one" }, { 2, "two" }, { 1, "ichi" } };
+    EXPECT_EQ(m.size(), 3U);
+    EXPECT_EQ(m.at(1), "one");  // First one is kept
+    EXPECT_EQ(m.find(2)->second, "two");
+    EXPECT_EQ(m.count(3), 1U);
+    EXPECT_EQ(m.count(4), 0U);
+    EXPECT_THROW(m.at(4), std::out_of_range);
+
+    m.find(3)->second = "san";
+    EXPECT_EQ(m.at(3), "san");
+
+    int expect = 1;
+    for(auto e : m) { EXPECT_EQ(e.first, expect++); }
+    EXPECT_EQ(expect, 4);
+    EXPECT_EQ(m.rbegin()->first, 3);
+    EXPECT_EQ(std::prev(m.end())->first, 3);
+}
+
+TEST(FrozenMap, Bounds)
+{
+    // Every size up to a few full levels, including incomplete last level
+    for(int n = 0; n < 70; ++n)
+    {
+        std::vector<std::pair<int, int>> src;
+        for(int i = 0; i < n; ++i) { src.emplace_back(i * 2, i); }
+        std::shuffle(src.begin(), src.end(), std::mt19937(n));
+        frozen_map<int, int> m(src.begin(), src.end());
+        std::map<int, int> sm(src.begin(), src.end());
+        ASSERT_EQ(m.size(), sm.size());
+
+        // In-order traversal both ways
+        EXPECT_TRUE(std::equal(sm.begin(), sm.end(), m.begin(), [](const std::pair<const int, int>& a, std::pair<const int&, int&> b) {
+            return a.first == b.first && a.second == b.second;
+        }));
+        EXPECT_TRUE(std::equal(sm.rbegin(), sm.rend(), m.rbegin(), [](const std::pair<const int, int>& a, std::pair<const int&, int&> b) {
+            return a.first == b.first;
+        }));
+
+        for(int k = -1; k <= n * 2 + 1; ++k)
+        {
+            auto lb = sm.lower_bound(k);
+            auto flb = m.lower_bound(k);
+            if(lb == sm.end()) { EXPECT_EQ(flb, m.end()); }
+            else { EXPECT_EQ(lb->first, flb->first); }
+            auto ub = sm.upper_bound(k);
+            auto fub = m.upper_bound(k);
+            if(ub == sm.end()) { EXPECT_EQ(fub, m.end()); }
+            else { EXPECT_EQ(ub->first, fub->first); }
+            EXPECT_EQ(sm.count(k), m.count(k));
+            auto er = m.equal_range(k);
+            EXPECT_EQ(std::distance(er.first, er.second), static_cast<std::ptrdiff_t>(sm.count(k)));
+        }
+    }
+}
+
+TEST(FrozenMap, StringKey)
+{
+    frozen_map<std::string, int, std::greater<std::string>> m{ { "apple", 1 }, { "banana", 2 }, { "cherry", 3 } };
+    EXPECT_EQ(m.begin()->first, "cherry");
+    EXPECT_EQ(m.at("banana"), 2);
+    EXPECT_FALSE(m.contains("durian"));
+}
+
+TEST(FrozenMap, Heterogeneous)
+{
+    goblib::frozen_map<std::string, int, std::less<>> m = { { "GET", 1 }, { "PUT", 2 }, { "POST", 3 }, { "DELETE", 4 } };
+    EXPECT_EQ(m.find(std::string_view("POST"))->second, 3);
+    EXPECT_EQ(m.find("HEAD"), m.end());
+    EXPECT_EQ(m.count("GET"), 1U);
+    EXPECT_TRUE(m.contains(std::string_view("DELETE")));
+    EXPECT_EQ(m.lower_bound("H")->first, "POST");
+    EXPECT_EQ(m.upper_bound("PUT"), m.end());
+    auto r = m.equal_range("PUT");
+    EXPECT_EQ(std::distance(r.first, r.second), 1);
+}
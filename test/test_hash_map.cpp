@@ -0,0 +1,369 @@
+/*
+  Unit testing for hash_map
+*/
+#include <gob_stdmap.hpp>
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <unordered_map>
+#include <string>
+#include <string_view>
+#include <random>
+#include <sstream>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+using goblib::hash_map;
+
+namespace {
+// Every key collides
+struct constant_hash
+{
+    std::size_t operator()(int) const { return 42; }
+};
+
+// Stateful allocator that stays with its container on move assignment. Equal if the tags are
+template <class T>
+struct tagged_allocator
+{
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::false_type;
+    using is_always_equal = std::false_type;
+    int tag{};
+    explicit tagged_allocator(int t = 0) : tag(t) {}
+    template <class U>
+    tagged_allocator(const tagged_allocator<U>& o) : tag(o.tag) {}
+    T* allocate(std::size_t n) { return std::allocator<T>().allocate(n); }
+    void deallocate(T* p, std::size_t n) { std::allocator<T>().deallocate(p, n); }
+    template <class U>
+    bool operator==(const tagged_allocator<U>& o) const { return tag == o.tag; }
+    template <class U>
+    bool operator!=(const tagged_allocator<U>& o) const { return tag != o.tag; }
+};
+}  // namespace
+
+TEST(HashMap, Basic)
+{
+    hash_map<int, std::string> m;
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.begin(), m.end());
+    EXPECT_EQ(m.find(1), m.end());
+    EXPECT_EQ(m.bucket_count(), 0U);
+
+    EXPECT_TRUE(m.insert({ 1, "one" }).second);
+    EXPECT_FALSE(m.insert({ 1, "ichi" }).second);
+    m.emplace(2, "two");
+    m.try_emplace(3, 3, 'c');
+    m[4] = "four";
+    EXPECT_EQ(m.size(), 4U);
+    EXPECT_EQ(m.at(1), "one");
+    EXPECT_EQ(m.at(3), "ccc");
+    EXPECT_THROW(m.at(5), std::out_of_range);
+    EXPECT_EQ(m.count(2), 1U);
+    EXPECT_FALSE(m.contains(0));
+    EXPECT_FALSE(m.insert_or_assign(2, "ni").second);
+    EXPECT_EQ(m[2], "ni");
+
+    EXPECT_EQ(std::distance(m.begin(), m.end()), 4);
+    EXPECT_EQ(m.erase(2), 1U);
+    EXPECT_EQ(m.erase(2), 0U);
+    EXPECT_EQ(m.size(), 3U);
+    auto er = m.equal_range(3);
+    EXPECT_EQ(std::distance(er.first, er.second), 1);
+
+    hash_map<int, std::string> c = m;
+    EXPECT_EQ(c, m);
+    c[9] = "nine";
+    EXPECT_NE(c, m);
+    hash_map<int, std::string> mv = std::move(c);
+    EXPECT_EQ(mv.size(), 4U);
+    EXPECT_TRUE(c.empty());
+    m.clear();
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.begin(), m.end());
+}
+
+TEST(HashMap, Collision)
+{
+    hash_map<int, int, constant_hash> m;
+    for(int i = 0; i < 200; ++i) { m[i] = i; }
+    for(int i = 0; i < 200; ++i) { EXPECT_EQ(m.at(i), i); }
+    for(int i = 0; i < 200; i += 2) { m.erase(i); }
+    for(int i = 0; i < 200; ++i) { EXPECT_EQ(m.count(i), static_cast<std::size_t>(i & 1)); }
+}
+
+TEST(HashMap, Tombstone)
+{
+    // Insert / erase churn must not grow the table forever
+    hash_map<int, int> m;
+    m.reserve(100);
+    auto cap = m.bucket_count();
+    for(int i = 0; i < 100000; ++i)
+    {
+        m[i] = i;
+        if(i >= 50) { m.erase(i - 50); }
+    }
+    EXPECT_EQ(m.size(), 50U);
+    EXPECT_EQ(m.bucket_count(), cap);
+    for(int i = 100000 - 50; i < 100000; ++i) { EXPECT_EQ(m.at(i), i); }
+}
+
+TEST(HashMap, Iterate)
+{
+    hash_map<int, int> m;
+    for(int i = 0; i < 1000; ++i) { m[i] = i; }
+    long sum{};
+    for(auto& e : m) { sum += e.second; }
+    EXPECT_EQ(sum, 999 * 1000 / 2);
+
+    auto n = goblib::erase_if(m, [](const std::pair<const int, int>& e) { return e.first % 3 == 0; });
+    EXPECT_EQ(n, 334U);
+    EXPECT_EQ(m.size(), 666U);
+    for(auto& e : m) { EXPECT_NE(e.first % 3, 0); }
+
+    const auto& cm = m;
+    hash_map<int, int>::const_iterator it = m.begin();
+    EXPECT_EQ(it, cm.begin());
+}
+
+TEST(HashMap, Rehash)
+{
+    hash_map<std::string, int> m;
+    m.reserve(1000);
+    auto cap = m.bucket_count();
+    EXPECT_GE(cap * 7 / 8, 1000U);
+    for(int i = 0; i < 1000; ++i) { m[std::to_string(i)] = i; }
+    EXPECT_EQ(m.bucket_count(), cap);
+    EXPECT_LE(m.load_factor(), m.max_load_factor());
+    m.rehash(cap * 4);
+    EXPECT_EQ(m.bucket_count(), cap * 4);
+    for(int i = 0; i < 1000; ++i) { EXPECT_EQ(m.at(std::to_string(i)), i); }
+}
+
+TEST(HashMap, MoveOnly)
+{
+    hash_map<int, std::unique_ptr<int>> m;
+    for(int i = 0; i < 100; ++i) { m.try_emplace(i, new int(i)); }
+    for(int i = 0; i < 100; ++i) { EXPECT_EQ(*m.at(i), i); }
+}
+
+TEST(HashMap, MoveAssignAllocator)
+{
+    using alloc = tagged_allocator<std::pair<const int, std::string>>;
+    using map = hash_map<int, std::string, std::hash<int>, std::equal_to<int>, alloc>;
+    static_assert(!std::is_nothrow_move_assignable<map>::value);
+    map src(0, std::hash<int>(), std::equal_to<int>(), alloc(1));
+    for(int i = 0; i < 100; ++i) { src.try_emplace(i, std::to_string(i)); }
+
+    // Equal allocators: the storage is taken over
+    map a(0, std::hash<int>(), std::equal_to<int>(), alloc(1));
+    map b = src;
+    auto p = &b.at(7);
+    a = std::move(b);
+    EXPECT_EQ(&a.at(7), p);
+    EXPECT_TRUE(b.empty());
+
+    // Unequal allocators that do not propagate: the elements move into storage of this allocator
+    map c(0, std::hash<int>(), std::equal_to<int>(), alloc(2));
+    c.try_emplace(-1, "x");
+    p = &a.at(7);
+    c = std::move(a);
+    EXPECT_EQ(c.get_allocator().tag, 2);
+    EXPECT_NE(&c.at(7), p);
+    EXPECT_EQ(c, src);
+    EXPECT_TRUE(a.empty());
+}
+
+TEST(HashMap, PolymorphicAllocator)
+{
+    // Allocators that propagate on neither copy, move nor swap
+    using map = hash_map<int, std::string, std::hash<int>, std::equal_to<int>, std::pmr::polymorphic_allocator<std::pair<const int, std::string>>>;
+    std::pmr::monotonic_buffer_resource r1, r2;
+    map a(0, std::hash<int>(), std::equal_to<int>(), &r1);
+    map b(0, std::hash<int>(), std::equal_to<int>(), &r2);
+    for(int i = 0; i < 100; ++i) { a.try_emplace(i, std::to_string(i)); }
+    b = a;
+    EXPECT_EQ(b.get_allocator().resource(), &r2);
+    EXPECT_EQ(b, a);
+    map c(0, std::hash<int>(), std::equal_to<int>(), &r2);
+    c = std::move(b);
+    EXPECT_EQ(c, a);
+    swap(b, c);
+    EXPECT_EQ(b, a);
+    EXPECT_EQ(b.get_allocator().resource(), &r2);
+}
+
+TEST(HashMap, AliasedArguments)
+{
+    // The key or the mapped value comes from an element, and the insertion grows the table
+    hash_map<std::string, std::string> m;
+    auto fill = [&m] {
+        while(m.size() < 10 || m.growth_left() > 0) { m.try_emplace(std::to_string(m.size()), std::string(40, static_cast<char>('a' + m.size() % 26))); }
+    };
+    fill();
+    auto buckets = m.bucket_count();
+    EXPECT_TRUE(m.try_emplace("new", m.at("3")).second);
+    EXPECT_GT(m.bucket_count(), buckets);
+    EXPECT_EQ(m.at("new"), std::string(40, 'd'));
+
+    fill();
+    buckets = m.bucket_count();
+    const std::string& element = m.at("4");
+    EXPECT_TRUE(m.insert_or_assign(element, element).second);
+    EXPECT_GT(m.bucket_count(), buckets);
+    EXPECT_EQ(m.at(std::string(40, 'e')), std::string(40, 'e'));
+}
+
+TEST(HashMap, PortableGroup)
+{
+    using namespace goblib::stdmap_detail;
+    ctrl_t ctrl[8] = { 5, ctrl_empty, ctrl_deleted, 5, 0x7F, ctrl_empty, 1, ctrl_deleted };
+    group_portable g(ctrl);
+    std::vector<unsigned> pos;
+    for(auto m = g.match(5); m; m.clear_lowest()) { pos.push_back(m.lowest()); }
+    EXPECT_EQ(pos, (std::vector<unsigned>{ 0, 3 }));
+    pos.clear();
+    for(auto m = g.match_empty(); m; m.clear_lowest()) { pos.push_back(m.lowest()); }
+    EXPECT_EQ(pos, (std::vector<unsigned>{ 1, 5 }));
+    pos.clear();
+    for(auto m = g.match_empty_or_deleted(); m; m.clear_lowest()) { pos.push_back(m.lowest()); }
+    EXPECT_EQ(pos, (std::vector<unsigned>{ 1, 2, 5, 7 }));
+}
+
+TEST(HashMap, CompatibleWithStdUnorderedMap)
+{
+    std::mt19937 rng(777);
+    std::uniform_int_distribution<int> dist(0, 4999);
+    std::unordered_map<int, int> sm;
+    hash_map<int, int> hm;
+
+    for(int i = 0; i < 50000; ++i)
+    {
+        int k = dist(rng);
+        switch(i % 4)
+        {
+        case 0:
+        case 1: sm[k] = i; hm[k] = i; break;
+        case 2: EXPECT_EQ(sm.erase(k), hm.erase(k)); break;
+        default: EXPECT_EQ(sm.count(k), hm.count(k)); break;
+        }
+    }
+    ASSERT_EQ(sm.size(), hm.size());
+    for(auto& e : sm) { EXPECT_EQ(hm.at(e.first), e.second); }
+    EXPECT_EQ(static_cast<std::size_t>(std::distance(hm.begin(), hm.end())), sm.size());
+}
+
+TEST(HashMap, Heterogeneous)
+{
+    hash_map<std::string, int, goblib::string_hash, std::equal_to<>> m;
+    for(int i = 0; i < 100; ++i) { m.emplace("key" + std::to_string(i), i); }
+    EXPECT_EQ(m.find(std::string_view("key42"))->second, 42);
+    EXPECT_EQ(m.find("key100"), m.end());
+    EXPECT_EQ(m.count("key7"), 1U);
+    EXPECT_TRUE(m.contains(std::string_view("key99")));
+    auto r = m.equal_range("key1");
+    EXPECT_EQ(std::distance(r.first, r.second), 1);
+    EXPECT_EQ(m.erase("key1"), 1U);
+    EXPECT_EQ(m.erase(std::string_view("key1")), 0U);
+    EXPECT_EQ(m.size(), 99U);
+    m.erase(m.begin());
+    EXPECT_EQ(m.size(), 98U);
+}
+
+TEST(HashMap, Stats)
+{
+    // Disabled policy takes no room
+    struct plain
+    {
+        std::hash<int> h;
+        std::equal_to<int> e;
+        std::allocator<std::pair<const int, int>> a;
+        void* ctrl;
+        void* slots;
+        std::size_t capacity, size, growth_left;
+    };
+    EXPECT_EQ(sizeof(hash_map<int, int>), sizeof(plain));
+
+    using map = hash_map<int, int, std::hash<int>, std::equal_to<int>, std::allocator<std::pair<const int, int>>, goblib::map_stats>;
+    map m;
+    for(int i = 0; i < 1000; ++i) { m.emplace(i, i); }
+    EXPECT_EQ(m.stats().peak_size(), 1000U);
+    EXPECT_GT(m.stats().reallocations(), 3U);
+    EXPECT_GT(m.stats().bytes_moved(), 1000 * sizeof(std::pair<const int, int>));
+    EXPECT_EQ(m.stats().lookups(), 0U);
+
+    for(int i = 0; i < 2000; ++i) { (void)m.find(i); }
+    EXPECT_EQ(m.stats().lookups(), 2000U);
+    EXPECT_EQ(m.stats().hits(), 1000U);
+    EXPECT_GE(m.stats().average_probes(), 1.0);
+    EXPECT_LT(m.stats().average_probes(), 2.0);
+
+    // All keys on one probe sequence
+    hash_map<int, int, constant_hash, std::equal_to<int>, std::allocator<std::pair<const int, int>>, goblib::map_stats> bad;
+    for(int i = 0; i < 200; ++i) { bad.emplace(i, i); }
+    bad.reset_stats();
+    for(int i = 0; i < 200; ++i) { EXPECT_TRUE(bad.contains(i)); }
+    EXPECT_GT(bad.stats().average_probes(), 4.0);
+
+    std::ostringstream os;
+    os << m.stats();
+    EXPECT_EQ(os.str().rfind("lookups=2000 hits=1000 misses=1000 ", 0), 0U);
+    map moved(std::move(m));
+    EXPECT_EQ(moved.stats().lookups(), 2000U);
+}
+
+namespace {
+// Move-only, over-aligned value which counts its moves
+struct alignas(64) block
+{
+    static inline int moves = 0;
+    explicit block(int n) : v(n) {}
+    block(block&& o) noexcept : v(o.v) { ++moves; }
+    block& operator=(block&& o) noexcept
+    {
+        v = o.v;
+        ++moves;
+        return *this;
+    }
+    int v;
+};
+struct relocatable_block : block
+{
+    using block::block;
+};
+}  // namespace
+
+template <>
+struct goblib::is_trivially_relocatable<relocatable_block> : std::true_type
+{
+};
+
+TEST(HashMap, InPlaceEmplace)
+{
+    hash_map<int, block> m;
+    block::moves = 0;
+    for(int i = 0; i < 1000; ++i)
+    {
+        m.try_emplace(i, i);
+        m.emplace(i + 1000, i);
+    }
+    // Rehash moves the elements
+    EXPECT_GT(block::moves, 0);
+    for(auto& e : m) { EXPECT_EQ(reinterpret_cast<std::uintptr_t>(&e.second) % 64, 0U); }
+
+    // Relocatable elements are copied bytewise, so nothing is ever moved
+    hash_map<int, relocatable_block> r;
+    block::moves = 0;
+    for(int i = 0; i < 1000; ++i)
+    {
+        r.try_emplace(i, i);
+        r.emplace(i + 1000, i);
+    }
+    EXPECT_EQ(block::moves, 0);
+    EXPECT_EQ(r.size(), 2000U);
+    for(int i = 0; i < 1000; ++i) { EXPECT_EQ(r.at(i + 1000).v, i); }
+
+    hash_map<int, std::unique_ptr<int>> u;
+    for(int i = 0; i < 1000; ++i) { u.emplace(i, std::make_unique<int>(i)); }
+    for(int i = 0; i < 1000; ++i) { EXPECT_EQ(*u.at(i), i); }
+}
@@ -0,0 +1,248 @@
+/*
+  Unit testing for incremental_hash_map
+*/
+#include <gob_stdmap.hpp>
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <string>
+#include <string_view>
+#include <random>
+#include <vector>
+
+using goblib::incremental_hash_map;
+
+namespace {
+// Every element is reached exactly once by iteration, and found by lookup
+template <class M, class R>
+void expect_same(const M& m, const R& ref)
+{
+    ASSERT_EQ(m.size(), ref.size());
+    std::size_t n{};
+    std::unordered_set<typename M::key_type> seen;
+    for(auto& e : m)
+    {
+        ++n;
+        EXPECT_TRUE(seen.insert(e.first).second);
+        auto it = ref.find(e.first);
+        ASSERT_NE(it, ref.end());
+        EXPECT_EQ(e.second, it->second);
+    }
+    EXPECT_EQ(n, ref.size());
+    for(auto& e : ref)
+    {
+        auto it = m.find(e.first);
+        ASSERT_NE(it, m.end());
+        EXPECT_EQ(it->second, e.second);
+    }
+}
+
+// Stateful allocator that stays with its container on move assignment. Equal if the tags are
+template <class T>
+struct tagged_allocator
+{
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::false_type;
+    using is_always_equal = std::false_type;
+    int tag{};
+    explicit tagged_allocator(int t = 0) : tag(t) {}
+    template <class U>
+    tagged_allocator(const tagged_allocator<U>& o) : tag(o.tag) {}
+    T* allocate(std::size_t n) { return std::allocator<T>().allocate(n); }
+    void deallocate(T* p, std::size_t n) { std::allocator<T>().deallocate(p, n); }
+    template <class U>
+    bool operator==(const tagged_allocator<U>& o) const { return tag == o.tag; }
+    template <class U>
+    bool operator!=(const tagged_allocator<U>& o) const { return tag != o.tag; }
+};
+}  // namespace
+
+TEST(IncrementalHashMap, Basic)
+{
+    incremental_hash_map<int, std::string> m;
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.begin(), m.end());
+    EXPECT_FALSE(m.rehashing());
+
+    EXPECT_TRUE(m.insert({ 1, "one" }).second);
+    EXPECT_FALSE(m.insert({ 1, "ichi" }).second);
+    m.emplace(2, "two");
+    m.try_emplace(3, 3, 'c');
+    m[4] = "four";
+    EXPECT_EQ(m.size(), 4U);
+    EXPECT_EQ(m.at(1), "one");
+    EXPECT_EQ(m.at(3), "ccc");
+    EXPECT_THROW(m.at(5), std::out_of_range);
+    EXPECT_FALSE(m.insert_or_assign(2, "ni").second);
+    EXPECT_EQ(m[2], "ni");
+    EXPECT_EQ(m.erase(2), 1U);
+    EXPECT_EQ(m.erase(2), 0U);
+
+    // Grow through several migrations; values inserted before a migration stay reachable
+    for(int i = 5; i < 1000; ++i) { m.try_emplace(i, std::to_string(i)); }
+    EXPECT_EQ(m.size(), 998U);
+    EXPECT_EQ(m.at(1), "one");
+    EXPECT_EQ(m.at(999), "999");
+    EXPECT_EQ(std::distance(m.begin(), m.end()), 998);
+
+    incremental_hash_map<int, std::string> c = m;
+    EXPECT_FALSE(c.rehashing());
+    EXPECT_EQ(c, m);
+    c[-1] = "x";
+    EXPECT_NE(c, m);
+    incremental_hash_map<int, std::string> mv = std::move(c);
+    EXPECT_EQ(mv.size(), 999U);
+    EXPECT_EQ(mv.at(-1), "x");
+    swap(mv, m);
+    EXPECT_EQ(m.size(), 999U);
+    EXPECT_EQ(goblib::erase_if(m, [](auto& e) { return e.first % 2 == 0; }), 498U);
+    EXPECT_EQ(m.count(4), 0U);
+    EXPECT_EQ(m.count(5), 1U);
+    m.clear();
+    EXPECT_TRUE(m.empty());
+    EXPECT_FALSE(m.rehashing());
+    EXPECT_EQ(m.begin(), m.end());
+}
+
+TEST(IncrementalHashMap, MoveAssignAllocator)
+{
+    // Allocators that do not propagate and differ: the migration in progress is finished before moving the elements
+    using alloc = tagged_allocator<std::pair<const int, int>>;
+    using map = incremental_hash_map<int, int, std::hash<int>, std::equal_to<int>, alloc, 1>;
+    map a(0, std::hash<int>(), std::equal_to<int>(), alloc(1));
+    for(int i = 0; !a.rehashing() || i < 100; ++i) { a[i] = i; }
+    const auto n = a.size();
+    map b(0, std::hash<int>(), std::equal_to<int>(), alloc(2));
+    b = std::move(a);
+    EXPECT_EQ(b.get_allocator().tag, 2);
+    EXPECT_EQ(b.size(), n);
+    // Insertions keep migrating from the right table
+    for(int i = static_cast<int>(n); i < static_cast<int>(n) + 300; ++i) { b[i] = i; }
+    b.finish_rehash();
+    for(int i = 0; i < static_cast<int>(n) + 300; ++i) { ASSERT_EQ(b.at(i), i); }
+    EXPECT_EQ(std::distance(b.begin(), b.end()), static_cast<std::ptrdiff_t>(n + 300));
+}
+
+TEST(IncrementalHashMap, BoundedMigration)
+{
+    incremental_hash_map<std::uint32_t, std::uint32_t, std::hash<std::uint32_t>, std::equal_to<std::uint32_t>,
+                         std::allocator<std::pair<const std::uint32_t, std::uint32_t>>, 4>
+            m;
+    std::size_t migrations{};
+    for(std::uint32_t i = 0; i < 100000; ++i)
+    {
+        const bool was = m.rehashing();
+        const auto pending = m.rehash_pending();
+        const auto buckets = m.bucket_count();
+        ASSERT_TRUE(m.try_emplace(i, i).second);
+        if(!was && m.rehashing())
+        {
+            // A migration starts with a table of twice the slots and no element moved beyond the step
+            ++migrations;
+            EXPECT_EQ(m.bucket_count(), buckets * 2);
+            EXPECT_GE(m.rehash_pending() + 4, buckets - buckets / 8);
+        }
+        else if(was) { EXPECT_LE(pending - m.rehash_pending(), 4U); }
+        // The new table never grows while a migration is in progress
+        if(was && m.rehashing()) { EXPECT_EQ(m.bucket_count(), buckets); }
+    }
+    EXPECT_GE(migrations, 10U);
+    for(std::uint32_t i = 0; i < 100000; i += 97) { ASSERT_EQ(m.at(i), i); }
+
+    // Explicit steps
+    while(!m.rehashing()) { m.try_emplace(static_cast<std::uint32_t>(m.size()), 0); }
+    auto pending = m.rehash_pending();
+    EXPECT_TRUE(m.rehash_step(10));
+    EXPECT_EQ(m.rehash_pending(), pending - 10);
+    m.finish_rehash();
+    EXPECT_FALSE(m.rehashing());
+    EXPECT_EQ(m.rehash_pending(), 0U);
+}
+
+TEST(IncrementalHashMap, CompatibleWithUnorderedMap)
+{
+    // Step 1 keeps migrations long, so the operations hit elements in both tables
+    incremental_hash_map<std::uint32_t, std::string, std::hash<std::uint32_t>, std::equal_to<std::uint32_t>,
+                         std::allocator<std::pair<const std::uint32_t, std::string>>, 1>
+            m;
+    std::unordered_map<std::uint32_t, std::string> ref;
+    std::mt19937 rng(11);
+    for(int i = 0; i < 60000; ++i)
+    {
+        auto k = static_cast<std::uint32_t>(rng() % 20000);
+        switch(rng() % 8)
+        {
+        case 0:
+        case 1:
+        case 2:
+            EXPECT_EQ(m.try_emplace(k, std::to_string(i)).second, ref.try_emplace(k, std::to_string(i)).second);
+            break;
+        case 3:
+            EXPECT_EQ(m.insert_or_assign(k, "a").second, ref.insert_or_assign(k, "a").second);
+            break;
+        case 4:
+            EXPECT_EQ(m.erase(k), ref.erase(k));
+            break;
+        case 5:
+        {
+            auto it = m.find(k);
+            ASSERT_EQ(it == m.end(), !ref.count(k));
+            if(it != m.end())
+            {
+                ref.erase(k);
+                m.erase(it);
+            }
+            break;
+        }
+        case 6:
+            EXPECT_EQ(m.contains(k), ref.count(k) == 1);
+            break;
+        default:
+            if(i % 1000 == 0) { expect_same(m, ref); }
+            break;
+        }
+    }
+    expect_same(m, ref);
+
+    // Erasing while iterating in the middle of a migration
+    while(!m.rehashing()) { m.try_emplace(static_cast<std::uint32_t>(rng()), "n"); }
+    for(auto it = m.begin(); it != m.end();)
+    {
+        if(it->first % 3 == 0) { it = m.erase(it); }
+        else { ++it; }
+    }
+    for(auto& e : m) { EXPECT_NE(e.first % 3, 0U); }
+    auto r = m.erase(m.begin(), m.end());
+    EXPECT_EQ(r, m.end());
+    EXPECT_TRUE(m.empty());
+}
+
+TEST(IncrementalHashMap, Tombstones)
+{
+    // Insert / erase churn at a constant size reuses the table instead of growing without bound
+    incremental_hash_map<int, int> m;
+    for(int i = 0; i < 1000; ++i) { m[i] = i; }
+    m.finish_rehash();
+    const auto buckets = m.bucket_count();
+    for(int i = 1000; i < 200000; ++i)
+    {
+        m[i] = i;
+        m.erase(i - 1000);
+    }
+    EXPECT_EQ(m.size(), 1000U);
+    EXPECT_LE(m.bucket_count(), buckets * 2);
+    for(int i = 199000; i < 200000; ++i) { ASSERT_EQ(m.at(i), i); }
+}
+
+TEST(IncrementalHashMap, HeterogeneousLookup)
+{
+    incremental_hash_map<std::string, int, goblib::string_hash, std::equal_to<>> m;
+    for(int i = 0; i < 300; ++i) { m[std::to_string(i)] = i; }
+    EXPECT_EQ(m.find(std::string_view("42"))->second, 42);
+    EXPECT_TRUE(m.contains("299"));
+    EXPECT_EQ(m.count(std::string_view("300")), 0U);
+    EXPECT_EQ(m.erase(std::string_view("7")), 1U);
+    EXPECT_FALSE(m.contains("7"));
+}
@@ -0,0 +1,181 @@
+/*
+  Unit testing for mapped_map
+*/
+#include <gob_stdmap.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using goblib::mapped_map;
+using goblib::write_mapped_map;
+
+namespace {
+struct temp_file
+{
+    std::string path{ testing::TempDir() + "gob_mapped_map_" + testing::UnitTest::GetInstance()->current_test_info()->name() + ".bin" };
+    ~temp_file() { std::remove(path.c_str()); }
+};
+
+// 64 byte aligned copy of the image
+struct image
+{
+    explicit image(const std::string& s) : buf(new std::uint64_t[s.size() / 8 + 16]), size(s.size())
+    {
+        auto p = reinterpret_cast<std::uintptr_t>(buf.get());
+        data = reinterpret_cast<char*>((p + 63) & ~std::uintptr_t(63));
+        std::memcpy(data, s.data(), s.size());
+    }
+    std::unique_ptr<std::uint64_t[]> buf;
+    char* data;
+    std::size_t size;
+};
+}  // namespace
+
+TEST(MappedMap, Basic)
+{
+    temp_file tmp;
+    std::vector<std::pair<std::uint32_t, double>> src = { { 3, 0.3 }, { 1, 0.1 }, { 2, 0.2 }, { 1, 9.9 }, { 10, 1.0 } };
+    ASSERT_TRUE((write_mapped_map<std::uint32_t, double>(tmp.path, src.begin(), src.end())));
+
+    mapped_map<std::uint32_t, double> m;
+    EXPECT_FALSE(m.is_open());
+    EXPECT_TRUE(m.empty());
+    ASSERT_TRUE(m.open(tmp.path));
+    EXPECT_EQ(m.size(), 4U);
+
+    std::uint32_t expect[] = { 1, 2, 3, 10 };
+    int i{};
+    for(auto e : m) { EXPECT_EQ(e.first, expect[i++]); }
+    EXPECT_EQ(m.at(1), 0.1);  // First of the equivalent keys
+    EXPECT_THROW(m.at(4), std::out_of_range);
+    EXPECT_TRUE(m.contains(10));
+    EXPECT_EQ(m.count(5), 0U);
+    EXPECT_EQ(m.find(4), m.end());
+    EXPECT_EQ(m.find(3)->second, 0.3);
+    EXPECT_EQ(m.lower_bound(4)->first, 10U);
+    EXPECT_EQ(m.upper_bound(10), m.end());
+    auto r = m.equal_range(2);
+    EXPECT_EQ(std::distance(r.first, r.second), 1);
+    EXPECT_EQ(m.rbegin()->first, 10U);
+
+    auto moved = std::move(m);
+    EXPECT_FALSE(m.is_open());
+    EXPECT_EQ(moved.at(2), 0.2);
+    moved.close();
+    EXPECT_FALSE(moved.is_open());
+
+    // Key and value sizes are recorded
+    mapped_map<std::uint64_t, double> other;
+    EXPECT_FALSE(other.open(tmp.path));
+    mapped_map<std::uint32_t, float> other2;
+    EXPECT_FALSE(other2.open(tmp.path));
+    EXPECT_FALSE(m.open(tmp.path + ".none"));
+}
+
+TEST(MappedMap, StringKeys)
+{
+    temp_file tmp;
+    std::map<std::string, std::string> src = { { "apple", "red" },
+                                               { "banana", "" },
+                                               { "", "empty" },
+                                               { "cherry_is_a_long_key", "dark red" },
+                                               { "cherry", "red" },
+                                               { "cherry_is", "?" } };
+    ASSERT_TRUE((write_mapped_map<std::string_view, std::string_view>(tmp.path, src.begin(), src.end())));
+
+    mapped_map<std::string_view, std::string_view> m(tmp.path);
+    ASSERT_TRUE(m.is_open());
+    ASSERT_EQ(m.size(), src.size());
+    auto it = m.begin();
+    for(auto& e : src)
+    {
+        EXPECT_EQ(it->first, e.first);
+        EXPECT_EQ(it->second, e.second);
+        ++it;
+    }
+    for(auto& e : src) { EXPECT_EQ(m.at(e.first), e.second); }
+    EXPECT_FALSE(m.contains("cherry_"));
+    EXPECT_FALSE(m.contains("cherry_is_a_long_key_"));
+    EXPECT_EQ(m.lower_bound("cherry_")->first, "cherry_is");
+    EXPECT_EQ(m.upper_bound("cherry_is_a_long_key"), m.end());
+
+    mapped_map<std::string_view, std::uint32_t> wrong;
+    EXPECT_FALSE(wrong.open(tmp.path));
+}
+
+TEST(MappedMap, Image)
+{
+    std::vector<std::pair<std::string, std::uint16_t>> src;
+    std::mt19937 rng(1);
+    for(int i = 0; i < 2000; ++i) { src.emplace_back("key" + std::to_string(rng()), static_cast<std::uint16_t>(i)); }
+    std::ostringstream os;
+    ASSERT_TRUE((write_mapped_map<std::string_view, std::uint16_t>(os, src.begin(), src.end())));
+    auto bytes = os.str();
+    EXPECT_EQ(bytes.size() % 64, 0U);
+
+    // Position independent: the same bytes work wherever they are
+    image img(bytes);
+    mapped_map<std::string_view, std::uint16_t> m;
+    ASSERT_TRUE(m.open(img.data, img.size));
+    std::map<std::string, std::uint16_t> ref(src.begin(), src.end());
+    EXPECT_EQ(m.size(), ref.size());
+    for(auto& e : ref) { EXPECT_EQ(m.at(e.first), e.second); }
+    EXPECT_TRUE(std::is_sorted(m.begin(), m.end(), [](auto a, auto b) { return a.first < b.first; }));
+
+    EXPECT_FALSE(m.open(img.data, img.size - 64));  // Truncated
+    EXPECT_FALSE(m.open(img.data + 8, img.size));   // Misaligned
+    img.data[0] = 'X';
+    EXPECT_FALSE(m.open(img.data, img.size));  // Magic
+    img.data[0] = bytes[0];
+    img.data[8] = 2;
+    EXPECT_FALSE(m.open(img.data, img.size));  // Version
+}
+
+TEST(MappedMap, CorruptOffsets)
+{
+    using header = goblib::stdmap_detail::mapped_map_header;
+    std::vector<std::pair<std::string, std::string>> src = { { "a", "1" }, { "bb", "22" }, { "ccc", "333" } };
+    std::ostringstream os;
+    ASSERT_TRUE((write_mapped_map<std::string_view, std::string_view>(os, src.begin(), src.end())));
+    const auto bytes = os.str();
+    header h;
+    std::memcpy(&h, bytes.data(), sizeof(h));
+
+    // Offsets that go backwards or past the blob would make views outside the image
+    auto open_with = [&](std::uint64_t section, std::size_t i, std::uint64_t v)
+    {
+        image img(bytes);
+        std::memcpy(img.data + section + i * 8, &v, sizeof(v));
+        mapped_map<std::string_view, std::string_view> m;
+        return m.open(img.data, img.size);
+    };
+    EXPECT_TRUE(open_with(h.key_offsets_offset, 1, 1));  // Unchanged
+    EXPECT_FALSE(open_with(h.key_offsets_offset, 1, 4));
+    EXPECT_FALSE(open_with(h.key_offsets_offset, 2, h.key_blob_size + 1));
+    EXPECT_FALSE(open_with(h.key_offsets_offset, 3, h.key_blob_size - 1));
+    EXPECT_FALSE(open_with(h.values_offset, 0, 2));
+    EXPECT_FALSE(open_with(h.values_offset, 1, ~std::uint64_t{}));
+    EXPECT_TRUE(open_with(h.values_offset, 1, 1));
+}
+
+TEST(MappedMap, Empty)
+{
+    std::vector<std::pair<std::string, int>> src;
+    std::ostringstream os;
+    ASSERT_TRUE((write_mapped_map<std::string_view, int>(os, src.begin(), src.end())));
+    image img(os.str());
+    mapped_map<std::string_view, int> m;
+    ASSERT_TRUE(m.open(img.data, img.size));
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.begin(), m.end());
+    EXPECT_EQ(m.find("a"), m.end());
+}
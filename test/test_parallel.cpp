@@ -0,0 +1,101 @@
+/*
+  Unit testing for parallel algorithms
+*/
+#include <gob_stdmap.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+// Enough elements for several tasks per thread
+constexpr std::size_t count = 200000;
+
+std::vector<std::pair<std::uint32_t, std::uint32_t>> make_source(std::uint32_t seed, std::uint32_t range)
+{
+    std::mt19937 rng(seed);
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> v(count);
+    for(std::uint32_t i = 0; i < count; ++i) { v[i] = { static_cast<std::uint32_t>(rng() % range), i }; }
+    return v;
+}
+
+template <class M>
+std::map<std::uint32_t, std::uint32_t> to_std(const M& m)
+{
+    std::map<std::uint32_t, std::uint32_t> r;
+    for(auto it = m.begin(); it != m.end(); ++it) { r.emplace((*it).first, (*it).second); }
+    return r;
+}
+}  // namespace
+
+TEST(Parallel, Build)
+{
+    auto src = make_source(1, count / 2);
+    goblib::flat_map<std::uint32_t, std::uint32_t> expect(src.begin(), src.end());
+    for(unsigned threads : { 1U, 3U, 8U })
+    {
+        auto m = goblib::parallel_build<goblib::flat_map<std::uint32_t, std::uint32_t>>(src.begin(), src.end(), threads);
+        EXPECT_EQ(m, expect) << threads;
+    }
+    // First of equivalent keys wins
+    auto b = goblib::parallel_build<goblib::btree_map<std::uint32_t, std::uint32_t>>(src.begin(), src.end(), 4);
+    EXPECT_EQ(to_std(b), to_std(expect));
+
+    std::vector<std::pair<std::string, int>> s = { { "b", 1 }, { "a", 2 }, { "b", 3 } };
+    auto sm = goblib::parallel_build<goblib::flat_map<std::string, int>>(s.begin(), s.end(), 4);
+    EXPECT_EQ(sm.size(), 2U);
+    EXPECT_EQ(sm.at("b"), 1);
+    EXPECT_TRUE((goblib::parallel_build<goblib::flat_map<std::string, int>>(s.end(), s.end())).empty());
+}
+
+TEST(Parallel, SetOperations)
+{
+    using map = goblib::flat_map<std::uint32_t, std::uint32_t>;
+    auto sa = make_source(2, count * 2);
+    auto sb = make_source(3, count * 2);
+    map a(sa.begin(), sa.end()), b(sb.begin(), sb.end());
+    auto ra = to_std(a), rb = to_std(b);
+    auto less = [](const auto& x, const auto& y) { return x.first < y.first; };
+
+    std::map<std::uint32_t, std::uint32_t> u, i, d;
+    std::set_union(ra.begin(), ra.end(), rb.begin(), rb.end(), std::inserter(u, u.end()), less);
+    std::set_intersection(ra.begin(), ra.end(), rb.begin(), rb.end(), std::inserter(i, i.end()), less);
+    std::set_difference(ra.begin(), ra.end(), rb.begin(), rb.end(), std::inserter(d, d.end()), less);
+
+    for(unsigned threads : { 1U, 4U })
+    {
+        EXPECT_EQ(to_std(goblib::parallel_union(a, b, threads)), u);
+        EXPECT_EQ(to_std(goblib::parallel_intersection(a, b, threads)), i);
+        EXPECT_EQ(to_std(goblib::parallel_difference(a, b, threads)), d);
+    }
+    // Very different sizes, and an empty side
+    map small = { { 5, 5 }, { count, 0 } };
+    EXPECT_EQ(goblib::parallel_union(small, b, 4).size(), rb.size() + 2 - rb.count(5) - rb.count(count));
+    EXPECT_EQ(goblib::parallel_difference(b, map{}, 4), b);
+    EXPECT_TRUE(goblib::parallel_intersection(map{}, b, 4).empty());
+
+    // Linked (btree) and split (soa) maps
+    goblib::btree_map<std::uint32_t, std::uint32_t> ba(a.begin(), a.end()), bb(b.begin(), b.end());
+    EXPECT_EQ(to_std(goblib::parallel_union(ba, bb, 4)), u);
+    goblib::soa_flat_map<std::uint32_t, std::uint32_t> oa(a.begin(), a.end()), ob(b.begin(), b.end());
+    EXPECT_EQ(to_std(goblib::parallel_intersection(oa, ob, 4)), i);
+}
+
+TEST(Parallel, Merge)
+{
+    auto sa = make_source(4, count);
+    auto sb = make_source(5, count);
+    std::vector<std::pair<std::uint32_t, std::string>> va, vb;
+    for(auto& e : sa) { va.emplace_back(e.first, "a" + std::to_string(e.second)); }
+    for(auto& e : sb) { vb.emplace_back(e.first, "b" + std::to_string(e.second)); }
+    goblib::flat_map<std::uint32_t, std::string> a(va.begin(), va.end()), b(vb.begin(), vb.end());
+    auto expect = a;
+    expect.insert(b.begin(), b.end());
+
+    goblib::parallel_merge(a, std::move(b), 4);
+    EXPECT_EQ(a, expect);
+    EXPECT_TRUE(b.empty());
+}
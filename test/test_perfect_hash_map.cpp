@@ -0,0 +1,121 @@
+/*
+  Unit testing for perfect_hash_map and constexpr_perfect_hash_map
+*/
+#include <gob_stdmap.hpp>
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using goblib::perfect_hash_map;
+
+namespace {
+enum class Field : int { Id, Price, Qty, Side };
+
+constexpr auto field_id = goblib::make_perfect_hash_map<std::string_view, Field>({
+    { "price", Field::Price },
+    { "id", Field::Id },
+    { "side", Field::Side },
+    { "qty", Field::Qty },
+});
+
+constexpr auto country = goblib::make_perfect_hash_map<std::string_view, int>({
+    { "JP", 81 }, { "US", 1 }, { "GB", 44 }, { "FR", 33 }, { "DE", 49 }, { "IT", 39 }, { "ES", 34 }, { "CN", 86 },
+    { "KR", 82 }, { "IN", 91 }, { "BR", 55 }, { "CA", 1 }, { "AU", 61 }, { "MX", 52 }, { "RU", 7 }, { "NL", 31 },
+});
+
+constexpr auto codes = goblib::make_perfect_hash_map<Field, char>({ { Field::Side, 's' }, { Field::Id, 'i' } });
+
+// Evaluated at compile time
+static_assert(field_id.size() == 4, "");
+static_assert(field_id.at("qty") == Field::Qty, "");
+static_assert(field_id.contains("side") && !field_id.contains("sides"), "");
+static_assert(field_id.value_or("venue", Field::Id) == Field::Id, "");
+static_assert(field_id.find("open") == field_id.end(), "");
+static_assert(country.at("BR") == 55 && country.at("NL") == 31, "");
+static_assert(codes.at(Field::Side) == 's' && codes.count(Field::Qty) == 0, "");
+}  // namespace
+
+TEST(PerfectHashMap, Constexpr)
+{
+    std::string_view key = "price";
+    EXPECT_EQ(field_id.at(key), Field::Price);
+    EXPECT_EQ(field_id.at(std::string("id")), Field::Id);
+    EXPECT_THROW(field_id.at("none"), std::out_of_range);
+    // Every element sits in its own slot
+    std::set<std::string_view> seen;
+    for(auto& e : country)
+    {
+        EXPECT_TRUE(seen.insert(e.first).second);
+        EXPECT_EQ(country.find(e.first), &e);
+    }
+    EXPECT_EQ(seen.size(), country.size());
+
+    // Built at run time, duplicate keys throw instead of losing elements
+    EXPECT_THROW((goblib::make_perfect_hash_map<int, char>({ { 1, 'a' }, { 2, 'b' }, { 3, 'c' }, { 1, 'z' } })),
+                 std::invalid_argument);
+}
+
+TEST(PerfectHashMap, Basic)
+{
+    perfect_hash_map<int, std::string> m = { { 3, "three" }, { 1, "one" }, { 2, "two" }, { 1, "uno" } };
+    EXPECT_EQ(m.size(), 3U);
+    EXPECT_EQ(m.at(1), "one");  // First of the duplicates
+    EXPECT_THROW(m.at(4), std::out_of_range);
+    EXPECT_EQ(m.count(2), 1U);
+    EXPECT_FALSE(m.contains(0));
+    EXPECT_EQ(m.find(5), m.end());
+    m.find(3)->second = "san";
+    EXPECT_EQ(m.at(3), "san");
+    auto r = m.equal_range(2);
+    EXPECT_EQ(std::distance(r.first, r.second), 1);
+
+    perfect_hash_map<int, int> empty;
+    EXPECT_TRUE(empty.empty());
+    EXPECT_FALSE(empty.contains(0));
+    perfect_hash_map<int, int> one = { { 7, 1 } };
+    EXPECT_EQ(one.at(7), 1);
+    EXPECT_FALSE(one.contains(8));
+
+    // Distinct keys with the same hash cannot be separated
+    struct bad_hash
+    {
+        std::size_t operator()(int) const { return 0; }
+    };
+    std::vector<std::pair<int, int>> src = { { 1, 1 }, { 2, 2 } };
+    EXPECT_THROW((perfect_hash_map<int, int, bad_hash>(src.begin(), src.end())), std::invalid_argument);
+}
+
+TEST(PerfectHashMap, CompatibleWithUnorderedMap)
+{
+    for(std::size_t n : { 2U, 10U, 1000U, 50000U })
+    {
+        std::mt19937_64 rng(n);
+        std::unordered_map<std::uint64_t, std::uint64_t> ref;
+        while(ref.size() < n) { ref.emplace(rng(), ref.size()); }
+        perfect_hash_map<std::uint64_t, std::uint64_t> m(ref.begin(), ref.end());
+        ASSERT_EQ(m.size(), n);
+        EXPECT_LE(m.bucket_count(), n / 3 + 1);
+        for(auto& e : ref) { ASSERT_EQ(m.at(e.first), e.second); }
+        for(int i = 0; i < 1000; ++i)
+        {
+            auto k = rng();
+            EXPECT_EQ(m.contains(k), ref.count(k) == 1);
+        }
+    }
+}
+
+TEST(PerfectHashMap, Heterogeneous)
+{
+    std::vector<std::pair<std::string, int>> src;
+    for(int i = 0; i < 500; ++i) { src.emplace_back("field" + std::to_string(i), i); }
+    perfect_hash_map<std::string, int, goblib::string_hash, std::equal_to<>> m(src.begin(), src.end());
+    EXPECT_EQ(m.find(std::string_view("field123"))->second, 123);
+    EXPECT_TRUE(m.contains("field499"));
+    EXPECT_EQ(m.count(std::string_view("field500")), 0U);
+}
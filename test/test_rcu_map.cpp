@@ -0,0 +1,94 @@
+/*
+  Unit testing for rcu_map
+*/
+#include <gob_stdmap.hpp>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using goblib::rcu_map;
+
+TEST(RcuMap, Basic)
+{
+    rcu_map<goblib::flat_map<std::string, int>> m({ { "a", 1 } });
+    auto rd = m.make_reader();
+    EXPECT_EQ(m.version(), 0U);
+    {
+        auto s = rd.lock();
+        EXPECT_EQ(s->at("a"), 1);
+
+        // The snapshot keeps seeing its version
+        m.update([](auto& map) { map["b"] = 2; });
+        EXPECT_EQ(s->size(), 1U);
+        EXPECT_EQ(rd.lock()->size(), 2U);  // Nested snapshot sees the new version
+        EXPECT_EQ(m.retired(), 1U);        // Still pinned
+    }
+    m.reclaim();
+    EXPECT_EQ(m.retired(), 0U);
+    EXPECT_EQ(m.version(), 1U);
+    EXPECT_EQ(rd.read([](const auto& map) { return map.at("b"); }), 2);
+}
+
+TEST(RcuMap, Batch)
+{
+    rcu_map<goblib::flat_map<int, int>> m;
+    EXPECT_FALSE(m.publish());
+    for(int i = 0; i < 10; ++i)
+    {
+        m.enqueue([i](auto& map) { map[i] = i * i; });
+    }
+    EXPECT_EQ(m.pending(), 10U);
+    EXPECT_EQ(m.make_reader().lock()->size(), 0U);
+    EXPECT_TRUE(m.publish());
+    EXPECT_EQ(m.pending(), 0U);
+    EXPECT_EQ(m.version(), 1U);  // One version for the whole batch
+
+    auto rd = m.make_reader();
+    EXPECT_EQ(rd.lock()->at(9), 81);
+
+    m.enqueue([](auto& map) { map.erase(0); });
+    m.assign(goblib::flat_map<int, int>{ { 0, 1 }, { 100, 2 } });
+    auto s = rd.lock();
+    EXPECT_EQ(s->size(), 1U);  // Pending erase applied on top of the assigned map
+    EXPECT_EQ(s->at(100), 2);
+}
+
+TEST(RcuMap, ConcurrentReaders)
+{
+    // Every version holds keys 0..N-1 all mapped to the version number
+    constexpr int N = 64;
+    goblib::flat_map<int, int> init;
+    for(int i = 0; i < N; ++i) { init[i] = 0; }
+    rcu_map<goblib::flat_map<int, int>> m(init);
+
+    std::atomic<bool> stop{};
+    std::atomic<int> torn{};
+    std::vector<std::thread> readers;
+    for(int t = 0; t < 4; ++t)
+    {
+        readers.emplace_back([&] {
+            auto rd = m.make_reader();
+            while(!stop.load(std::memory_order_relaxed))
+            {
+                auto s = rd.lock();
+                const int v = s->begin()->second;
+                for(auto& e : *s) { torn += e.second != v; }
+                if(static_cast<int>(s->size()) != N) { ++torn; }
+            }
+        });
+    }
+    for(int ver = 1; ver <= 500; ++ver)
+    {
+        m.update([ver](auto& map) {
+            for(auto& e : map) { e.second = ver; }
+        });
+    }
+    stop = true;
+    for(auto& t : readers) { t.join(); }
+    EXPECT_EQ(torn.load(), 0);
+    m.synchronize();
+    EXPECT_EQ(m.retired(), 0U);
+    EXPECT_EQ(m.make_reader().lock()->at(N - 1), 500);
+}
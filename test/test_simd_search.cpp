@@ -0,0 +1,88 @@
+/*
+  Unit testing for the count search on integer keys
+*/
+#include <gob_stdmap.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <limits>
+#include <cstdint>
+
+namespace {
+enum class Color : std::uint8_t { Red = 1, Green = 100, Blue = 200 };
+
+template <class T>
+void check_type()
+{
+    using namespace goblib::stdmap_detail;
+    static_assert(is_count_searchable<T, std::less<T>>::value, "");
+    std::mt19937_64 rng(sizeof(T) * 31 + std::is_signed<T>::value);
+    for(std::size_t n : { 0, 1, 7, 16, 31, 64, 65, 100, 256, 1000 })
+    {
+        std::vector<T> keys;
+        keys.push_back(std::numeric_limits<T>::min());
+        keys.push_back(std::numeric_limits<T>::max());
+        while(keys.size() < n) { keys.push_back(static_cast<T>(rng())); }
+        keys.resize(n);
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+        std::vector<T> probes(keys);
+        for(int i = 0; i < 64; ++i) { probes.push_back(static_cast<T>(rng())); }
+        probes.push_back(std::numeric_limits<T>::min());
+        probes.push_back(std::numeric_limits<T>::max());
+        for(auto k : probes)
+        {
+            auto lb = static_cast<std::size_t>(std::lower_bound(keys.begin(), keys.end(), k) - keys.begin());
+            auto ub = static_cast<std::size_t>(std::upper_bound(keys.begin(), keys.end(), k) - keys.begin());
+            ASSERT_EQ(lower_bound_index(keys.data(), keys.size(), k, std::less<T>()), lb) << +k << " n:" << keys.size();
+            ASSERT_EQ(upper_bound_index(keys.data(), keys.size(), k, std::less<T>()), ub) << +k << " n:" << keys.size();
+        }
+    }
+}
+}  // namespace
+
+TEST(SimdSearch, IntegerTypes)
+{
+    check_type<std::int8_t>();
+    check_type<std::uint8_t>();
+    check_type<std::int16_t>();
+    check_type<std::uint16_t>();
+    check_type<std::int32_t>();
+    check_type<std::uint32_t>();
+    check_type<std::int64_t>();
+    check_type<std::uint64_t>();
+    check_type<char>();
+}
+
+TEST(SimdSearch, Fallback)
+{
+    using namespace goblib::stdmap_detail;
+    static_assert(!is_count_searchable<int, std::greater<int>>::value, "");
+    static_assert(!is_count_searchable<double, std::less<double>>::value, "");
+    static_assert(!is_count_searchable<bool, std::less<bool>>::value, "");
+    static_assert(is_count_searchable<Color, std::less<Color>>::value, "");
+
+    std::vector<int> keys{ 9, 7, 5, 3, 1 };
+    EXPECT_EQ(lower_bound_index(keys.data(), keys.size(), 5, std::greater<int>()), 2U);
+    EXPECT_EQ(upper_bound_index(keys.data(), keys.size(), 5, std::greater<int>()), 3U);
+}
+
+TEST(SimdSearch, SoaFlatMap)
+{
+    goblib::soa_flat_map<Color, const char*> cm{ { Color::Blue, "blue" }, { Color::Red, "red" }, { Color::Green, "green" } };
+    EXPECT_STREQ(cm.at(Color::Green), "green");
+    EXPECT_EQ(cm.begin()->first, Color::Red);
+    EXPECT_EQ(cm.find(static_cast<Color>(2)), cm.end());
+
+    goblib::soa_flat_map<std::uint32_t, int> m;
+    for(std::uint32_t i = 0; i < 256; ++i) { m[i * 0x01000001U] = static_cast<int>(i); }
+    for(std::uint32_t i = 0; i < 256; ++i)
+    {
+        EXPECT_EQ(m.at(i * 0x01000001U), static_cast<int>(i));
+        EXPECT_FALSE(m.contains(i * 0x01000001U + 1));
+    }
+    EXPECT_EQ(m.lower_bound(0xFFFFFFFFU), m.end());
+    EXPECT_EQ(m.upper_bound(0)->second, 1);
+}
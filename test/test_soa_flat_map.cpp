@@ -0,0 +1,227 @@
+/*
+  Unit testing for soa_flat_map
+*/
+#include <gob_stdmap.hpp>
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+#include <string_view>
+#include <random>
+#include <stdexcept>
+#include <array>
+#include <vector>
+
+using goblib::soa_flat_map;
+
+TEST(SoaFlatMap, Basic)
+{
+    soa_flat_map<int, std::string> m;
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.begin(), m.end());
+
+    EXPECT_TRUE(m.insert({ 3, "three" }).second);
+    EXPECT_FALSE(m.insert({ 3, "san" }).second);
+    m.emplace(1, "one");
+    m.try_emplace(2, 3, 'x');
+    m[0] = "zero";
+    EXPECT_EQ(m.size(), 4U);
+
+    int expect = 0;
+    for(auto e : m) { EXPECT_EQ(e.first, expect++); }
+    EXPECT_EQ(m.find(2)->second, "xxx");
+    EXPECT_EQ((*m.find(3)).second, "three");
+    EXPECT_EQ(m.at(1), "one");
+    EXPECT_THROW(m.at(9), std::out_of_range);
+    EXPECT_EQ(m.find(9), m.end());
+    EXPECT_TRUE(std::is_sorted(m.keys().begin(), m.keys().end()));
+    EXPECT_EQ(m.keys().size(), m.values().size());
+
+    // Modify the mapped value through the proxy
+    m.find(1)->second = "ichi";
+    EXPECT_EQ(m.values()[1], "ichi");
+
+    EXPECT_FALSE(m.insert_or_assign(3, "san").second);
+    EXPECT_EQ(m.at(3), "san");
+    EXPECT_TRUE(m.insert_or_assign(4, "yon").second);
+}
+
+TEST(SoaFlatMap, Iterator)
+{
+    soa_flat_map<int, int> m{ { 1, 10 }, { 2, 20 }, { 3, 30 } };
+    const auto& cm = m;
+    soa_flat_map<int, int>::const_iterator ci = m.begin();
+    EXPECT_EQ(ci, cm.begin());
+    EXPECT_EQ(m.end() - m.begin(), 3);
+    EXPECT_EQ(m.begin()[2].second, 30);
+    EXPECT_EQ(m.rbegin()->first, 3);
+    EXPECT_EQ(std::prev(m.end())->second, 30);
+    EXPECT_EQ(std::distance(cm.rbegin(), cm.rend()), 3);
+
+    auto er = m.equal_range(2);
+    EXPECT_EQ(er.second - er.first, 1);
+    EXPECT_EQ(m.lower_bound(0), m.begin());
+    EXPECT_EQ(m.upper_bound(3), m.end());
+}
+
+TEST(SoaFlatMap, Erase)
+{
+    soa_flat_map<int, int> m;
+    for(int i = 0; i < 10; ++i) { m[i] = i; }
+    EXPECT_EQ(m.erase(5), 1U);
+    EXPECT_EQ(m.erase(5), 0U);
+    auto it = m.erase(m.find(6));
+    EXPECT_EQ(it->first, 7);
+    auto n = goblib::erase_if(m, [](std::pair<const int&, int&> e) { return e.first % 2; });
+    EXPECT_EQ(n, 4U);
+    EXPECT_EQ(m, (soa_flat_map<int, int>{ { 0, 0 }, { 2, 2 }, { 4, 4 }, { 8, 8 } }));
+    m.erase(m.begin(), m.end());
+    EXPECT_TRUE(m.empty());
+}
+
+TEST(SoaFlatMap, LargeValue)
+{
+    struct Big
+    {
+        std::array<char, 128> data{};
+        int id{};
+    };
+    soa_flat_map<uint16_t, Big> m;
+    for(uint16_t i = 0; i < 256; ++i) { m[static_cast<uint16_t>(255 - i)].id = 255 - i; }
+    for(uint16_t i = 0; i < 256; ++i) { EXPECT_EQ(m.at(i).id, i); }
+}
+
+TEST(SoaFlatMap, CompatibleWithStdMap)
+{
+    std::mt19937 rng(321);
+    std::uniform_int_distribution<int> dist(0, 999);
+    std::map<int, int> sm;
+    soa_flat_map<int, int> fm;
+
+    for(int i = 0; i < 5000; ++i)
+    {
+        int k = dist(rng);
+        switch(i % 4)
+        {
+        case 0:
+        case 1: sm[k] = i; fm[k] = i; break;
+        case 2: EXPECT_EQ(sm.erase(k), fm.erase(k)); break;
+        default: EXPECT_EQ(sm.count(k), fm.count(k)); break;
+        }
+    }
+    ASSERT_EQ(sm.size(), fm.size());
+    auto it = fm.begin();
+    for(auto& e : sm)
+    {
+        EXPECT_EQ(e.first, it->first);
+        EXPECT_EQ(e.second, it->second);
+        ++it;
+    }
+}
+
+TEST(SoaFlatMap, BulkInsert)
+{
+    std::vector<std::pair<int, int>> src;
+    for(int i = 0; i < 1000; ++i) { src.emplace_back((i * 7919) % 1000, i); }
+    src.emplace_back(5, -1);
+
+    soa_flat_map<int, int> m(src.begin(), src.end());
+    EXPECT_EQ(m.size(), 1000U);
+    EXPECT_TRUE(std::is_sorted(m.keys().begin(), m.keys().end()));
+    EXPECT_NE(m.at(5), -1);
+
+    std::vector<std::pair<int, int>> more{ { 2000, 1 }, { 5, -2 }, { -3, 3 }, { 2000, 2 } };
+    m.insert_range(std::move(more));
+    EXPECT_EQ(m.size(), 1002U);
+    EXPECT_NE(m.at(5), -2);
+    EXPECT_EQ(m.at(2000), 1);
+    EXPECT_EQ(m.begin()->first, -3);
+    EXPECT_EQ(m.keys().size(), m.values().size());
+
+    m.insert(goblib::sorted_unique, { { 3000, 0 }, { 3001, 1 } });
+    EXPECT_EQ(m.rbegin()->first, 3001);
+
+    soa_flat_map<int, int> adopted(goblib::sorted_unique, { 1, 2, 3 }, { 10, 20, 30 });
+    EXPECT_EQ(adopted.at(2), 20);
+}
+
+TEST(SoaFlatMap, Merge)
+{
+    soa_flat_map<int, std::string> a{ { 1, "a1" }, { 3, "a3" }, { 5, "a5" } };
+    soa_flat_map<int, std::string> b{ { 0, "b0" }, { 3, "b3" }, { 4, "b4" }, { 5, "b5" }, { 9, "b9" } };
+    a.merge(b);
+    EXPECT_EQ(a, (soa_flat_map<int, std::string>{ { 0, "b0" }, { 1, "a1" }, { 3, "a3" }, { 4, "b4" }, { 5, "a5" }, { 9, "b9" } }));
+    EXPECT_EQ(b, (soa_flat_map<int, std::string>{ { 3, "b3" }, { 5, "b5" } }));
+}
+
+namespace {
+// Copy throws once copies_left reaches 0. Move may throw (not noexcept), so moves are avoided where a failure must not lose data
+struct throwing_copy
+{
+    static int copies_left;
+    int v{};
+    explicit throwing_copy(int x) : v(x) {}
+    throwing_copy(const throwing_copy& o) : v(o.v)
+    {
+        if(copies_left-- == 0) { throw std::runtime_error("copy"); }
+    }
+    throwing_copy(throwing_copy&& o) : v(o.v) { o.v = -1; }
+    throwing_copy& operator=(const throwing_copy&) = default;
+    throwing_copy& operator=(throwing_copy&&) = default;
+};
+int throwing_copy::copies_left{ -1 };
+}  // namespace
+
+TEST(SoaFlatMap, GrowthAndAliasing)
+{
+    // Appends grow the arrays geometrically
+    soa_flat_map<int, std::string> m;
+    int reallocations{};
+    for(int i = 0; i < 1000; ++i)
+    {
+        auto p = m.keys().data();
+        m.try_emplace(i, std::to_string(i));
+        reallocations += p != m.keys().data();
+    }
+    EXPECT_LE(reallocations, 12);
+
+    // Arguments referring to an element that moves or is reallocated
+    m.shrink_to_fit();
+    EXPECT_TRUE(m.try_emplace(-1, m.at(500)).second);
+    EXPECT_TRUE(m.insert_or_assign(-2, m.at(999)).second);
+    EXPECT_EQ(m.at(-1), "500");
+    EXPECT_EQ(m.at(-2), "999");
+    EXPECT_EQ(m.at(500), "500");
+
+    // A range insert that fails while merging leaves the existing elements intact
+    soa_flat_map<int, throwing_copy> t;
+    for(int i = 0; i < 10; ++i) { t.try_emplace(i * 2, i); }
+    std::vector<std::pair<int, throwing_copy>> src;
+    for(int i = 0; i < 10; ++i) { src.emplace_back(i * 2 + 1, throwing_copy(100 + i)); }
+    throwing_copy::copies_left = 15;  // 10 for the copy of the range, then the merge fails
+    EXPECT_THROW(t.insert(src.begin(), src.end()), std::runtime_error);
+    throwing_copy::copies_left = -1;
+    ASSERT_EQ(t.size(), 10U);
+    for(int i = 0; i < 10; ++i) { EXPECT_EQ(t.at(i * 2).v, i); }
+}
+
+TEST(SoaFlatMap, Heterogeneous)
+{
+    goblib::soa_flat_map<std::string, int, std::less<>> m = { { "x", 24 }, { "y", 25 }, { "z", 26 } };
+    EXPECT_EQ(m.find(std::string_view("y"))->second, 25);
+    EXPECT_EQ(m.find("w"), m.end());
+    EXPECT_EQ(m.count("z"), 1U);
+    EXPECT_TRUE(m.contains(std::string_view("x")));
+    EXPECT_EQ(m.lower_bound("xa")->first, "y");
+    EXPECT_EQ(m.upper_bound("y")->first, "z");
+    auto r = m.equal_range("z");
+    EXPECT_EQ(std::distance(r.first, r.second), 1);
+    EXPECT_EQ(m.erase("x"), 1U);
+    EXPECT_EQ(m.erase(m.begin())->first, "z");
+
+    // Integer keys with a heterogeneous probe type fall back to std::lower_bound
+    goblib::soa_flat_map<std::int64_t, int, std::less<>> n;
+    for(int i = 0; i < 200; ++i) { n.emplace(i * 3, i); }
+    EXPECT_EQ(n.find(30)->second, 10);
+    EXPECT_EQ(n.lower_bound(31)->first, 33);
+    EXPECT_EQ(n.find(30L)->second, 10);
+}
@@ -0,0 +1,221 @@
+/*
+  Unit testing for static_flat_map
+*/
+#include <gob_stdmap.hpp>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+
+using goblib::static_flat_map;
+
+// Count global allocations to verify static_flat_map never allocates. Atomic, since other tests in this executable
+// allocate from their own threads
+namespace {
+std::atomic<std::size_t> new_count{};
+}
+void* operator new(std::size_t sz)
+{
+    new_count.fetch_add(1, std::memory_order_relaxed);
+    if(void* p = std::malloc(sz ? sz : 1)) { return p; }
+    throw std::bad_alloc();
+}
+// The nothrow forms too (std::stable_sort's buffer), so that every allocation pairs with the free below
+void* operator new(std::size_t sz, const std::nothrow_t&) noexcept
+{
+    new_count.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(sz ? sz : 1);
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+TEST(StaticFlatMap, NoAllocation)
+{
+    auto before = new_count.load(std::memory_order_relaxed);
+    {
+        static_flat_map<int, int, 64> m;
+        for(int i = 63; i >= 0; --i) { m[i] = i * 10; }
+        EXPECT_TRUE(m.full());
+        m.erase(10);
+        m.try_emplace(100, 1);
+        auto copy = m;
+        EXPECT_EQ(copy, m);
+    }
+    EXPECT_EQ(new_count.load(std::memory_order_relaxed), before);
+}
+
+TEST(StaticFlatMap, Basic)
+{
+    static_flat_map<int, std::string, 8> m{ { 3, "three" }, { 1, "one" } };
+    EXPECT_EQ(m.size(), 2U);
+    EXPECT_EQ(m.capacity(), 8U);
+    EXPECT_EQ(m.begin()->first, 1);
+    EXPECT_EQ(m.at(3), "three");
+    EXPECT_THROW(m.at(5), std::out_of_range);
+    EXPECT_FALSE(m.insert({ 3, "san" }).second);
+    m.emplace(2, "two");
+    EXPECT_EQ(m.find(2)->second, "two");
+    EXPECT_FALSE(m.insert_or_assign(2, "ni").second);
+    EXPECT_EQ(m[2], "ni");
+    EXPECT_EQ(m.lower_bound(0), m.begin());
+    EXPECT_EQ(m.upper_bound(3), m.end());
+    EXPECT_EQ(m.erase(1), 1U);
+    EXPECT_EQ(m.begin()->first, 2);
+
+    auto n = goblib::erase_if(m, [](const std::pair<int, std::string>& e) { return e.first == 3; });
+    EXPECT_EQ(n, 1U);
+    EXPECT_EQ(m.size(), 1U);
+}
+
+TEST(StaticFlatMap, Overflow)
+{
+    static_flat_map<int, int, 4> m;
+    for(int i = 0; i < 4; ++i) { EXPECT_TRUE(m.try_emplace(i, i).second); }
+    EXPECT_TRUE(m.full());
+
+    // Existing key succeeds, new key reports overflow
+    auto r = m.insert({ 2, 0 });
+    EXPECT_FALSE(r.second);
+    EXPECT_EQ(r.first->first, 2);
+    r = m.insert({ 9, 9 });
+    EXPECT_FALSE(r.second);
+    EXPECT_EQ(r.first, m.end());
+    EXPECT_EQ(m.insert_or_assign(9, 9).first, m.end());
+    EXPECT_EQ(m.emplace(-1, 0).first, m.end());
+    EXPECT_EQ(m[3], 3);
+    EXPECT_THROW(m[9], std::length_error);
+    EXPECT_EQ(m.size(), 4U);
+
+    static_flat_map<int, int, 2> s{ { 1, 1 }, { 2, 2 }, { 3, 3 } };  // Over capacity are ignored
+    EXPECT_EQ(s.size(), 2U);
+    EXPECT_FALSE(s.contains(3));
+}
+
+TEST(StaticFlatMap, CopyMove)
+{
+    static_flat_map<int, std::string, 4> a{ { 1, "a" }, { 2, "b" } };
+    static_flat_map<int, std::string, 4> b = a;
+    EXPECT_EQ(a, b);
+    static_flat_map<int, std::string, 4> c = std::move(b);
+    EXPECT_TRUE(b.empty());
+    EXPECT_EQ(c, a);
+    b = { { 9, "z" } };
+    swap(b, c);
+    EXPECT_EQ(b, a);
+    EXPECT_EQ(c.begin()->second, "z");
+    EXPECT_LT(a, c);
+}
+
+namespace {
+// Counts live objects and moves; copying throws once copies_left reaches 0
+struct tracked
+{
+    static int live, moves, copies_left;
+    int v{};
+    explicit tracked(int x) : v(x) { ++live; }
+    tracked(const tracked& o) : v(o.v)
+    {
+        if(copies_left-- == 0) { throw std::runtime_error("copy"); }
+        ++live;
+    }
+    tracked(tracked&& o) noexcept : v(o.v)
+    {
+        ++live;
+        ++moves;
+    }
+    tracked& operator=(tracked&& o) noexcept
+    {
+        v = o.v;
+        ++moves;
+        return *this;
+    }
+    tracked& operator=(const tracked&) = default;
+    ~tracked() { --live; }
+};
+int tracked::live{};
+int tracked::moves{};
+int tracked::copies_left{ -1 };
+}  // namespace
+
+TEST(StaticFlatMap, ConstructionInPlace)
+{
+    {
+        static_flat_map<int, tracked, 8> a;
+        for(int i = 0; i < 5; ++i) { a.try_emplace(i * 10, i); }
+        // A throwing copy destroys the elements copied so far
+        tracked::copies_left = 3;
+        EXPECT_THROW((static_flat_map<int, tracked, 8>(a)), std::runtime_error);
+        tracked::copies_left = -1;
+        EXPECT_EQ(tracked::live, 5);
+
+        // Only the elements after the position move, the new one is built in the slot
+        tracked::moves = 0;
+        EXPECT_TRUE(a.try_emplace(15, 100).second);
+        EXPECT_EQ(tracked::moves, 3);
+        EXPECT_EQ(a.at(15).v, 100);
+        // Arguments referring to an element that moves are still read correctly
+        EXPECT_TRUE(a.try_emplace(5, a.at(40)).second);
+        EXPECT_EQ(a.at(5).v, 4);
+        EXPECT_EQ(a.at(40).v, 4);
+        EXPECT_EQ(tracked::live, 7);
+    }
+    EXPECT_EQ(tracked::live, 0);
+
+    static_flat_map<int, std::string, 4> s{ { 1, "one" }, { 3, std::string(40, 'x') } };
+    EXPECT_TRUE(s.try_emplace(2, s.at(3)).second);
+    EXPECT_TRUE(s.insert_or_assign(0, s.at(1)).second);
+    EXPECT_EQ(s.at(2), std::string(40, 'x'));
+    EXPECT_EQ(s.at(0), "one");
+}
+
+TEST(StaticFlatMap, CompatibleWithStdMap)
+{
+    std::mt19937 rng(555);
+    std::uniform_int_distribution<int> dist(0, 199);
+    std::map<int, std::string> sm;
+    static_flat_map<int, std::string, 200> fm;
+
+    for(int i = 0; i < 5000; ++i)
+    {
+        int k = dist(rng);
+        switch(i % 4)
+        {
+        case 0:
+        case 1: sm[k] = std::to_string(i); fm[k] = std::to_string(i); break;
+        case 2: EXPECT_EQ(sm.erase(k), fm.erase(k)); break;
+        default: EXPECT_EQ(sm.count(k), fm.count(k)); break;
+        }
+    }
+    ASSERT_EQ(sm.size(), fm.size());
+    auto it = fm.begin();
+    for(auto& e : sm)
+    {
+        EXPECT_EQ(e.first, it->first);
+        EXPECT_EQ(e.second, it->second);
+        ++it;
+    }
+}
+
+TEST(StaticFlatMap, Heterogeneous)
+{
+    // Longer than SSO, so a temporary std::string would allocate
+    static_flat_map<std::string, int, 4, std::less<>> m{ { "a_key_longer_than_small_string_buffer_1", 1 },
+                                                         { "a_key_longer_than_small_string_buffer_2", 2 } };
+    const char* k2 = "a_key_longer_than_small_string_buffer_2";
+    auto before = new_count.load(std::memory_order_relaxed);
+    EXPECT_EQ(m.find(k2)->second, 2);
+    EXPECT_EQ(m.count(std::string_view(k2)), 1U);
+    EXPECT_FALSE(m.contains("a_key_longer_than_small_string_buffer_3"));
+    EXPECT_EQ(m.lower_bound("a_key_longer_than_small_string_buffer_15")->second, 2);
+    EXPECT_EQ(m.upper_bound(k2), m.end());
+    EXPECT_EQ(m.equal_range(k2).first->second, 2);
+    EXPECT_EQ(m.erase(k2), 1U);
+    EXPECT_EQ(new_count.load(std::memory_order_relaxed), before);
+    EXPECT_EQ(m.size(), 1U);
+}
@@ -0,0 +1,213 @@
+/*
+  Unit testing for string_flat_map
+*/
+#include <gob_stdmap.hpp>
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+#include <string_view>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using goblib::string_flat_map;
+
+TEST(StringFlatMap, Basic)
+{
+    string_flat_map<int> m;
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.begin(), m.end());
+
+    EXPECT_TRUE(m.insert({ "banana", 2 }).second);
+    EXPECT_FALSE(m.insert({ "banana", 20 }).second);
+    m.emplace("apple", 1);
+    m.try_emplace(std::string("cherry_is_a_long_key"), 3);
+    m["date"] = 4;
+    EXPECT_EQ(m.size(), 4U);
+
+    const char* expect[] = { "apple", "banana", "cherry_is_a_long_key", "date" };
+    int i{};
+    for(auto e : m) { EXPECT_EQ(e.first, expect[i++]); }
+    EXPECT_EQ(m.at("banana"), 2);
+    EXPECT_EQ(m.find(std::string_view("cherry_is_a_long_key"))->second, 3);
+    EXPECT_THROW(m.at("fig"), std::out_of_range);
+    EXPECT_EQ(m.find("cherry"), m.end());
+    EXPECT_EQ(m.lower_bound("c")->first, "cherry_is_a_long_key");
+    EXPECT_EQ(m.upper_bound("cherry_is_a_long_key")->first, "date");
+    auto r = m.equal_range("apple");
+    EXPECT_EQ(std::distance(r.first, r.second), 1);
+
+    m.find("apple")->second = 10;
+    EXPECT_EQ(m.values()[0], 10);
+    EXPECT_FALSE(m.insert_or_assign("date", 40).second);
+    EXPECT_EQ(m.at("date"), 40);
+    EXPECT_TRUE(m.insert_or_assign("elderberry", 5).second);
+
+    EXPECT_EQ(m.erase("banana"), 1U);
+    EXPECT_EQ(m.erase("banana"), 0U);
+    EXPECT_EQ(m.erase(m.begin())->first, "cherry_is_a_long_key");
+    EXPECT_EQ(m.size(), 3U);
+}
+
+TEST(StringFlatMap, KeyStorage)
+{
+    string_flat_map<int> m;
+    // Up to 12 chars are inline, longer keys go to the pool
+    m["123456789012"] = 1;
+    EXPECT_EQ(m.pool_size(), 0U);
+    m["1234567890123"] = 2;
+    EXPECT_EQ(m.pool_size(), 13U);
+
+    // Shared prefixes and embedded NUL are ordered as std::string
+    std::vector<std::string> keys = { "", "a", std::string("a\0", 2), std::string("a\0b", 3), "ab", "abcdefgh", "abcdefgh0",
+                                      "abcdefghijklmnopq", "abcdefghijklmnopr", "abcdefgi", "\xff", "\xff\xff" };
+    string_flat_map<int> s;
+    for(std::size_t i = keys.size(); i-- > 0;) { s[keys[i]] = static_cast<int>(i); }
+    ASSERT_EQ(s.size(), keys.size());
+    int i{};
+    for(auto e : s)
+    {
+        EXPECT_EQ(e.first, keys[i]);
+        EXPECT_EQ(e.second, i);
+        ++i;
+    }
+    for(std::size_t k = 0; k < keys.size(); ++k) { EXPECT_EQ(s.at(keys[k]), static_cast<int>(k)); }
+    EXPECT_FALSE(s.contains("abcdefghijklmnop"));
+    EXPECT_EQ(s.lower_bound("abcdefghijklmnop")->first, "abcdefghijklmnopq");
+
+    // An empty view may have a null data()
+    string_flat_map<int> e;
+    e.try_emplace(std::string_view{}, 7);
+    EXPECT_EQ(e.at(std::string_view{}), 7);
+    EXPECT_EQ(e.at(""), 7);
+}
+
+namespace {
+// Copy throws once copies_left reaches 0. Move is not noexcept
+struct throwing_copy
+{
+    static int copies, copies_left;
+    int v{};
+    explicit throwing_copy(int x) : v(x) {}
+    throwing_copy(const throwing_copy& o) : v(o.v)
+    {
+        if(copies_left-- == 0) { throw std::runtime_error("copy"); }
+        ++copies;
+    }
+    throwing_copy(throwing_copy&& o) : v(o.v) { o.v = -1; }
+    throwing_copy& operator=(const throwing_copy&) = default;
+    throwing_copy& operator=(throwing_copy&&) = default;
+};
+int throwing_copy::copies{};
+int throwing_copy::copies_left{ -1 };
+}  // namespace
+
+TEST(StringFlatMap, GrowthAndAliasing)
+{
+    // Appends grow the arrays geometrically
+    string_flat_map<std::string> m;
+    const std::string prefix = "a_pooled_key_";
+    int reallocations{};
+    for(int i = 0; i < 1000; ++i)
+    {
+        auto p = m.values().data();
+        m.try_emplace(prefix + std::to_string(1000 + i), std::to_string(i));
+        reallocations += p != m.values().data();
+    }
+    EXPECT_LE(reallocations, 12);
+
+    // Keys and arguments referring into the values, the inline entries and the pool
+    m.shrink_to_fit();
+    EXPECT_TRUE(m.try_emplace("b", m.at(prefix + "1500")).second);
+    EXPECT_EQ(m.at("b"), "500");
+    m.try_emplace("inline", "x");
+    std::string_view inl = m.find("inline")->first;
+    EXPECT_TRUE(m.try_emplace(inl.substr(0, 2), inl).second);
+    std::string_view pooled = m.find(prefix + "1999")->first;
+    EXPECT_TRUE(m.try_emplace(pooled.substr(0, 8), pooled).second);
+    EXPECT_EQ(m.at("in"), "inline");
+    EXPECT_EQ(m.at("a_pooled"), prefix + "1999");
+    EXPECT_EQ(m.at(prefix + "1500"), "500");
+
+    // A range insert that fails while merging leaves the existing elements intact
+    string_flat_map<throwing_copy> t;
+    for(int i = 0; i < 10; ++i) { t.try_emplace(std::to_string(i * 2 + 10), i); }
+    std::vector<std::pair<std::string, throwing_copy>> src;
+    for(int i = 0; i < 10; ++i) { src.emplace_back(std::to_string(i * 2 + 11), throwing_copy(100 + i)); }
+    auto dry = t;
+    throwing_copy::copies = 0;
+    dry.insert(src.begin(), src.end());
+    throwing_copy::copies_left = throwing_copy::copies - 5;  // Fails in the merge, after staging the range
+    EXPECT_THROW(t.insert(src.begin(), src.end()), std::runtime_error);
+    throwing_copy::copies_left = -1;
+    ASSERT_EQ(t.size(), 10U);
+    for(int i = 0; i < 10; ++i) { EXPECT_EQ(t.at(std::to_string(i * 2 + 10)).v, i); }
+}
+
+TEST(StringFlatMap, Compaction)
+{
+    string_flat_map<int> m;
+    for(int i = 0; i < 1000; ++i) { m["a_long_key_to_be_pooled_" + std::to_string(i)] = i; }
+    auto full = m.pool_size();
+    // Erasing most keys compacts the pool
+    auto n = goblib::erase_if(m, [](std::pair<std::string_view, int&> e) { return e.second % 10 != 0; });
+    EXPECT_EQ(n, 900U);
+    EXPECT_LT(m.pool_size(), full / 2);
+    for(int i = 0; i < 1000; i += 10) { EXPECT_EQ(m.at("a_long_key_to_be_pooled_" + std::to_string(i)), i); }
+
+    m.erase(m.begin());
+    m.shrink_to_fit();
+    std::size_t total{};
+    for(auto e : m) { total += e.first.size(); }
+    EXPECT_EQ(m.pool_size(), total);
+}
+
+TEST(StringFlatMap, BulkInsert)
+{
+    std::vector<std::pair<std::string, int>> src = { { "delta_long_key_name", 4 }, { "alpha", 1 }, { "charlie", 3 },
+                                                     { "alpha", 100 }, { "bravo_long_key_name", 2 } };
+    string_flat_map<int> m(src.begin(), src.end());
+    ASSERT_EQ(m.size(), 4U);
+    EXPECT_EQ(m.at("alpha"), 1);  // First one wins
+    EXPECT_EQ(m.begin()[1].first, "bravo_long_key_name");
+
+    // Existing elements win over new ones
+    m.insert({ { "charlie", 30 }, { "echo", 5 } });
+    EXPECT_EQ(m.at("charlie"), 3);
+    EXPECT_EQ(m.at("echo"), 5);
+    EXPECT_TRUE(std::is_sorted(m.begin(), m.end(), [](auto a, auto b) { return a.first < b.first; }));
+
+    auto copy = m;
+    EXPECT_EQ(copy, m);
+    copy["foxtrot"] = 6;
+    EXPECT_NE(copy, m);
+}
+
+TEST(StringFlatMap, CompatibleWithStdMap)
+{
+    std::mt19937 rng(2024);
+    std::uniform_int_distribution<int> dist(0, 1999);
+    std::map<std::string, int> sm;
+    string_flat_map<int> fm;
+
+    auto key = [](int k) { return (k % 3 ? "k" : "a_key_longer_than_inline_") + std::to_string(k); };
+    for(int i = 0; i < 20000; ++i)
+    {
+        auto k = key(dist(rng));
+        switch(i % 4)
+        {
+        case 0:
+        case 1: sm[k] = i; fm[k] = i; break;
+        case 2: EXPECT_EQ(sm.erase(k), fm.erase(k)); break;
+        default: EXPECT_EQ(sm.count(k), fm.count(k)); break;
+        }
+    }
+    ASSERT_EQ(sm.size(), fm.size());
+    auto it = fm.begin();
+    for(auto& e : sm)
+    {
+        EXPECT_EQ(e.first, it->first);
+        EXPECT_EQ(e.second, it->second);
+        ++it;
+    }
+}